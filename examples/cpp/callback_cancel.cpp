@@ -1,29 +1,35 @@
 /// @example cancel_callback.cpp
-/// Cancel callback of primes by throwing a
-/// primesieve::cancel_callback() exception. Note that multi-threaded
-/// callback can currently not be cancelled this way.
+/// Stop sieving from within a callback using PrimeSieve::stop(),
+/// sieving stops after the current segment has been processed.
+/// This also works with ParallelPrimeSieve (all threads stop).
+/// Throwing a primesieve::cancel_callback() exception is still
+/// supported but slower and single-threaded only.
 
 #include <primesieve.hpp>
 #include <stdint.h>
 #include <iostream>
 
-int i = 0;
-
-void callback(uint64_t prime)
+class StopAfter : public primesieve::Callback<uint64_t>
 {
-  if (++i == 1000000)
+public:
+  StopAfter(primesieve::PrimeSieve& ps) : ps_(ps), i_(0) { }
+  void callback(uint64_t prime)
   {
-    std::cout << "10^6th prime = " << prime << std::endl;
-    throw primesieve::cancel_callback();
+    if (++i_ == 1000000)
+    {
+      std::cout << "10^6th prime = " << prime << std::endl;
+      ps_.stop();
+    }
   }
-}
+private:
+  primesieve::PrimeSieve& ps_;
+  int i_;
+};
 
 int main()
 {
-  try
-  {
-    primesieve::callback_primes(0, 1000000000, callback);
-  }
-  catch (primesieve::cancel_callback&) { }
+  primesieve::PrimeSieve ps;
+  StopAfter stopAfter(ps);
+  ps.callbackPrimes(0, 1000000000, &stopAfter);
   return 0;
 }
@@ -0,0 +1,27 @@
+/// @example callback_primes_batch.cpp
+/// Objects derived from primesieve::BatchCallback receive the
+/// primes in batches instead of one virtual call per prime.
+
+#include <primesieve.hpp>
+#include <stdint.h>
+#include <cstddef>
+#include <iostream>
+
+struct SumPrimes : primesieve::BatchCallback
+{
+  SumPrimes() : sum(0) { }
+  void callback(const uint64_t* primes, std::size_t count, int)
+  {
+    for (std::size_t i = 0; i < count; i++)
+      sum += primes[i];
+  }
+  uint64_t sum;
+};
+
+int main()
+{
+  SumPrimes sumPrimes;
+  primesieve::callback_primes(2, 1000000000, &sumPrimes);
+  std::cout << "Sum of the primes below 10^9 = " << sumPrimes.sum << std::endl;
+  return 0;
+}
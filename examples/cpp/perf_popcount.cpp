@@ -0,0 +1,72 @@
+/// @example perf_popcount.cpp
+/// Micro-benchmark of the popcount implementations used for
+/// counting primes, prints the cost of counting the 1 bits of
+/// one sieve segment (default sieve size) for each
+/// implementation supported by the CPU.
+/// @note Uses the internal <primesieve/popcount.hpp> header.
+
+#include <primesieve.hpp>
+#include <primesieve/popcount.hpp>
+#include <stdint.h>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+int main()
+{
+  using namespace primesieve;
+
+  int sieveSize = get_sieve_size();
+  uint64_t words = static_cast<uint64_t>(sieveSize) * 1024 / 8;
+  std::vector<uint64_t> segment(static_cast<std::size_t>(words));
+
+  // xorshift64, about 50% of the bits are set
+  uint64_t x = 88172645463325252ull;
+  for (std::size_t i = 0; i < segment.size(); i++)
+  {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    segment[i] = x;
+  }
+
+  uint64_t iters = (uint64_t(1) << 33) / (words * 64) + 1;
+
+  std::cout << "Sieve size: " << sieveSize << " KB" << std::endl;
+  std::cout << "Selected:   " << getPopcountName(getPopcount()) << std::endl;
+
+  for (int i = 0; i < POPCOUNT_ALGORITHMS; i++)
+  {
+    std::cout << std::left << std::setw(12) << getPopcountName(i);
+
+    if (!hasPopcount(i))
+    {
+      std::cout << "not supported" << std::endl;
+      continue;
+    }
+
+    uint64_t sum = 0;
+    std::clock_t t1 = std::clock();
+    for (uint64_t j = 0; j < iters; j++)
+    {
+      // prevent hoisting the popcount out of the loop
+      segment[j % words] ^= 1;
+      sum += popcount(&segment[0], words, i);
+    }
+    std::clock_t t2 = std::clock();
+
+    double seconds = static_cast<double>(t2 - t1) / CLOCKS_PER_SEC;
+    double usPerSegment = seconds * 1e6 / static_cast<double>(iters);
+    double gbPerSecond = static_cast<double>(words * 8) * static_cast<double>(iters) / seconds / 1e9;
+    bool ok = (sum > 0) &&
+              (popcount(&segment[0], words, i) == popcount(&segment[0], words, POPCOUNT_DEFAULT));
+
+    std::cout << std::fixed << std::setprecision(2)
+              << std::right << std::setw(10) << usPerSegment << " us/segment"
+              << std::setw(10) << gbPerSecond << " GB/s"
+              << (ok ? "" : "   ERROR: wrong result") << std::endl;
+  }
+
+  return 0;
+}
@@ -64,6 +64,18 @@ enum {
   UINT64_PRIMES
 };
 
+/** Multi-threading backends of the primesieve_parallel_*
+ *  functions.
+ */
+enum {
+  /** OpenMP if available, else THREAD_POOL_BACKEND. */
+  DEFAULT_BACKEND,
+  /** Multi-threading using OpenMP. */
+  OPENMP_BACKEND,
+  /** Pool of C++11 std::threads with work-stealing. */
+  THREAD_POOL_BACKEND
+};
+
 /** Get an array with the primes inside the interval [start, stop].
  *  @param size  The size of the returned primes array.
  *  @param type  The type of the primes to generate, e.g. INT_PRIMES.
@@ -71,6 +83,15 @@ enum {
  */
 void* primesieve_generate_primes(uint64_t start, uint64_t stop, size_t* size, int type);
 
+/** Get an array with the primes inside the interval [start, stop]
+ *  using multiple threads. By default all CPU cores are used, use
+ *  primesieve_set_num_threads(int) to change the number of threads.
+ *  @param size  The size of the returned primes array.
+ *  @param type  The type of the primes to generate, e.g. INT_PRIMES.
+ *  @pre stop <= 2^64 - 2^32 * 10.
+ */
+void* primesieve_parallel_generate_primes(uint64_t start, uint64_t stop, size_t* size, int type);
+
 /** Get an array with the first n primes >= start.
  *  @param type  The type of the primes to generate, e.g. INT_PRIMES.
  *  @pre stop <= 2^64 - 2^32 * 10.
@@ -95,7 +116,16 @@ uint64_t primesieve_nth_prime(int64_t n, uint64_t start);
  */
 uint64_t primesieve_parallel_nth_prime(int64_t n, uint64_t start);
 
+/** Count the primes <= x using the combinatorial
+ *  Lagarias-Miller-Odlyzko algorithm which is much faster than
+ *  sieving for large x, it uses O(x^(2/3)) operations.
+ *  @pre x <= 2^64 - 2^32 * 10.
+ */
+uint64_t primesieve_pi(uint64_t x);
+
 /** Count the primes within the interval [start, stop].
+ *  If start is small and stop is large the primes are
+ *  counted using primesieve_pi(x).
  *  @pre stop <= 2^64 - 2^32 * 10.
  */
 uint64_t primesieve_count_primes(uint64_t start, uint64_t stop);
@@ -219,7 +249,31 @@ void primesieve_callback_primes(uint64_t start, uint64_t stop, void (*callback)(
  */
 void primesieve_parallel_callback_primes(uint64_t start, uint64_t stop, void (*callback)(uint64_t prime, int thread_id));
 
-/** Get the current set sieve size in kilobytes. */
+/** Call back the primes within the interval [start, stop] in
+ *  batches of up to 1024 primes (in arithmetic order), this avoids
+ *  the overhead of one function call per prime.
+ *  @param callback  A callback function, thread_id is always 0.
+ *  @pre   stop      <= 2^64 - 2^32 * 10.
+ */
+void primesieve_callback_primes_batch(uint64_t start, uint64_t stop, void (*callback)(const uint64_t* primes, size_t count, int thread_id));
+
+/** Call back the primes within the interval [start, stop] in
+ *  batches of up to 1024 primes. This function is not synchronized,
+ *  multiple threads call back batches in parallel. By default all
+ *  CPU cores are used, use primesieve_set_num_threads(int) to change
+ *  the number of threads.
+ *  @warning         Batches are not called back in arithmetic order.
+ *  @param callback  A callback function.
+ *  @pre   stop      <= 2^64 - 2^32 * 10.
+ */
+void primesieve_parallel_callback_primes_batch(uint64_t start, uint64_t stop, void (*callback)(const uint64_t* primes, size_t count, int thread_id));
+
+/** Get the current set sieve size in kilobytes.
+ *  @note By default the default sieve size (the tuned sieve
+ *        size or else half the L2 cache size) is returned, the
+ *        sieve size is then chosen for each sieved range (see
+ *        primesieve_set_sieve_size()).
+ */
 int primesieve_get_sieve_size();
 
 /** Get the current set number of threads.
@@ -227,18 +281,23 @@ int primesieve_get_sieve_size();
  */
 int primesieve_get_num_threads();
 
+/** Get the current set multi-threading backend.
+ *  @note By default DEFAULT_BACKEND is returned.
+ */
+int primesieve_get_thread_backend();
+
 /** Returns the largest valid stop number for primesieve.
  *  @return (2^64-1) - (2^32-1) * 10.
  */
 uint64_t primesieve_get_max_stop();
 
 /** Set the sieve size in kilobytes.
- *  The best sieving performance is achieved with a sieve size of
- *  your CPU's L1 data cache size (per core). For sieving >= 10^17 a
- *  sieve size of your CPU's L2 cache size sometimes performs
- *  better.
- *  @param sieve_size Sieve size in kilobytes.
- *  @pre   sieve_size >= 1 && <= 2048.
+ *  The best sieving performance is achieved with a sieve size
+ *  that fits into your CPU's L2 cache (per core), by default (0)
+ *  the tuned sieve size (see primesieve --tune) or else half the
+ *  L2 cache size (detected at runtime) is used.
+ *  @param sieve_size Sieve size in kilobytes or 0 (automatic).
+ *  @pre   sieve_size == 0 || (sieve_size >= 1 && <= 2048).
  */
 void primesieve_set_sieve_size(int sieve_size);
 
@@ -250,12 +309,53 @@ void primesieve_set_sieve_size(int sieve_size);
  */
 void primesieve_set_num_threads(int num_threads);
 
+/** Set the multi-threading backend for use in subsequent
+ *  primesieve_parallel_* function calls. If primesieve has not
+ *  been compiled with support for the backend the default
+ *  backend is used.
+ *  @param backend  DEFAULT_BACKEND, OPENMP_BACKEND or
+ *                  THREAD_POOL_BACKEND.
+ */
+void primesieve_set_thread_backend(int backend);
+
 /** Deallocate a primes array created using the
- *  primesieve_generate_primes() or primesieve_generate_n_primes()
- *  functions.
+ *  primesieve_generate_primes(), primesieve_parallel_generate_primes()
+ *  or primesieve_generate_n_primes() functions.
  */
 void primesieve_free(void* primes);
 
+/** Free the memory that the calling thread keeps cached for reuse
+ *  by subsequent small queries (sieve array, buckets, lookup
+ *  tables), at most a few megabytes. The cache is also freed when
+ *  the thread exits.
+ */
+void primesieve_clear_cache();
+
+/** Load a pi(x) index file created using primesieve_build_pi_index().
+ *  Subsequent primesieve_count_primes() and primesieve_nth_prime()
+ *  calls only sieve the pieces between the interval bounds and the
+ *  nearest pi(x) checkpoints.
+ *  @return 1 if success, 0 if error (errno is set to EDOM).
+ */
+int primesieve_load_pi_index(const char* filename);
+
+/** Unload the currently loaded pi(x) index. */
+void primesieve_unload_pi_index();
+
+/** Create a pi(x) index file which stores pi(k * 2^32) for
+ *  k * 2^32 <= stop. By default all CPU cores are used, use
+ *  primesieve_set_num_threads(int) to change the number of threads.
+ *  @return 1 if success, 0 if error (errno is set to EDOM).
+ *  @pre stop <= 2^64 - 2^32 * 10.
+ */
+int primesieve_build_pi_index(const char* filename, uint64_t stop);
+
+/** Check the currently loaded pi(x) index against known values
+ *  of pi(x) and the primesieve_test() values.
+ *  @return 1 if success, 0 if error.
+ */
+int primesieve_check_pi_index();
+
 /** Run extensive correctness tests.
  *  The tests last about one minute on a quad core CPU from
  *  2013 and use up to 1 gigabyte of memory.
@@ -24,9 +24,11 @@
 #include <primesieve/cancel_callback.hpp>
 #include <primesieve/iterator.hpp>
 #include <primesieve/PushBackPrimes.hpp>
+#include <primesieve/PrimeFile.hpp>
 #include <primesieve/primesieve_error.hpp>
 
 #include <stdint.h>
+#include <cstddef>
 #include <vector>
 #include <string>
 
@@ -37,7 +39,21 @@ namespace primesieve
 {
   enum {
     /// Use all CPU cores for prime sieving.
-    MAX_THREADS = -1
+    MAX_THREADS = -1,
+    /// Use the tuned sieve size (see primesieve::tune()) or
+    /// else half the CPU's L2 cache size.
+    AUTO_SIEVE_SIZE = 0
+  };
+
+  /// Multi-threading backends of the primesieve::parallel_*
+  /// functions, see ParallelPrimeSieve.hpp.
+  enum {
+    /// OpenMP if available, else THREAD_POOL_BACKEND.
+    DEFAULT_BACKEND = ParallelPrimeSieve::DEFAULT_BACKEND,
+    /// Multi-threading using OpenMP.
+    OPENMP_BACKEND = ParallelPrimeSieve::OPENMP_BACKEND,
+    /// Pool of C++11 std::threads with work-stealing.
+    THREAD_POOL_BACKEND = ParallelPrimeSieve::THREAD_POOL_BACKEND
   };
 
   /// Store the primes <= stop in the primes vector.
@@ -110,7 +126,16 @@ namespace primesieve
   ///
   uint64_t parallel_nth_prime(int64_t n, uint64_t start = 0);
 
+  /// Count the primes <= x using the combinatorial
+  /// Lagarias-Miller-Odlyzko algorithm which is much faster than
+  /// sieving for large x, it uses O(x^(2/3)) operations.
+  /// @pre x <= 2^64 - 2^32 * 10.
+  ///
+  uint64_t pi(uint64_t x);
+
   /// Count the primes within the interval [start, stop].
+  /// If start is small and stop is large the primes are
+  /// counted using primesieve::pi(x).
   /// @pre stop <= 2^64 - 2^32 * 10.
   ///
   uint64_t count_primes(uint64_t start, uint64_t stop);
@@ -224,6 +249,15 @@ namespace primesieve
   ///
   void print_sextuplets(uint64_t start, uint64_t stop);
 
+  /// Store the primes within the interval [start, stop] in a
+  /// binary prime file, use primesieve::PrimeFile to read it.
+  /// @param format  BITMAP_FORMAT stores the sieve array (30
+  ///                numbers per byte), DELTA_FORMAT stores the
+  ///                prime gaps as varints.
+  /// @pre stop <= 2^64 - 2^32 * 10.
+  ///
+  void store_primes(uint64_t start, uint64_t stop, const std::string& filename, int format = BITMAP_FORMAT);
+
   /// Call back the primes within the interval [start, stop].
   /// @param callback  A callback function.
   /// @pre   stop <= 2^64 - 2^32 * 10.
@@ -236,6 +270,22 @@ namespace primesieve
   ///
   void callback_primes(uint64_t start, uint64_t stop, primesieve::Callback<uint64_t>* callback);
 
+  /// Call back the primes within the interval [start, stop] in
+  /// batches of up to 1024 primes (in arithmetic order), this avoids
+  /// the overhead of one function call per prime.
+  /// @param callback  A callback function, thread_id is always 0.
+  /// @pre   stop      <= 2^64 - 2^32 * 10.
+  ///
+  void callback_primes(uint64_t start, uint64_t stop, void (*callback)(const uint64_t* primes, std::size_t count, int thread_id));
+
+  /// Call back the primes within the interval [start, stop] in
+  /// batches of up to 1024 primes (in arithmetic order), this avoids
+  /// the overhead of one virtual function call per prime.
+  /// @param callback  An object derived from primesieve::BatchCallback.
+  /// @pre   stop      <= 2^64 - 2^32 * 10.
+  ///
+  void callback_primes(uint64_t start, uint64_t stop, primesieve::BatchCallback* callback);
+
   /// Call back the primes within the interval [start, stop].
   /// This function is synchronized, only one thread at a time calls
   /// back primes. By default all CPU cores are used, use
@@ -280,7 +330,58 @@ namespace primesieve
   ///
   void parallel_callback_primes(uint64_t start, uint64_t stop, primesieve::Callback<uint64_t, int>* callback);
 
+  /// Call back the primes within the interval [start, stop] in
+  /// batches of up to 1024 primes. This function is not
+  /// synchronized, multiple threads call back batches in parallel.
+  /// By default all CPU cores are used, use
+  /// primesieve::set_num_threads(int) to change the number of
+  /// threads.
+  /// @warning         Batches are not called back in arithmetic order.
+  /// @param callback  A callback function.
+  /// @pre   stop      <= 2^64 - 2^32 * 10.
+  ///
+  void parallel_callback_primes(uint64_t start, uint64_t stop, void (*callback)(const uint64_t* primes, std::size_t count, int thread_id));
+
+  /// Call back the primes within the interval [start, stop] in
+  /// batches of up to 1024 primes. This function is not
+  /// synchronized, multiple threads call back batches in parallel.
+  /// By default all CPU cores are used, use
+  /// primesieve::set_num_threads(int) to change the number of
+  /// threads.
+  /// @warning         Batches are not called back in arithmetic order.
+  /// @param callback  An object derived from primesieve::BatchCallback.
+  /// @pre   stop      <= 2^64 - 2^32 * 10.
+  ///
+  void parallel_callback_primes(uint64_t start, uint64_t stop, primesieve::BatchCallback* callback);
+
+  /// Call back the sieve array (bitmap) of each segment of the
+  /// interval [start, stop] without decoding the primes, the
+  /// segments are passed in arithmetic order.
+  /// @param callback  An object derived from primesieve::SegmentCallback,
+  ///                  thread_num is always 0.
+  /// @pre   stop      <= 2^64 - 2^32 * 10.
+  ///
+  void callback_segments(uint64_t start, uint64_t stop, primesieve::SegmentCallback* callback);
+
+  /// Call back the sieve array (bitmap) of each segment of the
+  /// interval [start, stop] without decoding the primes. This
+  /// function is not synchronized, multiple threads call back
+  /// segments in parallel. By default all CPU cores are used, use
+  /// primesieve::set_num_threads(int) to change the number of
+  /// threads.
+  /// @warning         Segments are not called back in arithmetic order.
+  /// @param callback  An object derived from primesieve::SegmentCallback.
+  /// @pre   stop      <= 2^64 - 2^32 * 10.
+  ///
+  void parallel_callback_segments(uint64_t start, uint64_t stop, primesieve::SegmentCallback* callback);
+
   /// Get the current set sieve size in kilobytes.
+  /// @note By default the default sieve size (the tuned sieve
+  ///       size or else half the L2 cache size) is returned,
+  ///       the sieve size is then chosen for each sieved range.
+  ///       Use PrimeSieve::getSieveSize() to get the sieve
+  ///       size that is used for a specific range.
+  ///
   int get_sieve_size();
 
   /// Get the current set number of threads.
@@ -288,18 +389,24 @@ namespace primesieve
   ///
   int get_num_threads();
 
+  /// Get the current set multi-threading backend.
+  /// @note By default DEFAULT_BACKEND is returned.
+  ///
+  int get_thread_backend();
+
   /// Returns the largest valid stop number for primesieve.
   /// @return (2^64-1) - (2^32-1) * 10.
   ///
   uint64_t get_max_stop();
 
   /// Set the sieve size in kilobytes.
-  /// The best sieving performance is achieved with a sieve size of
-  /// your CPU's L1 data cache size (per core). For sieving >= 10^17 a
-  /// sieve size of your CPU's L2 cache size sometimes performs
-  /// better.
-  /// @param sieve_size Sieve size in kilobytes.
-  /// @pre   sieve_size >= 1 && sieve_size <= 2048.
+  /// The best sieving performance is achieved with a sieve size
+  /// that fits into your CPU's L2 cache (per core), by default
+  /// (AUTO_SIEVE_SIZE) the tuned sieve size for the sieved range
+  /// or else half the L2 cache size (detected at runtime) is used.
+  /// @param sieve_size Sieve size in kilobytes or AUTO_SIEVE_SIZE.
+  /// @pre   sieve_size == AUTO_SIEVE_SIZE ||
+  ///        (sieve_size >= 1 && sieve_size <= 2048).
   ///
   void set_sieve_size(int sieve_size);
 
@@ -311,6 +418,92 @@ namespace primesieve
   ///
   void set_num_threads(int num_threads);
 
+  /// Set the multi-threading backend for use in subsequent
+  /// primesieve::parallel_* function calls. If primesieve has
+  /// not been compiled with support for the backend the default
+  /// backend is used.
+  /// @param backend  DEFAULT_BACKEND, OPENMP_BACKEND or
+  ///                 THREAD_POOL_BACKEND.
+  ///
+  void set_thread_backend(int backend);
+
+  /// Free the memory that the calling thread keeps cached for
+  /// reuse by subsequent small queries (sieve array, buckets,
+  /// lookup tables), at most a few megabytes. The cache is
+  /// also freed when the thread exits.
+  ///
+  void clear_cache();
+
+  /// Store the primes within the interval [start, stop] in the
+  /// primes vector using multiple threads. By default all CPU
+  /// cores are used, use primesieve::set_num_threads(int) to
+  /// change the number of threads. The primes are stored in
+  /// ascending order.
+  /// @pre stop <= 2^64 - 2^32 * 10.
+  ///
+  template <typename T>
+  inline void parallel_generate_primes(uint64_t start, uint64_t stop, std::vector<T>* primes)
+  {
+    if (primes)
+    {
+      ParallelPrimeSieve pps;
+      pps.setNumThreads(get_num_threads());
+      pps.setBackend(get_thread_backend());
+      ParallelPushBackPrimes<T> pb(*primes);
+      pb.pushBackPrimes(start, stop, pps);
+    }
+  }
+
+  /// Store the primes <= stop in the primes vector using
+  /// multiple threads. By default all CPU cores are used, use
+  /// primesieve::set_num_threads(int) to change the number of
+  /// threads. The primes are stored in ascending order.
+  /// @pre stop <= 2^64 - 2^32 * 10.
+  ///
+  template <typename T>
+  inline void parallel_generate_primes(uint64_t stop, std::vector<T>* primes)
+  {
+    parallel_generate_primes(0, stop, primes);
+  }
+
+  /// Load a pi(x) index file created using
+  /// primesieve::build_pi_index(). Subsequent count_primes() and
+  /// nth_prime() calls only sieve the pieces between the interval
+  /// bounds and the nearest pi(x) checkpoints.
+  /// @warning Not thread-safe, must not be called while other
+  ///          threads count primes.
+  ///
+  void load_pi_index(const std::string& filename);
+
+  /// Unload the currently loaded pi(x) index.
+  void unload_pi_index();
+
+  /// Create a pi(x) index file which stores pi(k * 2^32) for
+  /// k * 2^32 <= stop. By default all CPU cores are used, use
+  /// primesieve::set_num_threads(int) to change the number of
+  /// threads.
+  /// @pre stop <= 2^64 - 2^32 * 10.
+  ///
+  void build_pi_index(const std::string& filename, uint64_t stop);
+
+  /// Check the currently loaded pi(x) index against known
+  /// values of pi(x) and the primesieve_test() values.
+  /// @return true if success else false.
+  ///
+  bool check_pi_index();
+
+  /// Benchmark sieve sizes (16 to 2048 kilobytes), bucket sizes
+  /// and the EratSmall, EratMedium factors for ranges near 10^8,
+  /// 10^10, ..., 10^18 on the current machine (single-threaded)
+  /// and use the fastest settings from now on when the sieve size
+  /// is AUTO_SIEVE_SIZE. Each range runs up to 20 configurations
+  /// twice. The settings are saved to the tuning profile file
+  /// ($PRIMESIEVE_TUNING_FILE or by default ~/.primesieve_tuning)
+  /// which is loaded at startup.
+  /// Tuning takes about 5 to 10 minutes.
+  ///
+  void tune();
+
   /// Run extensive correctness tests.
   /// The tests last about one minute on a quad core CPU from
   /// 2013 and use up to 1 gigabyte of memory.
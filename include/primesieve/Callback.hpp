@@ -2,7 +2,7 @@
 /// @file   Callback.hpp
 /// @brief  Callback interface classes.
 ///
-/// Copyright (C) 2013 Kim Walisch, <kim.walisch@gmail.com>
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
 ///
 /// This file is distributed under the BSD License. See the COPYING
 /// file in the top level directory.
@@ -12,6 +12,7 @@
 #define CALLBACK_PRIMESIEVE_HPP
 
 #include <stdint.h>
+#include <cstddef>
 
 namespace primesieve {
 
@@ -42,6 +43,56 @@ public:
   virtual ~Callback() { }
 };
 
+/// Batch callback interface class. Objects derived from this class
+/// can be passed to the primesieve::callback_primes() and
+/// primesieve::parallel_callback_primes() functions. Instead of one
+/// virtual call per prime the primes are passed in batches (in
+/// ascending order) of up to PrimeSieve::getBatchSize() primes,
+/// batches never span multiple sieve segments.
+///
+class BatchCallback
+{
+public:
+  virtual void callback(const uint64_t* primes, std::size_t count, int thread_num) = 0;
+  virtual ~BatchCallback() { }
+};
+
+/// Segment callback interface class. Objects derived from this class
+/// can be passed to the primesieve::callback_segments() and
+/// primesieve::parallel_callback_segments() functions. Each sieved
+/// segment is passed as is (read-only, without copying) instead of
+/// decoding its primes. Byte i of the sieve array corresponds to the
+/// numbers [low + i * 30, low + i * 30 + 30[, its 8 bits (LSB first)
+/// correspond to low + i * 30 + { 7, 11, 13, 17, 19, 23, 29, 31 }, a
+/// set bit is a prime. Bits outside [start, stop] are 0 and the last
+/// segment is zero padded to a multiple of 8 bytes. The primes 2, 3
+/// and 5 are not part of the bitmap.
+///
+class SegmentCallback
+{
+public:
+  virtual void callback(const uint8_t* sieve, std::size_t bytes, uint64_t low, int thread_num) = 0;
+  virtual ~SegmentCallback() { }
+};
+
+/// Array interface class used by ParallelPrimeSieve::storePrimes()
+/// and primesieve::parallel_generate_primes(). The threads store
+/// the primes of their chunks into disjoint slices of the array.
+///
+class PrimeArray
+{
+public:
+  /// Resize the array to size primes, the existing primes must be
+  /// kept. The last call sets the final size.
+  ///
+  virtual void resize(std::size_t size) = 0;
+  /// Store primes[0, count[ at array[index, index + count[,
+  /// called concurrently for disjoint slices.
+  ///
+  virtual void store(const uint64_t* primes, std::size_t count, std::size_t index) = 0;
+  virtual ~PrimeArray() { }
+};
+
 } // namespace primesieve
 
 #endif
@@ -0,0 +1,62 @@
+///
+/// @file   CpuInfo.hpp
+/// @brief  Runtime detection of the CPU's cache sizes and number of
+///         cores. The detected values are used as defaults for the
+///         sieve size and the EratSmall, EratMedium and
+///         primesieve::iterator cache limits.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef CPUINFO_HPP
+#define CPUINFO_HPP
+
+#include "config.hpp"
+#include <stdint.h>
+
+namespace primesieve {
+
+/// CpuInfo detects the CPU's L1 data, L2 and L3 cache sizes and
+/// the number of CPU cores and threads using the operating system
+/// (sysfs on Linux, sysctl on Mac OS X, GetLogicalProcessorInformation
+/// on Windows). Cache sizes that cannot be detected this way are
+/// queried using CPUID on x86 CPUs.
+///
+class CpuInfo
+{
+public:
+  CpuInfo();
+  bool hasL1dCache() const { return l1dCacheSize_ > 0; }
+  bool hasL2Cache() const { return l2CacheSize_ > 0; }
+  bool hasL3Cache() const { return l3CacheSize_ > 0; }
+  /// Cache sizes in bytes, 0 if unknown
+  uint64_t l1dCacheSize() const { return l1dCacheSize_; }
+  uint64_t l2CacheSize() const { return l2CacheSize_; }
+  uint64_t l3CacheSize() const { return l3CacheSize_; }
+  uint64_t l3CacheSizePerThread() const { return l3CacheSize_ / l3Sharing_; }
+  /// Number of physical CPU cores
+  int cpuCores() const { return cpuCores_; }
+  /// Number of logical CPU cores (hardware threads)
+  int cpuThreads() const { return cpuThreads_; }
+private:
+  uint64_t l1dCacheSize_;
+  uint64_t l2CacheSize_;
+  uint64_t l3CacheSize_;
+  /// Number of threads sharing the L3 cache
+  int l3Sharing_;
+  int cpuCores_;
+  int cpuThreads_;
+  void init();
+  void initCpuid();
+  void check();
+};
+
+/// CpuInfo is initialized at first use.
+const CpuInfo& cpuInfo();
+
+} // namespace primesieve
+
+#endif
@@ -14,35 +14,30 @@
 #include "WheelFactorization.hpp"
 
 #include <stdint.h>
-#include <vector>
 
 namespace primesieve {
 
+class SieveContext;
+
 /// EratBig is an implementation of the segmented sieve of
 /// Eratosthenes optimized for big sieving primes that have very few
-/// multiples per segment.
+/// multiples per segment. The sieving primes are stored in buckets
+/// of a derived class which is instantiated for each preset bucket
+/// size, see create().
 ///
 class EratBig: public Modulo210Wheel_t {
 public:
-  EratBig(uint64_t, uint_t, uint_t);
-  ~EratBig();
-  void crossOff(byte_t*);
+  static EratBig* create(uint64_t, uint_t, uint_t, uint_t, uint_t, bool, SieveContext* = NULL);
+  virtual ~EratBig() { }
+  virtual void crossOff(byte_t*) = 0;
+  virtual uint64_t getBucketAllocs() const = 0;
+  /// Bytes of the bucket allocations backed by huge pages
+  virtual uint64_t getHugePageBytes() const = 0;
+protected:
+  EratBig(uint64_t stop, uint_t sieveSize) :
+    Modulo210Wheel_t(stop, sieveSize)
+  { }
 private:
-  const uint_t limit_;
-  /// log2 of SieveOfEratosthenes::sieveSize_
-  const uint_t log2SieveSize_;
-  const uint_t moduloSieveSize_;
-  /// Vector of bucket lists, holds the sieving primes
-  std::vector<Bucket*> lists_;
-  /// List of empty buckets
-  Bucket* stock_;
-  /// Pointers of the allocated buckets
-  std::vector<Bucket*> pointers_;
-  void init(uint_t);
-  static void moveBucket(Bucket&, Bucket*&);
-  void pushBucket(uint_t);
-  void storeSievingPrime(uint_t, uint_t, uint_t);
-  void crossOff(byte_t*, SievingPrime*, SievingPrime*);
   DISALLOW_COPY_AND_ASSIGN(EratBig);
 };
 
@@ -14,26 +14,26 @@
 #include "WheelFactorization.hpp"
 
 #include <stdint.h>
-#include <list>
 
 namespace primesieve {
 
 /// EratMedium is an implementation of the segmented sieve of
 /// Eratosthenes optimized for medium sieving primes that have a few
-/// multiples per segment.
+/// multiples per segment. The sieving primes are stored in buckets
+/// of a derived class which is instantiated for each preset bucket
+/// size, see create().
 ///
 class EratMedium : public Modulo210Wheel_t {
 public:
-  EratMedium(uint64_t, uint_t, uint_t);
+  static EratMedium* create(uint64_t, uint_t, uint_t, uint_t);
+  virtual ~EratMedium() { }
   uint_t getLimit() const { return limit_; }
-  void crossOff(byte_t*, uint_t);
+  virtual void crossOff(byte_t*, uint_t) = 0;
+protected:
+  EratMedium(uint64_t, uint_t, uint_t);
+  static void crossOff(byte_t*, uint_t, SievingPrime*, SievingPrime*);
 private:
-  typedef std::list<Bucket>::iterator BucketIterator_t;
   const uint_t limit_;
-  /// List of buckets, holds the sieving primes
-  std::list<Bucket> buckets_;
-  void storeSievingPrime(uint_t, uint_t, uint_t);
-  static void crossOff(byte_t*, uint_t, Bucket&);
   DISALLOW_COPY_AND_ASSIGN(EratMedium);
 };
 
@@ -0,0 +1,46 @@
+///
+/// @file   EratSettings.hpp
+/// @brief  Runtime settings of the EratSmall, EratMedium and
+///         EratBig classes, see PrimeSieve::setBucketSize().
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef ERATSETTINGS_HPP
+#define ERATSETTINGS_HPP
+
+#include "config.hpp"
+
+namespace primesieve {
+
+struct EratSettings
+{
+  /// Number of sieving primes per Bucket, a power of 2
+  /// >= config::MIN_BUCKETSIZE && <= config::MAX_BUCKETSIZE
+  uint_t bucketSize;
+  /// Size in bytes of EratBig's bucket allocations
+  uint_t bytesPerAlloc;
+  /// Sieving primes <= blockSize * factorEratSmall are
+  /// processed by EratSmall, see config.hpp
+  double factorEratSmall;
+  /// Sieving primes <= blockSize * factorEratMedium are
+  /// processed by EratMedium, see config.hpp
+  double factorEratMedium;
+  /// Allocate EratBig's buckets and the sieve array
+  /// using huge pages if possible, see HugePages.hpp
+  bool hugePages;
+  EratSettings() :
+    bucketSize(config::BUCKETSIZE),
+    bytesPerAlloc(config::BYTES_PER_ALLOC),
+    factorEratSmall(config::FACTOR_ERATSMALL),
+    factorEratMedium(config::FACTOR_ERATMEDIUM),
+    hugePages(true)
+  { }
+};
+
+} // namespace primesieve
+
+#endif
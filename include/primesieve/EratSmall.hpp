@@ -14,26 +14,73 @@
 #include "WheelFactorization.hpp"
 
 #include <stdint.h>
-#include <list>
+#include <vector>
 
 namespace primesieve {
 
+/// A PatternPrime is a tiny sieving prime whose multiples are
+/// crossed off using a precomputed byte pattern. The pattern of a
+/// prime p repeats every p bytes of the sieve array.
+///
+struct PatternPrime
+{
+  uint_t prime;
+  /// Pattern size in bytes, a multiple of prime
+  uint_t period;
+  /// Offset of the prime's pattern within EratSmall::patterns_
+  uint_t pattern;
+  /// Pattern index that corresponds to the current sieve byte
+  uint_t index;
+  /// Sieve byte of the first multiple, used only in
+  /// the segment in which the prime has been added
+  uint_t start;
+};
+
 /// EratSmall is an implementation of the segmented sieve of
 /// Eratosthenes optimized for small sieving primes that have many
-/// multiples per segment.
+/// multiples per segment. The sieving primes are stored in buckets
+/// of a derived class which is instantiated for each preset bucket
+/// size, see create().
 ///
 class EratSmall : public Modulo30Wheel_t {
 public:
-  EratSmall(uint64_t, uint_t, uint_t);
+  /// Tiny sieving primes cross-off code, PATTERNS_SCALAR
+  /// uses the buckets like all other sieving primes
+  enum
+  {
+    PATTERNS_SCALAR,
+    PATTERNS_AVX2,
+    PATTERNS_AVX512,
+    PATTERN_KERNELS
+  };
+  static EratSmall* create(uint64_t, uint_t, uint_t, uint_t);
+  static bool hasPatternKernel(int);
+  static int getPatternKernel();
+  static void setPatternKernel(int);
+  virtual ~EratSmall() { }
   uint_t getLimit() const { return limit_; }
   void crossOff(byte_t*, byte_t*);
+protected:
+  EratSmall(uint64_t, uint_t, uint_t);
+  bool isPatternPrime(uint_t prime) const { return prime < patternLimit_; }
+  void storePatternPrime(uint_t, uint_t, uint_t);
+  virtual void crossOffBuckets(byte_t*, byte_t*) = 0;
+  static void crossOff(byte_t*, byte_t*, SievingPrime*, SievingPrime*);
 private:
-  typedef std::list<Bucket>::iterator BucketIterator_t;
+  typedef void (*PatternKernel_t)(byte_t*, uint_t, PatternPrime*, PatternPrime*, const byte_t*);
   const uint_t limit_;
-  /// List of buckets, holds the sieving primes
-  std::list<Bucket> buckets_;
-  void storeSievingPrime(uint_t, uint_t, uint_t);
-  static void crossOff(byte_t*, byte_t*, Bucket&);
+  /// Sieving primes < patternLimit_ are crossed off
+  /// using patterns_ (0 if no SIMD kernel available)
+  uint_t patternLimit_;
+  /// SIMD kernel selected at runtime using CPUID
+  PatternKernel_t patternKernel_;
+  std::vector<PatternPrime> patternPrimes_;
+  std::vector<PatternPrime> newPatternPrimes_;
+  /// Buffer of crossOffPatterns(), a member to
+  /// avoid allocating memory for each block
+  std::vector<PatternPrime> pendingPatternPrimes_;
+  std::vector<byte_t> patterns_;
+  void crossOffPatterns(byte_t*, uint_t);
   DISALLOW_COPY_AND_ASSIGN(EratSmall);
 };
 
@@ -0,0 +1,54 @@
+///
+/// @file   HugePages.hpp
+/// @brief  Allocate memory backed by 2 megabyte huge pages (if
+///         possible) to reduce TLB misses, used for EratBig's
+///         buckets and the sieve array.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef HUGEPAGES_HPP
+#define HUGEPAGES_HPP
+
+#include <cstddef>
+
+namespace primesieve {
+
+enum
+{
+  /// Huge pages are only used for allocations >= HUGE_PAGE_SIZE,
+  /// the allocation size is then rounded up to a multiple of
+  /// HUGE_PAGE_SIZE.
+  HUGE_PAGE_SIZE = 1 << 21
+};
+
+/// Page types returned by allocatePages()
+enum
+{
+  NORMAL_PAGES,
+  /// madvise(MADV_HUGEPAGE), the kernel may still use normal
+  /// pages if it runs out of free huge pages
+  TRANSPARENT_HUGE_PAGES,
+  /// mmap(MAP_HUGETLB), requires reserved huge pages
+  /// (/proc/sys/vm/nr_hugepages)
+  EXPLICIT_HUGE_PAGES
+};
+
+/// Allocate size bytes of memory. If hugePages is true and size >=
+/// HUGE_PAGE_SIZE explicit huge pages are tried first, then
+/// transparent huge pages, else (e.g. not Linux) the memory is
+/// allocated using operator new.
+/// @param pageType  Set to the page type that has been obtained.
+/// @throw std::bad_alloc
+///
+void* allocatePages(std::size_t size, bool hugePages, int* pageType);
+
+/// Free memory allocated using allocatePages()
+void freePages(void* ptr, std::size_t size, int pageType);
+
+} // namespace primesieve
+
+#endif
@@ -3,7 +3,7 @@
 /// @brief  The ParallelPrimeSieve class provides an easy API for
 ///         multi-threaded prime sieving.
 ///
-/// Copyright (C) 2014 Kim Walisch, <kim.walisch@gmail.com>
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
 ///
 /// This file is distributed under the BSD License. See the COPYING
 /// file in the top level directory.
@@ -21,9 +21,30 @@ namespace primesieve {
 /// derived from PrimeSieve so it has the same API.
 /// Please refer to doc/EXAMPLES for more information.
 ///
+/// Multi-threading is implemented using either OpenMP or a pool
+/// of C++11 std::threads with work-stealing (THREAD_POOL_BACKEND).
+/// By default OpenMP is used if primesieve has been compiled with
+/// OpenMP support, else the thread pool (if the compiler supports
+/// C++11) and if neither is available ParallelPrimeSieve is
+/// single-threaded.
+///
+/// Primes are printed in ascending order (also when using multiple
+/// threads), use setOrdered(true) to get the same behavior for
+/// callbacks. Ordered mode requires the thread pool, each thread
+/// buffers the primes of its chunk (at most
+/// config::ORDERED_BUFFER_SIZE bytes) until all previous chunks
+/// have been processed.
+///
 class ParallelPrimeSieve : public PrimeSieve
 {
 public:
+  /// Multi-threading backends
+  enum
+  {
+    DEFAULT_BACKEND,
+    OPENMP_BACKEND,
+    THREAD_POOL_BACKEND
+  };
   /// Used for inter-process communication with the
   /// primesieve GUI application.
   struct SharedMemory
@@ -41,24 +62,45 @@ public:
   virtual ~ParallelPrimeSieve() { }
   void init(SharedMemory&);
   static int getMaxThreads();
+  static bool hasBackend(int);
   int getNumThreads() const;
+  int getBackend() const;
+  bool isOrdered() const;
   void setNumThreads(int numThreads);
+  void setBackend(int);
+  void setOrdered(bool);
   using PrimeSieve::sieve;
   virtual void sieve();
+  virtual void stop();
+  void storePrimes(uint64_t, uint64_t, PrimeArray*);
 private:
   enum { IDEAL_NUM_THREADS = -1 };
   void* lock_;
   SharedMemory* shm_;
   int numThreads_;
+  int backend_;
+  /// Callback primes in ascending order
+  bool ordered_;
+  /// Ordered mode: the oldest unfinished chunk
+  void* order_;
+  static int defaultBackend();
   bool tooMany(int) const;
   int idealNumThreads() const;
   uint64_t getThreadInterval(int) const;
   uint64_t align(uint64_t) const;
+  void sieveOpenMP(int, uint64_t);
+  void sieveThreadPool(int, uint64_t);
+  void sieveOrdered(int);
+  void storeOpenMP(int, uint64_t, PrimeArray*);
+  void storeThreadPool(int, uint64_t, PrimeArray*);
+  uint64_t storeChunk(uint64_t, uint64_t, int, PrimeArray*, uint64_t);
+  void finishTurn(uint64_t);
+  void sievingPrimesStats(double, int);
   template <typename T> T getLock() { return static_cast<T>(lock_); }
-  virtual double getWallTime() const;
   virtual void setLock();
   virtual void unsetLock();
   virtual bool updateStatus(uint64_t, bool);
+  virtual void waitTurn(uint64_t);
 };
 
 } // namespace primesieve
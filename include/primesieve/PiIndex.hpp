@@ -0,0 +1,86 @@
+///
+/// @file   PiIndex.hpp
+/// @brief  On-disk index of the prime-counting function pi(x) at
+///         fixed checkpoints, used by PrimeSieve::countPrimes()
+///         and PrimeSieve::nthPrime() to sieve only the pieces
+///         between the nearest checkpoints and [start, stop].
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef PIINDEX_HPP
+#define PIINDEX_HPP
+
+#include "config.hpp"
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace primesieve {
+
+class PrimeSieve;
+
+/// The index file stores pi(k * step) for k = 0 ... checkpoints - 1
+/// with step = 2^log2Step. File format version 1, all integers
+/// are stored in little-endian byte order:
+///
+/// offset  size  content
+///      0     8  magic "PSPIIDX\0"
+///      8     4  version (1)
+///     12     4  log2Step
+///     16     8  checkpoints
+///     24     8  checksum (FNV-1a of the pi(x) values)
+///     32   8*n  pi(0), pi(step), pi(2 * step), ...
+///
+/// The file is memory-mapped on POSIX systems, on other
+/// systems it is read into memory.
+///
+class PiIndex {
+public:
+  enum { FILE_VERSION = 1, DEFAULT_LOG2_STEP = 32 };
+  /// The currently loaded index or NULL
+  static const PiIndex* get();
+  /// Load the index file, replaces the current index.
+  /// @warning Not thread-safe, must not be called
+  ///          while other threads count primes.
+  static void load(const std::string& filename);
+  static void unload();
+  static void build(const std::string& filename,
+                    uint64_t stop,
+                    int log2Step,
+                    int threads,
+                    int backend);
+  ~PiIndex();
+  uint64_t getStep() const { return step_; }
+  uint64_t getCheckpoints() const { return checkpoints_; }
+  /// Largest checkpoint
+  uint64_t getLimit() const { return (checkpoints_ - 1) * step_; }
+  /// @return pi(k * step)
+  uint64_t getPi(uint64_t k) const;
+  uint64_t getDistance(uint64_t x) const;
+  bool isFaster(uint64_t start, uint64_t stop) const;
+  uint64_t pi(PrimeSieve& ps, uint64_t x) const;
+  uint64_t countPrimes(PrimeSieve& ps, uint64_t start, uint64_t stop) const;
+  bool check(int threads, int backend) const;
+private:
+  PiIndex();
+  void open(const std::string& filename);
+  uint64_t step_;
+  uint64_t checkpoints_;
+  const byte_t* pi_;
+  /// mmap'ed file
+  void* map_;
+  std::size_t mapSize_;
+  /// Used if mmap is not available
+  std::vector<byte_t> buffer_;
+  DISALLOW_COPY_AND_ASSIGN(PiIndex);
+};
+
+} // namespace primesieve
+
+#endif
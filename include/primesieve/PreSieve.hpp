@@ -1,7 +1,7 @@
 ///
 /// @file  PreSieve.hpp
 ///
-/// Copyright (C) 2013 Kim Walisch, <kim.walisch@gmail.com>
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
 ///
 /// This file is distributed under the BSD License. See the COPYING
 /// file in the top level directory.
@@ -12,6 +12,7 @@
 
 #include "config.hpp"
 #include <stdint.h>
+#include <vector>
 
 namespace primesieve {
 
@@ -19,37 +20,42 @@ namespace primesieve {
 ///         of Eratosthenes.
 ///
 /// PreSieve objects are used to pre-sieve multiples of small primes
-/// e.g. <= 19 to speed up SieveOfEratosthenes. The idea is to
-/// allocate an array (preSieved_) and remove the multiples of small
-/// primes from it at initialization. Then whilst sieving, the
-/// preSieved_ array is copied to the SieveOfEratosthenes array at the
-/// beginning of each new segment to pre-sieve the multiples of small
-/// primes <= limit_. Pre-sieving speeds up my sieve of Eratosthenes
-/// implementation by about 20 percent when sieving < 10^10.
+/// e.g. <= 89 to speed up SieveOfEratosthenes. The small primes are
+/// split into groups e.g. {7, 11, 13, 17}, {19, 23, 29}, {31, 37},
+/// ... and for each group a buffer is allocated in which the
+/// multiples of the group's primes are removed at initialization.
+/// The sieve pattern of a group repeats every product(group) bytes.
+/// Then whilst sieving, the first buffer is copied to the
+/// SieveOfEratosthenes array at the beginning of each new segment
+/// and the other buffers are combined with the sieve array using
+/// bitwise AND (vectorized if AVX2 is available) to pre-sieve the
+/// multiples of small primes <= limit_.
 ///
 /// <b> Memory Usage </b>
 ///
-/// - PreSieve objects use: primeProduct(limit_) / 30 bytes of memory
-/// - PreSieve multiples of primes <= 11 uses   77    bytes
-/// - PreSieve multiples of primes <= 13 uses 1001    bytes
-/// - PreSieve multiples of primes <= 17 uses   16.62 kilobytes
-/// - PreSieve multiples of primes <= 19 uses  315.75 kilobytes
-/// - PreSieve multiples of primes <= 23 uses    7.09 megabytes
+/// Each buffer uses product(group) bytes of memory and groups are
+/// chosen so that each buffer is <= MAX_BUFFER_SIZE (32 kilobytes).
+///
+/// - PreSieve multiples of primes <= 13 uses  1001 bytes
+/// - PreSieve multiples of primes <= 19 uses 16.64 kilobytes
+/// - PreSieve multiples of primes <= 89 uses 55.27 kilobytes
 ///
 class PreSieve {
 public:
   PreSieve(int);
-  ~PreSieve();
   uint_t getLimit() const { return limit_; }
   void doIt(byte_t*, uint_t, uint64_t) const;
+  void restorePrimes(byte_t*, uint_t, uint64_t) const;
 private:
-  static const uint_t primes_[10];
-  /// Pre-sieve multiples of primes <= limit_ (>= 11 && <= 23)
+  enum { MAX_BUFFER_SIZE = 1 << 15 };
+  static const uint_t primes_[23];
+  /// Pre-sieve multiples of primes <= limit_ (>= 11 && <= 97)
   uint_t limit_;
-  uint_t primeProduct_;
-  byte_t* preSieved_;
-  uint_t size_;
+  /// Each buffer holds the pre-sieved pattern
+  /// of a group of small primes
+  std::vector<std::vector<byte_t> > buffers_;
   void init();
+  static void initBuffer(std::vector<byte_t>&, const uint_t*, const uint_t*);
   DISALLOW_COPY_AND_ASSIGN(PreSieve);
 };
 
@@ -0,0 +1,117 @@
+///
+/// @file   PrimeFile.hpp
+/// @brief  PrimeFile memory-maps a binary prime file created
+///         using primesieve::store_primes() and provides
+///         next_prime(), countPrimes() and nthPrime() using the
+///         file's block index.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef PRIMEFILE_HPP
+#define PRIMEFILE_HPP
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace primesieve {
+
+/// File format version 1, all integers are stored in little-endian
+/// byte order:
+///
+/// offset  size  content
+///      0     8  magic "PSPRIME\0"
+///      8     4  version (1)
+///     12     4  format (BITMAP_FORMAT or DELTA_FORMAT)
+///     16     8  start
+///     24     8  stop
+///     32     8  number of primes
+///     40     8  low, bitmap byte i corresponds to the
+///               numbers [low + i * 30, low + i * 30 + 30[
+///     48     8  blocks
+///     56     8  index offset
+///     64     -  data, zero padded to a multiple of 8 bytes
+///          24*n index: for each block its data offset, the number
+///               of primes before the block and its first number
+///               (bitmap) or first prime (delta)
+///
+/// BITMAP_FORMAT: the sieve bytes in blocks of BLOCK_BYTES, the
+/// primes < 7 are not stored in the bitmap, they belong to the
+/// first block if they are within [start, stop].
+/// DELTA_FORMAT: blocks of BLOCK_PRIMES primes, each block starts
+/// with its first prime followed by the prime gaps (divided by 2
+/// for odd primes), all encoded as LEB128 varints.
+///
+enum
+{
+  BITMAP_FORMAT,
+  DELTA_FORMAT
+};
+
+class PrimeFile
+{
+public:
+  enum
+  {
+    FILE_VERSION = 1,
+    BLOCK_BYTES = 4096,
+    BLOCK_PRIMES = 4096
+  };
+  PrimeFile(const std::string& filename);
+  ~PrimeFile();
+  int getFormat() const { return format_; }
+  uint64_t getStart() const { return start_; }
+  uint64_t getStop() const { return stop_; }
+  uint64_t getPrimeCount() const { return count_; }
+  /// Count the stored primes within [start, stop]
+  uint64_t countPrimes(uint64_t start, uint64_t stop) const;
+  /// @return The nth stored prime, n >= 1
+  uint64_t nthPrime(uint64_t n) const;
+  /// next_prime() returns the first stored prime >= start
+  void skipto(uint64_t start);
+  /// @return The next stored prime or 0 if there is none
+  uint64_t next_prime()
+  {
+    if (i_ >= primes_.size() && !nextBlock())
+      return 0;
+    return primes_[i_++];
+  }
+private:
+  const unsigned char* data_;
+  uint64_t dataSize_;
+  const unsigned char* index_;
+  uint64_t start_;
+  uint64_t stop_;
+  uint64_t count_;
+  uint64_t low_;
+  uint64_t blocks_;
+  int format_;
+  /// next_prime() decodes one block at a time
+  std::vector<uint64_t> primes_;
+  std::size_t i_;
+  uint64_t block_;
+  /// mmap'ed file
+  void* map_;
+  std::size_t mapSize_;
+  /// Used if mmap is not available
+  std::vector<unsigned char> file_;
+  void open(const std::string& filename);
+  uint64_t getOffset(uint64_t block) const;
+  uint64_t getCount(uint64_t block) const;
+  uint64_t getFirst(uint64_t block) const;
+  uint64_t findBlock(uint64_t n) const;
+  uint64_t pi(uint64_t x) const;
+  bool nextBlock();
+  void decodeBlock(uint64_t block, std::vector<uint64_t>& primes) const;
+  PrimeFile(const PrimeFile&);
+  void operator=(const PrimeFile&);
+};
+
+} // namespace primesieve
+
+#endif
@@ -0,0 +1,63 @@
+///
+/// @file   PrimeFileWriter.hpp
+/// @brief  PrimeFileWriter stores the primes of [start, stop] in a
+///         binary prime file, either as the raw sieve bitmap (30
+///         numbers per byte) or as delta-varint blocks. See
+///         PrimeFile.hpp for the file format.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef PRIMEFILEWRITER_HPP
+#define PRIMEFILEWRITER_HPP
+
+#include "config.hpp"
+#include "Callback.hpp"
+#include "PrimeFile.hpp"
+
+#include <stdint.h>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace primesieve {
+
+class PrimeFileWriter : public SegmentCallback
+{
+public:
+  PrimeFileWriter(const std::string& filename, uint64_t start, uint64_t stop, int format);
+  /// Store the primes of the current segment
+  void callback(const uint8_t* sieve, std::size_t sieveSize, uint64_t segmentLow, int);
+  /// Write the index and the header
+  void close();
+  uint64_t getPrimeCount() const { return count_; }
+private:
+  std::ofstream file_;
+  std::string filename_;
+  uint64_t start_;
+  uint64_t stop_;
+  uint64_t low_;
+  uint64_t count_;
+  /// Bytes written after the header
+  uint64_t dataSize_;
+  /// Bytes (bitmap) or primes (delta) of the current block
+  uint64_t blockSize_;
+  uint64_t prevPrime_;
+  int format_;
+  std::vector<uint64_t> index_;
+  std::vector<uint64_t> primes_;
+  std::vector<byte_t> buffer_;
+  void newBlock(uint64_t first);
+  void writeBitmap(const byte_t*, uint64_t);
+  void writePrimes(const uint64_t*, std::size_t);
+  void writeData(const byte_t*, std::size_t);
+  DISALLOW_COPY_AND_ASSIGN(PrimeFileWriter);
+};
+
+} // namespace primesieve
+
+#endif
@@ -1,7 +1,7 @@
 ///
 /// @file  PrimeFinder.hpp
 ///
-/// Copyright (C) 2014 Kim Walisch, <kim.walisch@gmail.com>
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
 ///
 /// This file is distributed under the BSD License. See the COPYING
 /// file in the top level directory.
@@ -14,11 +14,13 @@
 #include "SieveOfEratosthenes.hpp"
 
 #include <stdint.h>
+#include <cstddef>
 #include <vector>
 
 namespace primesieve {
 
 class PrimeSieve;
+class PrimeWriter;
 
 /// PrimeFinder is a SieveOfEratosthenes class that is used to
 /// callback, print and count primes and prime k-tuplets
@@ -26,22 +28,54 @@ class PrimeSieve;
 ///
 class PrimeFinder : public SieveOfEratosthenes {
 public:
+  /// Prime k-tuplet counting code
+  enum
+  {
+    TUPLETS_SCALAR,
+    TUPLETS_AVX2,
+    TUPLET_KERNELS
+  };
   PrimeFinder(PrimeSieve&);
+  ~PrimeFinder();
+  static bool hasTupletKernel(int);
+  static int getTupletKernel();
+  static void setTupletKernel(int);
+  virtual bool isStopped() const;
+  void flush();
 private:
   enum { END = 0xff + 1 };
   static const uint_t kBitmasks_[6][5];
   /// Count lookup tables for prime k-tuplets
   std::vector<uint_t> kCounts_[6];
+  /// Enabled prime k-tuplet types (1 = twins, 2 = triplets, ...)
+  std::vector<uint_t> kTypes_;
+  /// Bitmasks of the enabled prime k-tuplet types and the
+  /// k-tuplet type of each bitmask (for the SIMD counter)
+  std::vector<byte_t> kMasks_;
+  std::vector<byte_t> kMaskTypes_;
   /// Reference to the associated PrimeSieve object
   PrimeSieve& ps_;
+  /// Decoded primes for batch callbacks
+  std::vector<uint64_t> batch_;
+  /// Output buffer for printing, NULL if not printing
+  PrimeWriter* writer_;
+  /// Ordered mode: primes buffered until it is our turn
+  std::vector<uint64_t> pending_;
+  /// SIMD prime k-tuplet counter, NULL = scalar
+  uint_t (*tupletFunction_)(const byte_t*, uint_t, const byte_t*, const byte_t*, std::size_t, uint64_t*);
   void init_kCounts();
   virtual void segmentFinished(const byte_t*, uint_t);
   void count(const byte_t*, uint_t);
-  void print(const byte_t*, uint_t) const;
+  void countTuplets(const byte_t*, uint_t);
+  void print(const byte_t*, uint_t);
   template <typename T> void callbackPrimes(T, const byte_t*, uint_t) const;
   template <typename T> void callbackPrimes(T, const byte_t*, uint_t, int) const;
   void callbackPrimes(const byte_t*, uint_t) const;
-  static void printPrime(uint64_t);
+  template <typename T> void callbackBatch(T, const byte_t*, uint_t);
+  void callbackBatch(const byte_t*, uint_t);
+  void bufferPrimes(const byte_t*, uint_t);
+  void callbackPending();
+  void findNthPrime(const byte_t*, uint_t);
   DISALLOW_COPY_AND_ASSIGN(PrimeFinder);
 };
 
@@ -21,6 +21,7 @@ class PrimeGenerator : public SieveOfEratosthenes {
 public:
   PrimeGenerator(PrimeFinder&);
   void doIt();
+  virtual bool isStopped() const;
 private:
   PrimeFinder& finder_;
   void segmentFinished(const byte_t*, uint_t);
@@ -13,13 +13,19 @@
 #define PRIMESIEVE_CLASS_HPP
 
 #include "Callback.hpp"
+#include "SieveStats.hpp"
 
 #include <stdint.h>
+#include <cstddef>
 #include <string>
 #include <vector>
 
 namespace primesieve {
 
+class SievingPrimes;
+class StageTimer;
+class SieveContext;
+
 /// PrimeSieve is a highly optimized C++ implementation of the
 /// segmented sieve of Eratosthenes that generates primes and prime
 /// k-tuplets (twin primes, prime triplets, ...) in order up to 2^64
@@ -29,6 +35,7 @@ namespace primesieve {
 class PrimeSieve
 {
   friend class PrimeFinder;
+  friend class ParallelPrimeSieve;
   friend class LockGuard;
 public:
   /// Public flags for use with setFlags(int)
@@ -57,15 +64,33 @@ public:
   uint64_t getStart() const;
   uint64_t getStop() const;
   int getSieveSize() const;
+  int getBucketSize() const;
+  int getBucketAllocSize() const;
+  double getFactorEratSmall() const;
+  double getFactorEratMedium() const;
+  SieveContext* getContext() const;
+  int getBatchSize() const;
   int getFlags() const;
+  int getPrintFd() const;
   double getStatus() const;
   double getSeconds() const;
+  const SieveStats& getStats() const;
   // Setters
   void setStart(uint64_t);
   void setStop(uint64_t);
   void setSieveSize(int);
+  void setBucketSize(int);
+  void setBucketAllocSize(int);
+  void setFactorEratSmall(double);
+  void setFactorEratMedium(double);
+  void setHugePages(bool);
+  void setContext(SieveContext*);
+  void setCaching(bool);
+  void setBatchSize(int);
   void setFlags(int);
   void addFlags(int);
+  void setPrintFd(int);
+  void setStats(bool);
   // Bool is*
   bool isFlag(int) const;
   bool isCallback() const;
@@ -73,17 +98,26 @@ public:
   bool isCount(int) const;
   bool isPrint() const;
   bool isPrint(int) const;
+  bool isStopped() const;
+  bool isStats() const;
+  bool isHugePages() const;
+  bool isCaching() const;
   // Sieve
   virtual void sieve();
   void sieve(uint64_t, uint64_t);
   void sieve(uint64_t, uint64_t, int);
+  virtual void stop();
   // Callback
   void callbackPrimes(uint64_t, uint64_t, void (*)(uint64_t));
   void callbackPrimes(uint64_t, uint64_t, void (*)(uint64_t, int));
   void callbackPrimes(uint64_t, uint64_t, Callback<uint64_t>*);
   void callbackPrimes(uint64_t, uint64_t, Callback<uint64_t, int>*);
+  void callbackPrimes(uint64_t, uint64_t, void (*)(const uint64_t*, std::size_t, int));
+  void callbackPrimes(uint64_t, uint64_t, BatchCallback*);
+  void callbackSegments(uint64_t, uint64_t, SegmentCallback*);
   void callbackPrimes_c(uint64_t, uint64_t, void (*)(uint64_t));
   void callbackPrimes_c(uint64_t, uint64_t, void (*)(uint64_t, int));
+  void callbackPrimes_c(uint64_t, uint64_t, void (*)(const uint64_t*, std::size_t, int));
   // nth prime
   uint64_t nthPrime(uint64_t);
   uint64_t nthPrime(int64_t, uint64_t);
@@ -94,6 +128,8 @@ public:
   void printQuadruplets(uint64_t, uint64_t);
   void printQuintuplets(uint64_t, uint64_t);
   void printSextuplets(uint64_t, uint64_t);
+  // Store
+  void storePrimes(uint64_t, uint64_t, const std::string&, int);
   // Count
   uint64_t countPrimes(uint64_t, uint64_t);
   uint64_t countTwins(uint64_t, uint64_t);
@@ -118,19 +154,27 @@ protected:
   std::vector<uint64_t> counts_;
   /// Time elapsed of sieve()
   double seconds_;
+  /// Sieving primes shared by all ParallelPrimeSieve
+  /// threads, NULL if not used
+  const SievingPrimes* sievingPrimes_;
+  /// Per stage timings and counters, see setStats()
+  SieveStats stats_;
   uint64_t getInterval() const;
   void reset();
   virtual double getWallTime() const;
   virtual void setLock();
   virtual void unsetLock();
   virtual bool updateStatus(uint64_t, bool);
+  virtual void waitTurn(uint64_t);
 private:
   struct SmallPrime
   {
     uint32_t firstPrime;
     uint32_t lastPrime;
     int index;
-    std::string str;
+    /// const char* (not std::string) so that smallPrimes_
+    /// is initialized before any static initializer runs
+    const char* str;
   };
   static const SmallPrime smallPrimes_[8];
   /// Sum of all processed segments
@@ -139,25 +183,75 @@ private:
   uint64_t toUpdate_;
   /// Status of sieve() in percent
   double percent_;
-  /// Sieve size in kilobytes
+  /// Sieve size in kilobytes, 0 = automatic
+  /// (see getDefaultSieveSize())
   int sieveSize_;
+  /// Number of sieving primes per bucket (EratSmall,
+  /// EratMedium and EratBig), 0 = automatic
+  int bucketSize_;
+  /// Size in kilobytes of EratBig's bucket allocations
+  int bucketAllocSize_;
+  /// Sieving primes <= L1d block size * factor are processed
+  /// by EratSmall (and EratMedium), see config.hpp,
+  /// < 0 = automatic
+  double factorEratSmall_;
+  double factorEratMedium_;
+  /// Use huge pages for large allocations
+  bool hugePages_;
+  /// Cache of the sieve array, PreSieve, EratBig's buckets and
+  /// the sieving primes, NULL = the sieving thread's context
+  SieveContext* context_;
+  /// Use a SieveContext, false = allocate for each sieve()
+  bool caching_;
+  /// Max number of primes per batch callback,
+  /// 0 = one batch per segment
+  int batchSize_;
   /// Flags (settings) for PrimeSieve e.g. COUNT_PRIMES, PRINT_TWINS, ...
   int flags_;
+  /// File descriptor for printing primes (default 1 = stdout)
+  int printFd_;
+  /// Collect stats_ during sieve()
+  bool isStats_;
+  /// Used by sieve() if isStats_
+  StageTimer* timer_;
   /// ParallelPrimeSieve thread number
   int threadNum_;
   /// Pointer to the parent ParallelPrimeSieve object
   PrimeSieve* parent_;
+  /// Set by stop(), checked once per segment
+  volatile bool stopped_;
+  /// Ordered ParallelPrimeSieve mode: the primes of chunk_ are
+  /// printed (or passed to the callback) once all previous
+  /// chunks are done (hasTurn_), until then they are buffered
+  uint64_t chunk_;
+  bool ordered_;
+  bool hasTurn_;
+  /// Used by findNthPrime(), number of primes
+  /// to skip and the nth prime (0 if not found)
+  uint64_t nthPrimeRemaining_;
+  uint64_t nthPrime_;
   /// Callbacks for use with *callbackPrimes()
   void (*callback_)(uint64_t);
   void (*callback_tn_)(uint64_t, int);
   Callback<uint64_t>* cb_;
   Callback<uint64_t, int>* cb_tn_;
+  void (*callback_batch_)(const uint64_t*, std::size_t, int);
+  BatchCallback* cb_batch_;
+  SegmentCallback* cb_segment_;
   static void printStatus(double, double);
+  static int getDefaultSieveSize(uint64_t);
   bool isFlag(int, int) const;
   bool isValidFlags(int) const;
   bool isStatus() const;
   bool isParallelPrimeSieveChild() const;
+  void copyEratSettings(const PrimeSieve&);
+  bool hasTurn() const;
+  void takeTurn();
+  int setStage(int);
   void doSmallPrime(const SmallPrime&);
+  uint64_t findNthPrime(uint64_t, uint64_t, uint64_t, uint64_t*);
+  uint64_t findNextPrimes(uint64_t, uint64_t);
+  uint64_t findPreviousPrimes(uint64_t, uint64_t);
   enum
   {
       INIT_STATUS = 0,
@@ -167,12 +261,17 @@ private:
   /// @pre flag >= (1 << 20)
   enum
   {
-    CALLBACK_PRIMES        = 1 << 20,
-    CALLBACK_PRIMES_TN     = 1 << 21,
-    CALLBACK_PRIMES_OBJ    = 1 << 22,
-    CALLBACK_PRIMES_OBJ_TN = 1 << 23,
-    CALLBACK_PRIMES_C      = 1 << 24,
-    CALLBACK_PRIMES_C_TN   = 1 << 25
+    CALLBACK_PRIMES           = 1 << 20,
+    CALLBACK_PRIMES_TN        = 1 << 21,
+    CALLBACK_PRIMES_OBJ       = 1 << 22,
+    CALLBACK_PRIMES_OBJ_TN    = 1 << 23,
+    CALLBACK_PRIMES_C         = 1 << 24,
+    CALLBACK_PRIMES_C_TN      = 1 << 25,
+    CALLBACK_PRIMES_BATCH     = 1 << 26,
+    CALLBACK_PRIMES_OBJ_BATCH = 1 << 27,
+    CALLBACK_PRIMES_C_BATCH   = 1 << 28,
+    FIND_NTH_PRIME            = 1 << 29,
+    CALLBACK_SEGMENTS         = 1 << 30
   };
 };
 
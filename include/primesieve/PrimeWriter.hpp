@@ -0,0 +1,66 @@
+///
+/// @file   PrimeWriter.hpp
+/// @brief  PrimeWriter converts primes and prime k-tuplets to
+///         decimal text in a large buffer which is written to a
+///         file descriptor using write(2), this is much faster
+///         than printing using std::cout.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef PRIMEWRITER_HPP
+#define PRIMEWRITER_HPP
+
+#include "config.hpp"
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace primesieve {
+
+/// Write the decimal digits of n to str (no null terminator).
+/// @return Pointer to the end of the written digits.
+///
+char* toDecimal(uint64_t n, char* str);
+
+class PrimeWriter
+{
+public:
+  /// Max length of a prime: 20 digits + '\n'
+  enum { MAX_PRIME_LENGTH = 21 };
+  PrimeWriter(int fd);
+  /// Make sure there is space for at least bytes more bytes
+  void reserve(std::size_t bytes);
+  /// Append prime + '\n'
+  /// @pre reserve(MAX_PRIME_LENGTH) has been called
+  ///
+  void writePrime(uint64_t prime)
+  {
+    char* end = toDecimal(prime, &buffer_[size_]);
+    *end++ = '\n';
+    size_ = end - &buffer_[0];
+  }
+  /// Append "(p1, p2, ...)\n"
+  void writeTuplet(const uint64_t* primes, int k);
+  void write(const std::string& str);
+  /// @return true if the buffer should be flushed
+  bool isFull() const { return size_ >= config::PRINT_BUFFER_SIZE; }
+  bool isEmpty() const { return size_ == 0; }
+  std::size_t size() const { return size_; }
+  /// Write the buffer to the file descriptor
+  void flush();
+private:
+  std::vector<char> buffer_;
+  std::size_t size_;
+  int fd_;
+  DISALLOW_COPY_AND_ASSIGN(PrimeWriter);
+};
+
+} // namespace primesieve
+
+#endif
@@ -1,10 +1,12 @@
 ///
 /// @file   PushBackPrimes.hpp
 /// @brief  This file contains classes needed to store primes in
-///         std::vector objects. These classes derive from Callback
-///         and call PrimeSieve's callbackPrimes() method, the
-///         primes are then pushed back onto the vector inside the
-///         callback method.
+///         std::vector objects. These classes derive from
+///         BatchCallback and call PrimeSieve's callbackPrimes()
+///         method, the primes are then appended to the vector
+///         inside the callback method. ParallelPushBackPrimes
+///         derives from PrimeArray and uses
+///         ParallelPrimeSieve::storePrimes().
 ///
 /// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
 ///
@@ -16,11 +18,12 @@
 #define PUSHBACKPRIMES_HPP
 
 #include "PrimeSieve.hpp"
+#include "ParallelPrimeSieve.hpp"
 #include "Callback.hpp"
-#include "cancel_callback.hpp"
 
 #include <stdint.h>
 #include <cmath>
+#include <cstddef>
 #include <vector>
 
 namespace primesieve {
@@ -38,7 +41,7 @@ inline uint64_t approximate_prime_count(uint64_t start, uint64_t stop)
 }
 
 template <typename T>
-class PushBackPrimes : public Callback<uint64_t>
+class PushBackPrimes : public BatchCallback
 {
 public:
   PushBackPrimes(std::vector<T>& primes)
@@ -54,9 +57,12 @@ public:
       ps.callbackPrimes(start, stop, this);
     }
   }
-  void callback(uint64_t prime)
+  void callback(const uint64_t* primes, std::size_t count, int)
   {
-    primes_.push_back(static_cast<T>(prime));
+    std::size_t size = primes_.size();
+    primes_.resize(size + count);
+    for (std::size_t i = 0; i < count; i++)
+      primes_[size + i] = static_cast<T>(primes[i]);
   }
 private:
   PushBackPrimes(const PushBackPrimes&);
@@ -64,41 +70,80 @@ private:
   std::vector<T>& primes_;
 };
 
+/// Append the primes to a vector using multiple threads, the
+/// vector is resized once and each thread converts the primes
+/// of its chunks into a disjoint slice of the vector.
+///
+template <typename T>
+class ParallelPushBackPrimes : public PrimeArray
+{
+public:
+  ParallelPushBackPrimes(std::vector<T>& primes)
+    : primes_(primes),
+      size_(primes.size())
+  { }
+  void pushBackPrimes(uint64_t start, uint64_t stop, ParallelPrimeSieve& pps)
+  {
+    if (start <= stop)
+      pps.storePrimes(start, stop, this);
+  }
+  void resize(std::size_t size)
+  {
+    primes_.resize(size_ + size);
+  }
+  void store(const uint64_t* primes, std::size_t count, std::size_t index)
+  {
+    T* slice = &primes_[size_ + index];
+    for (std::size_t i = 0; i < count; i++)
+      slice[i] = static_cast<T>(primes[i]);
+  }
+private:
+  ParallelPushBackPrimes(const ParallelPushBackPrimes&);
+  void operator=(const ParallelPushBackPrimes&);
+  std::vector<T>& primes_;
+  std::size_t size_;
+};
+
 template <typename T>
-class PushBack_N_Primes : public Callback<uint64_t>
+class PushBack_N_Primes : public BatchCallback
 {
 public:
   PushBack_N_Primes(std::vector<T>& primes) 
-    : primes_(primes)
+    : primes_(primes),
+      ps_(NULL)
   { }
   void pushBack_N_Primes(uint64_t n, uint64_t start)
   {
     n_ = n;
     primes_.reserve(primes_.size() + static_cast<std::size_t>(n_));
     PrimeSieve ps;
-    try
+    ps_ = &ps;
+    while (n_ > 0)
     {
-      while (n_ > 0)
-      {
-        uint64_t logn = 50;
-        // choose stop > nth prime
-        uint64_t stop = start + n_ * logn + 10000;
-        ps.callbackPrimes(start, stop, this);
-        start = stop + 1;
-      }
+      uint64_t logn = 50;
+      // choose stop > nth prime
+      uint64_t stop = start + n_ * logn + 10000;
+      ps.callbackPrimes(start, stop, this);
+      start = stop + 1;
     }
-    catch (cancel_callback&) { }
   }
-  void callback(uint64_t prime)
+  void callback(const uint64_t* primes, std::size_t count, int)
   {
-    primes_.push_back(static_cast<T>(prime));
-    if (--n_ == 0)
-      throw cancel_callback();
+    std::size_t size = primes_.size();
+    if (count > n_)
+      count = static_cast<std::size_t>(n_);
+    primes_.resize(size + count);
+    for (std::size_t i = 0; i < count; i++)
+      primes_[size + i] = static_cast<T>(primes[i]);
+    n_ -= count;
+    if (n_ == 0)
+      ps_->stop();
   }
   private:
     PushBack_N_Primes(const PushBack_N_Primes&);
     void operator=(const PushBack_N_Primes&);
     std::vector<T>& primes_;
+    PrimeSieve* ps_;
     uint64_t n_;
 };
 
@@ -0,0 +1,99 @@
+///
+/// @file   SieveContext.hpp
+/// @brief  Caches the memory and lookup tables used by PrimeSieve
+///         so that repeated small queries do not allocate.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef SIEVECONTEXT_HPP
+#define SIEVECONTEXT_HPP
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+namespace primesieve {
+
+class PreSieve;
+class SievingPrimes;
+
+/// @brief  Cache of a PrimeSieve's per query allocations.
+///
+/// Each sieving operation needs the PreSieve buffers, the sieve
+/// array, EratBig's buckets and the sieving primes <= sqrt(stop).
+/// For small queries e.g. countPrimes(1e12, 1e12 + 1e6) setting
+/// up these dominates the run-time. PrimeSieve borrows them from
+/// its SieveContext and returns them after sieving so that the
+/// next query can reuse them.
+///
+/// By default PrimeSieve::sieve() uses the SieveContext of the
+/// thread it runs on (if the compiler supports C++11
+/// thread_local), a user owned SieveContext can be set using
+/// PrimeSieve::setContext(). As the thread's SieveContext lives
+/// until the thread exits it only caches the memory of small
+/// queries (config::THREAD_CONTEXT_CACHE_SIZE), use
+/// primesieve::clear_cache() to free it.
+/// A SieveContext must not be used by multiple threads
+/// simultaneously.
+///
+class SieveContext
+{
+public:
+  SieveContext();
+  /// @param maxCacheSize     Max bytes of unused memory to keep.
+  /// @param maxSievingPrime  Only cache sieving primes <= maxSievingPrime.
+  SieveContext(std::size_t maxCacheSize, uint64_t maxSievingPrime);
+  ~SieveContext();
+  /// SieveContext of the calling thread, NULL if the
+  /// compiler does not support thread_local.
+  static SieveContext* threadContext();
+  /// Free all cached memory (except the lookup
+  /// tables that are in use by a running sieve)
+  void clear();
+  /// Number of bytes of cached memory
+  std::size_t getCachedBytes() const;
+  /// Used internally by SieveOfEratosthenes and EratBig,
+  /// see HugePages.hpp.
+  void* allocatePages(std::size_t size, bool hugePages, int* pageType);
+  void freePages(void* ptr, std::size_t size, int pageType);
+  /// Used internally by PrimeSieve::sieve(), the lookup
+  /// tables are not freed while the context is in use.
+  void addUser();
+  void removeUser();
+  const PreSieve& getPreSieve(int limit);
+  /// Each non NULL result must be returned using
+  /// releaseSievingPrimes().
+  const SievingPrimes* getSievingPrimes(uint64_t stop, int sieveSize);
+  void releaseSievingPrimes();
+private:
+  struct Pages
+  {
+    void* ptr;
+    std::size_t size;
+    int pageType;
+  };
+  std::size_t maxCacheSize_;
+  uint64_t maxSievingPrime_;
+  /// PreSieve objects, one per limit
+  std::vector<PreSieve*> preSieves_;
+  /// Unused memory returned by freePages()
+  std::vector<Pages> pages_;
+  std::size_t pagesBytes_;
+  /// Sieving primes up to sievingPrimes_->getLimit()
+  SievingPrimes* sievingPrimes_;
+  /// Number of unreleased getSievingPrimes() results,
+  /// e.g. queries nested inside a callback
+  int sievingPrimesUsers_;
+  /// Number of running sieve() calls using this context
+  int users_;
+  SieveContext(const SieveContext&);
+  void operator=(const SieveContext&);
+};
+
+} // namespace primesieve
+
+#endif
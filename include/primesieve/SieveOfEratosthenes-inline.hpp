@@ -16,6 +16,7 @@
 #include "EratSmall.hpp"
 #include "EratMedium.hpp"
 #include "EratBig.hpp"
+#include "StageTimer.hpp"
 #include "pmath.hpp"
 
 #include <stdint.h>
@@ -42,6 +43,14 @@ inline uint_t SieveOfEratosthenes::getSieveSize() const
   return sieveSize_;
 }
 
+/// Switch to a SieveStats stage if timer_ is used.
+/// @return The previous stage.
+///
+inline int SieveOfEratosthenes::setStage(int stage)
+{
+  return timer_ ? timer_->enter(stage) : stage;
+}
+
 /// Reconstruct the prime number corresponding to the first set
 /// bit of the `bits' parameter and unset that bit.
 ///
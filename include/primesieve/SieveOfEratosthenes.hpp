@@ -11,6 +11,7 @@
 #define SIEVEOFERATOSTHENES_HPP
 
 #include "config.hpp"
+#include "EratSettings.hpp"
 
 #include <stdint.h>
 #include <string>
@@ -21,6 +22,8 @@ class PreSieve;
 class EratSmall;
 class EratMedium;
 class EratBig;
+class StageTimer;
+class SieveContext;
 
 /// @brief  The abstract SieveOfEratosthenes class sieves primes using
 ///         the segmented sieve of Eratosthenes.
@@ -39,14 +42,22 @@ public:
   uint_t getSqrtStop() const;
   uint_t getSieveSize() const;
   uint_t getPreSieve() const;
+  uint64_t getBucketAllocs() const;
+  uint64_t getHugePageBytes() const;
+  const EratSettings& getEratSettings() const;
+  SieveContext* getContext() const;
   void addSievingPrime(uint_t);
   void sieve();
+  virtual bool isStopped() const;
 protected:
-  SieveOfEratosthenes(uint64_t, uint64_t, uint_t);
+  SieveOfEratosthenes(uint64_t, uint64_t, uint_t, const EratSettings& = EratSettings(), SieveContext* = NULL);
   virtual ~SieveOfEratosthenes();
   virtual void segmentFinished(const byte_t*, uint_t) = 0;
   static uint64_t getNextPrime(uint64_t*, uint64_t);
   uint64_t getSegmentLow() const;
+  int setStage(int);
+  /// Per stage timings, NULL if not used
+  StageTimer* timer_;
 private:
   static const uint_t bitValues_[8];
   static const uint_t bruijnBitValues_[64];
@@ -58,6 +69,11 @@ private:
   const uint64_t start_;
   /// Sieve primes <= stop_
   const uint64_t stop_;
+  /// Bucket size and Erat* limits
+  const EratSettings settings_;
+  /// Provides the sieve array, PreSieve and EratBig's
+  /// buckets if not NULL
+  SieveContext* context_;
   /// sqrt(stop_)
   uint_t sqrtStop_;
   /// Copy of preSieve_->getLimit()
@@ -68,10 +84,17 @@ private:
   uint_t limitEratMedium_;
   /// Size of sieve_ in bytes (power of 2)
   uint_t sieveSize_;
+  /// PreSieve and EratSmall process sieve_ in blocks
+  /// of blockSize_ bytes (power of 2, <= L1d cache size)
+  uint_t blockSize_;
   /// Sieve of Eratosthenes array
   byte_t* sieve_;
+  /// Allocated size of sieve_ in bytes
+  uint_t sieveAllocSize_;
+  /// Page type of sieve_, see HugePages.hpp
+  int sievePageType_;
   /// Pre-sieve multiples of tiny sieving primes
-  PreSieve* preSieve_;
+  const PreSieve* preSieve_;
   /// Cross-off multiples of small sieving primes
   EratSmall* eratSmall_;
   /// cross-off multiples of medium sieving primes
@@ -81,7 +104,7 @@ private:
   static uint64_t getByteRemainder(uint64_t);
   void init();
   void cleanUp();
-  void preSieve();
+  void preSieve(byte_t*, uint_t, uint64_t);
   void crossOffMultiples();
   void sieveSegment();
   DISALLOW_COPY_AND_ASSIGN(SieveOfEratosthenes);
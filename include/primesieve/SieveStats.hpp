@@ -0,0 +1,69 @@
+///
+/// @file   SieveStats.hpp
+/// @brief  Per stage timings and counters of PrimeSieve::sieve(),
+///         enabled using PrimeSieve::setStats(true).
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef SIEVESTATS_HPP
+#define SIEVESTATS_HPP
+
+#include <stdint.h>
+#include <vector>
+
+namespace primesieve {
+
+/// The time of sieve() is split into stages, at any point in time
+/// exactly one stage is active, hence the stage times add up to
+/// the total time (summed over all threads).
+///
+struct SieveStats
+{
+  enum
+  {
+    /// Pre-sieve multiples of tiny primes (PreSieve::doIt())
+    PRE_SIEVE,
+    /// Cross-off multiples (EratSmall, EratMedium, EratBig)
+    ERAT_SMALL,
+    ERAT_MEDIUM,
+    ERAT_BIG,
+    /// Generate the sieving primes <= sqrt(stop)
+    PRIME_GENERATOR,
+    /// PrimeFinder: callback (or find) the primes,
+    /// count and print the primes of each segment
+    CALLBACK,
+    COUNT,
+    PRINT,
+    /// ParallelPrimeSieve ordered mode: wait
+    /// until the previous chunks are done
+    WAIT,
+    /// Initialization and everything else
+    OTHER,
+    STAGES
+  };
+  SieveStats();
+  void reset();
+  /// Add the stats of a ParallelPrimeSieve thread
+  void add(const SieveStats&, int threadNum, double busy);
+  static const char* getStageName(int stage);
+  /// Seconds spent in each stage
+  double seconds[STAGES];
+  /// Number of sieved segments
+  uint64_t segments;
+  /// Number of EratBig bucket allocations
+  uint64_t bucketAllocs;
+  /// Bytes of the sieve arrays and EratBig buckets
+  /// backed by huge pages, see PrimeSieve::setHugePages()
+  uint64_t hugePageBytes;
+  /// ParallelPrimeSieve: the time each thread was not
+  /// sieving (e.g. waiting for other threads to finish)
+  std::vector<double> threadIdle;
+};
+
+} // namespace primesieve
+
+#endif
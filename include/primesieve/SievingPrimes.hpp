@@ -0,0 +1,54 @@
+///
+/// @file  SievingPrimes.hpp
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef SIEVINGPRIMES_HPP
+#define SIEVINGPRIMES_HPP
+
+#include "config.hpp"
+
+#include <stdint.h>
+#include <vector>
+
+namespace primesieve {
+
+class PrimeFinder;
+
+/// @brief  Shared, read-only table of sieving primes.
+///
+/// ParallelPrimeSieve generates the sieving primes up to sqrt(stop)
+/// only once (in parallel, one piece of the table per thread) and
+/// stores them in a SievingPrimes object. Then each thread adds
+/// the sieving primes of its chunk from this table to its
+/// PrimeFinder instead of running its own PrimeGenerator, i.e.
+/// each thread only computes the multipleIndex and wheelIndex of
+/// the sieving primes.
+///
+/// The primes are stored in a bit array with 30 numbers per byte
+/// (like the SieveOfEratosthenes array) which uses sqrt(stop) / 30
+/// bytes of memory e.g. 105 megabytes for stop = 10^19.
+///
+class SievingPrimes {
+public:
+  SievingPrimes(uint64_t, uint_t, int);
+  uint_t getLimit() const { return limit_; }
+  int getPieces() const { return pieces_; }
+  void sievePiece(int);
+  void addSievingPrimes(PrimeFinder&) const;
+private:
+  /// Holds the primes >= 7 and <= limit_
+  uint_t limit_;
+  uint_t sieveSize_;
+  int pieces_;
+  std::vector<byte_t> primes_;
+  DISALLOW_COPY_AND_ASSIGN(SievingPrimes);
+};
+
+} // namespace primesieve
+
+#endif
@@ -0,0 +1,55 @@
+///
+/// @file   StageTimer.hpp
+/// @brief  StageTimer adds the elapsed time to the current
+///         SieveStats stage whenever the stage changes.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef STAGETIMER_HPP
+#define STAGETIMER_HPP
+
+#include "config.hpp"
+#include "SieveStats.hpp"
+
+namespace primesieve {
+
+/// @return Seconds elapsed since an arbitrary point in
+///         time (monotonic wall clock).
+///
+double wallTime();
+
+class StageTimer
+{
+public:
+  StageTimer(SieveStats& stats) :
+    stats_(stats),
+    stage_(SieveStats::OTHER),
+    time_(wallTime())
+  { }
+  /// Add the elapsed time to the current stage and
+  /// switch to stage.
+  /// @return The previous stage.
+  ///
+  int enter(int stage)
+  {
+    double time = wallTime();
+    stats_.seconds[stage_] += time - time_;
+    time_ = time;
+    int previous = stage_;
+    stage_ = stage;
+    return previous;
+  }
+private:
+  SieveStats& stats_;
+  int stage_;
+  double time_;
+  DISALLOW_COPY_AND_ASSIGN(StageTimer);
+};
+
+} // namespace primesieve
+
+#endif
@@ -0,0 +1,98 @@
+///
+/// @file   ThreadPool.hpp
+/// @brief  C++11 std::thread backend of ParallelPrimeSieve, an
+///         alternative to OpenMP. Only available if
+///         PRIMESIEVE_THREAD_POOL is defined (see config.hpp).
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include "config.hpp"
+
+#if defined(PRIMESIEVE_THREAD_POOL)
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace primesieve {
+
+/// ThreadPool holds long-lived worker threads which are created
+/// at first use and then reused by all subsequent
+/// ParallelPrimeSieve::sieve() calls. run(threads, task) executes
+/// task(threadNum) on the calling thread (threadNum = 0) and on
+/// threads - 1 worker threads and waits until all have finished.
+///
+class ThreadPool
+{
+public:
+  /// Process-wide thread pool
+  static ThreadPool& getInstance();
+  ThreadPool();
+  ~ThreadPool();
+  void run(int threads, const std::function<void(int)>& task);
+private:
+  std::vector<std::thread> workers_;
+  /// Only one run() at a time uses the workers
+  std::mutex runMutex_;
+  std::mutex mutex_;
+  std::condition_variable wakeUp_;
+  std::condition_variable finished_;
+  const std::function<void(int)>* task_;
+  std::exception_ptr exception_;
+  uint64_t generation_;
+  int threads_;
+  int running_;
+  bool exit_;
+  void worker(int, uint64_t);
+  void execute(int);
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+/// WorkStealing distributes the sieving interval [start, stop[
+/// among the threads. Each thread owns a range of the interval
+/// from which it takes chunks at the front, once its range is
+/// empty it steals the back half of the largest remaining range
+/// of another thread. The chunk size shrinks to about
+/// remaining / (threads * 2) near the end so that a long-tail
+/// chunk does not leave the other threads idle.
+///
+class WorkStealing
+{
+public:
+  WorkStealing(uint64_t start, uint64_t stop, int threads, uint64_t maxChunk, uint64_t minChunk);
+  bool getChunk(int threadNum, uint64_t* start, uint64_t* stop);
+  void abort();
+private:
+  struct Range
+  {
+    std::mutex mutex;
+    uint64_t start;
+    uint64_t stop;
+  };
+  std::vector<Range> ranges_;
+  std::atomic<uint64_t> remaining_;
+  std::atomic<bool> abort_;
+  uint64_t maxChunk_;
+  uint64_t minChunk_;
+  int threads_;
+  bool steal(int);
+  DISALLOW_COPY_AND_ASSIGN(WorkStealing);
+};
+
+} // namespace primesieve
+
+#endif /* PRIMESIEVE_THREAD_POOL */
+
+#endif
@@ -0,0 +1,102 @@
+///
+/// @file   TuningProfile.hpp
+/// @brief  Machine specific sieving settings (per range magnitude)
+///         found by benchmarking candidate settings, see
+///         primesieve --tune. The profile is stored in a small text
+///         file and loaded at first use.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef TUNINGPROFILE_HPP
+#define TUNINGPROFILE_HPP
+
+#include "config.hpp"
+
+#include <stdint.h>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace primesieve {
+
+/// Tuning profile file format (text), lines starting with '#'
+/// are comments:
+///
+///   version 1
+///   l1d_cache_size <bytes>
+///   l2_cache_size <bytes>
+///   sieve_size <exponent> <kilobytes>
+///   bucket_size <exponent> <sieving primes>
+///   factor_erat_small <exponent> <factor>
+///   factor_erat_medium <exponent> <factor>
+///
+/// Each setting is used for stop >= 10^exponent until the next
+/// exponent for which that setting has been tuned. The profile
+/// is ignored if the cache sizes differ from the current CPU's
+/// cache sizes (new hardware needs to be tuned again).
+///
+class TuningProfile
+{
+public:
+  enum
+  {
+    FILE_VERSION = 1,
+    /// Exponents of the tuned range magnitudes
+    MIN_EXPONENT = 8,
+    MAX_EXPONENT = 18
+  };
+  TuningProfile();
+  /// Load the profile file, an invalid or missing
+  /// file results in an empty profile.
+  TuningProfile(const std::string& filename);
+  bool empty() const;
+  /// @return The tuned sieve size in kilobytes for sieving
+  ///         up to stop or 0 if not tuned.
+  int getSieveSize(uint64_t stop) const;
+  /// @return The tuned bucket size or 0 if not tuned
+  int getBucketSize(uint64_t stop) const;
+  /// @return The tuned factor or -1 if not tuned
+  double getFactorEratSmall(uint64_t stop) const;
+  double getFactorEratMedium(uint64_t stop) const;
+  void setSieveSize(int exponent, int sieveSize);
+  void setBucketSize(int exponent, int bucketSize);
+  void setFactorEratSmall(int exponent, double factor);
+  void setFactorEratMedium(int exponent, double factor);
+  /// @return true if the file has been loaded
+  bool load(const std::string& filename);
+  void save(const std::string& filename) const;
+  /// Benchmark candidate sieve sizes, bucket sizes and
+  /// EratSmall, EratMedium factors for each range magnitude
+  /// and keep the fastest settings.
+  /// @param status  Progress output, may be NULL.
+  ///
+  void tune(std::ostream* status);
+  /// @return $PRIMESIEVE_TUNING_FILE, else ~/.primesieve_tuning
+  ///         (%APPDATA%\primesieve_tuning.txt on Windows) or an
+  ///         empty string if there is no home directory.
+  static std::string getDefaultFilename();
+private:
+  /// sieveSizes_[exponent], 0 if not tuned
+  std::vector<int> sieveSizes_;
+  /// bucketSizes_[exponent], 0 if not tuned
+  std::vector<int> bucketSizes_;
+  /// factorsEratSmall_[exponent], -1 if not tuned
+  std::vector<double> factorsEratSmall_;
+  std::vector<double> factorsEratMedium_;
+  static int checkExponent(int exponent);
+  uint64_t l1dCacheSize_;
+  uint64_t l2CacheSize_;
+};
+
+/// The tuning profile used by PrimeSieve, it is loaded
+/// from TuningProfile::getDefaultFilename() at first use.
+///
+TuningProfile& tuningProfile();
+
+} // namespace primesieve
+
+#endif
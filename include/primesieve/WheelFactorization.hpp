@@ -125,15 +125,18 @@ private:
 /// @see http://www.ieeta.pt/~tos/software/prime_sieve.html
 /// The Bucket class is designed as a singly linked list, once there
 /// is no more space in the current Bucket a new Bucket node is
-/// allocated.
+/// allocated. Each Bucket holds SIZE sieving primes, the Erat*
+/// classes are instantiated for a few preset bucket sizes (see
+/// config::MIN_BUCKETSIZE) so that SIZE is a compile-time constant.
 ///
+template <uint_t SIZE>
 class Bucket
 {
 public:
   Bucket(const Bucket&) { reset(); }
   Bucket()              { reset(); }
   SievingPrime* begin() { return &sievingPrimes_[0]; }
-  SievingPrime* last()  { return &sievingPrimes_[config::BUCKETSIZE - 1]; }
+  SievingPrime* last()  { return &sievingPrimes_[SIZE - 1]; }
   SievingPrime* end()   { return prime_; }
   Bucket* next()        { return next_; }
   bool hasNext() const  { return next_ != NULL; }
@@ -156,7 +159,7 @@ public:
 private:
   SievingPrime* prime_;
   Bucket* next_;
-  SievingPrime sievingPrimes_[config::BUCKETSIZE];
+  SievingPrime sievingPrimes_[SIZE];
 };
 
 /// The abstract WheelFactorization class is used skip multiples of
@@ -2,7 +2,7 @@
  *  @file   callback_t.hpp
  *  @brief  Callback types with C++ linkage and extern "C" linkage.
  * 
- *  Copyright (C) 2013 Kim Walisch, <kim.walisch@gmail.com>
+ *  Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
  * 
  *  This file is distributed under the BSD License. See the COPYING
  *  file in the top level directory.
@@ -12,15 +12,18 @@
 #define CALLBACK_t_HPP
 
 #include <stdint.h>
+#include <cstddef>
 
 // C++ linkage
 typedef void (*callback_t)(uint64_t);
 typedef void (*callback_tn_t)(uint64_t, int);
+typedef void (*callback_batch_t)(const uint64_t*, std::size_t, int);
 
 extern "C"
 {
 typedef void (*callback_c_t)(uint64_t);
 typedef void (*callback_c_tn_t)(uint64_t, int);
+typedef void (*callback_c_batch_t)(const uint64_t*, std::size_t, int);
 }
 
 #endif
@@ -14,6 +14,10 @@
 
 namespace primesieve {
 
+/// Throwing cancel_callback from within a callback stops sieving,
+/// PrimeSieve::stop() is the faster alternative that also
+/// stops all threads of a ParallelPrimeSieve.
+///
 class cancel_callback : public std::exception { };
 
 } // namespace primesieve
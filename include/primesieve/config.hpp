@@ -23,6 +23,7 @@
 #endif
 
 #include <stdint.h>
+#include <cstddef>
 
 /// Disable assert() macro
 #if !defined(DEBUG) && !defined(NDEBUG)
@@ -36,7 +37,8 @@
   void operator=(const ClassName&)
 #endif
 
-/// Default CPU L1 data cache size in kilobytes (per core)
+/// Default CPU L1 data cache size in kilobytes (per core), only
+/// used if the L1 data cache size cannot be detected at runtime
 #ifndef L1_DCACHE_SIZE
   #define L1_DCACHE_SIZE 32
 #endif
@@ -45,6 +47,24 @@
   #define SIEVESIZE L1_DCACHE_SIZE
 #endif
 
+/// Build ParallelPrimeSieve's std::thread pool backend (an
+/// alternative to OpenMP) if the compiler supports C++11. Use
+/// -DPRIMESIEVE_NO_THREAD_POOL (./configure --disable-thread-pool)
+/// to disable it.
+#if !defined(PRIMESIEVE_NO_THREAD_POOL) && \
+    (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1800))
+  #define PRIMESIEVE_THREAD_POOL
+#endif
+
+/// Each thread caches the memory and lookup tables of its last
+/// sieving operation in a thread_local SieveContext if the
+/// compiler supports C++11. Use -DPRIMESIEVE_NO_THREAD_LOCAL
+/// to disable it.
+#if !defined(PRIMESIEVE_NO_THREAD_LOCAL) && \
+    (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900))
+  #define PRIMESIEVE_THREAD_LOCAL
+#endif
+
 namespace primesieve {
 
 /// byte_t must be unsigned in primesieve
@@ -62,31 +82,34 @@ enum {
 namespace config {
 
 enum {
-  /// Default sieve size in kilobytes of the PrimeSieve class. Set
-  /// PRIMESIEVE_SIEVESIZE to your CPUs L1 data cache size to get the
-  /// best performance.
+  /// Default sieve size in kilobytes of the PrimeSieve class if
+  /// the CPU's L1 data cache size cannot be detected at runtime
+  /// (see CpuInfo.hpp). Set PRIMESIEVE_SIEVESIZE to your CPUs L1
+  /// data cache size to get the best performance.
   /// @pre PRIMESIEVE_SIEVESIZE >= 1 && <= 2048
   ///
   PRIMESIEVE_SIEVESIZE = SIEVESIZE,
 
-  /// Sieve size in kilobytes of the PrimeGenerator class.
+  /// Sieve size in kilobytes of the PrimeGenerator class if the
+  /// CPU's L1 data cache size cannot be detected at runtime.
   /// @pre PRIMEGENERATOR_SIEVESIZE >= 1 && <= 2048
   ///
   PRIMEGENERATOR_SIEVESIZE = L1_DCACHE_SIZE,
 
   /// Default pre-sieve limit. Multiples of primes up to this limit
   /// are pre-sieved to speed up the sieve of Eratosthenes.
-  /// @pre PRESIEVE >= 13 && <= 23.
+  /// @pre PRESIEVE >= 13 && <= 97.
   ///
-  PRESIEVE = 19,
+  PRESIEVE = 89,
 
   /// Pre-sieving is not used unless the sieving interval is >=
   /// PRESIEVE_THRESHOLD. (Pre-sieving is expensive to initialize.)
   ///
   PRESIEVE_THRESHOLD = 100000000,
 
-  /// Number of sieving primes per Bucket in EratSmall, EratMedium and
-  /// EratBig objects, affects performance by about 3%.
+  /// Default number of sieving primes per Bucket in EratSmall,
+  /// EratMedium and EratBig objects, affects performance by about
+  /// 3%. Can be changed at runtime using PrimeSieve::setBucketSize().
   ///
   /// - For x86-64 CPUs after  2010 use 1024
   /// - For x86-64 CPUs before 2010 use 512
@@ -94,13 +117,47 @@ enum {
   ///
   BUCKETSIZE = 1 << 10,
 
+  /// The Erat* classes are instantiated for the bucket sizes
+  /// MIN_BUCKETSIZE, 2 * MIN_BUCKETSIZE, ..., MAX_BUCKETSIZE.
+  ///
+  MIN_BUCKETSIZE = 1 << 8,
+  MAX_BUCKETSIZE = 1 << 11,
+
+  /// Sieving primes < ERATSMALL_PATTERN_LIMIT are crossed off in
+  /// EratSmall using precomputed byte patterns and AVX2/AVX-512
+  /// instructions (if supported by the CPU).
+  ///
+  ERATSMALL_PATTERN_LIMIT = 128,
+
   /// EratBig allocates BYTES_PER_ALLOC of new memory each time
-  /// it needs more buckets. Default = 8 megabytes.
+  /// it needs more buckets. Default = 8 megabytes, can be changed
+  /// at runtime using PrimeSieve::setBucketAllocSize().
   ///
   BYTES_PER_ALLOC = (1 << 20) * 8,
 
+  /// Default max number of primes per batch callback
+  /// (see BatchCallback in Callback.hpp), 1024 primes
+  /// use 8 kilobytes i.e. the batch fits into the L1 cache.
+  /// @pre BATCH_SIZE >= 64
+  ///
+  BATCH_SIZE = 1 << 10,
+
+  /// Printed primes are converted to text in a buffer of
+  /// PRINT_BUFFER_SIZE bytes (per thread) which is written
+  /// using write(2) once full, see PrimeWriter.hpp.
+  ///
+  PRINT_BUFFER_SIZE = 1 << 20,
+
+  /// In ordered ParallelPrimeSieve mode each thread buffers at
+  /// most ORDERED_BUFFER_SIZE bytes of primes (or text) until
+  /// all previous chunks are done, then it waits.
+  ///
+  ORDERED_BUFFER_SIZE = (1 << 20) * 8,
+
   /// primesieve::iterator caches at least ITERATOR_CACHE_SMALL
-  /// bytes of primes. L3_CACHE_SIZE is a good value.
+  /// bytes of primes. If the CPU's L3 cache size is detected at
+  /// runtime the L3 cache size per thread is used instead
+  /// (but at most ITERATOR_CACHE_SMALL).
   ///
   ITERATOR_CACHE_SMALL = (1 << 20) * 8,
 
@@ -110,8 +167,11 @@ enum {
   ITERATOR_CACHE_MAX = (1 << 20) * 1024
 };
 
-  /// Sieving primes <= (sieveSize in bytes * FACTOR_ERATSMALL)
-  /// are processed in EratSmall objects, speed up ~ 5%.
+  /// Sieving primes <= (blockSize in bytes * FACTOR_ERATSMALL)
+  /// are processed in EratSmall objects, speed up ~ 5%. The block
+  /// size is the sieve size or the CPU's L1 data cache size
+  /// (detected at runtime) if the sieve size is larger. Default,
+  /// can be changed at runtime using PrimeSieve::setFactorEratSmall().
   /// @pre FACTOR_ERATSMALL >= 0 && <= 3
   ///
   /// - For x86-64 CPUs after  2010 use 0.5
@@ -120,8 +180,9 @@ enum {
   ///
   const double FACTOR_ERATSMALL = 0.5;
 
-  /// Sieving primes <= (sieveSize in bytes * FACTOR_ERATMEDIUM)
+  /// Sieving primes <= (blockSize in bytes * FACTOR_ERATMEDIUM)
   /// (and > EratSmall see above) are processed in EratMedium objects.
+  /// Default, see PrimeSieve::setFactorEratMedium().
   /// @pre FACTOR_ERATMEDIUM >= 0 && <= 9
   ///
   /// Statistically ideal factor for 4th Wheel is:
@@ -142,6 +203,34 @@ enum {
   ///
   const uint64_t MAX_THREAD_INTERVAL = static_cast<uint64_t>(2e10);
 
+  /// PrimeSieve::countPrimes(start, stop) may use the
+  /// combinatorial prime counting algorithm in piLMO.cpp instead
+  /// of sieving if stop >= PI_LMO_THRESHOLD.
+  ///
+  const uint64_t PI_LMO_THRESHOLD = static_cast<uint64_t>(1e8);
+
+  /// A SieveContext keeps at most CONTEXT_CACHE_SIZE bytes of
+  /// unused sieve arrays and EratBig buckets for reuse, i.e. the
+  /// memory of small queries (stop <= 10^16) is kept, the memory
+  /// of large queries is freed.
+  ///
+  const std::size_t CONTEXT_CACHE_SIZE = (1 << 20) * 32;
+
+  /// A SieveContext caches the sieving primes <= sqrt(stop) if
+  /// sqrt(stop) <= CONTEXT_MAX_SIEVING_PRIME, uses up to
+  /// CONTEXT_MAX_SIEVING_PRIME / 30 bytes of memory.
+  ///
+  const uint_t CONTEXT_MAX_SIEVING_PRIME = 100000000;
+
+  /// The implicit SieveContext of each thread (see
+  /// SieveContext::threadContext()) lives until the thread exits
+  /// hence it uses much lower limits: it keeps at most
+  /// THREAD_CONTEXT_CACHE_SIZE bytes of unused memory and only
+  /// caches the sieving primes <= THREAD_CONTEXT_MAX_SIEVING_PRIME.
+  ///
+  const std::size_t THREAD_CONTEXT_CACHE_SIZE = (1 << 20) * 2;
+  const uint_t THREAD_CONTEXT_MAX_SIEVING_PRIME = 1 << 20;
+
 } // namespace config
 } // namespace primesieve
 
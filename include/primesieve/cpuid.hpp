@@ -0,0 +1,92 @@
+///
+/// @file   cpuid.hpp
+/// @brief  Runtime detection of CPU instruction set extensions and
+///         function attributes to compile SIMD code without having
+///         to pass e.g. -mavx2 to the compiler.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef CPUID_PRIMESIEVE_HPP
+#define CPUID_PRIMESIEVE_HPP
+
+#include <stdint.h>
+
+#if defined(__i386__) || \
+    defined(__x86_64__) || \
+    defined(_M_IX86) || \
+    defined(_M_X64)
+  #define PRIMESIEVE_X86
+#endif
+
+/// GCC >= 4.9 and Clang allow using AVX2 and AVX-512 intrinsics
+/// inside functions marked with the target attribute, MSVC
+/// allows using them without any special compiler flags.
+///
+#if defined(PRIMESIEVE_X86) && \
+   (defined(__clang__) || \
+   (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+  #define HAS_TARGET_POPCNT
+  #define TARGET_POPCNT __attribute__ ((target ("popcnt")))
+  #define HAS_TARGET_AVX2
+  #define TARGET_AVX2 __attribute__ ((target ("avx2")))
+  #if defined(__clang__) || __GNUC__ >= 5
+    #define HAS_TARGET_AVX512
+    #define TARGET_AVX512 __attribute__ ((target ("avx512f")))
+  #endif
+  #if (defined(__clang__) && __clang_major__ >= 5) || \
+      (!defined(__clang__) && __GNUC__ >= 7)
+    #define HAS_TARGET_AVX512_VPOPCNT
+    #define TARGET_AVX512_VPOPCNT __attribute__ ((target ("avx512f,avx512vpopcntdq")))
+  #endif
+#elif defined(PRIMESIEVE_X86) && defined(_MSC_VER)
+  #define HAS_TARGET_POPCNT
+  #define TARGET_POPCNT
+  #if _MSC_VER >= 1700
+    #define HAS_TARGET_AVX2
+    #define TARGET_AVX2
+  #endif
+  #if _MSC_VER >= 1911
+    #define HAS_TARGET_AVX512
+    #define TARGET_AVX512
+  #endif
+  #if _MSC_VER >= 1920
+    #define HAS_TARGET_AVX512_VPOPCNT
+    #define TARGET_AVX512_VPOPCNT
+  #endif
+#endif
+
+namespace primesieve {
+
+/// @return true if the CPU supports the POPCNT instruction.
+///
+bool has_cpuid_popcnt();
+
+/// @return true if the CPU and the operating system
+///         support the AVX2 instruction set.
+///
+bool has_cpuid_avx2();
+
+/// @return true if the CPU and the operating system
+///         support the AVX-512 foundation instructions.
+///
+bool has_cpuid_avx512();
+
+/// @return true if the CPU and the operating system support
+///         the AVX-512 VPOPCNTDQ instructions.
+///
+bool has_cpuid_avx512_vpopcnt();
+
+/// Get the size of the CPU's level 1 data, level 2 or level 3
+/// cache using the CPUID deterministic cache parameters leaf
+/// (Intel: 0x4, AMD: 0x8000001D).
+/// @return Cache size in bytes or 0 if unknown.
+///
+uint64_t get_cpuid_cache_size(int level);
+
+} // namespace primesieve
+
+#endif
@@ -0,0 +1,42 @@
+///
+/// @file   decodePrimes.hpp
+/// @brief  Reconstruct the primes from the 1 bits of a sieve
+///         array, many bits at a time.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef DECODEPRIMES_HPP
+#define DECODEPRIMES_HPP
+
+#include "config.hpp"
+
+#include <stdint.h>
+#include <cstddef>
+
+namespace primesieve {
+
+enum {
+  /// Callers that decode into a buffer on the stack decode
+  /// DECODE_WORDS 64-bit words at once, i.e. up to 1024 primes
+  /// (8 kilobytes) which fits into the L1 data cache.
+  ///
+  DECODE_WORDS = 16
+};
+
+/// Decode the primes of sieve[0, words * 8[ into the primes
+/// array. The first byte of the sieve array corresponds to the
+/// numbers [base, base + 30[.
+/// @pre   primes must have space for the number of primes + 8
+///        elements (the SIMD decoder writes up to 8 elements
+///        beyond the last prime), words * 64 always suffices.
+/// @return The number of primes written to the primes array.
+///
+std::size_t decodePrimes(const byte_t* sieve, std::size_t words, uint64_t base, uint64_t* primes);
+
+} // namespace primesieve
+
+#endif
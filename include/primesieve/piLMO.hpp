@@ -0,0 +1,35 @@
+///
+/// @file   piLMO.hpp
+/// @brief  Count the primes <= x using the combinatorial
+///         Lagarias-Miller-Odlyzko algorithm in O(x^(2/3)) operations
+///         instead of sieving the whole interval [0, x].
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef PILMO_HPP
+#define PILMO_HPP
+
+#include <stdint.h>
+
+namespace primesieve {
+
+/// Count the primes <= x, uses O(x^(1/3) * alpha) memory.
+uint64_t piLMO(uint64_t x);
+
+/// Count the primes <= x using y = alpha * x^(1/3),
+/// used for tuning.
+///
+uint64_t piLMO(uint64_t x, double alpha);
+
+/// @return true if counting the primes within [start, stop]
+///         using piLMO() is faster than sieving.
+///
+bool isPiLMOFaster(uint64_t start, uint64_t stop);
+
+} // namespace primesieve
+
+#endif
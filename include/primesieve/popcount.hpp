@@ -0,0 +1,59 @@
+///
+/// @file   popcount.hpp
+/// @brief  Count the number of 1 bits in an array, the fastest
+///         implementation supported by the CPU is selected at
+///         runtime.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef POPCOUNT_HPP
+#define POPCOUNT_HPP
+
+#include <stdint.h>
+
+namespace primesieve {
+
+/// popcount implementations
+enum {
+  /// Harley-Seal using only integer operations
+  POPCOUNT_DEFAULT,
+  /// POPCNT instruction
+  POPCOUNT_POPCNT,
+  /// Harley-Seal using AVX2 and a pshufb lookup table
+  POPCOUNT_AVX2,
+  /// AVX-512 VPOPCNTDQ instruction
+  POPCOUNT_AVX512,
+  POPCOUNT_ALGORITHMS
+};
+
+/// Count the number of 1 bits in array[0, size[ using the
+/// fastest implementation supported by the CPU.
+///
+uint64_t popcount(const uint64_t* array, uint64_t size);
+
+/// Count the number of 1 bits in array[0, size[ using
+/// the given implementation.
+/// @pre hasPopcount(algorithm)
+///
+uint64_t popcount(const uint64_t* array, uint64_t size, int algorithm);
+
+/// @return true if the popcount implementation is supported
+///         by the compiler and the CPU.
+///
+bool hasPopcount(int algorithm);
+
+/// @return The fastest popcount implementation
+///         supported by the CPU.
+///
+int getPopcount();
+
+/// @return Name of the popcount implementation e.g. "avx2".
+const char* getPopcountName(int algorithm);
+
+} // namespace primesieve
+
+#endif
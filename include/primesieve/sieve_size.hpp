@@ -0,0 +1,26 @@
+///
+/// @file   sieve_size.hpp
+/// @brief  The sieve size setting of the primesieve API functions.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef SIEVE_SIZE_HPP
+#define SIEVE_SIZE_HPP
+
+namespace primesieve {
+
+/// @return The sieve size set using set_sieve_size() or by
+///         default AUTO_SIEVE_SIZE. Unlike get_sieve_size()
+///         this is passed to PrimeSieve::setSieveSize() so
+///         that the automatic sieve size is chosen for each
+///         sieved range.
+///
+int get_sieve_size_setting();
+
+} // namespace primesieve
+
+#endif
@@ -0,0 +1,125 @@
+///
+/// @file   PerfCounters.cpp
+/// @brief  Hardware performance counters using perf_event_open(2).
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include "PerfCounters.hpp"
+
+#include <stdint.h>
+#include <cstring>
+
+#if defined(__linux__)
+  #include <linux/perf_event.h>
+  #include <sys/ioctl.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+namespace {
+
+#if defined(__linux__)
+
+/// Count user space events of the calling thread
+int openCounter(uint32_t type, uint64_t config)
+{
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  long fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  return static_cast<int>(fd);
+}
+
+uint64_t cacheReadMisses(uint64_t cache)
+{
+  return cache |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+#endif
+
+} // namespace
+
+PerfCounters::PerfCounters()
+{
+  for (int i = 0; i < COUNTERS; i++)
+  {
+    fds_[i] = -1;
+    values_[i] = 0;
+  }
+
+#if defined(__linux__)
+  fds_[CYCLES]          = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  fds_[INSTRUCTIONS]    = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  fds_[L1D_READ_MISSES] = openCounter(PERF_TYPE_HW_CACHE, cacheReadMisses(PERF_COUNT_HW_CACHE_L1D));
+  fds_[LLC_READ_MISSES] = openCounter(PERF_TYPE_HW_CACHE, cacheReadMisses(PERF_COUNT_HW_CACHE_LL));
+  fds_[BRANCH_MISSES]   = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#if defined(__linux__)
+  for (int i = 0; i < COUNTERS; i++)
+    if (fds_[i] >= 0)
+      close(fds_[i]);
+#endif
+}
+
+void PerfCounters::start()
+{
+#if defined(__linux__)
+  for (int i = 0; i < COUNTERS; i++)
+  {
+    if (fds_[i] >= 0)
+    {
+      ioctl(fds_[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(fds_[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+}
+
+void PerfCounters::stop()
+{
+#if defined(__linux__)
+  for (int i = 0; i < COUNTERS; i++)
+  {
+    if (fds_[i] >= 0)
+    {
+      ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+      uint64_t value = 0;
+      if (read(fds_[i], &value, sizeof(value)) != sizeof(value))
+        value = 0;
+      values_[i] = value;
+    }
+  }
+#endif
+}
+
+const char* PerfCounters::getName(int counter)
+{
+  const char* names[COUNTERS] =
+  {
+    "cycles",
+    "instructions",
+    "l1d_read_misses",
+    "llc_read_misses",
+    "branch_misses"
+  };
+
+  if (counter < 0 || counter >= COUNTERS)
+    return "";
+  return names[counter];
+}
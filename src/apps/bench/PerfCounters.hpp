@@ -0,0 +1,51 @@
+///
+/// @file   PerfCounters.hpp
+/// @brief  Hardware performance counters (cycles, instructions,
+///         cache and branch misses) of the calling thread using
+///         Linux perf_event_open(2). On other operating systems
+///         or if the kernel does not permit access (see
+///         /proc/sys/kernel/perf_event_paranoid) the counters
+///         are unavailable.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#ifndef PERFCOUNTERS_HPP
+#define PERFCOUNTERS_HPP
+
+#include <stdint.h>
+
+class PerfCounters
+{
+public:
+  enum
+  {
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_READ_MISSES,
+    /// Last level cache, there is no generic
+    /// perf event for the L2 cache
+    LLC_READ_MISSES,
+    BRANCH_MISSES,
+    COUNTERS
+  };
+  PerfCounters();
+  ~PerfCounters();
+  /// Reset and enable the counters
+  void start();
+  /// Disable and read the counters
+  void stop();
+  bool isAvailable(int counter) const { return fds_[counter] >= 0; }
+  uint64_t getValue(int counter) const { return values_[counter]; }
+  static const char* getName(int counter);
+private:
+  int fds_[COUNTERS];
+  uint64_t values_[COUNTERS];
+  PerfCounters(const PerfCounters&);
+  void operator=(const PerfCounters&);
+};
+
+#endif
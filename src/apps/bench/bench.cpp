@@ -0,0 +1,564 @@
+///
+/// @file   bench.cpp
+/// @brief  primesieve_bench runs micro benchmarks of the sieving
+///         kernels (PreSieve, EratSmall, EratMedium, EratBig,
+///         popcount, decodePrimes) and macro benchmarks of the
+///         public API (count, generate, iterate, nth prime) at
+///         increasing offsets and prints the results, including
+///         hardware performance counters, as JSON.
+///
+///         Usage: primesieve_bench [OPTION]...
+///         Build: make bench
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primesieve.hpp>
+#include <primesieve/config.hpp>
+#include <primesieve/CpuInfo.hpp>
+#include <primesieve/decodePrimes.hpp>
+#include <primesieve/EratBig.hpp>
+#include <primesieve/EratMedium.hpp>
+#include <primesieve/EratSmall.hpp>
+#include <primesieve/EratSettings.hpp>
+#include <primesieve/pmath.hpp>
+#include <primesieve/popcount.hpp>
+#include <primesieve/PreSieve.hpp>
+#include <primesieve/StageTimer.hpp>
+#include "../console/calculator.hpp"
+#include "PerfCounters.hpp"
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace primesieve;
+
+namespace {
+
+struct BenchOptions
+{
+  bool micro;
+  bool macro;
+  vector<uint64_t> offsets;
+  /// Macro benchmarks sieve [offset, offset + dist]
+  uint64_t dist;
+  /// Number of segments per micro benchmark
+  uint64_t segments;
+  /// Sieve size in kilobytes or AUTO_SIEVE_SIZE
+  int sieveSize;
+  int threads;
+  BenchOptions() :
+    micro(true),
+    macro(true),
+    dist(100000000),
+    segments(1000),
+    sieveSize(AUTO_SIEVE_SIZE),
+    threads(1)
+  { }
+};
+
+struct Result
+{
+  string name;
+  string type;
+  uint64_t offset;
+  uint64_t iterations;
+  /// Sieve size in kilobytes
+  int sieveSize;
+  double seconds;
+  /// e.g. the prime count, keeps the work observable
+  uint64_t checksum;
+  /// Hardware performance counters, -1 if unavailable
+  int64_t counters[PerfCounters::COUNTERS];
+};
+
+/// Measures the wall time and the hardware
+/// performance counters of the calling thread
+class Measure
+{
+public:
+  Measure(PerfCounters& counters) :
+    counters_(counters)
+  {
+    counters_.start();
+    time_ = wallTime();
+  }
+  void stop(Result& result)
+  {
+    result.seconds = wallTime() - time_;
+    counters_.stop();
+    for (int i = 0; i < PerfCounters::COUNTERS; i++)
+    {
+      result.counters[i] = -1;
+      if (counters_.isAvailable(i))
+        result.counters[i] = static_cast<int64_t>(counters_.getValue(i));
+    }
+  }
+private:
+  PerfCounters& counters_;
+  double time_;
+};
+
+/// Copies the first sieve segment, used
+/// by the popcount and decode benchmarks
+class CopySegment : public SegmentCallback
+{
+public:
+  vector<byte_t> sieve;
+  uint64_t low;
+  CopySegment() : low(0) { }
+  void callback(const uint8_t* segment, size_t bytes, uint64_t segmentLow, int)
+  {
+    if (sieve.empty())
+    {
+      sieve.assign(segment, segment + bytes);
+      low = segmentLow;
+    }
+  }
+};
+
+void help()
+{
+  cout << "Usage: primesieve_bench [OPTION]..." << endl
+       << "Benchmark primesieve and print the results as JSON." << endl
+       << endl
+       << "Options:" << endl
+       << "  --micro            Only run the micro benchmarks" << endl
+       << "  --macro            Only run the macro benchmarks" << endl
+       << "  --offsets=<N,...>  Comma separated offsets e.g. 1e10,1e12" << endl
+       << "  --dist=<N>         Macro benchmarks sieve [offset, offset + N]" << endl
+       << "  --segments=<N>     Number of segments per micro benchmark" << endl
+       << "  --size=<N>         Sieve size in kilobytes, 1 <= N <= 2048," << endl
+       << "                     default: tuned or L2 cache size / 2" << endl
+       << "  --threads=<N>      Number of threads of the macro benchmarks," << endl
+       << "                     counters only cover the main thread" << endl
+       << "  --help             Print this help menu" << endl;
+  exit(0);
+}
+
+uint64_t parseNumber(const string& str)
+{
+  return calculator::eval<uint64_t>(str);
+}
+
+BenchOptions parseOptions(int argc, char** argv)
+{
+  BenchOptions options;
+  vector<uint64_t> offsets;
+
+  for (int i = 1; i < argc; i++)
+  {
+    string arg = argv[i];
+    string value;
+    string::size_type pos = arg.find('=');
+    if (pos != string::npos)
+    {
+      value = arg.substr(pos + 1);
+      arg = arg.substr(0, pos);
+    }
+
+    if (arg == "--micro")
+      options.macro = false;
+    else if (arg == "--macro")
+      options.micro = false;
+    else if (arg == "--offsets")
+    {
+      istringstream iss(value);
+      string offset;
+      while (getline(iss, offset, ','))
+        offsets.push_back(parseNumber(offset));
+    }
+    else if (arg == "--dist")
+      options.dist = parseNumber(value);
+    else if (arg == "--segments")
+      options.segments = max<uint64_t>(1, parseNumber(value));
+    else if (arg == "--size")
+      options.sieveSize = static_cast<int>(parseNumber(value));
+    else if (arg == "--threads")
+      options.threads = static_cast<int>(parseNumber(value));
+    else
+      help();
+  }
+
+  if (!options.micro && !options.macro)
+    options.micro = options.macro = true;
+
+  options.offsets = offsets;
+  if (offsets.empty())
+  {
+    uint64_t defaults[] = { 100000000ull, 10000000000ull, 1000000000000ull,
+                            100000000000000ull, 10000000000000000ull,
+                            1000000000000000000ull, 10000000000000000000ull };
+    options.offsets.assign(defaults, defaults + 7);
+  }
+
+  if (options.sieveSize != AUTO_SIEVE_SIZE)
+    options.sieveSize = getInBetween(1, options.sieveSize, 2048);
+  options.threads = max(1, options.threads);
+  set_sieve_size(options.sieveSize);
+  set_num_threads(options.threads);
+
+  return options;
+}
+
+/// Sieving primes of one of the erat* objects, like
+/// SieveOfEratosthenes::addSievingPrime() a sieving prime is
+/// added once its square is within the current segment.
+///
+class SievingPrimesList
+{
+public:
+  SievingPrimesList(uint64_t low, uint64_t high) :
+    i_(0)
+  {
+    if (low < high)
+      generate_primes(low + 1, high, &primes_);
+  }
+  bool empty() const { return primes_.empty(); }
+  /// Number of sieving primes added so far
+  uint64_t count() const { return i_; }
+  template <typename T>
+  void add(T& erat, uint64_t segmentLow, uint64_t segmentHigh)
+  {
+    for (; i_ < primes_.size() && isquare<uint64_t>(primes_[i_]) <= segmentHigh; i_++)
+      erat.addSievingPrime(primes_[i_], segmentLow);
+  }
+private:
+  vector<uint_t> primes_;
+  size_t i_;
+};
+
+/// @return The sieve size in kilobytes used for sieving up to stop
+int getSieveSize(const BenchOptions& options, uint64_t stop)
+{
+  PrimeSieve ps;
+  ps.setSieveSize(options.sieveSize);
+  ps.setStop(stop);
+  return ps.getSieveSize();
+}
+
+/// Runs the sieving kernels on options.segments consecutive
+/// segments starting at offset, mirrors the setup of
+/// SieveOfEratosthenes::init(). The timings of the erat*
+/// kernels include adding their sieving primes.
+///
+void microBenchmarks(const BenchOptions& options,
+                     uint64_t offset,
+                     PerfCounters& counters,
+                     vector<Result>& results)
+{
+  uint64_t segmentLow = offset - offset % NUMBERS_PER_BYTE;
+  uint64_t maxStop = get_max_stop();
+  if (segmentLow >= maxStop)
+    return;
+
+  int kilobytes = getSieveSize(options, offset);
+  uint_t sieveSize = static_cast<uint_t>(kilobytes) * 1024;
+  uint_t blockSize = sieveSize;
+  if (cpuInfo().hasL1dCache())
+    blockSize = min(blockSize, floorPowerOf2(static_cast<uint_t>(cpuInfo().l1dCacheSize())));
+
+  EratSettings settings;
+  uint_t limitSmall  = static_cast<uint_t>(blockSize * settings.factorEratSmall);
+  uint_t limitMedium = static_cast<uint_t>(blockSize * settings.factorEratMedium);
+  uint_t limitPreSieve = config::PRESIEVE;
+
+  uint64_t segments = options.segments;
+  uint64_t interval = sieveSize * NUMBERS_PER_BYTE;
+  segments = min(segments, (maxStop - segmentLow) / interval);
+  if (segments == 0)
+    return;
+
+  uint64_t stop = segmentLow + segments * interval - 1;
+  uint64_t sqrtStop = isqrt(stop);
+  vector<byte_t> sieve(sieveSize);
+  byte_t* begin = &sieve[0];
+
+  Result result;
+  result.type = "micro";
+  result.offset = offset;
+  result.iterations = segments;
+  result.sieveSize = kilobytes;
+
+  {
+    PreSieve preSieve(limitPreSieve);
+    Measure measure(counters);
+    uint64_t low = segmentLow;
+    for (uint64_t i = 0; i < segments; i++, low += interval)
+      for (uint_t j = 0; j < sieveSize; j += blockSize)
+        preSieve.doIt(&begin[j], min(blockSize, sieveSize - j), low + j * NUMBERS_PER_BYTE);
+    measure.stop(result);
+    result.name = "PreSieve::doIt";
+    result.checksum = begin[sieveSize - 1];
+    results.push_back(result);
+  }
+
+  SievingPrimesList smallPrimes(limitPreSieve, min<uint64_t>(limitSmall, sqrtStop));
+  if (!smallPrimes.empty())
+  {
+    EratSmall* eratSmall = EratSmall::create(stop, blockSize, limitSmall, settings.bucketSize);
+    Measure measure(counters);
+    uint64_t low = segmentLow;
+    for (uint64_t i = 0; i < segments; i++, low += interval)
+    {
+      smallPrimes.add(*eratSmall, low, low + interval + 1);
+      for (uint_t j = 0; j < sieveSize; j += blockSize)
+        eratSmall->crossOff(&begin[j], &begin[min(j + blockSize, sieveSize)]);
+    }
+    measure.stop(result);
+    delete eratSmall;
+    result.name = "EratSmall::crossOff";
+    result.checksum = smallPrimes.count();
+    results.push_back(result);
+  }
+
+  SievingPrimesList mediumPrimes(limitSmall, min<uint64_t>(limitMedium, sqrtStop));
+  if (!mediumPrimes.empty())
+  {
+    EratMedium* eratMedium = EratMedium::create(stop, sieveSize, limitMedium, settings.bucketSize);
+    Measure measure(counters);
+    uint64_t low = segmentLow;
+    for (uint64_t i = 0; i < segments; i++, low += interval)
+    {
+      mediumPrimes.add(*eratMedium, low, low + interval + 1);
+      eratMedium->crossOff(begin, sieveSize);
+    }
+    measure.stop(result);
+    delete eratMedium;
+    result.name = "EratMedium::crossOff";
+    result.checksum = mediumPrimes.count();
+    results.push_back(result);
+  }
+
+  SievingPrimesList bigPrimes(limitMedium, sqrtStop);
+  if (!bigPrimes.empty())
+  {
+    EratBig* eratBig = EratBig::create(stop, sieveSize, static_cast<uint_t>(sqrtStop), settings.bucketSize, settings.bytesPerAlloc, settings.hugePages);
+    Measure measure(counters);
+    uint64_t low = segmentLow;
+    for (uint64_t i = 0; i < segments; i++, low += interval)
+    {
+      bigPrimes.add(*eratBig, low, low + interval + 1);
+      eratBig->crossOff(begin);
+    }
+    measure.stop(result);
+    delete eratBig;
+    result.name = "EratBig::crossOff";
+    result.checksum = bigPrimes.count();
+    results.push_back(result);
+  }
+
+  // popcount and decodePrimes use a real sieve segment
+  CopySegment segment;
+  PrimeSieve ps;
+  ps.setSieveSize(kilobytes);
+  ps.callbackSegments(max<uint64_t>(offset, 7), min(offset + interval, maxStop), &segment);
+  size_t words = segment.sieve.size() / 8;
+  const uint64_t* sieve64 = reinterpret_cast<const uint64_t*>(&segment.sieve[0]);
+
+  {
+    uint64_t sum = 0;
+    Measure measure(counters);
+    for (uint64_t i = 0; i < segments; i++)
+      sum += popcount(sieve64, words);
+    measure.stop(result);
+    result.name = "popcount";
+    result.checksum = sum;
+    results.push_back(result);
+  }
+
+  {
+    uint64_t sum = 0;
+    vector<uint64_t> primes(words * 64 + 8);
+    Measure measure(counters);
+    for (uint64_t i = 0; i < segments; i++)
+    {
+      size_t n = decodePrimes(&segment.sieve[0], words, segment.low, &primes[0]);
+      sum += primes[n / 2];
+    }
+    measure.stop(result);
+    result.name = "decodePrimes";
+    result.checksum = sum;
+    results.push_back(result);
+  }
+}
+
+void macroBenchmarks(const BenchOptions& options,
+                     uint64_t offset,
+                     PerfCounters& counters,
+                     vector<Result>& results)
+{
+  uint64_t maxStop = get_max_stop();
+  if (offset >= maxStop)
+    return;
+
+  uint64_t stop = offset + min(options.dist, maxStop - offset);
+  bool parallel = options.threads > 1;
+
+  Result result;
+  result.type = "macro";
+  result.offset = offset;
+  result.iterations = 1;
+  result.sieveSize = getSieveSize(options, stop);
+
+  {
+    Measure measure(counters);
+    uint64_t count = (parallel) ? parallel_count_primes(offset, stop) : count_primes(offset, stop);
+    measure.stop(result);
+    result.checksum = count;
+    result.name = "count_primes";
+    results.push_back(result);
+  }
+
+  {
+    vector<uint64_t> primes;
+    Measure measure(counters);
+    if (parallel)
+      parallel_generate_primes(offset, stop, &primes);
+    else
+      generate_primes(offset, stop, &primes);
+    measure.stop(result);
+    result.name = "generate_primes";
+    result.checksum = primes.size();
+    results.push_back(result);
+  }
+
+  {
+    uint64_t count = 0;
+    Measure measure(counters);
+    primesieve::iterator it(offset);
+    for (uint64_t prime = it.next_prime(); prime <= stop; prime = it.next_prime())
+      count++;
+    measure.stop(result);
+    result.name = "iterator";
+    result.checksum = count;
+    results.push_back(result);
+  }
+
+  {
+    // about as many primes as within [offset, stop]
+    double x = static_cast<double>(max<uint64_t>(offset, 3));
+    int64_t n = static_cast<int64_t>(options.dist / log(x)) + 1;
+    Measure measure(counters);
+    uint64_t prime = (parallel) ? parallel_nth_prime(n, offset) : nth_prime(n, offset);
+    measure.stop(result);
+    result.checksum = prime;
+    result.name = "nth_prime";
+    results.push_back(result);
+  }
+}
+
+string jsonString(const string& str)
+{
+  string json = "\"";
+  for (size_t i = 0; i < str.size(); i++)
+  {
+    if (str[i] == '"' || str[i] == '\\')
+      json += '\\';
+    json += str[i];
+  }
+  return json + "\"";
+}
+
+string compilerName()
+{
+  ostringstream oss;
+#if defined(__clang__)
+  oss << "clang " << __clang_major__ << "." << __clang_minor__;
+#elif defined(__GNUC__)
+  oss << "gcc " << __GNUC__ << "." << __GNUC_MINOR__;
+#elif defined(_MSC_VER)
+  oss << "msvc " << _MSC_VER;
+#else
+  oss << "unknown";
+#endif
+  return oss.str();
+}
+
+void printJson(const BenchOptions& options, const vector<Result>& results)
+{
+  cout << "{" << endl;
+  cout << "  \"version\": " << jsonString(primesieve_version()) << "," << endl;
+  cout << "  \"compiler\": " << jsonString(compilerName()) << "," << endl;
+  cout << "  \"threads\": " << options.threads << "," << endl;
+  cout << "  \"l1d_cache_size\": " << cpuInfo().l1dCacheSize() << "," << endl;
+  cout << "  \"l2_cache_size\": " << cpuInfo().l2CacheSize() << "," << endl;
+  cout << "  \"l3_cache_size\": " << cpuInfo().l3CacheSize() << "," << endl;
+  cout << "  \"benchmarks\": [";
+
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const Result& r = results[i];
+    double nsPerIter = r.seconds * 1e9 / static_cast<double>(r.iterations);
+
+    cout << ((i > 0) ? "," : "") << endl;
+    cout << "    {" << endl;
+    cout << "      \"name\": " << jsonString(r.name) << "," << endl;
+    cout << "      \"type\": " << jsonString(r.type) << "," << endl;
+    cout << "      \"offset\": " << r.offset << "," << endl;
+    cout << "      \"iterations\": " << r.iterations << "," << endl;
+    cout << "      \"sieve_size_kb\": " << r.sieveSize << "," << endl;
+    cout << "      \"seconds\": " << r.seconds << "," << endl;
+    cout << "      \"ns_per_iteration\": " << nsPerIter << "," << endl;
+    cout << "      \"checksum\": " << r.checksum << "," << endl;
+    cout << "      \"counters\": {";
+
+    for (int j = 0; j < PerfCounters::COUNTERS; j++)
+    {
+      cout << ((j > 0) ? ", " : " ") << jsonString(PerfCounters::getName(j)) << ": ";
+      if (r.counters[j] >= 0)
+        cout << r.counters[j];
+      else
+        cout << "null";
+    }
+
+    cout << " }" << endl;
+    cout << "    }";
+  }
+
+  cout << endl << "  ]" << endl;
+  cout << "}" << endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  BenchOptions options = parseOptions(argc, argv);
+  PerfCounters counters;
+  vector<Result> results;
+
+  try
+  {
+    for (size_t i = 0; i < options.offsets.size(); i++)
+    {
+      uint64_t offset = options.offsets[i];
+      cerr << "Offset " << offset << "..." << endl;
+      if (options.micro)
+        microBenchmarks(options, offset, counters, results);
+      if (options.macro)
+        macroBenchmarks(options, offset, counters, results);
+    }
+  }
+  catch (exception& e)
+  {
+    cerr << "Error: " << e.what() << "." << endl;
+    return 1;
+  }
+
+  printJson(options, results);
+
+  return 0;
+}
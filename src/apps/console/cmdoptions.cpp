@@ -10,10 +10,12 @@
 ///
 
 #include <primesieve.hpp>
+#include <primesieve/TuningProfile.hpp>
 #include "cmdoptions.hpp"
 #include "calculator.hpp"
 
 #include <string>
+#include <iostream>
 #include <map>
 #include <exception>
 #include <cstdlib>
@@ -42,17 +44,25 @@ struct Option
 
 enum OptionValues
 {
+  OPTION_BACKEND,
+  OPTION_BUILD_PI_INDEX,
   OPTION_COUNT,
+  OPTION_DELTA,
+  OPTION_FD,
   OPTION_HELP,
   OPTION_NTHPRIME,
   OPTION_NUMBER,
   OPTION_DISTANCE,
+  OPTION_PI_INDEX,
   OPTION_PRINT,
   OPTION_QUIET,
   OPTION_SIZE,
+  OPTION_STATS,
+  OPTION_STORE,
   OPTION_TEST,
   OPTION_THREADS,
   OPTION_TIME,
+  OPTION_TUNE,
   OPTION_VERSION
 };
 
@@ -61,8 +71,12 @@ map<string, OptionValues> optionMap;
 
 void initOptionMap()
 {
+  optionMap["--backend"]  = OPTION_BACKEND;
+  optionMap["--build-pi-index"] = OPTION_BUILD_PI_INDEX;
   optionMap["-c"]         = OPTION_COUNT;
   optionMap["--count"]    = OPTION_COUNT;
+  optionMap["--delta"]    = OPTION_DELTA;
+  optionMap["--fd"]       = OPTION_FD;
   optionMap["-h"]         = OPTION_HELP;
   optionMap["--help"]     = OPTION_HELP;
   optionMap["-n"]         = OPTION_NTHPRIME;
@@ -72,16 +86,20 @@ void initOptionMap()
   optionMap["--dist"]     = OPTION_DISTANCE;
   optionMap["-o"]         = OPTION_DISTANCE;
   optionMap["--offset"]   = OPTION_DISTANCE;
+  optionMap["--pi-index"] = OPTION_PI_INDEX;
   optionMap["-p"]         = OPTION_PRINT;
   optionMap["--print"]    = OPTION_PRINT;
   optionMap["-q"]         = OPTION_QUIET;
   optionMap["--quiet"]    = OPTION_QUIET;
   optionMap["-s"]         = OPTION_SIZE;
   optionMap["--size"]     = OPTION_SIZE;
+  optionMap["--stats"]    = OPTION_STATS;
+  optionMap["--store"]    = OPTION_STORE;
   optionMap["--test"]     = OPTION_TEST;
   optionMap["-t"]         = OPTION_THREADS;
   optionMap["--threads"]  = OPTION_THREADS;
   optionMap["--time"]     = OPTION_TIME;
+  optionMap["--tune"]     = OPTION_TUNE;
   optionMap["-v"]         = OPTION_VERSION;
   optionMap["--version"]  = OPTION_VERSION;
 }
@@ -92,6 +110,30 @@ void test()
   exit(ok ? 0 : 1);
 }
 
+/// Benchmark sieve sizes, save the
+/// fastest settings and exit
+///
+void tuneProfile()
+{
+  try
+  {
+    TuningProfile& profile = tuningProfile();
+    profile.tune(&cout);
+    string filename = TuningProfile::getDefaultFilename();
+    if (!filename.empty())
+    {
+      profile.save(filename);
+      cout << "Tuning profile saved to " << filename << endl;
+    }
+  }
+  catch (exception& e)
+  {
+    cerr << "Error: " << e.what() << "." << endl;
+    exit(1);
+  }
+  exit(0);
+}
+
 int check(int primeType)
 {
   primeType--;
@@ -121,6 +163,18 @@ int getPrintFlags(int n)
   return PrimeSieve::PRINT_PRIMES << check(n);
 }
 
+/// e.g. "--backend=threads" -> THREAD_POOL_BACKEND
+int getBackend(const string& name)
+{
+  if (name == "openmp")
+    return ParallelPrimeSieve::OPENMP_BACKEND;
+  if (name == "threads")
+    return ParallelPrimeSieve::THREAD_POOL_BACKEND;
+
+  help();
+  return ParallelPrimeSieve::DEFAULT_BACKEND;
+}
+
 /// e.g. "--threads=8" -> (id = "--threads", value = "8")
 Option makeOption(const string& str)
 {
@@ -169,12 +223,20 @@ PrimeSieveOptions parseOptions(int argc, char** argv)
                               break;
         case OPTION_SIZE:     pso.sieveSize = option.getValue<int>(); break;
         case OPTION_THREADS:  pso.threads = option.getValue<int>(); break;
+        case OPTION_BACKEND:  pso.backend = getBackend(option.value); break;
+        case OPTION_FD:       pso.fd = option.getValue<int>(); break;
+        case OPTION_PI_INDEX: pso.piIndex = option.value; break;
+        case OPTION_BUILD_PI_INDEX: pso.buildPiIndex = option.value; break;
+        case OPTION_STORE:    pso.store = option.value; break;
+        case OPTION_DELTA:    pso.delta = true; break;
+        case OPTION_STATS:    pso.stats = true; break;
         case OPTION_QUIET:    pso.quiet = true; break;
         case OPTION_NTHPRIME: pso.nthPrime = true; break;
         case OPTION_TIME:     pso.time = true; break;
         case OPTION_NUMBER:   pso.numbers.push_back(option.getValue<uint64_t>()); break;
         case OPTION_DISTANCE: pso.numbers.push_back(option.getValue<uint64_t>() + pso.numbers.front()); break;
         case OPTION_TEST:     test(); break;
+        case OPTION_TUNE:     tuneProfile(); break;
         case OPTION_VERSION:  version(); break;
         case OPTION_HELP:     help(); break;
       }
@@ -189,6 +251,10 @@ PrimeSieveOptions parseOptions(int argc, char** argv)
       pso.numbers.size() > 2)
     help();
 
+  if (!pso.buildPiIndex.empty() &&
+      pso.numbers.size() != 1)
+    help();
+
   if (!pso.quiet)
     pso.time = true;
 
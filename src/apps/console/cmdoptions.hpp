@@ -11,25 +11,37 @@
 #define CMDOPTIONS_HPP
 
 #include <deque>
+#include <string>
 #include <stdint.h>
 
 struct PrimeSieveOptions
 {
   std::deque<uint64_t> numbers;
+  std::string piIndex;
+  std::string buildPiIndex;
+  std::string store;
   int flags;
   int sieveSize;
   int threads;
+  int backend;
+  int fd;
   bool quiet;
   bool nthPrime;
   bool time;
+  bool delta;
+  bool stats;
 
   PrimeSieveOptions() :
     flags(0),
     sieveSize(0),
     threads(0),
+    backend(0),
+    fd(0),
     quiet(false),
     nthPrime(false),
-    time(false)
+    time(false),
+    delta(false),
+    stats(false)
   { }
 };
 
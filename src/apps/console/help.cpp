@@ -26,19 +26,33 @@ const string helpMenu(
   "\n"
   "Options:\n"
   "\n"
+  "          --backend=<B>    Multi-threading backend: openmp or threads\n"
+  "          --build-pi-index=<FILE>\n"
+  "                           Build a pi(x) index file up to STOP and exit\n"
   "  -c[N+], --count[=N+]     Count primes and prime k-tuplets, 1 <= N <= 6\n"
   "                           N: 1 = primes, 2 = twins, 3 = triplets, ...\n"
   "  -d<N>,  --dist=<N>       Sieve the interval [START, START + N]\n"
+  "          --delta          Use the delta-varint format with --store\n"
+  "          --fd=<N>         Write the printed primes to file descriptor N\n"
+  "                           (default 1 = stdout), e.g. --fd=3 3>primes.txt\n"
   "  -h,     --help           Print this help menu\n"
   "  -n,     --nthprime       Calculate the nth prime,\n"
   "                           e.g. 1 100 -n finds the 1st prime > 100\n"
+  "          --pi-index=<FILE>\n"
+  "                           Use a pi(x) index file to count primes\n"
   "  -p[N],  --print[=N]      Print primes or prime k-tuplets, 1 <= N <= 6\n"
   "                           N: 1 = primes, 2 = twins, 3 = triplets, ...\n"
   "  -q,     --quiet          Quiet mode, prints less output\n"
   "  -s<N>,  --size=<N>       Set the sieve size in kilobytes, 1 <= N <= 2048\n"
+  "          --stats          Print the time spent in each sieving stage\n"
+  "          --store=<FILE>   Store the primes in a binary prime file\n"
+  "                           (sieve bitmap, 30 numbers per byte)\n"
   "          --test           Run various sieving tests and exit\n"
   "  -t<N>,  --threads=<N>    Set the number of threads, 1 <= N <= CPU cores\n"
   "          --time           Print the time elapsed in seconds\n"
+  "          --tune           Benchmark sieve sizes, bucket sizes and erat\n"
+  "                           factors on this machine, save the fastest\n"
+  "                           to ~/.primesieve_tuning and exit\n"
   "  -v,     --version        Print version and license information\n"
   "\n"
   "Examples:\n"
@@ -47,7 +61,14 @@ const string helpMenu(
   "  $ primesieve 1e6 --print\n"
   "\n"
   "  Count the twin primes inside [10^9, 10^9 + 2^32]\n"
-  "  $ primesieve 1e9 --dist=2**32 -c2"
+  "  $ primesieve 1e9 --dist=2**32 -c2\n"
+  "\n"
+  "  Build a pi(x) index up to 10^12 and use it to count the primes\n"
+  "  $ primesieve 1e12 --build-pi-index=pi.idx\n"
+  "  $ primesieve 5e11 9e11 --pi-index=pi.idx\n"
+  "\n"
+  "  Store the primes below 10^10 in a binary prime file\n"
+  "  $ primesieve 1e10 --store=primes.bin"
 );
 
 } // end namespace
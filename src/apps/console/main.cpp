@@ -10,6 +10,8 @@
 ///
 
 #include <primesieve/ParallelPrimeSieve.hpp>
+#include <primesieve/PiIndex.hpp>
+#include <primesieve.hpp>
 #include "cmdoptions.hpp"
 
 #include <iostream>
@@ -70,6 +72,33 @@ void printResults(ParallelPrimeSieve& pps,
          << endl;
 }
 
+/// Print the time spent in each stage (summed over
+/// all threads) and the idle time of each thread.
+///
+void printStats(const SieveStats& stats)
+{
+  double total = 0;
+  for (int i = 0; i < SieveStats::STAGES; i++)
+    total += stats.seconds[i];
+
+  cout << endl << left;
+  for (int i = 0; i < SieveStats::STAGES; i++)
+  {
+    double percent = (total > 0) ? stats.seconds[i] * 100 / total : 0;
+    cout << setw(17) << SieveStats::getStageName(i) << " : "
+         << fixed << setprecision(3) << stats.seconds[i] << " s ("
+         << setprecision(1) << percent << "%)" << endl;
+  }
+
+  cout << setw(17) << "Segments" << " : " << stats.segments << endl;
+  cout << setw(17) << "Bucket allocs" << " : " << stats.bucketAllocs << endl;
+  cout << setw(17) << "Huge pages" << " : " << stats.hugePageBytes / (1 << 20) << " MB" << endl;
+
+  for (size_t i = 0; i < stats.threadIdle.size(); i++)
+    cout << "Thread " << setw(10) << i << " : idle "
+         << setprecision(3) << stats.threadIdle[i] << " s" << endl;
+}
+
 /// Used to count and print primes and prime k-tuplets
 void sieve(PrimeSieveOptions& options)
 {
@@ -78,8 +107,10 @@ void sieve(PrimeSieveOptions& options)
 
   if (options.flags     != 0) pps.setFlags(options.flags);
   if (options.sieveSize != 0) pps.setSieveSize(options.sieveSize);
+  if (options.backend   != 0) pps.setBackend(options.backend);
   if (options.threads   != 0) pps.setNumThreads(options.threads);
-  else if (pps.isPrint())     pps.setNumThreads(1);
+  if (options.fd        != 0) pps.setPrintFd(options.fd);
+  if (options.stats)          pps.setStats(true);
 
   if (numbers.size() < 2)
     numbers.push_front(0);
@@ -87,18 +118,29 @@ void sieve(PrimeSieveOptions& options)
   pps.setStart(numbers[0]);
   pps.setStop (numbers[1]);
 
+  // the pi(x) index is only used for counting primes
+  bool usePiIndex = !options.piIndex.empty() &&
+                    pps.getFlags() == pps.COUNT_PRIMES;
+
   if (!options.quiet)
   {
     cout << "Sieve size = " << pps.getSieveSize() << " kilobytes" << endl;
     cout << "Threads    = " << pps.getNumThreads() << endl;
 
     // enable printing status
-    if (!pps.isPrint())
+    if (!pps.isPrint() && !usePiIndex)
       pps.addFlags(pps.PRINT_STATUS);
   }
 
-  pps.sieve();
+  if (usePiIndex)
+    pps.countPrimes(numbers[0], numbers[1]);
+  else
+    pps.sieve();
+
   printResults(pps, options);
+
+  if (pps.isStats())
+    printStats(pps.getStats());
 }
 
 void nthPrime(PrimeSieveOptions& options)
@@ -108,6 +150,7 @@ void nthPrime(PrimeSieveOptions& options)
 
   if (options.flags     != 0) pps.setFlags(options.flags);
   if (options.sieveSize != 0) pps.setSieveSize(options.sieveSize);
+  if (options.backend   != 0) pps.setBackend(options.backend);
   if (options.threads   != 0) pps.setNumThreads(options.threads);
 
   if (numbers.size() < 2)
@@ -124,6 +167,47 @@ void nthPrime(PrimeSieveOptions& options)
          << pps.getSeconds() << endl;
 }
 
+/// Build a pi(x) index file up to STOP, then load
+/// and check it.
+///
+void buildPiIndex(PrimeSieveOptions& options)
+{
+  if (options.threads != 0) set_num_threads(options.threads);
+  if (options.backend != 0) set_thread_backend(options.backend);
+
+  uint64_t stop = options.numbers[0];
+  const string& filename = options.buildPiIndex;
+
+  build_pi_index(filename, stop);
+  load_pi_index(filename);
+  bool ok = check_pi_index();
+
+  cout << "Checkpoints : " << PiIndex::get()->getCheckpoints() << endl;
+  cout << "Check       : " << (ok ? "OK" : "ERROR") << endl;
+
+  if (!ok)
+    throw primesieve_error("pi(x) index check failed");
+}
+
+/// Store the primes within [START, STOP] in a binary prime file
+void storePrimes(PrimeSieveOptions& options)
+{
+  PrimeSieve ps;
+  deque<uint64_t>& numbers = options.numbers;
+
+  if (options.sieveSize != 0) ps.setSieveSize(options.sieveSize);
+  if (numbers.size() < 2)
+    numbers.push_front(0);
+
+  int format = options.delta ? DELTA_FORMAT : BITMAP_FORMAT;
+  ps.storePrimes(numbers[0], numbers[1], options.store, format);
+
+  cout << "Primes  : " << ps.getPrimeCount() << endl;
+  if (options.time)
+    cout << "Seconds : " << fixed << setprecision(3)
+         << ps.getSeconds() << endl;
+}
+
 } // namespace
 
 int main(int argc, char** argv)
@@ -133,8 +217,19 @@ int main(int argc, char** argv)
 
   try
   {
+    if (!options.buildPiIndex.empty())
+    {
+      buildPiIndex(options);
+      return 0;
+    }
+
+    if (!options.piIndex.empty())
+      load_pi_index(options.piIndex);
+
     if (isNthPrime)
       nthPrime(options);
+    else if (!options.store.empty())
+      storePrimes(options);
     else
       sieve(options);
   }
@@ -44,13 +44,29 @@ SOURCES += \
   ../../primesieve/EratBig.cpp \
   ../../primesieve/EratMedium.cpp \
   ../../primesieve/EratSmall.cpp \
+  ../../primesieve/HugePages.cpp \
+  ../../primesieve/cpuid.cpp \
+  ../../primesieve/CpuInfo.cpp \
+  ../../primesieve/decodePrimes.cpp \
+  ../../primesieve/iterator.cpp \
   ../../primesieve/ParallelPrimeSieve.cpp \
+  ../../primesieve/PiIndex.cpp \
+  ../../primesieve/piLMO.cpp \
   ../../primesieve/popcount.cpp \
   ../../primesieve/PreSieve.cpp \
+  ../../primesieve/PrimeFile.cpp \
   ../../primesieve/PrimeFinder.cpp \
   ../../primesieve/PrimeGenerator.cpp \
+  ../../primesieve/PrimeWriter.cpp \
+  ../../primesieve/primesieve-api.cpp \
+  ../../primesieve/PrimeSieve-nthPrime.cpp \
   ../../primesieve/PrimeSieve.cpp \
+  ../../primesieve/SieveContext.cpp \
   ../../primesieve/SieveOfEratosthenes.cpp \
+  ../../primesieve/SieveStats.cpp \
+  ../../primesieve/SievingPrimes.cpp \
+  ../../primesieve/ThreadPool.cpp \
+  ../../primesieve/TuningProfile.cpp \
   ../../primesieve/WheelFactorization.cpp
 
 # ---------------------------------------------------------
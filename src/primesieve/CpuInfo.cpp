@@ -0,0 +1,277 @@
+///
+/// @file   CpuInfo.cpp
+/// @brief  Runtime detection of the CPU's cache sizes and number of
+///         cores on Linux, Mac OS X and Windows. On x86 CPUs the
+///         cache sizes can also be detected using CPUID.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primesieve/config.hpp>
+#include <primesieve/CpuInfo.hpp>
+#include <primesieve/cpuid.hpp>
+
+#include <stdint.h>
+#include <cstddef>
+
+#if defined(_WIN32) || defined(_WIN64)
+
+#include <windows.h>
+#include <vector>
+
+#elif defined(__APPLE__)
+
+#include <sys/types.h>
+#include <sys/sysctl.h>
+
+#else
+
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#endif
+
+namespace {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+typedef BOOL (WINAPI *LPFN_GLPI)(PSYSTEM_LOGICAL_PROCESSOR_INFORMATION, PDWORD);
+
+int countBits(ULONG_PTR mask)
+{
+  int bits = 0;
+  for (; mask != 0; mask &= mask - 1)
+    bits++;
+  return bits;
+}
+
+#elif defined(__APPLE__)
+
+/// @return Value of the sysctl or 0 if an error occurred
+uint64_t getSysctl(const char* name)
+{
+  uint64_t value = 0;
+  std::size_t size = sizeof(value);
+  if (sysctlbyname(name, &value, &size, NULL, 0) != 0)
+    return 0;
+  // 32-bit values are stored in the low
+  // bytes on little endian CPUs
+  if (size == sizeof(uint32_t))
+    value &= 0xffffffffu;
+  return value;
+}
+
+#else
+
+/// @return First line of the file or an
+///         empty string if the file does not exist.
+///
+std::string getString(const std::string& filename)
+{
+  std::ifstream file(filename.c_str());
+  std::string str;
+  if (file)
+    std::getline(file, str);
+  return str;
+}
+
+/// Convert a cache size like e.g. "32K" or "8M" to bytes.
+uint64_t getCacheSize(const std::string& str)
+{
+  std::istringstream iss(str);
+  uint64_t size = 0;
+  char unit = 0;
+  iss >> size >> unit;
+
+  switch (unit)
+  {
+    case 'K': return size << 10;
+    case 'M': return size << 20;
+    case 'G': return size << 30;
+  }
+
+  return size;
+}
+
+/// Count the CPUs of a sysfs CPU list like e.g. "0-3,8-11".
+int countCpus(const std::string& list)
+{
+  std::istringstream iss(list);
+  std::string range;
+  int cpus = 0;
+
+  while (std::getline(iss, range, ','))
+  {
+    std::size_t pos = range.find('-');
+    if (pos == std::string::npos)
+      cpus += 1;
+    else
+    {
+      int first = std::atoi(range.substr(0, pos).c_str());
+      int last = std::atoi(range.substr(pos + 1).c_str());
+      cpus += last - first + 1;
+    }
+  }
+
+  return cpus;
+}
+
+#endif
+
+} // namespace
+
+namespace primesieve {
+
+CpuInfo::CpuInfo() :
+  l1dCacheSize_(0),
+  l2CacheSize_(0),
+  l3CacheSize_(0),
+  l3Sharing_(1),
+  cpuCores_(0),
+  cpuThreads_(0)
+{
+  init();
+  initCpuid();
+  check();
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+
+/// Uses GetLogicalProcessorInformation(),
+/// available since Windows XP SP3.
+///
+void CpuInfo::init()
+{
+  LPFN_GLPI glpi = (LPFN_GLPI) GetProcAddress(GetModuleHandle(TEXT("kernel32")), "GetLogicalProcessorInformation");
+
+  // GetLogicalProcessorInformation not supported
+  if (glpi == NULL)
+    return;
+
+  DWORD bytes = 0;
+  glpi(NULL, &bytes);
+  std::size_t size = bytes / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
+  if (size == 0)
+    return;
+
+  std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(size);
+  if (!glpi(&info[0], &bytes))
+    return;
+
+  for (std::size_t i = 0; i < size; i++)
+  {
+    if (info[i].Relationship == RelationProcessorCore)
+    {
+      cpuCores_++;
+      cpuThreads_ += countBits(info[i].ProcessorMask);
+    }
+
+    if (info[i].Relationship == RelationCache &&
+        (info[i].Cache.Type == CacheData ||
+         info[i].Cache.Type == CacheUnified))
+    {
+      switch (info[i].Cache.Level)
+      {
+        case 1: l1dCacheSize_ = info[i].Cache.Size; break;
+        case 2: l2CacheSize_ = info[i].Cache.Size; break;
+        case 3: l3CacheSize_ = info[i].Cache.Size;
+                l3Sharing_ = countBits(info[i].ProcessorMask);
+                break;
+      }
+    }
+  }
+}
+
+#elif defined(__APPLE__)
+
+void CpuInfo::init()
+{
+  l1dCacheSize_ = getSysctl("hw.l1dcachesize");
+  l2CacheSize_ = getSysctl("hw.l2cachesize");
+  l3CacheSize_ = getSysctl("hw.l3cachesize");
+  cpuCores_ = static_cast<int>(getSysctl("hw.physicalcpu"));
+  cpuThreads_ = static_cast<int>(getSysctl("hw.logicalcpu"));
+  // The L3 cache is shared by all CPU cores
+  l3Sharing_ = cpuThreads_;
+}
+
+#else
+
+/// Read the cache topology of the first CPU core
+/// from sysfs (Linux).
+///
+void CpuInfo::init()
+{
+  for (int i = 0; i < 16; i++)
+  {
+    std::ostringstream path;
+    path << "/sys/devices/system/cpu/cpu0/cache/index" << i << "/";
+    std::string type = getString(path.str() + "type");
+    if (type.empty())
+      break;
+    if (type != "Data" && type != "Unified")
+      continue;
+
+    int level = std::atoi(getString(path.str() + "level").c_str());
+    uint64_t size = getCacheSize(getString(path.str() + "size"));
+
+    switch (level)
+    {
+      case 1: l1dCacheSize_ = size; break;
+      case 2: l2CacheSize_ = size; break;
+      case 3: l3CacheSize_ = size;
+              l3Sharing_ = countCpus(getString(path.str() + "shared_cpu_list"));
+              break;
+    }
+  }
+
+#if defined(_SC_NPROCESSORS_ONLN)
+  cpuThreads_ = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+#endif
+  int threadsPerCore = countCpus(getString("/sys/devices/system/cpu/cpu0/topology/thread_siblings_list"));
+  if (threadsPerCore > 0)
+    cpuCores_ = cpuThreads_ / threadsPerCore;
+}
+
+#endif
+
+/// Use CPUID for the cache sizes that
+/// could not be detected using the OS.
+///
+void CpuInfo::initCpuid()
+{
+  if (!hasL1dCache()) l1dCacheSize_ = get_cpuid_cache_size(1);
+  if (!hasL2Cache()) l2CacheSize_ = get_cpuid_cache_size(2);
+  if (!hasL3Cache()) l3CacheSize_ = get_cpuid_cache_size(3);
+}
+
+/// Discard implausible values
+void CpuInfo::check()
+{
+  if (l1dCacheSize_ < (1 << 10) || l1dCacheSize_ > (1 << 22))
+    l1dCacheSize_ = 0;
+  if (l2CacheSize_ < (1 << 10) || l2CacheSize_ > (1 << 30))
+    l2CacheSize_ = 0;
+  if (l3CacheSize_ < (1 << 10) || l3CacheSize_ > (uint64_t(1) << 34))
+    l3CacheSize_ = 0;
+  if (cpuThreads_ < 1)
+    cpuThreads_ = 1;
+  if (cpuCores_ < 1 || cpuCores_ > cpuThreads_)
+    cpuCores_ = cpuThreads_;
+  if (l3Sharing_ < 1 || l3Sharing_ > cpuThreads_)
+    l3Sharing_ = 1;
+}
+
+const CpuInfo& cpuInfo()
+{
+  static const CpuInfo info;
+  return info;
+}
+
+} // namespace primesieve
@@ -13,6 +13,8 @@
 
 #include <primesieve/config.hpp>
 #include <primesieve/EratBig.hpp>
+#include <primesieve/HugePages.hpp>
+#include <primesieve/SieveContext.hpp>
 #include <primesieve/WheelFactorization.hpp>
 #include <primesieve/primesieve_error.hpp>
 #include <primesieve/pmath.hpp>
@@ -21,20 +23,68 @@
 #include <cstddef>
 #include <cassert>
 #include <algorithm>
+#include <new>
 #include <vector>
 
 namespace primesieve {
 
-/// @param stop       Upper bound for sieving.
-/// @param sieveSize  Sieve size in bytes.
-/// @param limit      Sieving primes in EratBig must be <= limit,
-///                   usually limit = sqrt(stop).
+/// EratBig with BUCKETSIZE sieving primes per bucket
+template <uint_t BUCKETSIZE>
+class EratBigBuckets : public EratBig {
+public:
+  EratBigBuckets(uint64_t, uint_t, uint_t, uint_t, bool, SieveContext*);
+  ~EratBigBuckets();
+  void crossOff(byte_t*);
+  uint64_t getBucketAllocs() const { return pointers_.size(); }
+  uint64_t getHugePageBytes() const;
+private:
+  typedef Bucket<BUCKETSIZE> Bucket_t;
+  const uint_t limit_;
+  /// log2 of SieveOfEratosthenes::sieveSize_
+  const uint_t log2SieveSize_;
+  const uint_t moduloSieveSize_;
+  /// Size in bytes of each bucket allocation
+  const uint_t allocSize_;
+  /// Number of buckets per allocation
+  const uint_t bucketsPerAlloc_;
+  /// Allocate the buckets using huge pages
+  const bool hugePages_;
+  /// Reuse the bucket allocations of previous
+  /// EratBig objects if not NULL
+  SieveContext* context_;
+  /// Vector of bucket lists, holds the sieving primes
+  std::vector<Bucket_t*> lists_;
+  /// List of empty buckets
+  Bucket_t* stock_;
+  /// Pointers of the allocated buckets
+  std::vector<Bucket_t*> pointers_;
+  /// Page types of the allocated buckets (see HugePages.hpp)
+  std::vector<int> pageTypes_;
+  void init(uint_t);
+  static void moveBucket(Bucket_t&, Bucket_t*&);
+  void pushBucket(uint_t);
+  void storeSievingPrime(uint_t, uint_t, uint_t);
+  void crossOff(byte_t*, SievingPrime*, SievingPrime*);
+};
+
+/// @param stop           Upper bound for sieving.
+/// @param sieveSize      Sieve size in bytes.
+/// @param limit          Sieving primes in EratBig must be <= limit,
+///                       usually limit = sqrt(stop).
+/// @param bytesPerAlloc  Size in bytes of the bucket allocations.
+/// @param hugePages      Allocate the buckets using huge pages.
+/// @param context        Cache for the bucket allocations or NULL.
 ///
-EratBig::EratBig(uint64_t stop, uint_t sieveSize, uint_t limit) :
-  Modulo210Wheel_t(stop, sieveSize),
+template <uint_t BUCKETSIZE>
+EratBigBuckets<BUCKETSIZE>::EratBigBuckets(uint64_t stop, uint_t sieveSize, uint_t limit, uint_t bytesPerAlloc, bool hugePages, SieveContext* context) :
+  EratBig(stop, sieveSize),
   limit_(limit),
   log2SieveSize_(ilog2(sieveSize)),
   moduloSieveSize_(sieveSize - 1),
+  allocSize_(std::max<uint_t>(bytesPerAlloc, sizeof(Bucket_t))),
+  bucketsPerAlloc_(static_cast<uint_t>(allocSize_ / sizeof(Bucket_t))),
+  hugePages_(hugePages),
+  context_(context),
   stock_(NULL)
 {
   // '>> log2SieveSize' requires a power of 2 sieveSize
@@ -43,13 +93,30 @@ EratBig::EratBig(uint64_t stop, uint_t sieveSize, uint_t limit) :
   init(sieveSize);
 }
 
-EratBig::~EratBig()
+template <uint_t BUCKETSIZE>
+EratBigBuckets<BUCKETSIZE>::~EratBigBuckets()
 {
   for (std::size_t i = 0; i < pointers_.size(); i++)
-    delete[] pointers_[i];
+  {
+    if (context_)
+      context_->freePages(pointers_[i], allocSize_, pageTypes_[i]);
+    else
+      freePages(pointers_[i], allocSize_, pageTypes_[i]);
+  }
+}
+
+template <uint_t BUCKETSIZE>
+uint64_t EratBigBuckets<BUCKETSIZE>::getHugePageBytes() const
+{
+  uint64_t bytes = 0;
+  for (std::size_t i = 0; i < pageTypes_.size(); i++)
+    if (pageTypes_[i] != NORMAL_PAGES)
+      bytes += allocSize_;
+  return bytes;
 }
 
-void EratBig::init(uint_t sieveSize)
+template <uint_t BUCKETSIZE>
+void EratBigBuckets<BUCKETSIZE>::init(uint_t sieveSize)
 {
   uint_t maxSievingPrime  = limit_ / NUMBERS_PER_BYTE;
   uint_t maxNextMultiple  = maxSievingPrime * getMaxFactor() + getMaxFactor();
@@ -58,7 +125,9 @@ void EratBig::init(uint_t sieveSize)
   uint_t size = maxSegmentCount + 1;
 
   // EratBig uses up to 1.6 gigabytes of memory near 2^64
-  pointers_.reserve(((1u << 30) * 2) / config::BYTES_PER_ALLOC);
+  std::size_t allocs = static_cast<std::size_t>(((UINT64_C(1) << 30) * 2) / allocSize_);
+  pointers_.reserve(allocs);
+  pageTypes_.reserve(allocs);
 
   lists_.resize(size, NULL);
   for (uint_t i = 0; i < size; i++)
@@ -66,7 +135,8 @@ void EratBig::init(uint_t sieveSize)
 }
 
 /// Add a new sieving prime to EratBig
-void EratBig::storeSievingPrime(uint_t prime, uint_t multipleIndex, uint_t wheelIndex)
+template <uint_t BUCKETSIZE>
+void EratBigBuckets<BUCKETSIZE>::storeSievingPrime(uint_t prime, uint_t multipleIndex, uint_t wheelIndex)
 {
   assert(prime <= limit_);
   uint_t sievingPrime = prime / NUMBERS_PER_BYTE;
@@ -77,25 +147,33 @@ void EratBig::storeSievingPrime(uint_t prime, uint_t multipleIndex, uint_t wheel
 }
 
 /// Add an empty bucket to the front of lists_[segment].
-void EratBig::pushBucket(uint_t segment)
+template <uint_t BUCKETSIZE>
+void EratBigBuckets<BUCKETSIZE>::pushBucket(uint_t segment)
 {
   // if the stock_ is empty allocate new buckets
   if (!stock_)
   {
-    const int N = config::BYTES_PER_ALLOC / sizeof(Bucket);
-    Bucket* buckets = new Bucket[N];
-    for (int i = 0; i < N-1; i++)
+    const uint_t N = bucketsPerAlloc_;
+    int pageType;
+    void* memory = (context_) ? context_->allocatePages(allocSize_, hugePages_, &pageType)
+                              : allocatePages(allocSize_, hugePages_, &pageType);
+    Bucket_t* buckets = static_cast<Bucket_t*>(memory);
+    for (uint_t i = 0; i < N; i++)
+      new (&buckets[i]) Bucket_t();
+    for (uint_t i = 0; i < N-1; i++)
       buckets[i].setNext(&buckets[i + 1]);
     buckets[N-1].setNext(NULL);
     pointers_.push_back(buckets);
+    pageTypes_.push_back(pageType);
     stock_ = buckets;
   }
-  Bucket* emptyBucket = stock_;
+  Bucket_t* emptyBucket = stock_;
   stock_ = stock_->next();
   moveBucket(*emptyBucket, lists_[segment]);
 }
 
-void EratBig::moveBucket(Bucket& src, Bucket*& dest)
+template <uint_t BUCKETSIZE>
+void EratBigBuckets<BUCKETSIZE>::moveBucket(Bucket_t& src, Bucket_t*& dest)
 {
   src.setNext(dest);
   dest = &src;
@@ -104,18 +182,19 @@ void EratBig::moveBucket(Bucket& src, Bucket*& dest)
 /// Cross-off the multiples of big sieving primes
 /// from the sieve array.
 ///
-void EratBig::crossOff(byte_t* sieve)
+template <uint_t BUCKETSIZE>
+void EratBigBuckets<BUCKETSIZE>::crossOff(byte_t* sieve)
 {
   // process the buckets in lists_[0] which hold the sieving primes
   // that have multiple(s) in the current segment
   while (lists_[0]->hasNext() || !lists_[0]->empty())
   {
-    Bucket* bucket = lists_[0];
+    Bucket_t* bucket = lists_[0];
     lists_[0] = NULL;
     pushBucket(0);
     do {
       crossOff(sieve, bucket->begin(), bucket->end());
-      Bucket* processed = bucket;
+      Bucket_t* processed = bucket;
       bucket = bucket->next();
       processed->reset();
       moveBucket(*processed, stock_);
@@ -133,9 +212,10 @@ void EratBig::crossOff(byte_t* sieve)
 /// primes that have very few multiples per segment. This algorithm
 /// uses a modulo 210 wheel that skips multiples of 2, 3, 5 and 7.
 ///
-void EratBig::crossOff(byte_t* sieve, SievingPrime* sPrime, SievingPrime* sEnd)
+template <uint_t BUCKETSIZE>
+void EratBigBuckets<BUCKETSIZE>::crossOff(byte_t* sieve, SievingPrime* sPrime, SievingPrime* sEnd)
 {
-  Bucket** lists = &lists_[0];
+  Bucket_t** lists = &lists_[0];
   uint_t moduloSieveSize = moduloSieveSize_;
   uint_t log2SieveSize = log2SieveSize_;
 
@@ -183,4 +263,24 @@ void EratBig::crossOff(byte_t* sieve, SievingPrime* sPrime, SievingPrime* sEnd)
   }
 }
 
+/// @param stop           Upper bound for sieving.
+/// @param sieveSize      Sieve size in bytes.
+/// @param limit          Sieving primes in EratBig must be <= limit.
+/// @param bucketSize     Number of sieving primes per bucket.
+/// @param bytesPerAlloc  Size in bytes of the bucket allocations.
+/// @param hugePages      Allocate the buckets using huge pages.
+/// @param context        Cache for the bucket allocations or NULL.
+///
+EratBig* EratBig::create(uint64_t stop, uint_t sieveSize, uint_t limit, uint_t bucketSize, uint_t bytesPerAlloc, bool hugePages, SieveContext* context)
+{
+  switch (bucketSize)
+  {
+    case 1 << 8:  return new EratBigBuckets<1 << 8 >(stop, sieveSize, limit, bytesPerAlloc, hugePages, context);
+    case 1 << 9:  return new EratBigBuckets<1 << 9 >(stop, sieveSize, limit, bytesPerAlloc, hugePages, context);
+    case 1 << 10: return new EratBigBuckets<1 << 10>(stop, sieveSize, limit, bytesPerAlloc, hugePages, context);
+    case 1 << 11: return new EratBigBuckets<1 << 11>(stop, sieveSize, limit, bytesPerAlloc, hugePages, context);
+  }
+  throw primesieve_error("EratBig: bucketSize must be 256, 512, 1024 or 2048");
+}
+
 } // namespace primesieve
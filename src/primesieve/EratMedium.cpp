@@ -33,38 +33,17 @@ EratMedium::EratMedium(uint64_t stop, uint_t sieveSize, uint_t limit) :
     throw primesieve_error("EratMedium: sieveSize must be <= 2^21, 2048 kilobytes");
   if (limit > sieveSize * 9)
     throw primesieve_error("EratMedium: limit must be <= sieveSize * 9");
-  buckets_.push_back(Bucket());
 }
 
-/// Add a new sieving prime to EratMedium
-void EratMedium::storeSievingPrime(uint_t prime, uint_t multipleIndex, uint_t wheelIndex)
-{
-  assert(prime <= limit_);
-  uint_t sievingPrime = prime / NUMBERS_PER_BYTE;
-  if (!buckets_.back().store(sievingPrime, multipleIndex, wheelIndex))
-    buckets_.push_back(Bucket());
-}
-
-/// Cross-off the multiples of medium sieving
-/// primes from the sieve array.
-///
-void EratMedium::crossOff(byte_t* sieve, uint_t sieveSize)
-{
-  for (BucketIterator_t iter = buckets_.begin(); iter != buckets_.end(); ++iter)
-    crossOff(sieve, sieveSize, *iter);
-}
-
-/// Cross-off the multiples of the sieving primes within the current
-/// bucket. This is an implementation of the segmented sieve of
-/// Eratosthenes with wheel factorization optimized for medium sieving
-/// primes that have a few multiples per segment. This algorithm uses
-/// a modulo 210 wheel that skips multiples of 2, 3, 5 and 7.
+/// Cross-off the multiples of the sieving primes within
+/// [sPrime, sEnd[ (a bucket). This is an implementation of the
+/// segmented sieve of Eratosthenes with wheel factorization
+/// optimized for medium sieving primes that have a few multiples
+/// per segment. This algorithm uses a modulo 210 wheel that skips
+/// multiples of 2, 3, 5 and 7.
 ///
-void EratMedium::crossOff(byte_t* sieve, uint_t sieveSize, Bucket& bucket)
+void EratMedium::crossOff(byte_t* sieve, uint_t sieveSize, SievingPrime* sPrime, SievingPrime* sEnd)
 {
-  SievingPrime* sPrime = bucket.begin();
-  SievingPrime* sEnd = bucket.end();
-
   // process 3 sieving primes per loop iteration to
   // increase instruction level parallelism
   for (; sPrime + 3 <= sEnd; sPrime += 3)
@@ -116,4 +95,55 @@ void EratMedium::crossOff(byte_t* sieve, uint_t sieveSize, Bucket& bucket)
   }
 }
 
+/// EratMedium with BUCKETSIZE sieving primes per bucket
+template <uint_t BUCKETSIZE>
+class EratMediumBuckets : public EratMedium {
+public:
+  EratMediumBuckets(uint64_t stop, uint_t sieveSize, uint_t limit) :
+    EratMedium(stop, sieveSize, limit)
+  {
+    buckets_.push_back(Bucket_t());
+  }
+
+  /// Cross-off the multiples of medium sieving
+  /// primes from the sieve array.
+  ///
+  void crossOff(byte_t* sieve, uint_t sieveSize)
+  {
+    for (BucketIterator_t iter = buckets_.begin(); iter != buckets_.end(); ++iter)
+      EratMedium::crossOff(sieve, sieveSize, iter->begin(), iter->end());
+  }
+private:
+  typedef Bucket<BUCKETSIZE> Bucket_t;
+  typedef typename std::list<Bucket_t>::iterator BucketIterator_t;
+  /// List of buckets, holds the sieving primes
+  std::list<Bucket_t> buckets_;
+
+  /// Add a new sieving prime to EratMedium
+  void storeSievingPrime(uint_t prime, uint_t multipleIndex, uint_t wheelIndex)
+  {
+    assert(prime <= getLimit());
+    uint_t sievingPrime = prime / NUMBERS_PER_BYTE;
+    if (!buckets_.back().store(sievingPrime, multipleIndex, wheelIndex))
+      buckets_.push_back(Bucket_t());
+  }
+};
+
+/// @param stop        Upper bound for sieving.
+/// @param sieveSize   Sieve size in bytes.
+/// @param limit       Sieving primes in EratMedium must be <= limit.
+/// @param bucketSize  Number of sieving primes per bucket.
+///
+EratMedium* EratMedium::create(uint64_t stop, uint_t sieveSize, uint_t limit, uint_t bucketSize)
+{
+  switch (bucketSize)
+  {
+    case 1 << 8:  return new EratMediumBuckets<1 << 8 >(stop, sieveSize, limit);
+    case 1 << 9:  return new EratMediumBuckets<1 << 9 >(stop, sieveSize, limit);
+    case 1 << 10: return new EratMediumBuckets<1 << 10>(stop, sieveSize, limit);
+    case 1 << 11: return new EratMediumBuckets<1 << 11>(stop, sieveSize, limit);
+  }
+  throw primesieve_error("EratMedium: bucketSize must be 256, 512, 1024 or 2048");
+}
+
 } // namespace primesieve
@@ -3,7 +3,7 @@
 /// @brief  Segmented sieve of Eratosthenes optimized for small
 ///         sieving primes.
 ///
-/// Copyright (C) 2014 Kim Walisch, <kim.walisch@gmail.com>
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
 ///
 /// This file is distributed under the BSD License. See the COPYING
 /// file in the top level directory.
@@ -14,10 +14,204 @@
 #include <primesieve/WheelFactorization.hpp>
 #include <primesieve/primesieve_error.hpp>
 #include <primesieve/bits.hpp>
+#include <primesieve/cpuid.hpp>
 
 #include <stdint.h>
 #include <cassert>
+#include <cstddef>
 #include <list>
+#include <vector>
+
+#if defined(HAS_TARGET_AVX2) || \
+    defined(HAS_TARGET_AVX512)
+  #include <immintrin.h>
+#endif
+
+namespace {
+
+using primesieve::byte_t;
+using primesieve::uint_t;
+using primesieve::PatternPrime;
+
+/// The SIMD kernels process the sieve array in blocks of
+/// PATTERN_BLOCK bytes that are kept in vector registers while
+/// the patterns of all pattern primes are applied.
+///
+enum { PATTERN_BLOCK = 256 };
+
+/// Cross-off the multiples of a pattern prime
+/// within sieve[start, stop[ byte by byte.
+///
+inline void crossOffPattern(byte_t* sieve,
+                            uint_t start,
+                            uint_t stop,
+                            PatternPrime& pp,
+                            const byte_t* patterns)
+{
+  const byte_t* pattern = &patterns[pp.pattern];
+  uint_t index = pp.index;
+  for (uint_t i = start; i < stop; i++)
+  {
+    sieve[i] &= pattern[index++];
+    if (index == pp.period)
+      index = 0;
+  }
+  pp.index = index;
+}
+
+/// Advance the pattern index by one block, this requires
+/// only a single subtraction as period >= PATTERN_BLOCK.
+///
+inline void nextBlock(PatternPrime& pp)
+{
+  pp.index += PATTERN_BLOCK;
+  if (pp.index >= pp.period)
+    pp.index -= pp.period;
+}
+
+#if defined(HAS_TARGET_AVX2)
+
+/// Load 256 sieve bytes into 8 AVX2 registers, AND them with
+/// the patterns of all pattern primes and store them back.
+///
+TARGET_AVX2
+void patternKernelAvx2(byte_t* sieve,
+                       uint_t sieveSize,
+                       PatternPrime* first,
+                       PatternPrime* last,
+                       const byte_t* patterns)
+{
+  uint_t limit = sieveSize - sieveSize % PATTERN_BLOCK;
+  uint_t i = 0;
+
+  for (; i < limit; i += PATTERN_BLOCK)
+  {
+    __m256i* s = reinterpret_cast<__m256i*>(&sieve[i]);
+    __m256i bits0 = _mm256_loadu_si256(s + 0);
+    __m256i bits1 = _mm256_loadu_si256(s + 1);
+    __m256i bits2 = _mm256_loadu_si256(s + 2);
+    __m256i bits3 = _mm256_loadu_si256(s + 3);
+    __m256i bits4 = _mm256_loadu_si256(s + 4);
+    __m256i bits5 = _mm256_loadu_si256(s + 5);
+    __m256i bits6 = _mm256_loadu_si256(s + 6);
+    __m256i bits7 = _mm256_loadu_si256(s + 7);
+
+    for (PatternPrime* pp = first; pp != last; pp++)
+    {
+      const byte_t* pattern = &patterns[pp->pattern + pp->index];
+      const __m256i* p = reinterpret_cast<const __m256i*>(pattern);
+      bits0 = _mm256_and_si256(bits0, _mm256_loadu_si256(p + 0));
+      bits1 = _mm256_and_si256(bits1, _mm256_loadu_si256(p + 1));
+      bits2 = _mm256_and_si256(bits2, _mm256_loadu_si256(p + 2));
+      bits3 = _mm256_and_si256(bits3, _mm256_loadu_si256(p + 3));
+      bits4 = _mm256_and_si256(bits4, _mm256_loadu_si256(p + 4));
+      bits5 = _mm256_and_si256(bits5, _mm256_loadu_si256(p + 5));
+      bits6 = _mm256_and_si256(bits6, _mm256_loadu_si256(p + 6));
+      bits7 = _mm256_and_si256(bits7, _mm256_loadu_si256(p + 7));
+      nextBlock(*pp);
+    }
+
+    _mm256_storeu_si256(s + 0, bits0);
+    _mm256_storeu_si256(s + 1, bits1);
+    _mm256_storeu_si256(s + 2, bits2);
+    _mm256_storeu_si256(s + 3, bits3);
+    _mm256_storeu_si256(s + 4, bits4);
+    _mm256_storeu_si256(s + 5, bits5);
+    _mm256_storeu_si256(s + 6, bits6);
+    _mm256_storeu_si256(s + 7, bits7);
+  }
+
+  for (PatternPrime* pp = first; pp != last; pp++)
+    crossOffPattern(sieve, i, sieveSize, *pp, patterns);
+}
+
+#endif
+
+#if defined(HAS_TARGET_AVX512)
+
+/// Load 256 sieve bytes into 4 AVX-512 registers, AND them with
+/// the patterns of all pattern primes and store them back.
+///
+TARGET_AVX512
+void patternKernelAvx512(byte_t* sieve,
+                         uint_t sieveSize,
+                         PatternPrime* first,
+                         PatternPrime* last,
+                         const byte_t* patterns)
+{
+  uint_t limit = sieveSize - sieveSize % PATTERN_BLOCK;
+  uint_t i = 0;
+
+  for (; i < limit; i += PATTERN_BLOCK)
+  {
+    byte_t* s = &sieve[i];
+    __m512i bits0 = _mm512_loadu_si512(s + 0);
+    __m512i bits1 = _mm512_loadu_si512(s + 64);
+    __m512i bits2 = _mm512_loadu_si512(s + 128);
+    __m512i bits3 = _mm512_loadu_si512(s + 192);
+
+    for (PatternPrime* pp = first; pp != last; pp++)
+    {
+      const byte_t* p = &patterns[pp->pattern + pp->index];
+      bits0 = _mm512_and_si512(bits0, _mm512_loadu_si512(p + 0));
+      bits1 = _mm512_and_si512(bits1, _mm512_loadu_si512(p + 64));
+      bits2 = _mm512_and_si512(bits2, _mm512_loadu_si512(p + 128));
+      bits3 = _mm512_and_si512(bits3, _mm512_loadu_si512(p + 192));
+      nextBlock(*pp);
+    }
+
+    _mm512_storeu_si512(s + 0, bits0);
+    _mm512_storeu_si512(s + 64, bits1);
+    _mm512_storeu_si512(s + 128, bits2);
+    _mm512_storeu_si512(s + 192, bits3);
+  }
+
+  for (PatternPrime* pp = first; pp != last; pp++)
+    crossOffPattern(sieve, i, sieveSize, *pp, patterns);
+}
+
+#endif
+
+typedef void (*PatternKernel_t)(byte_t*, uint_t, PatternPrime*, PatternPrime*, const byte_t*);
+
+/// @return The SIMD kernel of an EratSmall::PATTERNS_* kernel,
+///         NULL if scalar or not supported by the CPU.
+///
+PatternKernel_t getPatternFunction(int kernel)
+{
+#if defined(HAS_TARGET_AVX512)
+  if (kernel == primesieve::EratSmall::PATTERNS_AVX512 &&
+      primesieve::has_cpuid_avx512())
+    return patternKernelAvx512;
+#endif
+#if defined(HAS_TARGET_AVX2)
+  if (kernel == primesieve::EratSmall::PATTERNS_AVX2 &&
+      primesieve::has_cpuid_avx2())
+    return patternKernelAvx2;
+#endif
+  (void) kernel;
+  return NULL;
+}
+
+/// The fastest kernel supported by the CPU
+int selectPatternKernel()
+{
+  for (int i = primesieve::EratSmall::PATTERN_KERNELS - 1; i > 0; i--)
+    if (getPatternFunction(i))
+      return i;
+  return primesieve::EratSmall::PATTERNS_SCALAR;
+}
+
+/// The kernel is selected only once, on first use,
+/// it can be changed using setPatternKernel().
+///
+int& patternKernel()
+{
+  static int kernel = selectPatternKernel();
+  return kernel;
+}
+
+} // namespace
 
 namespace primesieve {
 
@@ -27,20 +221,68 @@ namespace primesieve {
 ///
 EratSmall::EratSmall(uint64_t stop, uint_t sieveSize, uint_t limit) :
   Modulo30Wheel_t(stop, sieveSize),
-  limit_(limit)
+  limit_(limit),
+  patternLimit_(0),
+  patternKernel_(getPatternFunction(patternKernel()))
 {
+  if (patternKernel_)
+    patternLimit_ = config::ERATSMALL_PATTERN_LIMIT;
   if (limit > sieveSize * 3)
     throw primesieve_error("EratSmall: limit must be <= sieveSize * 3");
-  buckets_.push_back(Bucket());
 }
 
-/// Add a new sieving prime to EratSmall
-void EratSmall::storeSievingPrime(uint_t prime, uint_t multipleIndex, uint_t wheelIndex)
+bool EratSmall::hasPatternKernel(int kernel)
+{
+  return kernel == PATTERNS_SCALAR ||
+         getPatternFunction(kernel) != NULL;
+}
+
+int EratSmall::getPatternKernel()
+{
+  return patternKernel();
+}
+
+/// Used for testing, select the pattern kernel of all
+/// subsequently created EratSmall objects.
+/// @pre hasPatternKernel(kernel)
+///
+void EratSmall::setPatternKernel(int kernel)
+{
+  if (hasPatternKernel(kernel))
+    patternKernel() = kernel;
+}
+
+/// Precompute the byte pattern of a tiny sieving prime. The
+/// pattern period is the smallest multiple of prime that is
+/// >= PATTERN_BLOCK and the pattern is followed by PATTERN_BLOCK
+/// padding bytes (copied from its beginning) so that a full block
+/// can be loaded at any pattern index. The pattern starts at the
+/// sieve byte of the prime's first multiple.
+///
+void EratSmall::storePatternPrime(uint_t prime, uint_t multipleIndex, uint_t wheelIndex)
 {
-  assert(prime <= limit_);
+  PatternPrime pp;
+  pp.prime = prime;
+  pp.period = prime * ((PATTERN_BLOCK + prime - 1) / prime);
+  pp.pattern = static_cast<uint_t>(patterns_.size());
+  pp.index = 0;
+  pp.start = multipleIndex;
+
+  patterns_.resize(pp.pattern + pp.period + PATTERN_BLOCK, 0xff);
+  byte_t* pattern = &patterns_[pp.pattern];
   uint_t sievingPrime = prime / NUMBERS_PER_BYTE;
-  if (!buckets_.back().store(sievingPrime, multipleIndex, wheelIndex))
-    buckets_.push_back(Bucket());
+
+  // cross-off the 8 multiples of prime within
+  // the first prime bytes, the 9th multiple
+  // is located at pattern[prime]
+  for (uint_t i = 0; i < prime;)
+    unsetBit(pattern, sievingPrime, &i, &wheelIndex);
+
+  uint_t size = pp.period + PATTERN_BLOCK;
+  for (uint_t i = prime; i < size; i++)
+    pattern[i] = pattern[i - prime];
+
+  newPatternPrimes_.push_back(pp);
 }
 
 /// Cross-off the multiples of small sieving
@@ -48,21 +290,58 @@ void EratSmall::storeSievingPrime(uint_t prime, uint_t multipleIndex, uint_t whe
 ///
 void EratSmall::crossOff(byte_t* sieve, byte_t* sieveLimit)
 {
-  for (BucketIterator_t iter = buckets_.begin(); iter != buckets_.end(); ++iter)
-    crossOff(sieve, sieveLimit, *iter);
+  if (!patternPrimes_.empty() ||
+      !newPatternPrimes_.empty())
+    crossOffPatterns(sieve, static_cast<uint_t>(sieveLimit - sieve));
+
+  crossOffBuckets(sieve, sieveLimit);
 }
 
-/// Cross-off the multiples of the sieving primes within the current
-/// bucket. This is an implementation of the segmented sieve of
-/// Eratosthenes with wheel factorization optimized for small sieving
-/// primes that have many multiples per segment. This algorithm uses a
-/// hardcoded modulo 30 wheel that skips multiples of 2, 3 and 5.
+/// Cross-off the multiples of the pattern primes using the SIMD
+/// kernel. Pattern primes that have been added within the current
+/// segment are processed byte by byte starting at their first
+/// multiple, from the next segment on they are processed by the
+/// SIMD kernel.
 ///
-void EratSmall::crossOff(byte_t* sieve, byte_t* sieveLimit, Bucket& bucket)
+void EratSmall::crossOffPatterns(byte_t* sieve, uint_t sieveSize)
 {
-  SievingPrime* sPrime = bucket.begin();
-  SievingPrime* sEnd   = bucket.end();
+  if (!patternPrimes_.empty())
+  {
+    PatternPrime* first = &patternPrimes_[0];
+    PatternPrime* last = first + patternPrimes_.size();
+    patternKernel_(sieve, sieveSize, first, last, &patterns_[0]);
+  }
+
+  std::vector<PatternPrime>& pending = pendingPatternPrimes_;
+  pending.clear();
 
+  for (std::size_t i = 0; i < newPatternPrimes_.size(); i++)
+  {
+    PatternPrime& pp = newPatternPrimes_[i];
+    if (pp.start >= sieveSize)
+    {
+      pp.start -= sieveSize;
+      pending.push_back(pp);
+    }
+    else
+    {
+      crossOffPattern(sieve, pp.start, sieveSize, pp, &patterns_[0]);
+      patternPrimes_.push_back(pp);
+    }
+  }
+
+  newPatternPrimes_.swap(pending);
+}
+
+/// Cross-off the multiples of the sieving primes within
+/// [sPrime, sEnd[ (a bucket). This is an implementation of the
+/// segmented sieve of Eratosthenes with wheel factorization
+/// optimized for small sieving primes that have many multiples
+/// per segment. This algorithm uses a hardcoded modulo 30 wheel
+/// that skips multiples of 2, 3 and 5.
+///
+void EratSmall::crossOff(byte_t* sieve, byte_t* sieveLimit, SievingPrime* sPrime, SievingPrime* sEnd)
+{
   for (; sPrime != sEnd; sPrime++)
   {
     uint_t sievingPrime  = sPrime->getSievingPrime();
@@ -334,4 +613,57 @@ void EratSmall::crossOff(byte_t* sieve, byte_t* sieveLimit, Bucket& bucket)
   }
 }
 
+/// EratSmall with BUCKETSIZE sieving primes per bucket
+template <uint_t BUCKETSIZE>
+class EratSmallBuckets : public EratSmall {
+public:
+  EratSmallBuckets(uint64_t stop, uint_t sieveSize, uint_t limit) :
+    EratSmall(stop, sieveSize, limit)
+  {
+    buckets_.push_back(Bucket_t());
+  }
+private:
+  typedef Bucket<BUCKETSIZE> Bucket_t;
+  typedef typename std::list<Bucket_t>::iterator BucketIterator_t;
+  /// List of buckets, holds the sieving primes
+  std::list<Bucket_t> buckets_;
+
+  /// Add a new sieving prime to EratSmall
+  void storeSievingPrime(uint_t prime, uint_t multipleIndex, uint_t wheelIndex)
+  {
+    assert(prime <= getLimit());
+    if (isPatternPrime(prime))
+    {
+      storePatternPrime(prime, multipleIndex, wheelIndex);
+      return;
+    }
+    uint_t sievingPrime = prime / NUMBERS_PER_BYTE;
+    if (!buckets_.back().store(sievingPrime, multipleIndex, wheelIndex))
+      buckets_.push_back(Bucket_t());
+  }
+
+  void crossOffBuckets(byte_t* sieve, byte_t* sieveLimit)
+  {
+    for (BucketIterator_t iter = buckets_.begin(); iter != buckets_.end(); ++iter)
+      crossOff(sieve, sieveLimit, iter->begin(), iter->end());
+  }
+};
+
+/// @param stop        Upper bound for sieving.
+/// @param sieveSize   Sieve size in bytes.
+/// @param limit       Sieving primes in EratSmall must be <= limit.
+/// @param bucketSize  Number of sieving primes per bucket.
+///
+EratSmall* EratSmall::create(uint64_t stop, uint_t sieveSize, uint_t limit, uint_t bucketSize)
+{
+  switch (bucketSize)
+  {
+    case 1 << 8:  return new EratSmallBuckets<1 << 8 >(stop, sieveSize, limit);
+    case 1 << 9:  return new EratSmallBuckets<1 << 9 >(stop, sieveSize, limit);
+    case 1 << 10: return new EratSmallBuckets<1 << 10>(stop, sieveSize, limit);
+    case 1 << 11: return new EratSmallBuckets<1 << 11>(stop, sieveSize, limit);
+  }
+  throw primesieve_error("EratSmall: bucketSize must be 256, 512, 1024 or 2048");
+}
+
 } // namespace primesieve
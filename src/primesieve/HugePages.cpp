@@ -0,0 +1,157 @@
+///
+/// @file   HugePages.cpp
+/// @brief  Allocate memory backed by 2 megabyte huge pages using
+///         mmap(MAP_HUGETLB) or madvise(MADV_HUGEPAGE) on Linux.
+///         Falls back to operator new on other systems or if no
+///         huge pages are available.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primesieve/HugePages.hpp>
+
+#include <cstddef>
+#include <new>
+
+#if defined(__linux__)
+  #include <sys/mman.h>
+  #include <fstream>
+  #include <string>
+  #define PRIMESIEVE_HUGE_PAGES
+#endif
+
+namespace {
+
+using namespace primesieve;
+
+#if defined(PRIMESIEVE_HUGE_PAGES)
+
+std::size_t roundUp(std::size_t size)
+{
+  return (size + HUGE_PAGE_SIZE - 1) & ~static_cast<std::size_t>(HUGE_PAGE_SIZE - 1);
+}
+
+#if defined(MADV_HUGEPAGE)
+
+/// Transparent huge pages are disabled if
+/// /sys/kernel/mm/transparent_hugepage/enabled
+/// is "always madvise [never]" (or missing).
+///
+bool detectTransparentHugePages()
+{
+  std::ifstream file("/sys/kernel/mm/transparent_hugepage/enabled");
+  std::string line;
+  if (!std::getline(file, line))
+    return false;
+  return line.find("[always]") != std::string::npos ||
+         line.find("[madvise]") != std::string::npos;
+}
+
+#endif
+
+/// mmap(MAP_HUGETLB) fails unless huge pages have
+/// been reserved by the administrator.
+///
+void* mapExplicitHugePages(std::size_t bytes)
+{
+#if defined(MAP_HUGETLB)
+  void* ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (ptr != MAP_FAILED)
+    return ptr;
+#endif
+  (void) bytes;
+  return NULL;
+}
+
+/// Transparent huge pages require HUGE_PAGE_SIZE aligned memory,
+/// hence we map HUGE_PAGE_SIZE more bytes and unmap the unaligned
+/// head and tail.
+///
+void* mapTransparentHugePages(std::size_t bytes)
+{
+#if defined(MADV_HUGEPAGE)
+  // detected only once, on the first huge page allocation
+  static const bool transparentHugePages = detectTransparentHugePages();
+  if (!transparentHugePages)
+    return NULL;
+
+  std::size_t mapSize = bytes + HUGE_PAGE_SIZE;
+  void* map = mmap(NULL, mapSize, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (map == MAP_FAILED)
+    return NULL;
+
+  char* begin = static_cast<char*>(map);
+  char* end = begin + mapSize;
+  char* aligned = reinterpret_cast<char*>(roundUp(reinterpret_cast<std::size_t>(begin)));
+
+  if (aligned > begin)
+    munmap(begin, aligned - begin);
+  if (end > aligned + bytes)
+    munmap(aligned + bytes, end - (aligned + bytes));
+
+  if (madvise(aligned, bytes, MADV_HUGEPAGE) == 0)
+    return aligned;
+
+  munmap(aligned, bytes);
+#endif
+  (void) bytes;
+  return NULL;
+}
+
+#endif
+
+} // namespace
+
+namespace primesieve {
+
+void* allocatePages(std::size_t size, bool hugePages, int* pageType)
+{
+  *pageType = NORMAL_PAGES;
+
+#if defined(PRIMESIEVE_HUGE_PAGES)
+  if (hugePages && size >= HUGE_PAGE_SIZE)
+  {
+    std::size_t bytes = roundUp(size);
+    void* ptr = mapExplicitHugePages(bytes);
+    if (ptr)
+    {
+      *pageType = EXPLICIT_HUGE_PAGES;
+      return ptr;
+    }
+    ptr = mapTransparentHugePages(bytes);
+    if (ptr)
+    {
+      *pageType = TRANSPARENT_HUGE_PAGES;
+      return ptr;
+    }
+  }
+#endif
+
+  (void) hugePages;
+  return ::operator new(size);
+}
+
+void freePages(void* ptr, std::size_t size, int pageType)
+{
+  if (!ptr)
+    return;
+
+#if defined(PRIMESIEVE_HUGE_PAGES)
+  if (pageType != NORMAL_PAGES)
+  {
+    munmap(ptr, roundUp(size));
+    return;
+  }
+#endif
+
+  (void) size;
+  (void) pageType;
+  ::operator delete(ptr);
+}
+
+} // namespace primesieve
@@ -1,7 +1,9 @@
 ///
 /// @file   ParallelPrimeSieve.cpp
 /// @brief  ParallelPrimeSieve sieves primes in parallel using
-///         OpenMP 2.0 (2002) or later.
+///         OpenMP 2.0 (2002) or later or using a pool of C++11
+///         std::threads. The sieving primes are generated only
+///         once and shared by all threads.
 ///
 /// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
 ///
@@ -12,24 +14,179 @@
 #include <primesieve/config.hpp>
 #include <primesieve/ParallelPrimeSieve.hpp>
 #include <primesieve/PrimeSieve.hpp>
+#include <primesieve/PushBackPrimes.hpp>
+#include <primesieve/SievingPrimes.hpp>
+#include <primesieve/primesieve_error.hpp>
 #include <primesieve/pmath.hpp>
 
 #include <stdint.h>
 #include <cstddef>
 #include <cassert>
+#include <cmath>
 #include <algorithm>
+#include <vector>
 
 #ifdef _OPENMP
   #include <omp.h>
   #include <primesieve/ParallelPrimeSieve-lock.hpp>
 #endif
 
+#if defined(PRIMESIEVE_THREAD_POOL)
+  #include <primesieve/CpuInfo.hpp>
+  #include <primesieve/ThreadPool.hpp>
+  #include <atomic>
+  #include <condition_variable>
+  #include <mutex>
+#endif
+
+namespace {
+
+using primesieve::BatchCallback;
+using primesieve::PrimeArray;
+using primesieve::SievingPrimes;
+
+/// Share the sieving primes with the child PrimeSieve
+/// objects and reset the pointer when sieving is done
+/// (or if an exception has been thrown).
+///
+class ShareSievingPrimes
+{
+public:
+  ShareSievingPrimes(const SievingPrimes*& ptr, const SievingPrimes& sievingPrimes) :
+    ptr_(ptr)
+  {
+    ptr_ = &sievingPrimes;
+  }
+  ~ShareSievingPrimes()
+  {
+    ptr_ = NULL;
+  }
+private:
+  const SievingPrimes*& ptr_;
+  DISALLOW_COPY_AND_ASSIGN(ShareSievingPrimes);
+};
+
+/// Temporarily switch the multi-threading backend, setLock()
+/// and unsetLock() depend on it.
+///
+class SwitchBackend
+{
+public:
+  SwitchBackend(int& backend, int newBackend) :
+    backend_(backend),
+    oldBackend_(backend)
+  {
+    backend_ = newBackend;
+  }
+  ~SwitchBackend()
+  {
+    backend_ = oldBackend_;
+  }
+private:
+  int& backend_;
+  int oldBackend_;
+  DISALLOW_COPY_AND_ASSIGN(SwitchBackend);
+};
+
+/// Point ptr to an object on the stack and reset it to
+/// NULL when sieving is done (or if an exception has
+/// been thrown).
+///
+class SetPointer
+{
+public:
+  SetPointer(void*& ptr, void* object) :
+    ptr_(ptr)
+  {
+    ptr_ = object;
+  }
+  ~SetPointer()
+  {
+    ptr_ = NULL;
+  }
+private:
+  void*& ptr_;
+  DISALLOW_COPY_AND_ASSIGN(SetPointer);
+};
+
+/// Store the primes of a chunk at array[index, ...[
+class StoreSlice : public BatchCallback
+{
+public:
+  StoreSlice(PrimeArray& array, uint64_t index) :
+    array_(array),
+    index_(index),
+    count_(0)
+  { }
+  void callback(const uint64_t* primes, std::size_t count, int)
+  {
+    array_.store(primes, count, static_cast<std::size_t>(index_ + count_));
+    count_ += count;
+  }
+  uint64_t getCount() const { return count_; }
+private:
+  PrimeArray& array_;
+  uint64_t index_;
+  uint64_t count_;
+  DISALLOW_COPY_AND_ASSIGN(StoreSlice);
+};
+
+/// Single-threaded storePrimes(), grows the array if the
+/// initial size estimate is too small.
+///
+class StoreAll : public BatchCallback
+{
+public:
+  StoreAll(PrimeArray& array, uint64_t size) :
+    array_(array),
+    size_(size),
+    count_(0)
+  {
+    array_.resize(static_cast<std::size_t>(size_));
+  }
+  void callback(const uint64_t* primes, std::size_t count, int)
+  {
+    if (count_ + count > size_)
+    {
+      size_ = std::max(size_ * 2, count_ + count);
+      array_.resize(static_cast<std::size_t>(size_));
+    }
+    array_.store(primes, count, static_cast<std::size_t>(count_));
+    count_ += count;
+  }
+  uint64_t getCount() const { return count_; }
+private:
+  PrimeArray& array_;
+  uint64_t size_;
+  uint64_t count_;
+  DISALLOW_COPY_AND_ASSIGN(StoreAll);
+};
+
+#if defined(PRIMESIEVE_THREAD_POOL)
+
+/// Shared by the threads in ordered mode, chunk i
+/// may print its primes once head == i.
+///
+struct OrderedState
+{
+  std::mutex mutex;
+  std::condition_variable turn;
+  uint64_t head;
+};
+
+#endif
+
+} // namespace
+
 namespace primesieve {
 
 ParallelPrimeSieve::ParallelPrimeSieve() :
   lock_(NULL),
   shm_(NULL),
-  numThreads_(IDEAL_NUM_THREADS)
+  numThreads_(IDEAL_NUM_THREADS),
+  backend_(defaultBackend()),
+  ordered_(false),
+  order_(NULL)
 { }
 
 void ParallelPrimeSieve::init(SharedMemory& shm)
@@ -56,6 +213,69 @@ void ParallelPrimeSieve::setNumThreads(int threads)
     numThreads_ = getInBetween(1, numThreads_, getMaxThreads());
 }
 
+/// @return true if primesieve has been compiled
+///         with support for backend.
+///
+bool ParallelPrimeSieve::hasBackend(int backend)
+{
+  switch (backend)
+  {
+#ifdef _OPENMP
+    case OPENMP_BACKEND: return true;
+#endif
+#if defined(PRIMESIEVE_THREAD_POOL)
+    case THREAD_POOL_BACKEND: return true;
+#endif
+  }
+  return false;
+}
+
+/// OpenMP if available, else the thread pool if available,
+/// else DEFAULT_BACKEND (single-threaded).
+///
+int ParallelPrimeSieve::defaultBackend()
+{
+  if (hasBackend(OPENMP_BACKEND))
+    return OPENMP_BACKEND;
+  if (hasBackend(THREAD_POOL_BACKEND))
+    return THREAD_POOL_BACKEND;
+  return DEFAULT_BACKEND;
+}
+
+/// Get the multi-threading backend used by sieve().
+int ParallelPrimeSieve::getBackend() const
+{
+  return backend_;
+}
+
+/// Set the multi-threading backend, if primesieve has not been
+/// compiled with support for backend the default backend is used.
+/// @param backend  DEFAULT_BACKEND, OPENMP_BACKEND or
+///                 THREAD_POOL_BACKEND.
+///
+void ParallelPrimeSieve::setBackend(int backend)
+{
+  if (backend < DEFAULT_BACKEND || backend > THREAD_POOL_BACKEND)
+    throw primesieve_error("invalid multi-threading backend");
+  backend_ = hasBackend(backend) ? backend : defaultBackend();
+}
+
+/// @return true if the primes are printed or passed to
+///         the callback in ascending order.
+///
+bool ParallelPrimeSieve::isOrdered() const
+{
+  return (ordered_ && isCallback()) || isPrint();
+}
+
+/// Callback primes in ascending order when using multiple
+/// threads, primes are always printed in order.
+///
+void ParallelPrimeSieve::setOrdered(bool ordered)
+{
+  ordered_ = ordered;
+}
+
 /// Get an ideal number of threads for the current
 /// set start_ and stop_ numbers.
 ///
@@ -102,44 +322,93 @@ bool ParallelPrimeSieve::tooMany(int threads) const
   return (threads > 1 && getInterval() / threads < config::MIN_THREAD_INTERVAL);
 }
 
-#ifdef _OPENMP
-
 int ParallelPrimeSieve::getMaxThreads()
 {
+#if defined(_OPENMP)
   return omp_get_max_threads();
-}
-
-double ParallelPrimeSieve::getWallTime() const
-{
-  return omp_get_wtime();
+#elif defined(PRIMESIEVE_THREAD_POOL)
+  return cpuInfo().cpuThreads();
+#else
+  return 1;
+#endif
 }
 
 /// Sieve the primes and prime k-tuplets within [start_, stop_]
-/// in parallel using OpenMP multi-threading.
+/// in parallel using the selected multi-threading backend.
+/// If no backend is available ParallelPrimeSieve behaves like
+/// the single threaded PrimeSieve.
 ///
 void ParallelPrimeSieve::sieve()
 {
   reset();
   if (start_ > stop_)
     return;
-  OmpInitLock ompInit(&lock_);
 
   int threads = getNumThreads();
   if (tooMany(threads))
     threads = idealNumThreads();
 
+  if (isOrdered() && threads > 1 && hasBackend(THREAD_POOL_BACKEND))
+    sieveOrdered(threads);
+  else
+  {
+    // ordered mode requires the thread pool
+    if (isOrdered())
+      threads = 1;
+    switch (backend_)
+    {
+      case OPENMP_BACKEND:      sieveOpenMP(threads, getThreadInterval(threads)); break;
+      case THREAD_POOL_BACKEND: sieveThreadPool(threads, getThreadInterval(threads)); break;
+      default:                  PrimeSieve::sieve(); break;
+    }
+  }
+
+  // the child PrimeSieve objects have subtracted
+  // their sieving time from threadIdle
+  if (isStats())
+    for (std::size_t i = 0; i < stats_.threadIdle.size(); i++)
+      stats_.threadIdle[i] = std::max(0.0, stats_.threadIdle[i] + seconds_);
+
+  // communicate the sieving results to the
+  // primesieve GUI application
+  if (shm_) {
+    std::copy(counts_.begin(), counts_.end(), shm_->counts);
+    shm_->seconds = seconds_;
+  }
+}
+
+/// Sieve [start_, stop_] using OpenMP multi-threading.
+void ParallelPrimeSieve::sieveOpenMP(int threads, uint64_t threadInterval)
+{
+#ifdef _OPENMP
+  OmpInitLock ompInit(&lock_);
+
   if (threads == 1)
     PrimeSieve::sieve();
   else {
-    uint64_t threadInterval = getThreadInterval(threads);
-    uint64_t count0 = 0, count1 = 0, count2 = 0, count3 = 0, count4 = 0, count5 = 0;
     double t1 = getWallTime();
+    // generate the sieving primes only once, the
+    // child PrimeSieve objects share this table
+    SievingPrimes sievingPrimes(stop_, getSieveSize(), threads);
+    ShareSievingPrimes share(sievingPrimes_, sievingPrimes);
+    int pieces = sievingPrimes.getPieces();
+
+    #pragma omp parallel for schedule(dynamic) num_threads(threads)
+    for (int i = 0; i < pieces; i++)
+      sievingPrimes.sievePiece(i);
+
+    sievingPrimesStats(getWallTime() - t1, threads);
+
+    uint64_t count0 = 0, count1 = 0, count2 = 0, count3 = 0, count4 = 0, count5 = 0;
 
 #if _OPENMP >= 200800 /* OpenMP >= 3.0 (2008) */
 
     #pragma omp parallel for schedule(dynamic) num_threads(threads) \
       reduction(+: count0, count1, count2, count3, count4, count5)
     for (uint64_t n = start_; n < stop_; n += threadInterval) {
+      // skip the remaining chunks after stop()
+      if (isStopped())
+        continue;
       PrimeSieve ps(*this, omp_get_thread_num());
       uint64_t threadStart = align(n);
       uint64_t threadStop  = align(n + threadInterval);
@@ -159,6 +428,9 @@ void ParallelPrimeSieve::sieve()
     #pragma omp parallel for schedule(dynamic) num_threads(threads) \
       reduction(+: count0, count1, count2, count3, count4, count5)
     for (int64_t i = 0; i < iters; i++) {
+      // skip the remaining chunks after stop()
+      if (isStopped())
+        continue;
       PrimeSieve ps(*this, omp_get_thread_num());
       uint64_t n = start_ + i * threadInterval;
       uint64_t threadStart = align(n);
@@ -182,84 +454,429 @@ void ParallelPrimeSieve::sieve()
     counts_[4] = count4;
     counts_[5] = count5;
   }
-
-  // communicate the sieving results to the
-  // primesieve GUI application
-  if (shm_) {
-    std::copy(counts_.begin(), counts_.end(), shm_->counts);
-    shm_->seconds = seconds_;
-  }
+#else
+  (void) threads;
+  (void) threadInterval;
+  PrimeSieve::sieve();
+#endif
 }
 
-/// Calculate the sieving status.
-/// @param processed  Sum of recently processed segments.
+/// Sieve [start_, stop_] using the std::thread pool, the
+/// chunks are distributed using work-stealing.
+/// @param threadInterval  Maximum chunk size.
 ///
-bool ParallelPrimeSieve::updateStatus(uint64_t processed, bool waitForLock)
+void ParallelPrimeSieve::sieveThreadPool(int threads, uint64_t threadInterval)
 {
-  OmpLockGuard lock(getLock<omp_lock_t*>(), waitForLock);
-  if (lock.isSet()) {
-    PrimeSieve::updateStatus(processed, false);
-    if (shm_)
-      shm_->status = getStatus();
+#if defined(PRIMESIEVE_THREAD_POOL)
+  std::mutex mutex;
+  SetPointer shareLock(lock_, &mutex);
+
+  if (threads == 1)
+    PrimeSieve::sieve();
+  else {
+    double t1 = getWallTime();
+    ThreadPool& threadPool = ThreadPool::getInstance();
+    SievingPrimes sievingPrimes(stop_, getSieveSize(), threads);
+    ShareSievingPrimes share(sievingPrimes_, sievingPrimes);
+    std::atomic<int> piece(0);
+
+    threadPool.run(threads, [&](int)
+    {
+      for (int i = piece++; i < sievingPrimes.getPieces(); i = piece++)
+        sievingPrimes.sievePiece(i);
+    });
+
+    sievingPrimesStats(getWallTime() - t1, threads);
+
+    // chunks below minChunk are not worth the
+    // per chunk initialization overhead
+    uint64_t minChunk = getInBetween(config::MIN_THREAD_INTERVAL, isqrt(stop_) * 100, threadInterval);
+    WorkStealing work(start_, stop_, threads, threadInterval, minChunk);
+    std::vector<uint64_t> counts(threads * 6, 0);
+
+    threadPool.run(threads, [&](int threadNum)
+    {
+      try {
+        uint64_t start = 0;
+        uint64_t stop = 0;
+        while (!isStopped() && work.getChunk(threadNum, &start, &stop)) {
+          uint64_t threadStart = align(start);
+          uint64_t threadStop  = align(stop);
+          // the interval end points are even (mod 30 = 2) except
+          // start_ and stop_, skip chunks that are empty after
+          // alignment so that stop_ is not counted twice
+          if (threadStart >= threadStop)
+            continue;
+          PrimeSieve ps(*this, threadNum);
+          ps.sieve(threadStart, threadStop);
+          for (int i = 0; i < 6; i++)
+            counts[threadNum * 6 + i] += ps.getCount(i);
+        }
+      }
+      catch (...) {
+        work.abort();
+        throw;
+      }
+    });
+
+    seconds_ = getWallTime() - t1;
+    for (int i = 0; i < threads * 6; i++)
+      counts_[i % 6] += counts[i];
   }
-  return lock.isSet();
+#else
+  (void) threads;
+  (void) threadInterval;
+  PrimeSieve::sieve();
+#endif
 }
 
-/// Used to synchronize threads for prime number generation
-
-void ParallelPrimeSieve::setLock()
+/// Sieve [start_, stop_] using the std::thread pool and print
+/// (or callback) the primes in ascending order. The chunks are
+/// handed out in ascending order, a thread sieves its chunk and
+/// buffers the primes until all previous chunks are done.
+/// The chunk size is chosen so that a chunk's primes fit into
+/// config::ORDERED_BUFFER_SIZE, hence threads rarely wait.
+///
+void ParallelPrimeSieve::sieveOrdered(int threads)
 {
-  omp_lock_t* lock = getLock<omp_lock_t*>();
-  omp_set_lock(lock);
+#if defined(PRIMESIEVE_THREAD_POOL)
+  SwitchBackend backend(backend_, THREAD_POOL_BACKEND);
+  std::mutex mutex;
+  OrderedState state;
+  state.head = 0;
+  SetPointer shareLock(lock_, &mutex);
+  SetPointer shareOrder(order_, &state);
+
+  double t1 = getWallTime();
+  ThreadPool& threadPool = ThreadPool::getInstance();
+  SievingPrimes sievingPrimes(stop_, getSieveSize(), threads);
+  ShareSievingPrimes share(sievingPrimes_, sievingPrimes);
+  std::atomic<int> piece(0);
+
+  threadPool.run(threads, [&](int)
+  {
+    for (int i = piece++; i < sievingPrimes.getPieces(); i = piece++)
+      sievingPrimes.sievePiece(i);
+  });
+
+  sievingPrimesStats(getWallTime() - t1, threads);
+
+  // bytes per buffered prime: decimal text or uint64_t
+  double bytes = isPrint() ? 21 : 8;
+  double primes = config::ORDERED_BUFFER_SIZE / bytes;
+  uint64_t chunk = static_cast<uint64_t>(primes * std::log(std::max(10.0, static_cast<double>(stop_))));
+  chunk = std::max(chunk, config::MIN_THREAD_INTERVAL);
+  chunk = std::min(chunk, getThreadInterval(threads));
+  chunk += 30 - chunk % 30;
+
+  uint64_t chunks = 1 + (getInterval() - 1) / chunk;
+  std::atomic<uint64_t> next(0);
+  std::vector<uint64_t> counts(threads * 6, 0);
+
+  threadPool.run(threads, [&](int threadNum)
+  {
+    try {
+      for (uint64_t i = next++; i < chunks && !isStopped(); i = next++) {
+        uint64_t n = start_ + i * chunk;
+        uint64_t threadStart = align(n);
+        uint64_t threadStop  = align(n + chunk);
+        if (threadStart < threadStop) {
+          PrimeSieve ps(*this, threadNum);
+          ps.ordered_ = true;
+          ps.chunk_ = i;
+          ps.sieve(threadStart, threadStop);
+          for (int j = 0; j < 6; j++)
+            counts[threadNum * 6 + j] += ps.getCount(j);
+        }
+        finishTurn(i);
+      }
+    }
+    catch (...) {
+      // the following chunks must not be printed,
+      // stop() wakes up the waiting threads
+      stop();
+      throw;
+    }
+  });
+
+  seconds_ = getWallTime() - t1;
+  for (int i = 0; i < threads * 6; i++)
+    counts_[i % 6] += counts[i];
+#else
+  (void) threads;
+  PrimeSieve::sieve();
+#endif
 }
 
-void ParallelPrimeSieve::unsetLock()
+/// The shared sieving primes are generated by all threads
+/// before sieving, this is accounted as PRIME_GENERATOR time.
+///
+void ParallelPrimeSieve::sievingPrimesStats(double seconds, int threads)
 {
-  omp_lock_t* lock = getLock<omp_lock_t*>();
-  omp_unset_lock(lock);
+  if (isStats())
+  {
+    stats_.seconds[SieveStats::PRIME_GENERATOR] += seconds * threads;
+    stats_.threadIdle.resize(threads, 0.0);
+    for (int i = 0; i < threads; i++)
+      stats_.threadIdle[i] -= seconds;
+  }
 }
 
-#endif /* _OPENMP */
+/// Stop sieving, in ordered mode this also wakes
+/// up the threads waiting for their turn.
+///
+void ParallelPrimeSieve::stop()
+{
+  PrimeSieve::stop();
+#if defined(PRIMESIEVE_THREAD_POOL)
+  if (order_)
+  {
+    OrderedState& state = *static_cast<OrderedState*>(order_);
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.turn.notify_all();
+  }
+#endif
+}
 
-/// If OpenMP is disabled then ParallelPrimeSieve behaves like
-/// the single threaded PrimeSieve.
+/// Ordered mode: block until all chunks < chunk are done,
+/// returns early after stop() or if a thread has failed.
 ///
-#if !defined(_OPENMP)
+void ParallelPrimeSieve::waitTurn(uint64_t chunk)
+{
+#if defined(PRIMESIEVE_THREAD_POOL)
+  OrderedState& state = *static_cast<OrderedState*>(order_);
+  std::unique_lock<std::mutex> lock(state.mutex);
+  while (state.head != chunk && !isStopped())
+    state.turn.wait(lock);
+#else
+  (void) chunk;
+#endif
+}
 
-int ParallelPrimeSieve::getMaxThreads()
+/// Ordered mode: chunk is done, the next chunk may print.
+void ParallelPrimeSieve::finishTurn(uint64_t chunk)
 {
-  return 1;
+#if defined(PRIMESIEVE_THREAD_POOL)
+  waitTurn(chunk);
+  OrderedState& state = *static_cast<OrderedState*>(order_);
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.head = std::max(state.head, chunk + 1);
+  state.turn.notify_all();
+#else
+  (void) chunk;
+#endif
 }
 
-void ParallelPrimeSieve::sieve()
+/// Store the primes within [start, stop] in array using multiple
+/// threads. First the primes of each chunk are counted, the
+/// exclusive prefix sum of the counts gives the offset of each
+/// chunk within the array. Then the array is resized only once
+/// and the threads store the primes of their chunks into
+/// disjoint slices of the array without locking.
+///
+void ParallelPrimeSieve::storePrimes(uint64_t start, uint64_t stop, PrimeArray* array)
 {
-  PrimeSieve::sieve();
+  setStart(start);
+  setStop(stop);
+  reset();
+  if (start_ > stop_)
+    return;
 
-  // communicate the sieving results to the
-  // primesieve GUI application
-  if (shm_) {
-    std::copy(counts_.begin(), counts_.end(), shm_->counts);
-    shm_->seconds = seconds_;
+  int threads = getNumThreads();
+  if (tooMany(threads))
+    threads = idealNumThreads();
+
+  if (threads > 1 && backend_ == OPENMP_BACKEND)
+    storeOpenMP(threads, getThreadInterval(threads), array);
+  else if (threads > 1 && backend_ == THREAD_POOL_BACKEND)
+    storeThreadPool(threads, getThreadInterval(threads), array);
+  else
+  {
+    // counting first would only slow down a single thread
+    double t1 = getWallTime();
+    PrimeSieve ps;
+    ps.setSieveSize(getSieveSize());
+    ps.copyEratSettings(*this);
+    StoreAll storeAll(*array, approximate_prime_count(start_, stop_));
+    ps.callbackPrimes(start_, stop_, &storeAll);
+    array->resize(static_cast<std::size_t>(storeAll.getCount()));
+    counts_[0] = storeAll.getCount();
+    seconds_ = getWallTime() - t1;
   }
 }
 
-double ParallelPrimeSieve::getWallTime() const
+/// Count the primes of chunk i (if array = NULL) or
+/// store them at array[index, ...[.
+/// @return  The number of primes of chunk i.
+///
+uint64_t ParallelPrimeSieve::storeChunk(uint64_t i, uint64_t chunkSize, int threadNum, PrimeArray* array, uint64_t index)
+{
+  uint64_t n = start_ + i * chunkSize;
+  uint64_t threadStart = align(n);
+  uint64_t threadStop  = align(n + chunkSize);
+  // skip chunks that are empty after alignment
+  // so that stop_ is not counted twice
+  if (threadStart >= threadStop)
+    return 0;
+
+  PrimeSieve ps(*this, threadNum);
+  if (!array)
+  {
+    ps.sieve(threadStart, threadStop, COUNT_PRIMES);
+    return ps.getPrimeCount();
+  }
+  StoreSlice slice(*array, index);
+  ps.callbackPrimes(threadStart, threadStop, &slice);
+  return slice.getCount();
+}
+
+/// storePrimes() using OpenMP multi-threading.
+void ParallelPrimeSieve::storeOpenMP(int threads, uint64_t chunkSize, PrimeArray* array)
+{
+#ifdef _OPENMP
+  OmpInitLock ompInit(&lock_);
+  double t1 = getWallTime();
+  SievingPrimes sievingPrimes(stop_, getSieveSize(), threads);
+  ShareSievingPrimes share(sievingPrimes_, sievingPrimes);
+  int pieces = sievingPrimes.getPieces();
+
+  #pragma omp parallel for schedule(dynamic) num_threads(threads)
+  for (int i = 0; i < pieces; i++)
+    sievingPrimes.sievePiece(i);
+
+  int64_t chunks = 1 + (getInterval() - 1) / chunkSize;
+  std::vector<uint64_t> offsets(static_cast<std::size_t>(chunks + 1), 0);
+
+  #pragma omp parallel for schedule(dynamic) num_threads(threads)
+  for (int64_t i = 0; i < chunks; i++)
+    offsets[i + 1] = storeChunk(i, chunkSize, omp_get_thread_num(), NULL, 0);
+
+  for (int64_t i = 0; i < chunks; i++)
+    offsets[i + 1] += offsets[i];
+  array->resize(static_cast<std::size_t>(offsets[chunks]));
+
+  #pragma omp parallel for schedule(dynamic) num_threads(threads)
+  for (int64_t i = 0; i < chunks; i++)
+    storeChunk(i, chunkSize, omp_get_thread_num(), array, offsets[i]);
+
+  seconds_ = getWallTime() - t1;
+  counts_[0] = offsets[chunks];
+#else
+  (void) threads;
+  (void) chunkSize;
+  (void) array;
+#endif
+}
+
+/// storePrimes() using the std::thread pool.
+void ParallelPrimeSieve::storeThreadPool(int threads, uint64_t chunkSize, PrimeArray* array)
 {
-  return PrimeSieve::getWallTime();
+#if defined(PRIMESIEVE_THREAD_POOL)
+  std::mutex mutex;
+  SetPointer shareLock(lock_, &mutex);
+  double t1 = getWallTime();
+  ThreadPool& threadPool = ThreadPool::getInstance();
+  SievingPrimes sievingPrimes(stop_, getSieveSize(), threads);
+  ShareSievingPrimes share(sievingPrimes_, sievingPrimes);
+  std::atomic<int> piece(0);
+
+  threadPool.run(threads, [&](int)
+  {
+    for (int i = piece++; i < sievingPrimes.getPieces(); i = piece++)
+      sievingPrimes.sievePiece(i);
+  });
+
+  uint64_t chunks = 1 + (getInterval() - 1) / chunkSize;
+  std::vector<uint64_t> offsets(chunks + 1, 0);
+  std::atomic<uint64_t> next(0);
+
+  threadPool.run(threads, [&](int threadNum)
+  {
+    for (uint64_t i = next++; i < chunks; i = next++)
+      offsets[i + 1] = storeChunk(i, chunkSize, threadNum, NULL, 0);
+  });
+
+  for (uint64_t i = 0; i < chunks; i++)
+    offsets[i + 1] += offsets[i];
+  array->resize(static_cast<std::size_t>(offsets[chunks]));
+  next = 0;
+
+  threadPool.run(threads, [&](int threadNum)
+  {
+    for (uint64_t i = next++; i < chunks; i = next++)
+      storeChunk(i, chunkSize, threadNum, array, offsets[i]);
+  });
+
+  seconds_ = getWallTime() - t1;
+  counts_[0] = offsets[chunks];
+#else
+  (void) threads;
+  (void) chunkSize;
+  (void) array;
+#endif
 }
 
+/// Calculate the sieving status.
+/// @param processed  Sum of recently processed segments.
+///
 bool ParallelPrimeSieve::updateStatus(uint64_t processed, bool waitForLock)
 {
+#if defined(PRIMESIEVE_THREAD_POOL)
+  if (backend_ == THREAD_POOL_BACKEND) {
+    std::unique_lock<std::mutex> lock(*getLock<std::mutex*>(), std::defer_lock);
+    if (waitForLock)
+      lock.lock();
+    else
+      lock.try_lock();
+    if (lock.owns_lock()) {
+      PrimeSieve::updateStatus(processed, false);
+      if (shm_)
+        shm_->status = getStatus();
+    }
+    return lock.owns_lock();
+  }
+#endif
+#ifdef _OPENMP
+  if (backend_ == OPENMP_BACKEND) {
+    OmpLockGuard lock(getLock<omp_lock_t*>(), waitForLock);
+    if (lock.isSet()) {
+      PrimeSieve::updateStatus(processed, false);
+      if (shm_)
+        shm_->status = getStatus();
+    }
+    return lock.isSet();
+  }
+#endif
   bool isUpdate = PrimeSieve::updateStatus(processed, waitForLock);
   if (shm_)
     shm_->status = getStatus();
   return isUpdate;
 }
 
-void ParallelPrimeSieve::setLock() { }
+/// Used to synchronize threads for prime number generation
 
-void ParallelPrimeSieve::unsetLock() { }
+void ParallelPrimeSieve::setLock()
+{
+#if defined(PRIMESIEVE_THREAD_POOL)
+  if (backend_ == THREAD_POOL_BACKEND)
+    getLock<std::mutex*>()->lock();
+#endif
+#ifdef _OPENMP
+  if (backend_ == OPENMP_BACKEND)
+    omp_set_lock(getLock<omp_lock_t*>());
+#endif
+}
 
+void ParallelPrimeSieve::unsetLock()
+{
+#if defined(PRIMESIEVE_THREAD_POOL)
+  if (backend_ == THREAD_POOL_BACKEND)
+    getLock<std::mutex*>()->unlock();
 #endif
+#ifdef _OPENMP
+  if (backend_ == OPENMP_BACKEND)
+    omp_unset_lock(getLock<omp_lock_t*>());
+#endif
+}
 
 } // namespace primesieve
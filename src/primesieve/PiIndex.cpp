@@ -0,0 +1,347 @@
+///
+/// @file   PiIndex.cpp
+/// @brief  Build, load and query the pi(x) checkpoint index.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#if !defined(__STDC_CONSTANT_MACROS)
+  #define __STDC_CONSTANT_MACROS
+#endif
+
+#include <primesieve/config.hpp>
+#include <primesieve/PiIndex.hpp>
+#include <primesieve/PrimeSieve.hpp>
+#include <primesieve/ParallelPrimeSieve.hpp>
+#include <primesieve/primesieve_error.hpp>
+#include <primesieve/littleendian_cast.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #define PRIMESIEVE_MMAP
+#endif
+
+namespace {
+
+using namespace primesieve;
+
+const char magic[8] = { 'P', 'S', 'P', 'I', 'I', 'D', 'X', '\0' };
+
+enum { HEADER_SIZE = 32 };
+
+/// The currently loaded index
+PiIndex* piIndex = NULL;
+
+uint64_t fnv1a(const byte_t* data, uint64_t size)
+{
+  uint64_t hash = UINT64_C(14695981039346656037);
+  for (uint64_t i = 0; i < size; i++)
+  {
+    hash ^= data[i];
+    hash *= UINT64_C(1099511628211);
+  }
+  return hash;
+}
+
+void putLittleEndian(byte_t* dest, uint64_t n, int bytes)
+{
+  for (int i = 0; i < bytes; i++)
+    dest[i] = static_cast<byte_t>(n >> (i * 8));
+}
+
+uint64_t sieveCount(PrimeSieve& ps, uint64_t start, uint64_t stop)
+{
+  if (start > stop)
+    return 0;
+  ps.sieve(start, stop, PrimeSieve::COUNT_PRIMES);
+  return ps.getPrimeCount();
+}
+
+/// pi(10^x) for x = 1 to 19
+const uint64_t pi10[19] =
+{
+  UINT64_C(4),
+  UINT64_C(25),
+  UINT64_C(168),
+  UINT64_C(1229),
+  UINT64_C(9592),
+  UINT64_C(78498),
+  UINT64_C(664579),
+  UINT64_C(5761455),
+  UINT64_C(50847534),
+  UINT64_C(455052511),
+  UINT64_C(4118054813),
+  UINT64_C(37607912018),
+  UINT64_C(346065536839),
+  UINT64_C(3204941750802),
+  UINT64_C(29844570422669),
+  UINT64_C(279238341033925),
+  UINT64_C(2623557157654233),
+  UINT64_C(24739954287740860),
+  UINT64_C(234057667276344607)
+};
+
+/// pi[10^x, 10^x+2^32] for x = 12 to 19, see primesieve_test.cpp
+const uint64_t pi10_2_32[8] =
+{
+  UINT64_C(155428406),
+  UINT64_C(143482916),
+  UINT64_C(133235063),
+  UINT64_C(124350420),
+  UINT64_C(116578809),
+  UINT64_C(109726486),
+  UINT64_C(103626726),
+  UINT64_C(98169972)
+};
+
+} // namespace
+
+namespace primesieve {
+
+PiIndex::PiIndex() :
+  step_(0),
+  checkpoints_(0),
+  pi_(NULL),
+  map_(NULL),
+  mapSize_(0)
+{ }
+
+PiIndex::~PiIndex()
+{
+#if defined(PRIMESIEVE_MMAP)
+  if (map_)
+    munmap(map_, mapSize_);
+#endif
+}
+
+const PiIndex* PiIndex::get()
+{
+  return piIndex;
+}
+
+void PiIndex::load(const std::string& filename)
+{
+  PiIndex* index = new PiIndex;
+  try {
+    index->open(filename);
+  }
+  catch (...) {
+    delete index;
+    throw;
+  }
+  unload();
+  piIndex = index;
+}
+
+void PiIndex::unload()
+{
+  delete piIndex;
+  piIndex = NULL;
+}
+
+/// Map (or read) the index file and validate its header
+/// and checksum.
+///
+void PiIndex::open(const std::string& filename)
+{
+  const byte_t* data = NULL;
+  uint64_t size = 0;
+
+#if defined(PRIMESIEVE_MMAP)
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+    throw primesieve_error("failed to open pi(x) index " + filename);
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size >= HEADER_SIZE)
+  {
+    mapSize_ = static_cast<std::size_t>(st.st_size);
+    map_ = mmap(NULL, mapSize_, PROT_READ, MAP_SHARED, fd, 0);
+    if (map_ == MAP_FAILED)
+      map_ = NULL;
+  }
+  close(fd);
+  if (!map_)
+    throw primesieve_error("failed to read pi(x) index " + filename);
+  data = static_cast<const byte_t*>(map_);
+  size = mapSize_;
+#else
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!file)
+    throw primesieve_error("failed to open pi(x) index " + filename);
+  file.seekg(0, std::ios::end);
+  size = static_cast<uint64_t>(file.tellg());
+  file.seekg(0, std::ios::beg);
+  if (size < HEADER_SIZE)
+    throw primesieve_error("failed to read pi(x) index " + filename);
+  buffer_.resize(static_cast<std::size_t>(size));
+  if (!file.read(reinterpret_cast<char*>(&buffer_[0]), buffer_.size()))
+    throw primesieve_error("failed to read pi(x) index " + filename);
+  data = &buffer_[0];
+#endif
+
+  if (std::memcmp(data, magic, sizeof(magic)) != 0)
+    throw primesieve_error(filename + " is not a pi(x) index file");
+
+  uint32_t version = littleendian_cast<uint32_t>(&data[8]);
+  uint32_t log2Step = littleendian_cast<uint32_t>(&data[12]);
+  uint64_t checkpoints = littleendian_cast<uint64_t>(&data[16]);
+  uint64_t checksum = littleendian_cast<uint64_t>(&data[24]);
+
+  if (version != FILE_VERSION)
+    throw primesieve_error("unsupported pi(x) index version in " + filename);
+  if (log2Step < 1 ||
+      log2Step > 62 ||
+      checkpoints < 1 ||
+      checkpoints > (size - HEADER_SIZE) / 8 ||
+      size != HEADER_SIZE + checkpoints * 8)
+    throw primesieve_error("corrupt pi(x) index " + filename);
+
+  pi_ = &data[HEADER_SIZE];
+  if (fnv1a(pi_, checkpoints * 8) != checksum)
+    throw primesieve_error("pi(x) index checksum mismatch in " + filename);
+
+  step_ = UINT64_C(1) << log2Step;
+  checkpoints_ = checkpoints;
+}
+
+/// Sieve pi(k * step) for k = 0 ... stop / step
+/// and write the index file.
+///
+void PiIndex::build(const std::string& filename,
+                    uint64_t stop,
+                    int log2Step,
+                    int threads,
+                    int backend)
+{
+  if (log2Step < 20 || log2Step > 62)
+    throw primesieve_error("pi(x) index step must be >= 2^20 and <= 2^62");
+
+  uint64_t step = UINT64_C(1) << log2Step;
+  uint64_t checkpoints = stop / step + 1;
+  std::vector<byte_t> data(static_cast<std::size_t>(HEADER_SIZE + checkpoints * 8));
+  byte_t* pi = &data[HEADER_SIZE];
+  uint64_t count = 0;
+
+  ParallelPrimeSieve pps;
+  pps.setNumThreads(threads);
+  pps.setBackend(backend);
+
+  for (uint64_t k = 1; k < checkpoints; k++)
+  {
+    count += sieveCount(pps, (k - 1) * step + 1, k * step);
+    putLittleEndian(&pi[k * 8], count, 8);
+  }
+
+  std::memcpy(&data[0], magic, sizeof(magic));
+  putLittleEndian(&data[8], FILE_VERSION, 4);
+  putLittleEndian(&data[12], log2Step, 4);
+  putLittleEndian(&data[16], checkpoints, 8);
+  putLittleEndian(&data[24], fnv1a(pi, checkpoints * 8), 8);
+
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary);
+  if (!file.write(reinterpret_cast<const char*>(&data[0]), data.size()))
+    throw primesieve_error("failed to write pi(x) index " + filename);
+}
+
+uint64_t PiIndex::getPi(uint64_t k) const
+{
+  return littleendian_cast<uint64_t>(&pi_[k * 8]);
+}
+
+/// Distance of x to the nearest checkpoint, i.e. the
+/// number of integers that need to be sieved for pi(x).
+///
+uint64_t PiIndex::getDistance(uint64_t x) const
+{
+  uint64_t k = std::min(x / step_, checkpoints_ - 1);
+  uint64_t low = k * step_;
+  if (k + 1 < checkpoints_)
+    return std::min(x - low, low + step_ - x);
+  return x - low;
+}
+
+/// @return true if counting the primes within [start, stop]
+///         using the index requires less sieving.
+///
+bool PiIndex::isFaster(uint64_t start, uint64_t stop) const
+{
+  if (start > stop)
+    return false;
+  uint64_t distance = getDistance(stop);
+  if (start > 0)
+    distance += getDistance(start - 1);
+  return distance < stop - start;
+}
+
+/// Calculate pi(x) = pi(checkpoint) +- the primes between
+/// the nearest checkpoint and x, ps is used for sieving.
+///
+uint64_t PiIndex::pi(PrimeSieve& ps, uint64_t x) const
+{
+  uint64_t k = std::min(x / step_, checkpoints_ - 1);
+  uint64_t low = k * step_;
+  if (k + 1 < checkpoints_ && low + step_ - x < x - low)
+    return getPi(k + 1) - sieveCount(ps, x + 1, low + step_);
+  return getPi(k) + sieveCount(ps, low + 1, x);
+}
+
+uint64_t PiIndex::countPrimes(PrimeSieve& ps, uint64_t start, uint64_t stop) const
+{
+  if (start > stop)
+    return 0;
+  uint64_t piStart = (start > 0) ? pi(ps, start - 1) : 0;
+  return pi(ps, stop) - piStart;
+}
+
+/// Check the index against the known values of pi(10^x) and
+/// the primesieve_test values (only values <= getLimit()).
+///
+bool PiIndex::check(int threads, int backend) const
+{
+  for (uint64_t k = 1; k < checkpoints_; k++)
+    if (getPi(k) < getPi(k - 1))
+      return false;
+
+  ParallelPrimeSieve pps;
+  pps.setNumThreads(threads);
+  pps.setBackend(backend);
+  uint64_t x = 1;
+
+  for (int i = 0; i < 19; i++)
+  {
+    x *= 10;
+    if (x > getLimit())
+      break;
+    if (pi(pps, x) != pi10[i])
+      return false;
+  }
+
+  x = UINT64_C(1000000000000);
+  uint64_t interval = UINT64_C(1) << 32;
+
+  for (int i = 0; i < 8; i++, x *= 10)
+  {
+    if (x + interval > getLimit())
+      break;
+    if (countPrimes(pps, x, x + interval) != pi10_2_32[i])
+      return false;
+  }
+
+  return true;
+}
+
+} // namespace primesieve
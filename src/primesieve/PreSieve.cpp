@@ -11,58 +11,142 @@
 
 #include <primesieve/config.hpp>
 #include <primesieve/PreSieve.hpp>
-#include <primesieve/EratSmall.hpp>
 #include <primesieve/primesieve_error.hpp>
+#include <primesieve/cpuid.hpp>
 
 #include <stdint.h>
+#include <algorithm>
 #include <cstring>
+#include <vector>
+
+#if defined(HAS_TARGET_AVX2)
+  #include <immintrin.h>
+#endif
 
 using std::memcpy;
-using std::memset;
+
+namespace {
+
+using primesieve::byte_t;
+using primesieve::uint_t;
+
+const uint_t bitValues[8] = { 7, 11, 13, 17, 19, 23, 29, 31 };
+
+/// sieve[i] &= buffer[i] for i < bytes
+void andBuffer(byte_t* sieve, const byte_t* buffer, uint_t bytes)
+{
+  for (uint_t i = 0; i < bytes; i++)
+    sieve[i] &= buffer[i];
+}
+
+#if defined(HAS_TARGET_AVX2)
+
+TARGET_AVX2
+void andBufferAvx2(byte_t* sieve, const byte_t* buffer, uint_t bytes)
+{
+  uint_t limit = bytes - bytes % 32;
+  uint_t i = 0;
+
+  for (; i < limit; i += 32)
+  {
+    __m256i* s = reinterpret_cast<__m256i*>(&sieve[i]);
+    const __m256i* b = reinterpret_cast<const __m256i*>(&buffer[i]);
+    _mm256_storeu_si256(s, _mm256_and_si256(_mm256_loadu_si256(s), _mm256_loadu_si256(b)));
+  }
+
+  for (; i < bytes; i++)
+    sieve[i] &= buffer[i];
+}
+
+#endif
+
+typedef void (*AndBuffer_t)(byte_t*, const byte_t*, uint_t);
+
+AndBuffer_t selectAndBuffer()
+{
+#if defined(HAS_TARGET_AVX2)
+  if (primesieve::has_cpuid_avx2())
+    return andBufferAvx2;
+#endif
+  return andBuffer;
+}
+
+/// Selected only once, on first use (also
+/// from other static initializers).
+///
+AndBuffer_t andBufferKernel()
+{
+  static const AndBuffer_t function = selectAndBuffer();
+  return function;
+}
+
+} // namespace
 
 namespace primesieve {
 
-const uint_t PreSieve::primes_[10] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29 };
+const uint_t PreSieve::primes_[23] =
+{
+   7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47,
+  53, 59, 61, 67, 71, 73, 79, 83, 89, 97, 101
+};
 
 /// PreSieve multiples of small primes <= limit.
-/// @pre limit >= 11 && <= 23
+/// @pre limit >= 11 && <= 97
 ///
 PreSieve::PreSieve(int limit) :
-  limit_(limit),
-  preSieved_(NULL)
+  limit_(limit)
 {
-  // limit_ <= 23 prevents 32-bit overflows
-  if (limit_ < 11 || limit_ > 23)
-    throw primesieve_error("PreSieve: limit must be >= 11 && <= 23");
+  if (limit_ < 11 || limit_ > 97)
+    throw primesieve_error("PreSieve: limit must be >= 11 && <= 97");
   init();
 }
 
-PreSieve::~PreSieve()
-{
-  delete[] preSieved_;
-}
-
-/// Cross-off the multiples of small primes <= limit_
-/// in the preSieved_ array.
+/// Split the small primes <= limit_ into groups whose
+/// product is <= MAX_BUFFER_SIZE and initialize one
+/// buffer per group.
 ///
 void PreSieve::init()
 {
-  primeProduct_ = 1;
-  for (int i = 0; primes_[i] <= limit_; i++)
-    primeProduct_ *= primes_[i];
+  const uint_t* first = primes_;
 
-  size_ = primeProduct_ / NUMBERS_PER_BYTE;
-  preSieved_ = new byte_t[size_];
-  memset(preSieved_, 0xff, size_);
+  while (*first <= limit_)
+  {
+    const uint_t* last = first + 1;
+    uint_t size = *first;
 
-  uint_t stop = primeProduct_ * 2;
-  EratSmall eratSmall(stop, size_, limit_);
+    while (*last <= limit_ && size * *last <= MAX_BUFFER_SIZE)
+      size *= *last++;
 
-  for (int i = 3; primes_[i] <= limit_; i++)
-    eratSmall.addSievingPrime(primes_[i], primeProduct_);
+    buffers_.push_back(std::vector<byte_t>(size, 0xff));
+    initBuffer(buffers_.back(), first, last);
+    first = last;
+  }
+}
 
-  // sieve [primeProduct_, primeProduct_ * 2]
-  eratSmall.crossOff(preSieved_, &preSieved_[size_]);
+/// Cross-off the multiples of the primes within [first, last[
+/// in buffer. Byte i of buffer corresponds to the numbers
+/// 30 * i + bitValues[0..7], hence the pattern of a prime p
+/// repeats every p bytes.
+///
+void PreSieve::initBuffer(std::vector<byte_t>& buffer,
+                          const uint_t* first,
+                          const uint_t* last)
+{
+  uint_t size = static_cast<uint_t>(buffer.size());
+
+  for (; first != last; first++)
+  {
+    uint_t prime = *first;
+    for (uint_t bit = 0; bit < 8; bit++)
+    {
+      // find the first multiple 30 * i + bitValues[bit]
+      uint_t i = 0;
+      while ((i * NUMBERS_PER_BYTE + bitValues[bit]) % prime != 0)
+        i++;
+      for (; i < size; i += prime)
+        buffer[i] &= ~(1 << bit);
+    }
+  }
 }
 
 /// Pre-sieve the multiples of small primes <= limit_
@@ -70,23 +154,46 @@ void PreSieve::init()
 ///
 void PreSieve::doIt(byte_t* sieve, uint_t sieveSize, uint64_t segmentLow) const
 {
-  // map segmentLow to the preSieved_ array
-  uint_t remainder = static_cast<uint_t>(segmentLow % primeProduct_);
-  uint_t index = remainder / NUMBERS_PER_BYTE;
-  uint_t sizeLeft = size_ - index;
-
-  if (sieveSize <= sizeLeft)
-    memcpy(sieve, &preSieved_[index], sieveSize);
-  else {
-    // copy the last remaining bytes at the end of preSieved_
-    // to the beginning of the sieve array
-    memcpy(sieve, &preSieved_[index], sizeLeft);
-
-    // restart copying at the beginning of preSieved_
-    for (index = sizeLeft; index + size_ < sieveSize; index += size_)
-      memcpy(&sieve[index], preSieved_, size_);
-
-    memcpy(&sieve[index], preSieved_, sieveSize - index);
+  uint64_t byteIndex = segmentLow / NUMBERS_PER_BYTE;
+  AndBuffer_t andBufferFunction = andBufferKernel();
+
+  for (std::size_t b = 0; b < buffers_.size(); b++)
+  {
+    const byte_t* buffer = &buffers_[b][0];
+    uint_t size = static_cast<uint_t>(buffers_[b].size());
+    // map segmentLow to the buffer
+    uint_t index = static_cast<uint_t>(byteIndex % size);
+
+    for (uint_t i = 0; i < sieveSize; index = 0)
+    {
+      uint_t bytes = std::min(size - index, sieveSize - i);
+      if (b == 0)
+        memcpy(&sieve[i], &buffer[index], bytes);
+      else
+        andBufferFunction(&sieve[i], &buffer[index], bytes);
+      i += bytes;
+    }
+  }
+}
+
+/// Set the bits of the small primes <= limit_ that have
+/// been crossed-off by doIt() in the sieve array.
+///
+void PreSieve::restorePrimes(byte_t* sieve, uint_t sieveSize, uint64_t segmentLow) const
+{
+  for (const uint_t* p = primes_; *p <= limit_; p++)
+  {
+    if (*p < segmentLow + bitValues[0])
+      continue;
+
+    uint_t n = static_cast<uint_t>(*p - segmentLow);
+    uint_t i = (n - bitValues[0]) / NUMBERS_PER_BYTE;
+    if (i >= sieveSize)
+      break;
+
+    for (uint_t bit = 0; bit < 8; bit++)
+      if (i * NUMBERS_PER_BYTE + bitValues[bit] == n)
+        sieve[i] |= 1 << bit;
   }
 }
 
@@ -0,0 +1,551 @@
+///
+/// @file   PrimeFile.cpp
+/// @brief  Write (PrimeFileWriter) and read (PrimeFile) binary
+///         prime files, see PrimeFile.hpp for the file format.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primesieve/config.hpp>
+#include <primesieve/PrimeFile.hpp>
+#include <primesieve/PrimeFileWriter.hpp>
+#include <primesieve/decodePrimes.hpp>
+#include <primesieve/popcount.hpp>
+#include <primesieve/primesieve_error.hpp>
+#include <primesieve/littleendian_cast.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #define PRIMESIEVE_MMAP
+#endif
+
+namespace {
+
+using namespace primesieve;
+
+const char magic[8] = { 'P', 'S', 'P', 'R', 'I', 'M', 'E', '\0' };
+
+const uint64_t smallPrimes[3] = { 2, 3, 5 };
+
+const uint64_t bitValues[8] = { 7, 11, 13, 17, 19, 23, 29, 31 };
+
+enum
+{
+  HEADER_SIZE = 64,
+  /// Index entry: offset, count, first number
+  INDEX_ENTRY = 24,
+  /// Flush the delta-varint buffer at this size
+  WRITE_BUFFER_SIZE = 1 << 16
+};
+
+void putLittleEndian(byte_t* dest, uint64_t n, int bytes)
+{
+  for (int i = 0; i < bytes; i++)
+    dest[i] = static_cast<byte_t>(n >> (i * 8));
+}
+
+void putVarint(std::vector<byte_t>& buffer, uint64_t n)
+{
+  while (n >= 0x80)
+  {
+    buffer.push_back(static_cast<byte_t>(n | 0x80));
+    n >>= 7;
+  }
+  buffer.push_back(static_cast<byte_t>(n));
+}
+
+uint64_t getVarint(const byte_t*& data)
+{
+  uint64_t n = 0;
+  for (int shift = 0; ; shift += 7)
+  {
+    byte_t byte = *data++;
+    n |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (byte < 0x80)
+      return n;
+  }
+}
+
+/// Count the 1 bits of bytes that are not a multiple of 8
+uint64_t popcountBytes(const byte_t* bytes, uint64_t size)
+{
+  uint64_t words = size / 8;
+  uint64_t count = popcount(reinterpret_cast<const uint64_t*>(bytes), words);
+  for (uint64_t i = words * 8; i < size; i++)
+    for (byte_t b = bytes[i]; b != 0; b &= b - 1)
+      count++;
+  return count;
+}
+
+/// Same as SieveOfEratosthenes: the first sieve byte
+/// corresponds to the numbers [low, low + 30[
+///
+uint64_t getLow(uint64_t start)
+{
+  start = std::max<uint64_t>(start, 7);
+  uint64_t r = start % NUMBERS_PER_BYTE;
+  if (r <= 1)
+    r += NUMBERS_PER_BYTE;
+  return start - r;
+}
+
+} // namespace
+
+namespace primesieve {
+
+PrimeFileWriter::PrimeFileWriter(const std::string& filename, uint64_t start, uint64_t stop, int format) :
+  filename_(filename),
+  start_(start),
+  stop_(stop),
+  low_(getLow(start)),
+  count_(0),
+  dataSize_(0),
+  blockSize_(0),
+  prevPrime_(0),
+  format_(format)
+{
+  if (format_ != BITMAP_FORMAT &&
+      format_ != DELTA_FORMAT)
+    throw primesieve_error("invalid prime file format");
+
+  file_.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file_)
+    throw primesieve_error("failed to open prime file " + filename);
+
+  // reserve space for the header
+  byte_t header[HEADER_SIZE] = { 0 };
+  file_.write(reinterpret_cast<const char*>(header), HEADER_SIZE);
+
+  if (format_ == BITMAP_FORMAT)
+    newBlock(low_);
+
+  for (int i = 0; i < 3; i++)
+  {
+    if (smallPrimes[i] < start_ || smallPrimes[i] > stop_)
+      continue;
+    if (format_ == BITMAP_FORMAT)
+      count_++;
+    else
+      writePrimes(&smallPrimes[i], 1);
+  }
+}
+
+void PrimeFileWriter::newBlock(uint64_t first)
+{
+  index_.push_back(HEADER_SIZE + dataSize_ + buffer_.size());
+  index_.push_back(count_);
+  index_.push_back(first);
+  blockSize_ = 0;
+}
+
+/// @param sieveSize  The sieve array is zero padded to a
+///                   multiple of 8 bytes.
+///
+void PrimeFileWriter::callback(const uint8_t* sieve, std::size_t sieveSize, uint64_t segmentLow, int)
+{
+  if (format_ == BITMAP_FORMAT)
+    writeBitmap(sieve, sieveSize);
+  else
+  {
+    std::size_t words = (sieveSize + 7) / 8;
+    uint64_t count = popcount(reinterpret_cast<const uint64_t*>(sieve), words);
+    primes_.resize(static_cast<std::size_t>(count) + 8);
+    std::size_t n = decodePrimes(sieve, words, segmentLow, &primes_[0]);
+    writePrimes(&primes_[0], n);
+  }
+}
+
+/// All segments except the last one are a multiple of 8 bytes,
+/// hence the blocks are split at 8 byte boundaries.
+///
+void PrimeFileWriter::writeBitmap(const byte_t* sieve, uint64_t size)
+{
+  while (size > 0)
+  {
+    if (blockSize_ == PrimeFile::BLOCK_BYTES)
+      newBlock(low_ + dataSize_ * NUMBERS_PER_BYTE);
+    uint64_t bytes = std::min<uint64_t>(size, PrimeFile::BLOCK_BYTES - blockSize_);
+    count_ += popcount(reinterpret_cast<const uint64_t*>(sieve), (bytes + 7) / 8);
+    writeData(sieve, static_cast<std::size_t>(bytes));
+    blockSize_ += bytes;
+    sieve += bytes;
+    size -= bytes;
+  }
+}
+
+/// Odd primes have even gaps, the gaps are stored
+/// divided by 2 except for the gap 2 -> 3.
+///
+void PrimeFileWriter::writePrimes(const uint64_t* primes, std::size_t size)
+{
+  for (std::size_t i = 0; i < size; i++)
+  {
+    uint64_t prime = primes[i];
+    if (count_ % PrimeFile::BLOCK_PRIMES == 0)
+    {
+      newBlock(prime);
+      putVarint(buffer_, prime);
+    }
+    else if (prevPrime_ == 2)
+      putVarint(buffer_, prime - prevPrime_);
+    else
+      putVarint(buffer_, (prime - prevPrime_) / 2);
+    prevPrime_ = prime;
+    count_++;
+  }
+
+  if (buffer_.size() >= WRITE_BUFFER_SIZE)
+  {
+    std::vector<byte_t> buffer;
+    buffer.swap(buffer_);
+    writeData(&buffer[0], buffer.size());
+  }
+}
+
+void PrimeFileWriter::writeData(const byte_t* data, std::size_t size)
+{
+  file_.write(reinterpret_cast<const char*>(data), size);
+  dataSize_ += size;
+}
+
+void PrimeFileWriter::close()
+{
+  if (!buffer_.empty())
+  {
+    std::vector<byte_t> buffer;
+    buffer.swap(buffer_);
+    writeData(&buffer[0], buffer.size());
+  }
+
+  // the index is 8 byte aligned
+  byte_t zeros[8] = { 0 };
+  writeData(zeros, static_cast<std::size_t>((8 - dataSize_ % 8) % 8));
+
+  uint64_t indexOffset = HEADER_SIZE + dataSize_;
+  uint64_t blocks = index_.size() / 3;
+  std::vector<byte_t> index(index_.size() * 8 + 1);
+  for (std::size_t i = 0; i < index_.size(); i++)
+    putLittleEndian(&index[i * 8], index_[i], 8);
+  file_.write(reinterpret_cast<const char*>(&index[0]), index_.size() * 8);
+
+  byte_t header[HEADER_SIZE] = { 0 };
+  std::memcpy(header, magic, sizeof(magic));
+  putLittleEndian(&header[8], PrimeFile::FILE_VERSION, 4);
+  putLittleEndian(&header[12], format_, 4);
+  putLittleEndian(&header[16], start_, 8);
+  putLittleEndian(&header[24], stop_, 8);
+  putLittleEndian(&header[32], count_, 8);
+  putLittleEndian(&header[40], low_, 8);
+  putLittleEndian(&header[48], blocks, 8);
+  putLittleEndian(&header[56], indexOffset, 8);
+  file_.seekp(0);
+  file_.write(reinterpret_cast<const char*>(header), HEADER_SIZE);
+  file_.close();
+
+  if (!file_)
+    throw primesieve_error("failed to write prime file " + filename_);
+}
+
+PrimeFile::PrimeFile(const std::string& filename) :
+  data_(NULL),
+  dataSize_(0),
+  index_(NULL),
+  start_(0),
+  stop_(0),
+  count_(0),
+  low_(0),
+  blocks_(0),
+  format_(BITMAP_FORMAT),
+  i_(0),
+  block_(0),
+  map_(NULL),
+  mapSize_(0)
+{
+  open(filename);
+  skipto(start_);
+}
+
+PrimeFile::~PrimeFile()
+{
+#if defined(PRIMESIEVE_MMAP)
+  if (map_)
+    munmap(map_, mapSize_);
+#endif
+}
+
+/// Map (or read) the prime file and validate its header
+void PrimeFile::open(const std::string& filename)
+{
+  const byte_t* data = NULL;
+  uint64_t size = 0;
+
+#if defined(PRIMESIEVE_MMAP)
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+    throw primesieve_error("failed to open prime file " + filename);
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size >= HEADER_SIZE)
+  {
+    mapSize_ = static_cast<std::size_t>(st.st_size);
+    map_ = mmap(NULL, mapSize_, PROT_READ, MAP_SHARED, fd, 0);
+    if (map_ == MAP_FAILED)
+      map_ = NULL;
+  }
+  ::close(fd);
+  if (!map_)
+    throw primesieve_error("failed to read prime file " + filename);
+  data = static_cast<const byte_t*>(map_);
+  size = mapSize_;
+#else
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!file)
+    throw primesieve_error("failed to open prime file " + filename);
+  file.seekg(0, std::ios::end);
+  size = static_cast<uint64_t>(file.tellg());
+  file.seekg(0, std::ios::beg);
+  if (size < HEADER_SIZE)
+    throw primesieve_error("failed to read prime file " + filename);
+  file_.resize(static_cast<std::size_t>(size));
+  if (!file.read(reinterpret_cast<char*>(&file_[0]), file_.size()))
+    throw primesieve_error("failed to read prime file " + filename);
+  data = &file_[0];
+#endif
+
+  if (std::memcmp(data, magic, sizeof(magic)) != 0)
+    throw primesieve_error(filename + " is not a prime file");
+
+  uint32_t version = littleendian_cast<uint32_t>(&data[8]);
+  uint32_t format = littleendian_cast<uint32_t>(&data[12]);
+  uint64_t indexOffset = littleendian_cast<uint64_t>(&data[56]);
+
+  if (version != FILE_VERSION)
+    throw primesieve_error("unsupported prime file version in " + filename);
+
+  start_ = littleendian_cast<uint64_t>(&data[16]);
+  stop_ = littleendian_cast<uint64_t>(&data[24]);
+  count_ = littleendian_cast<uint64_t>(&data[32]);
+  low_ = littleendian_cast<uint64_t>(&data[40]);
+  blocks_ = littleendian_cast<uint64_t>(&data[48]);
+  format_ = static_cast<int>(format);
+
+  if ((format != BITMAP_FORMAT && format != DELTA_FORMAT) ||
+      indexOffset < HEADER_SIZE ||
+      indexOffset % 8 != 0 ||
+      indexOffset > size ||
+      blocks_ != (size - indexOffset) / INDEX_ENTRY ||
+      size != indexOffset + blocks_ * INDEX_ENTRY ||
+      (format == BITMAP_FORMAT && blocks_ < 1))
+    throw primesieve_error("corrupt prime file " + filename);
+
+  data_ = &data[HEADER_SIZE];
+  dataSize_ = indexOffset - HEADER_SIZE;
+  index_ = &data[indexOffset];
+
+  for (uint64_t b = 0; b < blocks_; b++)
+    if (getOffset(b) > dataSize_ || getCount(b) > count_)
+      throw primesieve_error("corrupt prime file " + filename);
+}
+
+/// @return Offset of the block relative to data_
+uint64_t PrimeFile::getOffset(uint64_t block) const
+{
+  return littleendian_cast<uint64_t>(&index_[block * INDEX_ENTRY]) - HEADER_SIZE;
+}
+
+/// @return The number of primes before the block
+uint64_t PrimeFile::getCount(uint64_t block) const
+{
+  return littleendian_cast<uint64_t>(&index_[block * INDEX_ENTRY + 8]);
+}
+
+/// @return The first number (bitmap) or the first prime (delta)
+uint64_t PrimeFile::getFirst(uint64_t block) const
+{
+  return littleendian_cast<uint64_t>(&index_[block * INDEX_ENTRY + 16]);
+}
+
+/// @return The block that contains n, O(1) for
+///         the bitmap format else O(log blocks).
+///
+uint64_t PrimeFile::findBlock(uint64_t n) const
+{
+  if (blocks_ == 0)
+    return 0;
+
+  if (format_ == BITMAP_FORMAT)
+  {
+    if (n < low_ + 2)
+      return 0;
+    uint64_t byte = (n - low_ - 2) / NUMBERS_PER_BYTE;
+    return std::min(byte / BLOCK_BYTES, blocks_ - 1);
+  }
+
+  // last block whose first prime <= n
+  uint64_t first = 0;
+  uint64_t last = blocks_;
+  while (last - first > 1)
+  {
+    uint64_t middle = first + (last - first) / 2;
+    if (getFirst(middle) <= n)
+      first = middle;
+    else
+      last = middle;
+  }
+  return first;
+}
+
+void PrimeFile::decodeBlock(uint64_t block, std::vector<uint64_t>& primes) const
+{
+  primes.clear();
+  uint64_t offset = getOffset(block);
+  uint64_t end = (block + 1 < blocks_) ? getOffset(block + 1) : dataSize_;
+
+  if (format_ == BITMAP_FORMAT)
+  {
+    if (block == 0)
+      for (int i = 0; i < 3; i++)
+        if (smallPrimes[i] >= start_ && smallPrimes[i] <= stop_)
+          primes.push_back(smallPrimes[i]);
+
+    // the blocks are split at 8 byte boundaries
+    const byte_t* sieve = &data_[offset];
+    std::size_t words = static_cast<std::size_t>((end - offset) / 8);
+    std::size_t size = primes.size();
+    uint64_t count = popcount(reinterpret_cast<const uint64_t*>(sieve), words);
+    primes.resize(size + static_cast<std::size_t>(count) + 8);
+    size += decodePrimes(sieve, words, low_ + offset * NUMBERS_PER_BYTE, &primes[size]);
+    primes.resize(size);
+  }
+  else
+  {
+    const byte_t* data = &data_[offset];
+    uint64_t count = std::min<uint64_t>(BLOCK_PRIMES, count_ - getCount(block));
+    uint64_t prime = 0;
+    for (uint64_t i = 0; i < count; i++)
+    {
+      if (i == 0)
+        prime = getVarint(data);
+      else if (prime == 2)
+        prime += getVarint(data);
+      else
+        prime += getVarint(data) * 2;
+      primes.push_back(prime);
+    }
+  }
+}
+
+/// @return The number of stored primes <= x
+uint64_t PrimeFile::pi(uint64_t x) const
+{
+  if (count_ == 0 || x < start_)
+    return 0;
+  if (x >= stop_)
+    return count_;
+
+  uint64_t block = findBlock(x);
+  uint64_t count = getCount(block);
+
+  if (format_ == BITMAP_FORMAT)
+  {
+    if (block == 0)
+      for (int i = 0; i < 3; i++)
+        if (smallPrimes[i] >= start_ && smallPrimes[i] <= x)
+          count++;
+    if (x < low_ + 7)
+      return count;
+
+    // count the bits of the bytes before x's byte and
+    // then the bits of x's byte that are <= x
+    uint64_t byte = (x - low_ - 2) / NUMBERS_PER_BYTE;
+    uint64_t offset = getOffset(block);
+    count += popcountBytes(&data_[offset], byte - offset);
+    uint64_t r = x - (low_ + byte * NUMBERS_PER_BYTE);
+    for (int i = 0; i < 8 && bitValues[i] <= r; i++)
+      count += (data_[byte] >> i) & 1;
+    return count;
+  }
+
+  std::vector<uint64_t> primes;
+  decodeBlock(block, primes);
+  return count + (std::upper_bound(primes.begin(), primes.end(), x) - primes.begin());
+}
+
+uint64_t PrimeFile::countPrimes(uint64_t start, uint64_t stop) const
+{
+  if (start > stop)
+    return 0;
+  uint64_t piStart = (start > 0) ? pi(start - 1) : 0;
+  return pi(stop) - piStart;
+}
+
+/// The delta format finds the block in O(1), the
+/// bitmap format uses a binary search of the index.
+///
+uint64_t PrimeFile::nthPrime(uint64_t n) const
+{
+  if (n == 0 || n > count_)
+    throw primesieve_error("nth prime is not within the prime file");
+
+  uint64_t block = (n - 1) / BLOCK_PRIMES;
+
+  if (format_ == BITMAP_FORMAT)
+  {
+    // last block with less than n primes before it
+    uint64_t first = 0;
+    uint64_t last = blocks_;
+    while (last - first > 1)
+    {
+      uint64_t middle = first + (last - first) / 2;
+      if (getCount(middle) < n)
+        first = middle;
+      else
+        last = middle;
+    }
+    block = first;
+  }
+
+  std::vector<uint64_t> primes;
+  decodeBlock(block, primes);
+  return primes.at(static_cast<std::size_t>(n - 1 - getCount(block)));
+}
+
+void PrimeFile::skipto(uint64_t start)
+{
+  primes_.clear();
+  i_ = 0;
+  block_ = findBlock(start);
+  while (nextBlock() && primes_.back() < start)
+  { }
+  i_ = std::lower_bound(primes_.begin(), primes_.end(), start) - primes_.begin();
+}
+
+/// Decode the next non-empty block
+bool PrimeFile::nextBlock()
+{
+  while (block_ < blocks_)
+  {
+    decodeBlock(block_++, primes_);
+    i_ = 0;
+    if (!primes_.empty())
+      return true;
+  }
+  primes_.clear();
+  i_ = 0;
+  return false;
+}
+
+} // namespace primesieve
@@ -3,7 +3,7 @@
 /// @brief  Callback, print and count primes and prime k-tuplets
 ///         (twin primes, prime triplets, ...).
 ///
-/// Copyright (C) 2014 Kim Walisch, <kim.walisch@gmail.com>
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
 ///
 /// This file is distributed under the BSD License. See the COPYING
 /// file in the top level directory.
@@ -17,18 +17,155 @@
 #include <primesieve/callback_t.hpp>
 #include <primesieve/SieveOfEratosthenes.hpp>
 #include <primesieve/SieveOfEratosthenes-inline.hpp>
-#include <primesieve/littleendian_cast.hpp>
+#include <primesieve/EratSettings.hpp>
+#include <primesieve/SieveStats.hpp>
+#include <primesieve/decodePrimes.hpp>
+#include <primesieve/popcount.hpp>
+#include <primesieve/PrimeWriter.hpp>
+#include <primesieve/cpuid.hpp>
 
 #include <stdint.h>
 #include <algorithm>
+#include <cstddef>
 #include <vector>
-#include <iostream>
-#include <sstream>
 
-namespace primesieve {
+#if defined(HAS_TARGET_AVX2)
+  #include <immintrin.h>
+#endif
+
+namespace {
+
+using primesieve::byte_t;
+using primesieve::uint_t;
+
+#if defined(HAS_TARGET_AVX2)
+
+/// Count the sieve bytes that match the prime k-tuplet bitmasks,
+/// i.e. (byte & bitmask) == bitmask, 32 bytes at a time. The
+/// matches of each bitmask are accumulated in 8-bit lanes (at
+/// most 255 iterations) which are then summed up using VPSADBW.
+/// @return Number of bytes processed (multiple of 32).
+///
+TARGET_AVX2
+uint_t countTupletsAvx2(const byte_t* sieve,
+                        uint_t sieveSize,
+                        const byte_t* masks,
+                        const byte_t* types,
+                        std::size_t n,
+                        uint64_t* counts)
+{
+  enum { MAX_MASKS = 16 };
+  __m256i bitmasks[MAX_MASKS];
+  __m256i matches[MAX_MASKS];
+  __m256i sums[MAX_MASKS];
+  __m256i zero = _mm256_setzero_si256();
+  uint_t vectors = sieveSize / 32;
+  uint_t i = 0;
+
+  for (std::size_t j = 0; j < n; j++)
+  {
+    bitmasks[j] = _mm256_set1_epi8(static_cast<char>(masks[j]));
+    sums[j] = zero;
+  }
+
+  while (i < vectors)
+  {
+    uint_t limit = std::min(vectors, i + 255);
+
+    for (std::size_t j = 0; j < n; j++)
+      matches[j] = zero;
+
+    for (; i < limit; i++)
+    {
+      __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&sieve[i * 32]));
+      // match = 0xff if (byte & bitmask) == bitmask, subtracting
+      // 0xff (-1) adds 1 to the 8-bit lane
+      for (std::size_t j = 0; j < n; j++)
+      {
+        __m256i match = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, bitmasks[j]), bitmasks[j]);
+        matches[j] = _mm256_sub_epi8(matches[j], match);
+      }
+    }
+
+    for (std::size_t j = 0; j < n; j++)
+      sums[j] = _mm256_add_epi64(sums[j], _mm256_sad_epu8(matches[j], zero));
+  }
+
+  for (std::size_t j = 0; j < n; j++)
+  {
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), sums[j]);
+    counts[types[j]] += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  }
+
+  return vectors * 32;
+}
+
+#endif
+
+typedef uint_t (*TupletKernel_t)(const byte_t*, uint_t, const byte_t*, const byte_t*, std::size_t, uint64_t*);
+
+/// @return The SIMD prime k-tuplet counter of a
+///         PrimeFinder::TUPLETS_* kernel, NULL if
+///         scalar or not supported by the CPU.
+///
+TupletKernel_t getTupletFunction(int kernel)
+{
+#if defined(HAS_TARGET_AVX2)
+  if (kernel == primesieve::PrimeFinder::TUPLETS_AVX2 &&
+      primesieve::has_cpuid_avx2())
+    return countTupletsAvx2;
+#endif
+  (void) kernel;
+  return NULL;
+}
+
+/// The fastest kernel supported by the CPU
+int selectTupletKernel()
+{
+  for (int i = primesieve::PrimeFinder::TUPLET_KERNELS - 1; i > 0; i--)
+    if (getTupletFunction(i))
+      return i;
+  return primesieve::PrimeFinder::TUPLETS_SCALAR;
+}
+
+/// The kernel is selected only once, on first use,
+/// it can be changed using setTupletKernel().
+///
+int& tupletKernel()
+{
+  static int kernel = selectTupletKernel();
+  return kernel;
+}
+
+/// Adapter for use with PrimeFinder::callbackBatch()
+class BatchCallbackObj
+{
+public:
+  BatchCallbackObj(primesieve::BatchCallback* cb) : cb_(cb) { }
+  void operator()(const uint64_t* primes, std::size_t count, int threadNum) const
+  {
+    cb_->callback(primes, count, threadNum);
+  }
+private:
+  primesieve::BatchCallback* cb_;
+};
+
+/// @return The bucket size and Erat* limits of ps
+primesieve::EratSettings eratSettings(const primesieve::PrimeSieve& ps)
+{
+  primesieve::EratSettings settings;
+  settings.bucketSize = ps.getBucketSize();
+  settings.bytesPerAlloc = ps.getBucketAllocSize() * 1024;
+  settings.factorEratSmall = ps.getFactorEratSmall();
+  settings.factorEratMedium = ps.getFactorEratMedium();
+  settings.hugePages = ps.isHugePages();
+  return settings;
+}
 
-/// forward declaration
-uint64_t popcount(const uint64_t* array, uint64_t size);
+} // namespace
+
+namespace primesieve {
 
 const uint_t PrimeFinder::kBitmasks_[6][5] =
 {
@@ -43,11 +180,75 @@ const uint_t PrimeFinder::kBitmasks_[6][5] =
 PrimeFinder::PrimeFinder(PrimeSieve& ps) :
   SieveOfEratosthenes(std::max<uint64_t>(7, ps.getStart()),
                       ps.getStop(),
-                      ps.getSieveSize()),
-  ps_(ps)
+                      ps.getSieveSize(),
+                      eratSettings(ps),
+                      ps.getContext()),
+  ps_(ps),
+  writer_(NULL),
+  tupletFunction_(getTupletFunction(tupletKernel()))
 {
+  timer_ = ps_.timer_;
   if (ps_.isFlag(ps_.COUNT_TWINS, ps_.COUNT_SEXTUPLETS))
     init_kCounts();
+  if (ps_.isPrint())
+    writer_ = new PrimeWriter(ps_.getPrintFd());
+}
+
+PrimeFinder::~PrimeFinder()
+{
+  delete writer_;
+}
+
+/// Write the remaining buffered primes, must be called
+/// after sieve(). In ordered mode this waits until all
+/// previous chunks are done.
+///
+void PrimeFinder::flush()
+{
+  if (!writer_ && !ps_.isCallback())
+    return;
+
+  ps_.takeTurn();
+  // stopped (or aborted) while waiting, the
+  // following chunks must not be printed
+  if (ps_.ordered_ && ps_.isStopped())
+    return;
+
+  setStage(writer_ ? SieveStats::PRINT : SieveStats::CALLBACK);
+  callbackPending();
+
+  if (writer_ && !writer_->isEmpty())
+  {
+    LockGuard lock(ps_);
+    writer_->flush();
+  }
+}
+
+bool PrimeFinder::hasTupletKernel(int kernel)
+{
+  return kernel == TUPLETS_SCALAR ||
+         getTupletFunction(kernel) != NULL;
+}
+
+int PrimeFinder::getTupletKernel()
+{
+  return tupletKernel();
+}
+
+/// Used for testing, select the prime k-tuplet counting code of
+/// all subsequently created PrimeFinder objects.
+/// @pre hasTupletKernel(kernel)
+///
+void PrimeFinder::setTupletKernel(int kernel)
+{
+  if (hasTupletKernel(kernel))
+    tupletKernel() = kernel;
+}
+
+/// @return true if PrimeSieve::stop() has been called
+bool PrimeFinder::isStopped() const
+{
+  return ps_.isStopped();
 }
 
 /// Calculate the number of twins, triplets, ... (bitmask matches)
@@ -59,6 +260,7 @@ void PrimeFinder::init_kCounts()
   {
     if (ps_.isCount(i))
     {
+      kTypes_.push_back(i);
       kCounts_[i].resize(256);
       for (uint_t j = 0; j < kCounts_[i].size(); j++)
       {
@@ -70,6 +272,11 @@ void PrimeFinder::init_kCounts()
         }
         kCounts_[i][j] = bitmaskCount;
       }
+      for (const uint_t* b = kBitmasks_[i]; *b != END; b++)
+      {
+        kMasks_.push_back(static_cast<byte_t>(*b));
+        kMaskTypes_.push_back(static_cast<byte_t>(i));
+      }
     }
   }
 }
@@ -79,76 +286,106 @@ void PrimeFinder::init_kCounts()
 ///
 void PrimeFinder::segmentFinished(const byte_t* sieve, uint_t sieveSize)
 {
-  if (ps_.isCallback())
-    callbackPrimes(sieve, sieveSize);
+  if (timer_)
+  {
+    ps_.stats_.segments++;
+    setStage(SieveStats::CALLBACK);
+  }
+  if (ps_.isFlag(ps_.FIND_NTH_PRIME))
+    findNthPrime(sieve, sieveSize);
+  else if (ps_.isCallback())
+  {
+    if (!ps_.hasTurn())
+      bufferPrimes(sieve, sieveSize);
+    else
+    {
+      callbackPending();
+      if (ps_.isFlag(ps_.CALLBACK_PRIMES_BATCH, ps_.CALLBACK_PRIMES_C_BATCH))
+        callbackBatch(sieve, sieveSize);
+      else
+        callbackPrimes(sieve, sieveSize);
+    }
+  }
   if (ps_.isCount())
+  {
+    setStage(SieveStats::COUNT);
     count(sieve, sieveSize);
+  }
   if (ps_.isPrint())
+  {
+    setStage(SieveStats::PRINT);
     print(sieve, sieveSize);
+  }
+  if (ps_.isFlag(ps_.CALLBACK_SEGMENTS))
+  {
+    setStage(SieveStats::CALLBACK);
+    ps_.cb_segment_->callback(sieve, sieveSize, getSegmentLow(), ps_.threadNum_);
+  }
   if (ps_.isStatus())
     ps_.updateStatus(sieveSize * NUMBERS_PER_BYTE, /* waitForLock = */ false);
 }
 
 /// Reconstruct prime numbers from 1 bits of the sieve array and
-/// call a callback function for each prime.
+/// call a callback function for each prime. The primes are
+/// decoded in blocks of DECODE_WORDS 64-bit words.
 ///
 template <typename T>
 inline void PrimeFinder::callbackPrimes(T callback, const byte_t* sieve, uint_t sieveSize) const
 {
+  uint64_t primes[DECODE_WORDS * 64];
   uint64_t base = getSegmentLow();
-  for (uint_t i = 0; i < sieveSize; i += 8, base += NUMBERS_PER_BYTE * 8)
+  uint_t words = (sieveSize + 7) / 8;
+
+  for (uint_t i = 0; i < words; i += DECODE_WORDS, base += NUMBERS_PER_BYTE * 8 * DECODE_WORDS)
   {
-    uint64_t bits = littleendian_cast<uint64_t>(&sieve[i]); 
-    while (bits != 0)
-    {
-      uint64_t prime = getNextPrime(&bits, base);
-      callback(prime);
-    }
+    std::size_t n = decodePrimes(&sieve[i * 8], std::min<uint_t>(DECODE_WORDS, words - i), base, primes);
+    for (std::size_t j = 0; j < n; j++)
+      callback(primes[j]);
   }
 }
 
 template <>
 inline void PrimeFinder::callbackPrimes(Callback<uint64_t>* cb, const byte_t* sieve, uint_t sieveSize) const
 {
+  uint64_t primes[DECODE_WORDS * 64];
   uint64_t base = getSegmentLow();
-  for (uint_t i = 0; i < sieveSize; i += 8, base += NUMBERS_PER_BYTE * 8)
+  uint_t words = (sieveSize + 7) / 8;
+
+  for (uint_t i = 0; i < words; i += DECODE_WORDS, base += NUMBERS_PER_BYTE * 8 * DECODE_WORDS)
   {
-    uint64_t bits = littleendian_cast<uint64_t>(&sieve[i]); 
-    while (bits != 0)
-    {
-      uint64_t prime = getNextPrime(&bits, base);
-      cb->callback(prime);
-    }
+    std::size_t n = decodePrimes(&sieve[i * 8], std::min<uint_t>(DECODE_WORDS, words - i), base, primes);
+    for (std::size_t j = 0; j < n; j++)
+      cb->callback(primes[j]);
   }
 }
 
 template <typename T>
 inline void PrimeFinder::callbackPrimes(T callback, const byte_t* sieve, uint_t sieveSize, int threadNum) const
 {
+  uint64_t primes[DECODE_WORDS * 64];
   uint64_t base = getSegmentLow();
-  for (uint_t i = 0; i < sieveSize; i += 8, base += NUMBERS_PER_BYTE * 8)
+  uint_t words = (sieveSize + 7) / 8;
+
+  for (uint_t i = 0; i < words; i += DECODE_WORDS, base += NUMBERS_PER_BYTE * 8 * DECODE_WORDS)
   {
-    uint64_t bits = littleendian_cast<uint64_t>(&sieve[i]); 
-    while (bits != 0)
-    {
-      uint64_t prime = getNextPrime(&bits, base);
-      callback(prime, threadNum);
-    }
+    std::size_t n = decodePrimes(&sieve[i * 8], std::min<uint_t>(DECODE_WORDS, words - i), base, primes);
+    for (std::size_t j = 0; j < n; j++)
+      callback(primes[j], threadNum);
   }
 }
 
 template <>
 inline void PrimeFinder::callbackPrimes(Callback<uint64_t, int>* cb, const byte_t* sieve, uint_t sieveSize, int threadNum) const
 {
+  uint64_t primes[DECODE_WORDS * 64];
   uint64_t base = getSegmentLow();
-  for (uint_t i = 0; i < sieveSize; i += 8, base += NUMBERS_PER_BYTE * 8)
+  uint_t words = (sieveSize + 7) / 8;
+
+  for (uint_t i = 0; i < words; i += DECODE_WORDS, base += NUMBERS_PER_BYTE * 8 * DECODE_WORDS)
   {
-    uint64_t bits = littleendian_cast<uint64_t>(&sieve[i]); 
-    while (bits != 0)
-    {
-      uint64_t prime = getNextPrime(&bits, base);
-      cb->callback(prime, threadNum);
-    }
+    std::size_t n = decodePrimes(&sieve[i * 8], std::min<uint_t>(DECODE_WORDS, words - i), base, primes);
+    for (std::size_t j = 0; j < n; j++)
+      cb->callback(primes[j], threadNum);
   }
 }
 
@@ -165,6 +402,169 @@ void PrimeFinder::callbackPrimes(const byte_t* sieve, uint_t sieveSize) const
   if (ps_.isFlag(ps_.CALLBACK_PRIMES_C_TN))   { /* No Locking */     callbackPrimes(reinterpret_cast<callback_c_tn_t>(ps_.callback_tn_), sieve, sieveSize, ps_.threadNum_); }
 }
 
+/// Decode the primes of the current segment into the batch_
+/// buffer (each thread has its own PrimeFinder) and pass them
+/// to the callback in batches of up to ps_.getBatchSize() primes.
+///
+template <typename T>
+void PrimeFinder::callbackBatch(T callback, const byte_t* sieve, uint_t sieveSize)
+{
+  std::size_t limit = ps_.getBatchSize();
+  int threadNum = ps_.threadNum_;
+  uint64_t base = getSegmentLow();
+  uint_t words = (sieveSize + 7) / 8;
+  std::size_t n = 0;
+
+  // one batch per segment, decodePrimes() needs
+  // space for 8 extra primes
+  if (limit == 0)
+  {
+    limit = static_cast<std::size_t>(popcount(reinterpret_cast<const uint64_t*>(sieve), words)) + 8;
+    if (batch_.size() < limit)
+      batch_.resize(limit);
+    n = decodePrimes(sieve, words, base, &batch_[0]);
+    if (n > 0)
+      callback(&batch_[0], n, threadNum);
+    return;
+  }
+
+  if (batch_.size() < limit)
+    batch_.resize(limit);
+
+  uint64_t* primes = &batch_[0];
+
+  for (uint_t i = 0; i < words; )
+  {
+    // a 64-bit word contains at most 64 primes
+    std::size_t space = (limit - n) / 64;
+    if (space == 0)
+    {
+      callback(primes, n, threadNum);
+      // the callback may have called PrimeSieve::stop()
+      if (ps_.isStopped())
+        return;
+      n = 0;
+      continue;
+    }
+    uint_t count = static_cast<uint_t>(std::min<std::size_t>(space, words - i));
+    n += decodePrimes(&sieve[i * 8], count, base, &primes[n]);
+    base += NUMBERS_PER_BYTE * 8 * static_cast<uint64_t>(count);
+    i += count;
+  }
+
+  if (n > 0)
+    callback(primes, n, threadNum);
+}
+
+/// Callback the primes within the current segment in batches.
+/// @note primes < 7 are handled in PrimeSieve::doSmallPrime()
+///
+void PrimeFinder::callbackBatch(const byte_t* sieve, uint_t sieveSize)
+{
+  if (ps_.isFlag(ps_.CALLBACK_PRIMES_BATCH))     callbackBatch(ps_.callback_batch_, sieve, sieveSize);
+  if (ps_.isFlag(ps_.CALLBACK_PRIMES_OBJ_BATCH)) callbackBatch(BatchCallbackObj(ps_.cb_batch_), sieve, sieveSize);
+  if (ps_.isFlag(ps_.CALLBACK_PRIMES_C_BATCH))   callbackBatch(reinterpret_cast<callback_c_batch_t>(ps_.callback_batch_), sieve, sieveSize);
+}
+
+/// Ordered mode: decode the primes of the current segment into
+/// pending_ until it is our turn to callback primes.
+///
+void PrimeFinder::bufferPrimes(const byte_t* sieve, uint_t sieveSize)
+{
+  uint_t words = (sieveSize + 7) / 8;
+  std::size_t n = pending_.size();
+  // decodePrimes() needs space for 8 extra primes
+  std::size_t count = static_cast<std::size_t>(popcount(reinterpret_cast<const uint64_t*>(sieve), words));
+  pending_.resize(n + count + 8);
+  n += decodePrimes(sieve, words, getSegmentLow(), &pending_[n]);
+  pending_.resize(n);
+
+  if (n * sizeof(uint64_t) >= config::ORDERED_BUFFER_SIZE)
+  {
+    ps_.takeTurn();
+    callbackPending();
+  }
+}
+
+/// Ordered mode: callback the buffered primes
+/// (in batches of up to ps_.getBatchSize() primes).
+///
+void PrimeFinder::callbackPending()
+{
+  if (pending_.empty() || ps_.isStopped())
+  {
+    pending_.clear();
+    return;
+  }
+
+  const uint64_t* primes = &pending_[0];
+  std::size_t size = pending_.size();
+  std::size_t limit = ps_.getBatchSize();
+  int threadNum = ps_.threadNum_;
+  if (limit == 0)
+    limit = size;
+
+  for (std::size_t i = 0; i < size && !ps_.isStopped(); i += limit)
+  {
+    const uint64_t* p = &primes[i];
+    std::size_t n = std::min(limit, size - i);
+
+    if (ps_.isFlag(ps_.CALLBACK_PRIMES_BATCH))     ps_.callback_batch_(p, n, threadNum);
+    if (ps_.isFlag(ps_.CALLBACK_PRIMES_OBJ_BATCH)) ps_.cb_batch_->callback(p, n, threadNum);
+    if (ps_.isFlag(ps_.CALLBACK_PRIMES_C_BATCH))   reinterpret_cast<callback_c_batch_t>(ps_.callback_batch_)(p, n, threadNum);
+
+    for (std::size_t j = 0; j < n; j++)
+    {
+      if (ps_.isFlag(ps_.CALLBACK_PRIMES_OBJ))    ps_.cb_->callback(p[j]);
+      if (ps_.isFlag(ps_.CALLBACK_PRIMES_OBJ_TN)) ps_.cb_tn_->callback(p[j], threadNum);
+      if (ps_.isFlag(ps_.CALLBACK_PRIMES))        ps_.callback_(p[j]);
+      if (ps_.isFlag(ps_.CALLBACK_PRIMES_TN))     ps_.callback_tn_(p[j], threadNum);
+      if (ps_.isFlag(ps_.CALLBACK_PRIMES_C))      reinterpret_cast<callback_c_t>(ps_.callback_)(p[j]);
+      if (ps_.isFlag(ps_.CALLBACK_PRIMES_C_TN))   reinterpret_cast<callback_c_tn_t>(ps_.callback_tn_)(p[j], threadNum);
+    }
+  }
+
+  pending_.clear();
+}
+
+/// Count the primes of the current segment and only if the
+/// nth prime is within the current segment decode the block
+/// of DECODE_WORDS 64-bit words that contains it.
+/// @see PrimeSieve::findNthPrime()
+///
+void PrimeFinder::findNthPrime(const byte_t* sieve, uint_t sieveSize)
+{
+  const uint64_t* words = reinterpret_cast<const uint64_t*>(sieve);
+  uint_t size = (sieveSize + 7) / 8;
+  uint64_t count = popcount(words, size);
+
+  if (count < ps_.nthPrimeRemaining_)
+  {
+    ps_.nthPrimeRemaining_ -= count;
+    return;
+  }
+
+  uint64_t primes[DECODE_WORDS * 64];
+  uint64_t base = getSegmentLow();
+
+  for (uint_t i = 0; i < size; i += DECODE_WORDS, base += NUMBERS_PER_BYTE * 8 * DECODE_WORDS)
+  {
+    uint_t n = std::min<uint_t>(DECODE_WORDS, size - i);
+    count = popcount(&words[i], n);
+
+    if (count >= ps_.nthPrimeRemaining_)
+    {
+      decodePrimes(&sieve[i * 8], n, base, primes);
+      ps_.nthPrime_ = primes[ps_.nthPrimeRemaining_ - 1];
+      ps_.nthPrimeRemaining_ = 0;
+      ps_.stop();
+      return;
+    }
+
+    ps_.nthPrimeRemaining_ -= count;
+  }
+}
+
 /// Count the primes and prime k-tuplets within
 /// the current segment.
 ///
@@ -175,46 +575,59 @@ void PrimeFinder::count(const byte_t* sieve, uint_t sieveSize)
     ps_.counts_[0] += popcount(reinterpret_cast<const uint64_t*>(sieve), (sieveSize + 7) / 8);
 
   // count prime k-tuplets (i = 1 twins, i = 2 triplets, ...)
-  for (uint_t i = 1; i < ps_.counts_.size(); i++)
-  {
-    if (ps_.isCount(i))
-    {
-      uint_t sum0 = 0;
-      uint_t sum1 = 0;
-      uint_t sum2 = 0;
-      uint_t sum3 = 0;
-      for (uint_t j = 0; j < sieveSize; j += 4)
-      {
-        sum0 += kCounts_[i][sieve[j+0]];
-        sum1 += kCounts_[i][sieve[j+1]];
-        sum2 += kCounts_[i][sieve[j+2]];
-        sum3 += kCounts_[i][sieve[j+3]];
-      }
-      ps_.counts_[i] += (sum0 + sum1) + (sum2 + sum3);
-    }
-  }
+  if (!kTypes_.empty())
+    countTuplets(sieve, sieveSize);
 }
 
-void PrimeFinder::printPrime(uint64_t prime)
+/// Count all enabled prime k-tuplet types in a single pass over
+/// the sieve array. The SIMD kernel (if supported by the CPU)
+/// processes blocks of 32 bytes, the remaining bytes are
+/// counted using the kCounts_ lookup tables.
+///
+void PrimeFinder::countTuplets(const byte_t* sieve, uint_t sieveSize)
 {
-  std::cout << prime << '\n';
+  uint64_t counts[6] = { 0, 0, 0, 0, 0, 0 };
+  uint_t i = 0;
+
+  if (tupletFunction_)
+    i = tupletFunction_(sieve, sieveSize, &kMasks_[0], &kMaskTypes_[0], kMasks_.size(), counts);
+
+  std::size_t types = kTypes_.size();
+  for (; i < sieveSize; i++)
+    for (std::size_t t = 0; t < types; t++)
+      counts[kTypes_[t]] += kCounts_[kTypes_[t]][sieve[i]];
+
+  for (std::size_t t = 0; t < types; t++)
+    ps_.counts_[kTypes_[t]] += counts[kTypes_[t]];
 }
 
-/// Print primes and prime k-tuplets to cout.
+/// Convert the primes and prime k-tuplets of the current segment
+/// to text, the buffer is written to the print file descriptor
+/// (default stdout) once full.
 /// @note primes < 7 are handled in PrimeSieve::doSmallPrime()
 ///
-void PrimeFinder::print(const byte_t* sieve, uint_t sieveSize) const
+void PrimeFinder::print(const byte_t* sieve, uint_t sieveSize)
 {
   if (ps_.isFlag(ps_.PRINT_PRIMES))
   {
-    LockGuard lock(ps_);
-    callbackPrimes(printPrime, sieve, sieveSize);
+    uint64_t primes[DECODE_WORDS * 64];
+    uint64_t base = getSegmentLow();
+    uint_t words = (sieveSize + 7) / 8;
+
+    for (uint_t i = 0; i < words; i += DECODE_WORDS, base += NUMBERS_PER_BYTE * 8 * DECODE_WORDS)
+    {
+      std::size_t n = decodePrimes(&sieve[i * 8], std::min<uint_t>(DECODE_WORDS, words - i), base, primes);
+      writer_->reserve(n * PrimeWriter::MAX_PRIME_LENGTH);
+      for (std::size_t j = 0; j < n; j++)
+        writer_->writePrime(primes[j]);
+    }
   }
   // print prime k-tuplets
   if (ps_.isFlag(ps_.PRINT_TWINS, ps_.PRINT_SEXTUPLETS))
   {
     uint_t i = 1; // i = 1 twins, i = 2 triplets, ...
     uint64_t base = getSegmentLow();
+    uint64_t kTuplet[6];
 
     for (; !ps_.isPrint(i); i++);
     for (uint_t j = 0; j < sieveSize; j++, base += NUMBERS_PER_BYTE)
@@ -223,19 +636,27 @@ void PrimeFinder::print(const byte_t* sieve, uint_t sieveSize) const
       {
         if ((sieve[j] & *bitmask) == *bitmask)
         {
-          std::ostringstream kTuplet;
-          kTuplet << "(";
+          int k = 0;
           uint64_t bits = *bitmask;
           while (bits != 0)
-          {
-            kTuplet << getNextPrime(&bits, base);
-            kTuplet << ((bits != 0) ? ", " : ")\n");
-          }
-          std::cout << kTuplet.str();
+            kTuplet[k++] = getNextPrime(&bits, base);
+          writer_->writeTuplet(kTuplet, k);
         }
       }
     }
   }
+
+  // ordered mode: keep buffering until it is
+  // our turn or the buffer is too large
+  if (writer_->isFull() &&
+      (ps_.hasTurn() || writer_->size() >= config::ORDERED_BUFFER_SIZE))
+  {
+    ps_.takeTurn();
+    if (ps_.ordered_ && ps_.isStopped())
+      return;
+    LockGuard lock(ps_);
+    writer_->flush();
+  }
 }
 
 } // namespace primesieve
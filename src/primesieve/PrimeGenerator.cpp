@@ -14,17 +14,38 @@
 #include <primesieve/PrimeFinder.hpp>
 #include <primesieve/SieveOfEratosthenes.hpp>
 #include <primesieve/SieveOfEratosthenes-inline.hpp>
-#include <primesieve/littleendian_cast.hpp>
+#include <primesieve/decodePrimes.hpp>
+#include <primesieve/CpuInfo.hpp>
 
+#include <stdint.h>
+#include <algorithm>
+#include <cstddef>
 #include <vector>
 #include <cassert>
 
+namespace {
+
+/// @return CPU L1 data cache size in kilobytes if detected
+///         else config::PRIMEGENERATOR_SIEVESIZE.
+///
+primesieve::uint_t generatorSieveSize()
+{
+  using namespace primesieve;
+  if (cpuInfo().hasL1dCache())
+    return static_cast<uint_t>(cpuInfo().l1dCacheSize() >> 10);
+  return config::PRIMEGENERATOR_SIEVESIZE;
+}
+
+} // namespace
+
 namespace primesieve {
 
 PrimeGenerator::PrimeGenerator(PrimeFinder& finder) :
   SieveOfEratosthenes(finder.getPreSieve() + 1,
                       finder.getSqrtStop(),
-                      config::PRIMEGENERATOR_SIEVESIZE),
+                      generatorSieveSize(),
+                      finder.getEratSettings(),
+                      finder.getContext()),
   finder_(finder)
 { }
 
@@ -55,6 +76,12 @@ void PrimeGenerator::doIt()
   sieve();
 }
 
+/// Stop generating sieving primes if finder has been stopped
+bool PrimeGenerator::isStopped() const
+{
+  return finder_.isStopped();
+}
+
 void PrimeGenerator::segmentFinished(const byte_t* sieve, uint_t sieveSize)
 {
   generateSievingPrimes(sieve, sieveSize);
@@ -65,16 +92,15 @@ void PrimeGenerator::segmentFinished(const byte_t* sieve, uint_t sieveSize)
 ///
 void PrimeGenerator::generateSievingPrimes(const byte_t* sieve, uint_t sieveSize)
 {
+  uint64_t primes[DECODE_WORDS * 64];
   uint64_t base = getSegmentLow();
-  for (uint_t i = 0; i < sieveSize; i += 8)
+  uint_t words = (sieveSize + 7) / 8;
+
+  for (uint_t i = 0; i < words; i += DECODE_WORDS, base += NUMBERS_PER_BYTE * 8 * DECODE_WORDS)
   {
-    uint64_t bits = littleendian_cast<uint64_t>(&sieve[i]);
-    while (bits != 0)
-    {
-      uint_t prime = static_cast<uint_t>(getNextPrime(&bits, base));
-      finder_.addSievingPrime(prime);
-    }
-    base += NUMBERS_PER_BYTE * 8;
+    std::size_t n = decodePrimes(&sieve[i * 8], std::min<uint_t>(DECODE_WORDS, words - i), base, primes);
+    for (std::size_t j = 0; j < n; j++)
+      finder_.addSievingPrime(static_cast<uint_t>(primes[j]));
   }
 }
 
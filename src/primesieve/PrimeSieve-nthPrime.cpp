@@ -1,5 +1,13 @@
 ///
 /// @file  PrimeSieve-nthPrime.cpp
+/// @brief Find the nth prime. The position of the nth prime is
+///        estimated using the inverse of the Riemann R function,
+///        the primes up to the estimate are counted (using
+///        piLMO() or a pi(x) index if possible) and the remaining
+///        window of about sqrt(x) * log(x) is sieved. In the last
+///        window the primes of each segment are counted and only
+///        the segment that contains the nth prime is decoded,
+///        then sieving is stopped using PrimeSieve::stop().
 ///
 /// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
 ///
@@ -33,100 +41,128 @@ void checkLowerLimit(uint64_t stop)
     throw primesieve_error("nth prime < 2 is impossible, negative n is too small");
 }
 
-void checkLowerLimit(uint64_t start, double dist)
-{
-  double s = static_cast<double>(start);
-  s = max(1E4, s);
-  if (s / dist < 0.9)
-    throw primesieve_error("nth prime < 2 is impossible, negative n is too small");
-}
-
-int64_t pix(int64_t n)
+/// Logarithmic integral using Ramanujan's formula:
+/// li(x) = gamma + log(log(x)) + sqrt(x) * \sum_{n=1}^{\infty}
+///         ((-1)^(n-1) * log(x)^n) / (n! * 2^(n-1)) *
+///         \sum_{k=0}^{(n-1)/2} 1 / (2k + 1)
+///
+long double li(long double x)
 {
-  double x = static_cast<double>(n);
-  double logx = log(max(4.0, x));
-  double pix = x / logx;
+  if (x <= 2)
+    return 1.045163780117492784844588889194613136L;
+
+  const long double gamma = 0.577215664901532860606512090082402431L;
+  long double logx = log(x);
+  long double sum = 0;
+  long double innerSum = 0;
+  long double factorial = 1;
+  long double p = -1;
+  long double power2 = 1;
+  int k = 0;
+
+  for (int n = 1; n < 1000; n++)
+  {
+    p *= -logx;
+    factorial *= n;
+    long double q = factorial * power2;
+    power2 *= 2;
+    for (; k <= (n - 1) / 2; k++)
+      innerSum += 1.0L / (2 * k + 1);
+    long double oldSum = sum;
+    sum += (p / q) * innerSum;
+    if (fabs(sum - oldSum) < 1e-18L * fabs(sum))
+      break;
+  }
 
-  return static_cast<int64_t>(pix);
+  return gamma + log(logx) + sqrt(x) * sum;
 }
 
-bool sieveBackwards(int64_t n, int64_t count, uint64_t stop)
+int moebius(int n)
 {
-  return (count >= n) && !(count == n && stop < 2);
+  int mu = 1;
+  for (int p = 2; p * p <= n; p++)
+  {
+    if (n % p == 0)
+    {
+      n /= p;
+      if (n % p == 0)
+        return 0;
+      mu = -mu;
+    }
+  }
+  return (n > 1) ? -mu : mu;
 }
 
-uint64_t nthPrimeDistance(int64_t n, int64_t count, uint64_t start, bool bruteForce = false)
+/// Riemann R function, a very accurate approximation of pi(x):
+/// R(x) = \sum_{k=1}^{\infty} mu(k) / k * li(x^(1/k))
+///
+long double Ri(long double x)
 {
-  double x = static_cast<double>(n - count);
-  double s = static_cast<double>(start);
+  long double sum = 0;
 
-  x = abs(x);
-  x = max(4.0, x);
-  s = max(4.0, s);
+  for (int k = 1; k < 64; k++)
+  {
+    long double root = pow(x, 1.0L / k);
+    if (root < 2)
+      break;
+    int mu = moebius(k);
+    if (mu != 0)
+      sum += mu * li(root) / k;
+  }
 
-  double logx = log(x);
-  double loglogx = log(logx);
-  double pix = x * (logx + loglogx - 1);
+  return sum;
+}
 
-  // Correct start if sieving backwards
-  if (count >= n)
-    s -= pix;
+/// Find x with Ri(x) = y using Newton's method,
+/// Ri'(x) ~ 1 / log(x).
+///
+long double Ri_inverse(long double y, long double x)
+{
+  x = max(x, 2.0L);
 
-  // Approximate the nth prime using
-  // start + n * log(start + pi(n) / log log n))
-  double logStartPix = log(max(4.0, s + pix / loglogx));
-  double dist = max(pix, x * logStartPix);
-  double maxPrimeGap = logStartPix * logStartPix;
-  double safetyFactor = (count >= n || bruteForce) ? 2 : -2;
+  for (int i = 0; i < 100; i++)
+  {
+    long double dist = (Ri(x) - y) * log(x);
+    x = max(x - dist, 2.0L);
+    if (fabs(dist) < 1)
+      break;
+  }
 
-  // Make sure start + dist <= nth prime
-  dist += sqrt(dist) * log(logStartPix) * safetyFactor;
-  dist = max(dist, maxPrimeGap);
+  return x;
+}
 
-  if (count >= n)
-    checkLowerLimit(start, dist);
+/// Estimate the distance between x and the nth
+/// prime > x (n > 0) or < x (n < 0).
+///
+uint64_t nthPrimeDistance(int64_t n, uint64_t x)
+{
+  long double rx = Ri(static_cast<long double>(x));
+  long double guess = static_cast<long double>(x) + n * log(max(4.0L, x + fabs(n * 1.0L)));
+  long double nth = Ri_inverse(rx + n, guess);
+  long double dist = fabs(nth - x);
 
   return static_cast<uint64_t>(dist);
 }
 
-/// This class is used to generate n primes and
-/// then stop by throwing an exception.
+/// Upper bound for the distance of the nth prime (from
+/// x), adds the expected error of the estimate to dist.
 ///
-class NthPrime : public Callback<uint64_t> {
-public:
-  NthPrime() : n_(0), nthPrime_(0) { }
-  void findNthPrime(uint64_t, uint64_t, uint64_t);
-  void callback(uint64_t);
-  uint64_t getNthPrime() const;
-private:
-  uint64_t n_;
-  uint64_t nthPrime_;
-};
-
-void NthPrime::findNthPrime(uint64_t n, uint64_t start, uint64_t stop)
+uint64_t maxDistance(uint64_t n, uint64_t x, uint64_t dist)
 {
-  n_ = n;
-  PrimeSieve ps;
-  try {
-    ps.callbackPrimes(start, stop, this);
-    ps.callbackPrimes(stop + 1, get_max_stop(), this);
-    throw primesieve_error("nth prime is too large > 2^64 - 2^32 * 11");
-  }
-  catch (cancel_callback&) { }
-}
+  double logx = log(max(4.0, static_cast<double>(x)));
+  double error = (sqrt(static_cast<double>(n)) + 16) * logx * 2 + max_prime_gap(x);
 
-uint64_t NthPrime::getNthPrime() const
-{
-  return nthPrime_;
+  return dist + static_cast<uint64_t>(error);
 }
 
-void NthPrime::callback(uint64_t prime)
+/// Width of the window around the nth prime estimate
+/// that is sieved after counting the primes up to
+/// the estimate.
+///
+uint64_t windowSize(uint64_t x)
 {
-  if (--n_ == 0)
-  {
-    nthPrime_ = prime;
-    throw cancel_callback();
-  }
+  double d = static_cast<double>(max<uint64_t>(x, 4));
+  return static_cast<uint64_t>(sqrt(d) * log(d));
 }
 
 } // namespace
@@ -142,52 +178,143 @@ uint64_t PrimeSieve::nthPrime(int64_t n, uint64_t start)
 {
   setStart(start);
   double t1 = getWallTime();
+  uint64_t nthPrime = 0;
 
-  if (n != 0)
-    // Find nth prime > start (or < start)
-    start += (n > 0) ? 1 : ((start > 0) ? -1 : 0);
-  else
-    // Mathematica convention
-    n = 1;
-
-  uint64_t stop = start;
-  uint64_t dist = nthPrimeDistance(n, 0, start);
-  uint64_t nthPrimeGuess = start + dist;
-
-  int64_t pixSqrtNthPrime = pix(isqrt(nthPrimeGuess));
-  int64_t bruteForceMin = 10000;
-  int64_t bruteForceThreshold = max(bruteForceMin, pixSqrtNthPrime);
-  int64_t count = 0;
-
-  while (sieveBackwards(n, count, stop) || (n - count) > bruteForceThreshold)
+  if (n == 0)
+    // Mathematica convention:
+    // find the 1st prime >= start
+    nthPrime = findNextPrimes(1, start);
+  else if (n > 0)
   {
-    if (count < n)
+    // find the nth prime > start
+    checkLimit(start, 1);
+    start += 1;
+    uint64_t dist = nthPrimeDistance(n, start);
+    checkLimit(start, dist);
+
+    if (dist < windowSize(start + dist) * 2)
+      nthPrime = findNextPrimes(n, start);
+    else
     {
-      dist = nthPrimeDistance(n, count, start);
-      checkLimit(start, dist);
-      stop = start + dist;
-      count += countPrimes(start, stop);
-      start = stop + 1;
+      // count the primes up to the estimate and
+      // then sieve the remaining window
+      uint64_t stop = start + dist;
+      uint64_t count = countPrimes(start, stop);
+
+      if (count < static_cast<uint64_t>(n))
+        nthPrime = findNextPrimes(n - count, stop + 1);
+      else
+        nthPrime = findPreviousPrimes(count - n + 1, stop);
     }
-    if (sieveBackwards(n, count, stop))
+  }
+  else
+  {
+    // find the nth prime < start
+    checkLowerLimit(start);
+    start -= 1;
+    uint64_t k = static_cast<uint64_t>(-(n + 1)) + 1;
+    uint64_t dist = nthPrimeDistance(n, start);
+
+    if (dist < windowSize(start) * 2 || dist >= start)
+      nthPrime = findPreviousPrimes(k, start);
+    else
     {
-      checkLowerLimit(stop);
-      dist = nthPrimeDistance(n, count, stop);
-      start = (start > dist) ? start - dist : 1;
-      count -= countPrimes(start, stop);
-      stop = start - 1;
+      uint64_t stop = start - dist;
+      uint64_t count = countPrimes(stop, start);
+
+      if (count < k)
+        nthPrime = findPreviousPrimes(k - count, stop - 1);
+      else
+        nthPrime = findNextPrimes(count - k + 1, stop);
     }
   }
 
-  if (n < 0) count--;
-  dist = nthPrimeDistance(n, count, start, true) * 2;
-  checkLimit(start, dist);
-  stop = start + dist;
-  NthPrime np;
-  np.findNthPrime(n - count, start, stop);
   seconds_ = getWallTime() - t1;
+  return nthPrime;
+}
 
-  return np.getNthPrime();
+/// Find the nth prime >= start, the primes of each segment are
+/// counted and only the segment that contains the nth prime is
+/// decoded, see PrimeFinder::findNthPrime().
+/// @param count  Number of primes within [start, stop] if
+///               the nth prime > stop.
+/// @return       The nth prime or 0 if the nth prime > stop.
+///
+uint64_t PrimeSieve::findNthPrime(uint64_t n, uint64_t start, uint64_t stop, uint64_t* count)
+{
+  const uint64_t smallPrimes[3] = { 2, 3, 5 };
+  uint64_t remaining = n;
+
+  for (int i = 0; i < 3; i++)
+    if (smallPrimes[i] >= start && smallPrimes[i] <= stop)
+      if (--remaining == 0)
+        return smallPrimes[i];
+
+  start = max<uint64_t>(start, 7);
+  flags_ = FIND_NTH_PRIME;
+  nthPrimeRemaining_ = remaining;
+  nthPrime_ = 0;
+
+  if (start <= stop)
+    sieve(start, stop);
+
+  *count = n - nthPrimeRemaining_;
+  return nthPrime_;
+}
+
+/// Find the nth prime >= start
+uint64_t PrimeSieve::findNextPrimes(uint64_t n, uint64_t start)
+{
+  PrimeSieve ps;
+  ps.setSieveSize(sieveSize_);
+  ps.copyEratSettings(*this);
+
+  while (true)
+  {
+    uint64_t dist = nthPrimeDistance(n, start);
+    dist = maxDistance(n, start, dist);
+    dist = min(dist, get_max_stop() - start);
+    uint64_t stop = start + dist;
+    uint64_t count = 0;
+    uint64_t nthPrime = ps.findNthPrime(n, start, stop, &count);
+
+    if (nthPrime)
+      return nthPrime;
+
+    checkLimit(stop, 1);
+    n -= count;
+    start = stop + 1;
+  }
+}
+
+/// Find the nth prime <= stop (counting backwards)
+uint64_t PrimeSieve::findPreviousPrimes(uint64_t n, uint64_t stop)
+{
+  PrimeSieve ps;
+  ps.setSieveSize(sieveSize_);
+  ps.copyEratSettings(*this);
+
+  while (true)
+  {
+    int64_t n64 = static_cast<int64_t>(n);
+    uint64_t dist = nthPrimeDistance(-n64, stop);
+    dist = maxDistance(n, stop, dist);
+    uint64_t start = (stop > dist) ? stop - dist : 0;
+
+    // count the primes within [start, stop] and
+    // then find the (count - n + 1)th prime >= start
+    uint64_t count = ps.countPrimes(start, stop);
+
+    if (count >= n)
+    {
+      uint64_t unused = 0;
+      return ps.findNthPrime(count - n + 1, start, stop, &unused);
+    }
+
+    checkLowerLimit(start);
+    n -= count;
+    stop = start - 1;
+  }
 }
 
 } // namespace primesieve
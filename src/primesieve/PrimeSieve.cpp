@@ -17,13 +17,22 @@
 #include <primesieve/PrimeSieve-lock.hpp>
 #include <primesieve/PrimeFinder.hpp>
 #include <primesieve/PrimeGenerator.hpp>
+#include <primesieve/PrimeWriter.hpp>
+#include <primesieve/PrimeFileWriter.hpp>
+#include <primesieve/SievingPrimes.hpp>
+#include <primesieve/SieveContext.hpp>
+#include <primesieve/SieveStats.hpp>
+#include <primesieve/StageTimer.hpp>
+#include <primesieve/PiIndex.hpp>
+#include <primesieve/piLMO.hpp>
+#include <primesieve/CpuInfo.hpp>
+#include <primesieve/TuningProfile.hpp>
 #include <primesieve/pmath.hpp>
 
 #include <stdint.h>
 #include <iostream>
 #include <string>
 #include <cstddef>
-#include <ctime>
 #include <algorithm>
 
 namespace primesieve {
@@ -40,15 +49,105 @@ const PrimeSieve::SmallPrime PrimeSieve::smallPrimes_[8] =
   { 5, 17, 4, "(5, 7, 11, 13, 17)" }
 };
 
+namespace {
+
+/// Points PrimeSieve::timer_ to the local StageTimer
+/// of sieve(), reset to NULL when sieve() returns.
+///
+class SetTimer
+{
+public:
+  SetTimer(StageTimer*& ptr, StageTimer* timer) :
+    ptr_(ptr)
+  {
+    ptr_ = timer;
+  }
+  ~SetTimer()
+  {
+    ptr_ = NULL;
+  }
+private:
+  StageTimer*& ptr_;
+  DISALLOW_COPY_AND_ASSIGN(SetTimer);
+};
+
+/// Marks the SieveContext (if any) as in use so that its
+/// lookup tables are not freed while sieving.
+///
+class UseContext
+{
+public:
+  UseContext(SieveContext* context) :
+    context_(context)
+  {
+    if (context_)
+      context_->addUser();
+  }
+  ~UseContext()
+  {
+    if (context_)
+      context_->removeUser();
+  }
+private:
+  SieveContext* context_;
+  DISALLOW_COPY_AND_ASSIGN(UseContext);
+};
+
+/// Borrows the SieveContext's sieving primes (if any)
+/// and returns them when going out of scope.
+///
+class BorrowSievingPrimes
+{
+public:
+  BorrowSievingPrimes(SieveContext* context, uint64_t stop, int sieveSize) :
+    context_(context),
+    sievingPrimes_(NULL)
+  {
+    if (context_)
+      sievingPrimes_ = context_->getSievingPrimes(stop, sieveSize);
+  }
+  ~BorrowSievingPrimes()
+  {
+    if (sievingPrimes_)
+      context_->releaseSievingPrimes();
+  }
+  const SievingPrimes* get() const { return sievingPrimes_; }
+private:
+  SieveContext* context_;
+  const SievingPrimes* sievingPrimes_;
+  DISALLOW_COPY_AND_ASSIGN(BorrowSievingPrimes);
+};
+
+} // namespace
+
 PrimeSieve::PrimeSieve() :
   start_(0),
   stop_(0),
   counts_(6),
+  sievingPrimes_(NULL),
+  sieveSize_(0),
+  bucketSize_(0),
+  bucketAllocSize_(config::BYTES_PER_ALLOC / 1024),
+  factorEratSmall_(-1),
+  factorEratMedium_(-1),
+  hugePages_(true),
+  context_(NULL),
+  caching_(true),
+  batchSize_(config::BATCH_SIZE),
   flags_(COUNT_PRIMES),
+  printFd_(1),
+  isStats_(false),
+  timer_(NULL),
   threadNum_(0),
-  parent_(NULL)
+  parent_(NULL),
+  stopped_(false),
+  chunk_(0),
+  ordered_(false),
+  hasTurn_(false),
+  nthPrimeRemaining_(0),
+  nthPrime_(0),
+  cb_segment_(NULL)
 {
-  setSieveSize(config::PRIMESIEVE_SIEVESIZE);
   reset();
 }
 
@@ -57,14 +156,35 @@ PrimeSieve::PrimeSieve() :
 ///
 PrimeSieve::PrimeSieve(PrimeSieve& parent, int threadNum) :
   counts_(6),
-  sieveSize_(parent.sieveSize_),
+  sievingPrimes_(parent.sievingPrimes_),
+  sieveSize_(parent.getSieveSize()),
+  bucketSize_(parent.getBucketSize()),
+  bucketAllocSize_(parent.bucketAllocSize_),
+  factorEratSmall_(parent.getFactorEratSmall()),
+  factorEratMedium_(parent.getFactorEratMedium()),
+  hugePages_(parent.hugePages_),
+  context_(NULL),
+  caching_(false),
+  batchSize_(parent.batchSize_),
   flags_(parent.flags_),
+  printFd_(parent.printFd_),
+  isStats_(parent.isStats_),
+  timer_(NULL),
   threadNum_(threadNum),
   parent_(&parent),
+  stopped_(false),
+  chunk_(0),
+  ordered_(false),
+  hasTurn_(false),
+  nthPrimeRemaining_(0),
+  nthPrime_(0),
   callback_(parent.callback_),
   callback_tn_(parent.callback_tn_),
   cb_(parent.cb_),
-  cb_tn_(parent.cb_tn_)
+  cb_tn_(parent.cb_tn_),
+  callback_batch_(parent.callback_batch_),
+  cb_batch_(parent.cb_batch_),
+  cb_segment_(parent.cb_segment_)
 { }
 
 PrimeSieve::~PrimeSieve()
@@ -82,17 +202,23 @@ uint64_t PrimeSieve::getSextupletCount()         const { return counts_[5]; }
 uint64_t PrimeSieve::getCount(int index)         const { return counts_.at(index); }
 double   PrimeSieve::getStatus()                 const { return percent_; }
 double   PrimeSieve::getSeconds()                const { return seconds_; }
-int      PrimeSieve::getSieveSize()              const { return sieveSize_; }
+const SieveStats& PrimeSieve::getStats()         const { return stats_; }
+int      PrimeSieve::getBucketAllocSize()        const { return bucketAllocSize_; }
+int      PrimeSieve::getBatchSize()              const { return batchSize_; }
 int      PrimeSieve::getFlags()                  const { return (flags_ & ((1 << 20) - 1)); }
+int      PrimeSieve::getPrintFd()                const { return printFd_; }
 bool     PrimeSieve::isValidFlags(int flags)     const { return (flags >= 0 && flags < (1 << 20)); }
 bool     PrimeSieve::isFlag(int flag)            const { return (flags_ & flag) == flag; }
 bool     PrimeSieve::isFlag(int first, int last) const { return (flags_ & (last * 2 - first)) != 0; }
 bool     PrimeSieve::isCount(int index)          const { return isFlag(COUNT_PRIMES << index); }
 bool     PrimeSieve::isPrint(int index)          const { return isFlag(PRINT_PRIMES << index); }
-bool     PrimeSieve::isCallback()                const { return isFlag(CALLBACK_PRIMES, CALLBACK_PRIMES_C_TN); }
+bool     PrimeSieve::isCallback()                const { return isFlag(CALLBACK_PRIMES, CALLBACK_PRIMES_C_BATCH); }
 bool     PrimeSieve::isCount()                   const { return isFlag(COUNT_PRIMES, COUNT_SEXTUPLETS); }
 bool     PrimeSieve::isPrint()                   const { return isFlag(PRINT_PRIMES, PRINT_SEXTUPLETS); }
 bool     PrimeSieve::isStatus()                  const { return isFlag(PRINT_STATUS, CALCULATE_STATUS); }
+bool     PrimeSieve::isStats()                   const { return isStats_; }
+bool     PrimeSieve::isHugePages()               const { return hugePages_; }
+bool     PrimeSieve::isCaching()                 const { return caching_; }
 bool     PrimeSieve::isParallelPrimeSieveChild() const { return parent_ != NULL; }
 
 /// Set a start number (lower bound) for sieving.
@@ -117,14 +243,205 @@ void PrimeSieve::setStop(uint64_t stop)
   stop_ = stop;
 }
 
+/// The default sieve size in kilobytes is the tuned sieve size
+/// for stop (see primesieve --tune) or else half the CPU's L2
+/// cache size, segments are then sieved in L1 data cache sized
+/// blocks (see SieveOfEratosthenes::crossOffMultiples()). If the
+/// L2 cache size cannot be detected at runtime the default sieve
+/// size is the CPU's L1 data cache size.
+///
+int PrimeSieve::getDefaultSieveSize(uint64_t stop)
+{
+  int sieveSize = tuningProfile().getSieveSize(stop);
+  if (sieveSize != 0)
+    return sieveSize;
+
+  const CpuInfo& info = cpuInfo();
+
+  if (info.hasL2Cache() &&
+      info.l2CacheSize() / 2 > info.l1dCacheSize())
+    return static_cast<int>(info.l2CacheSize() >> 11);
+  if (info.hasL1dCache())
+    return static_cast<int>(info.l1dCacheSize() >> 10);
+
+  return config::PRIMESIEVE_SIEVESIZE;
+}
+
+/// @return The sieve size in kilobytes used for sieving
+///         up to the current stop number.
+///
+int PrimeSieve::getSieveSize() const
+{
+  if (sieveSize_ == 0)
+    return getDefaultSieveSize(stop_);
+  return sieveSize_;
+}
+
+/// @return The bucket size used for sieving up to the current
+///         stop number, by default the tuned bucket size (see
+///         primesieve --tune) or else config::BUCKETSIZE.
+///
+int PrimeSieve::getBucketSize() const
+{
+  if (bucketSize_ != 0)
+    return bucketSize_;
+  int bucketSize = tuningProfile().getBucketSize(stop_);
+  return (bucketSize != 0) ? bucketSize : config::BUCKETSIZE;
+}
+
+/// @return The EratSmall factor used for sieving up to the
+///         current stop number, by default the tuned factor
+///         or else config::FACTOR_ERATSMALL.
+///
+double PrimeSieve::getFactorEratSmall() const
+{
+  if (factorEratSmall_ >= 0)
+    return factorEratSmall_;
+  double factor = tuningProfile().getFactorEratSmall(stop_);
+  return (factor >= 0) ? factor : config::FACTOR_ERATSMALL;
+}
+
+/// @return The EratMedium factor used for sieving up to the
+///         current stop number, by default the tuned factor
+///         or else config::FACTOR_ERATMEDIUM.
+///
+double PrimeSieve::getFactorEratMedium() const
+{
+  if (factorEratMedium_ >= 0)
+    return factorEratMedium_;
+  double factor = tuningProfile().getFactorEratMedium(stop_);
+  return (factor >= 0) ? factor : config::FACTOR_ERATMEDIUM;
+}
+
+/// @return The SieveContext used by sieve() when called from
+///         the current thread or NULL if caching is disabled.
+///
+SieveContext* PrimeSieve::getContext() const
+{
+  if (!caching_)
+    return NULL;
+  return (context_) ? context_ : SieveContext::threadContext();
+}
+
 /// Set the size of the sieve of Eratosthenes array in kilobytes
-/// (default = 32). The best sieving performance is achieved with a
-/// sieve size of the CPU's L1 data cache size per core.
-/// @pre sieveSize >= 1 && <= 2048
+/// (default = 0, the tuned sieve size or the CPU's L2 cache
+/// size / 2, detected at runtime). The best sieving performance
+/// is achieved with a sieve size that fits into the CPU's L2
+/// cache (per core).
+/// @pre sieveSize == 0 || (sieveSize >= 1 && <= 2048)
 ///
 void PrimeSieve::setSieveSize(int sieveSize)
 {
-  sieveSize_ = getInBetween(1, floorPowerOf2(sieveSize), 2048);
+  if (sieveSize == 0)
+    sieveSize_ = 0;
+  else
+    sieveSize_ = getInBetween(1, floorPowerOf2(sieveSize), 2048);
+}
+
+/// Set the number of sieving primes per bucket in EratSmall,
+/// EratMedium and EratBig (default = 0, the tuned bucket size
+/// or else config::BUCKETSIZE).
+/// @pre bucketSize == 0 || (bucketSize >= 256 && <= 2048),
+///      rounded down to a power of 2.
+///
+void PrimeSieve::setBucketSize(int bucketSize)
+{
+  if (bucketSize == 0)
+    bucketSize_ = 0;
+  else
+    bucketSize_ = getInBetween<int>(config::MIN_BUCKETSIZE,
+                                    floorPowerOf2(bucketSize),
+                                    config::MAX_BUCKETSIZE);
+}
+
+/// Set the size in kilobytes of EratBig's bucket
+/// allocations (default = config::BYTES_PER_ALLOC).
+/// @pre kilobytes >= 64 && <= 1048576
+///
+void PrimeSieve::setBucketAllocSize(int kilobytes)
+{
+  bucketAllocSize_ = getInBetween(64, kilobytes, 1 << 20);
+}
+
+/// Sieving primes <= L1d block size * factor are processed by
+/// EratSmall (default = -1, the tuned factor or else
+/// config::FACTOR_ERATSMALL).
+/// @pre factor < 0 (automatic) || factor <= 3
+///
+void PrimeSieve::setFactorEratSmall(double factor)
+{
+  if (factor < 0)
+    factorEratSmall_ = -1;
+  else
+    factorEratSmall_ = std::min(factor, 3.0);
+}
+
+/// Sieving primes <= L1d block size * factor (and > EratSmall)
+/// are processed by EratMedium, the remaining ones by EratBig
+/// (default = -1, the tuned factor or else
+/// config::FACTOR_ERATMEDIUM).
+/// @pre factor < 0 (automatic) || factor <= 9
+///
+void PrimeSieve::setFactorEratMedium(double factor)
+{
+  if (factor < 0)
+    factorEratMedium_ = -1;
+  else
+    factorEratMedium_ = std::min(factor, 9.0);
+}
+
+/// Allocate EratBig's buckets and sieve arrays >= 2 megabytes
+/// using huge pages (default = true). On Linux explicit huge
+/// pages (MAP_HUGETLB) are tried first, then transparent huge
+/// pages (MADV_HUGEPAGE), else normal pages are used. Use
+/// setStats(true) to find out whether huge pages were obtained
+/// (SieveStats::hugePageBytes).
+///
+void PrimeSieve::setHugePages(bool hugePages)
+{
+  hugePages_ = hugePages;
+}
+
+/// Reuse the memory and lookup tables of previous sieving
+/// operations, see SieveContext.hpp. By default (NULL) sieve()
+/// uses the SieveContext of the thread it is called from.
+/// @pre The context must outlive sieve() and must not be
+///      used by other threads simultaneously.
+///
+void PrimeSieve::setContext(SieveContext* context)
+{
+  context_ = context;
+}
+
+/// Disable (false) or enable (true, default) the
+/// SieveContext, see setContext().
+///
+void PrimeSieve::setCaching(bool caching)
+{
+  caching_ = caching;
+}
+
+/// Copy the bucket size, Erat* limits and SieveContext
+/// into a PrimeSieve used internally.
+///
+void PrimeSieve::copyEratSettings(const PrimeSieve& ps)
+{
+  bucketSize_ = ps.bucketSize_;
+  bucketAllocSize_ = ps.bucketAllocSize_;
+  factorEratSmall_ = ps.factorEratSmall_;
+  factorEratMedium_ = ps.factorEratMedium_;
+  hugePages_ = ps.hugePages_;
+  context_ = ps.context_;
+  caching_ = ps.caching_;
+}
+
+/// Set the max number of primes per batch callback
+/// (default = 1024), 0 = one batch per segment.
+/// @pre batchSize == 0 || batchSize >= 64
+///
+void PrimeSieve::setBatchSize(int batchSize)
+{
+  batchSize_ = (batchSize > 0) ? std::max(batchSize, 64) : 0;
 }
 
 void PrimeSieve::setFlags(int flags)
@@ -139,6 +456,25 @@ void PrimeSieve::addFlags(int flags)
     flags_ |= flags;
 }
 
+/// Set the file descriptor the printed primes and prime
+/// k-tuplets are written to (default 1 = stdout).
+///
+void PrimeSieve::setPrintFd(int fd)
+{
+  if (fd < 0)
+    throw primesieve_error("invalid file descriptor");
+  printFd_ = fd;
+}
+
+/// Collect per stage timings and counters (PreSieve, EratSmall,
+/// EratMedium, EratBig, ...) during sieve(), see getStats().
+/// This adds a few timer calls per segment.
+///
+void PrimeSieve::setStats(bool stats)
+{
+  isStats_ = stats;
+}
+
 void PrimeSieve::reset()
 {
   std::fill(counts_.begin(), counts_.end(), 0);
@@ -146,11 +482,64 @@ void PrimeSieve::reset()
   toUpdate_  = 0;
   processed_ = 0;
   percent_   = -1.0;
+  stopped_   = false;
+  stats_.reset();
+}
+
+/// Stop sieving, sieve() returns after the current segment has
+/// been processed. Unlike throwing cancel_callback this does not
+/// unwind the sieve, stop() can be called from within a callback
+/// and stops all threads of a ParallelPrimeSieve.
+///
+void PrimeSieve::stop()
+{
+  stopped_ = true;
+  if (parent_)
+    parent_->stop();
+}
+
+bool PrimeSieve::isStopped() const
+{
+  return stopped_ || (parent_ && parent_->isStopped());
+}
+
+/// @return true if this PrimeSieve may print and callback
+///         primes, always true unless in ordered mode.
+///
+bool PrimeSieve::hasTurn() const
+{
+  return !ordered_ || hasTurn_;
+}
+
+/// Ordered mode: wait until all previous chunks are done
+void PrimeSieve::takeTurn()
+{
+  if (!hasTurn())
+  {
+    int stage = setStage(SieveStats::WAIT);
+    parent_->waitTurn(chunk_);
+    setStage(stage);
+    hasTurn_ = true;
+  }
+}
+
+/// Switch to a SieveStats stage if stats are collected.
+/// @return The previous stage.
+///
+int PrimeSieve::setStage(int stage)
+{
+  return timer_ ? timer_->enter(stage) : stage;
 }
 
+/// Block until chunk is the oldest unfinished chunk,
+/// implemented by ParallelPrimeSieve.
+///
+void PrimeSieve::waitTurn(uint64_t)
+{ }
+
 double PrimeSieve::getWallTime() const
 {
-  return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+  return wallTime();
 }
 
 void PrimeSieve::setLock()
@@ -214,11 +603,23 @@ void PrimeSieve::doSmallPrime(const SmallPrime& sp)
         reinterpret_cast<callback_c_t>(callback_)(sp.firstPrime);
       if (isFlag(CALLBACK_PRIMES_C_TN))
         reinterpret_cast<callback_c_tn_t>(callback_tn_)(sp.firstPrime, threadNum_);
+
+      uint64_t prime = sp.firstPrime;
+      if (isFlag(CALLBACK_PRIMES_BATCH))
+        callback_batch_(&prime, 1, threadNum_);
+      if (isFlag(CALLBACK_PRIMES_OBJ_BATCH))
+        cb_batch_->callback(&prime, 1, threadNum_);
+      if (isFlag(CALLBACK_PRIMES_C_BATCH))
+        reinterpret_cast<callback_c_batch_t>(callback_batch_)(&prime, 1, threadNum_);
     }
     if (isCount(sp.index))
       counts_[sp.index]++;
     if (isPrint(sp.index))
-      std::cout << sp.str << '\n';
+    {
+      PrimeWriter writer(printFd_);
+      writer.write(std::string(sp.str) + '\n');
+      writer.flush();
+    }
   }
 }
 
@@ -231,6 +632,8 @@ void PrimeSieve::sieve()
   if (start_ > stop_)
     return;
   double t1 = getWallTime();
+  StageTimer timer(stats_);
+  SetTimer setTimer(timer_, isStats_ ? &timer : NULL);
   if (isStatus())
     updateStatus(INIT_STATUS, false);
 
@@ -242,18 +645,42 @@ void PrimeSieve::sieve()
       doSmallPrime(smallPrimes_[i]);
   }
   if (stop_ >= 7) {
+    UseContext useContext(getContext());
     PrimeFinder finder(*this);
     // First generate the sieving primes up to
     // sqrt(stop) and add them to finder
     if (finder.getSqrtStop() > finder.getPreSieve()) {
-      PrimeGenerator generator(finder);
-      generator.doIt();
+      setStage(SieveStats::PRIME_GENERATOR);
+      // the primes are added while sieving, hence callbacks
+      // may run nested queries using the same context
+      BorrowSievingPrimes borrowed((sievingPrimes_) ? NULL : getContext(), stop_, getSieveSize());
+      const SievingPrimes* sievingPrimes = (sievingPrimes_) ? sievingPrimes_ : borrowed.get();
+      if (sievingPrimes &&
+          sievingPrimes->getLimit() >= finder.getSqrtStop())
+        sievingPrimes->addSievingPrimes(finder);
+      else {
+        PrimeGenerator generator(finder);
+        generator.doIt();
+        stats_.bucketAllocs += generator.getBucketAllocs();
+        stats_.hugePageBytes += generator.getHugePageBytes();
+      }
+      setStage(SieveStats::OTHER);
     }
     // sieve the primes within [start, stop]
     finder.sieve();
+    finder.flush();
+    stats_.bucketAllocs += finder.getBucketAllocs();
+    stats_.hugePageBytes += finder.getHugePageBytes();
   }
 
   seconds_ = getWallTime() - t1;
+  if (timer_) {
+    setStage(SieveStats::OTHER);
+    if (isParallelPrimeSieveChild()) {
+      LockGuard lock(*this);
+      parent_->stats_.add(stats_, threadNum_, seconds_);
+    }
+  }
   if (isStatus())
     updateStatus(FINISH_STATUS, true);
 }
@@ -329,6 +756,36 @@ void PrimeSieve::callbackPrimes(uint64_t start,
   sieve(start, stop);
 }
 
+/// Generate the primes within the interval [start, stop] and call
+/// a callback function for each batch of primes (unsynchronized if
+/// used with ParallelPrimeSieve).
+///
+void PrimeSieve::callbackPrimes(uint64_t start,
+                                uint64_t stop,
+                                void (*callback)(const uint64_t*, std::size_t, int))
+{
+  if (!callback)
+    throw primesieve_error("callback is NULL");
+  callback_batch_ = callback;
+  flags_ = CALLBACK_PRIMES_BATCH;
+  sieve(start, stop);
+}
+
+/// Generate the primes within the interval [start, stop] and call
+/// the callback method of the cb object for each batch of primes
+/// (unsynchronized if used with ParallelPrimeSieve).
+///
+void PrimeSieve::callbackPrimes(uint64_t start,
+                                uint64_t stop,
+                                BatchCallback* cb)
+{
+  if (!cb)
+    throw primesieve_error("BatchCallback pointer is NULL");
+  cb_batch_ = cb;
+  flags_ = CALLBACK_PRIMES_OBJ_BATCH;
+  sieve(start, stop);
+}
+
 /// Generate the primes within the interval [start, stop] and call a
 /// callback function with extern "C" linkage for each prime.
 ///
@@ -357,6 +814,68 @@ void PrimeSieve::callbackPrimes_c(uint64_t start,
   sieve(start, stop);
 }
 
+/// Batch callback with extern "C" linkage, see
+/// callbackPrimes(uint64_t, uint64_t, void (*)(const uint64_t*, std::size_t, int)).
+///
+void PrimeSieve::callbackPrimes_c(uint64_t start,
+                                  uint64_t stop,
+                                  void (*callback)(const uint64_t*, std::size_t, int))
+{
+  if (!callback)
+    throw primesieve_error("callback is NULL");
+  callback_batch_ = callback;
+  flags_ = CALLBACK_PRIMES_C_BATCH;
+  sieve(start, stop);
+}
+
+/// Sieve the interval [start, stop] and pass each sieved segment
+/// (bitmap) to the callback method of the cb object, the primes are
+/// not decoded (unsynchronized if used with ParallelPrimeSieve).
+/// @see SegmentCallback in Callback.hpp
+///
+void PrimeSieve::callbackSegments(uint64_t start,
+                                  uint64_t stop,
+                                  SegmentCallback* cb)
+{
+  if (!cb)
+    throw primesieve_error("SegmentCallback pointer is NULL");
+  cb_segment_ = cb;
+  flags_ = CALLBACK_SEGMENTS;
+  sieve(start, stop);
+}
+
+// Store member functions
+
+/// Store the primes within [start, stop] in a binary prime file
+/// which can be read using PrimeFile, always single-threaded.
+/// @param format  BITMAP_FORMAT or DELTA_FORMAT.
+///
+void PrimeSieve::storePrimes(uint64_t start, uint64_t stop, const std::string& filename, int format)
+{
+  setStart(start);
+  setStop(stop);
+  PrimeFileWriter writer(filename, start_, stop_, format);
+  int flags = flags_;
+  flags_ = CALLBACK_SEGMENTS;
+  cb_segment_ = &writer;
+
+  // writer is a local object, the previous
+  // flags must be restored in any case
+  try {
+    PrimeSieve::sieve();
+  }
+  catch (...) {
+    flags_ = flags;
+    cb_segment_ = NULL;
+    throw;
+  }
+
+  flags_ = flags;
+  cb_segment_ = NULL;
+  writer.close();
+  counts_[0] = writer.getPrimeCount();
+}
+
 // Print member functions
 
 void PrimeSieve::printPrimes(uint64_t start, uint64_t stop)
@@ -391,10 +910,43 @@ void PrimeSieve::printSextuplets(uint64_t start, uint64_t stop)
 
 // Count member functions
 
+/// If a pi(x) index has been loaded (see PiIndex.hpp) only the
+/// pieces between [start, stop] and the nearest checkpoints
+/// are sieved. If start is small and stop is large the primes
+/// are counted using the combinatorial algorithm in piLMO.cpp.
+///
 uint64_t PrimeSieve::countPrimes(uint64_t start, uint64_t stop)
 {
-  sieve(start, stop, COUNT_PRIMES);
-  return getPrimeCount();
+  setStart(start);
+  setStop(stop);
+  const PiIndex* piIndex = PiIndex::get();
+  bool usePiIndex = piIndex && piIndex->isFaster(start, stop);
+
+  if (!usePiIndex && !isPiLMOFaster(start, stop))
+  {
+    sieve(start, stop, COUNT_PRIMES);
+    return getPrimeCount();
+  }
+
+  double t1 = getWallTime();
+  uint64_t count = 0;
+
+  if (usePiIndex)
+    count = piIndex->countPrimes(*this, start, stop);
+  else
+  {
+    count = piLMO(stop);
+    if (start > 0)
+      count -= countPrimes(0, start - 1);
+  }
+
+  setStart(start);
+  setStop(stop);
+  setFlags(COUNT_PRIMES);
+  reset();
+  counts_[0] = count;
+  seconds_ = getWallTime() - t1;
+  return count;
 }
 
 uint64_t PrimeSieve::countTwins(uint64_t start, uint64_t stop)
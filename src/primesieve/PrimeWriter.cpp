@@ -0,0 +1,174 @@
+///
+/// @file   PrimeWriter.cpp
+/// @brief  Fast conversion of primes to decimal text and
+///         buffered output using write(2).
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primesieve/config.hpp>
+#include <primesieve/PrimeWriter.hpp>
+#include <primesieve/primesieve_error.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
+
+#if defined(_WIN32)
+  #include <io.h>
+#else
+  #include <unistd.h>
+#endif
+
+namespace {
+
+/// "00", "01", ..., "99"
+const char digitPairs[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+/// Number of decimal digits of n, checks 4 digits
+/// per iteration (a 64-bit integer has <= 20 digits).
+///
+int countDigits(uint64_t n)
+{
+  int digits = 1;
+  for (;;)
+  {
+    if (n < 10) return digits;
+    if (n < 100) return digits + 1;
+    if (n < 1000) return digits + 2;
+    if (n < 10000) return digits + 3;
+    n /= 10000;
+    digits += 4;
+  }
+}
+
+/// write(2) all bytes, retries after partial writes
+void writeAll(int fd, const char* data, std::size_t bytes)
+{
+  while (bytes > 0)
+  {
+#if defined(_WIN32)
+    int n = _write(fd, data, static_cast<unsigned>(bytes));
+#else
+    ssize_t n = write(fd, data, bytes);
+#endif
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      throw primesieve::primesieve_error("failed to write primes");
+    }
+    data += n;
+    bytes -= static_cast<std::size_t>(n);
+  }
+}
+
+} // namespace
+
+namespace primesieve {
+
+/// Convert n to decimal, 2 digits at a time
+/// from right to left using a lookup table.
+///
+char* toDecimal(uint64_t n, char* str)
+{
+  int digits = countDigits(n);
+  char* end = str + digits;
+  char* pos = end;
+
+  while (n >= 100)
+  {
+    std::size_t i = static_cast<std::size_t>(n % 100) * 2;
+    n /= 100;
+    pos -= 2;
+    pos[0] = digitPairs[i];
+    pos[1] = digitPairs[i + 1];
+  }
+
+  if (n >= 10)
+  {
+    std::size_t i = static_cast<std::size_t>(n) * 2;
+    pos[-2] = digitPairs[i];
+    pos[-1] = digitPairs[i + 1];
+  }
+  else
+    pos[-1] = static_cast<char>('0' + n);
+
+  return end;
+}
+
+PrimeWriter::PrimeWriter(int fd) :
+  size_(0),
+  fd_(fd)
+{ }
+
+/// The buffer is allocated on first use
+void PrimeWriter::reserve(std::size_t bytes)
+{
+  if (buffer_.size() - size_ < bytes)
+    buffer_.resize(std::max<std::size_t>(size_ + bytes, config::PRINT_BUFFER_SIZE + MAX_PRIME_LENGTH * 64));
+}
+
+/// e.g. "(5, 7, 11)\n"
+void PrimeWriter::writeTuplet(const uint64_t* primes, int k)
+{
+  reserve(k * (MAX_PRIME_LENGTH + 1) + 1);
+  char* pos = &buffer_[size_];
+  *pos++ = '(';
+
+  for (int i = 0; i < k; i++)
+  {
+    pos = toDecimal(primes[i], pos);
+    if (i + 1 < k)
+    {
+      *pos++ = ',';
+      *pos++ = ' ';
+    }
+  }
+
+  *pos++ = ')';
+  *pos++ = '\n';
+  size_ = pos - &buffer_[0];
+}
+
+void PrimeWriter::write(const std::string& str)
+{
+  if (str.empty())
+    return;
+
+  reserve(str.size());
+  std::copy(str.begin(), str.end(), &buffer_[size_]);
+  size_ += str.size();
+}
+
+/// Text printed using std::cout or printf() (e.g. the primes
+/// < 7) must appear before the buffered primes.
+///
+void PrimeWriter::flush()
+{
+  if (size_ == 0)
+    return;
+
+  std::cout.flush();
+  std::fflush(stdout);
+  writeAll(fd_, &buffer_[0], size_);
+  size_ = 0;
+}
+
+} // namespace primesieve
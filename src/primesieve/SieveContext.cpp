@@ -0,0 +1,212 @@
+///
+/// @file   SieveContext.cpp
+/// @brief  Caches the memory and lookup tables used by PrimeSieve
+///         so that repeated small queries do not allocate.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primesieve/config.hpp>
+#include <primesieve/SieveContext.hpp>
+#include <primesieve/HugePages.hpp>
+#include <primesieve/PreSieve.hpp>
+#include <primesieve/SievingPrimes.hpp>
+#include <primesieve/pmath.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace primesieve {
+
+SieveContext::SieveContext() :
+  maxCacheSize_(config::CONTEXT_CACHE_SIZE),
+  maxSievingPrime_(config::CONTEXT_MAX_SIEVING_PRIME),
+  pagesBytes_(0),
+  sievingPrimes_(NULL),
+  sievingPrimesUsers_(0),
+  users_(0)
+{ }
+
+SieveContext::SieveContext(std::size_t maxCacheSize, uint64_t maxSievingPrime) :
+  maxCacheSize_(maxCacheSize),
+  maxSievingPrime_(maxSievingPrime),
+  pagesBytes_(0),
+  sievingPrimes_(NULL),
+  sievingPrimesUsers_(0),
+  users_(0)
+{ }
+
+SieveContext::~SieveContext()
+{
+  clear();
+  delete sievingPrimes_;
+}
+
+SieveContext* SieveContext::threadContext()
+{
+#if defined(PRIMESIEVE_THREAD_LOCAL)
+  thread_local SieveContext context(config::THREAD_CONTEXT_CACHE_SIZE,
+                                    config::THREAD_CONTEXT_MAX_SIEVING_PRIME);
+  return &context;
+#else
+  return NULL;
+#endif
+}
+
+/// The cached pages are unused hence they can always be freed,
+/// clear() may however be called from within the callback of a
+/// query using this context.
+///
+void SieveContext::clear()
+{
+  for (std::size_t i = 0; i < pages_.size(); i++)
+    primesieve::freePages(pages_[i].ptr, pages_[i].size, pages_[i].pageType);
+
+  if (users_ == 0)
+  {
+    for (std::size_t i = 0; i < preSieves_.size(); i++)
+      delete preSieves_[i];
+    preSieves_.clear();
+  }
+
+  if (sievingPrimesUsers_ == 0)
+  {
+    delete sievingPrimes_;
+    sievingPrimes_ = NULL;
+  }
+
+  pages_.clear();
+  pagesBytes_ = 0;
+}
+
+void SieveContext::addUser()
+{
+  users_++;
+}
+
+void SieveContext::removeUser()
+{
+  users_--;
+}
+
+std::size_t SieveContext::getCachedBytes() const
+{
+  std::size_t bytes = pagesBytes_;
+  if (sievingPrimes_)
+    bytes += sievingPrimes_->getLimit() / NUMBERS_PER_BYTE;
+  return bytes;
+}
+
+/// Reuse previously freed memory of the same size (most recently
+/// freed first as it is likely still cached), else allocate.
+/// Huge pages are only reused if hugePages is true.
+///
+void* SieveContext::allocatePages(std::size_t size, bool hugePages, int* pageType)
+{
+  for (std::size_t i = pages_.size(); i > 0; i--)
+  {
+    Pages& pages = pages_[i - 1];
+    if (pages.size == size &&
+        (hugePages || pages.pageType == NORMAL_PAGES))
+    {
+      void* ptr = pages.ptr;
+      *pageType = pages.pageType;
+      pagesBytes_ -= size;
+      pages_.erase(pages_.begin() + (i - 1));
+      return ptr;
+    }
+  }
+
+  return primesieve::allocatePages(size, hugePages, pageType);
+}
+
+/// Keep the memory for reuse unless the cache is full
+void SieveContext::freePages(void* ptr, std::size_t size, int pageType)
+{
+  if (!ptr)
+    return;
+
+  if (pagesBytes_ + size <= maxCacheSize_)
+  {
+    Pages pages;
+    pages.ptr = ptr;
+    pages.size = size;
+    pages.pageType = pageType;
+    pages_.push_back(pages);
+    pagesBytes_ += size;
+  }
+  else
+    primesieve::freePages(ptr, size, pageType);
+}
+
+/// PreSieve objects are immutable after
+/// initialization hence they can be shared.
+///
+const PreSieve& SieveContext::getPreSieve(int limit)
+{
+  for (std::size_t i = 0; i < preSieves_.size(); i++)
+    if (preSieves_[i]->getLimit() == static_cast<uint_t>(limit))
+      return *preSieves_[i];
+
+  preSieves_.reserve(preSieves_.size() + 1);
+  preSieves_.push_back(new PreSieve(limit));
+  return *preSieves_.back();
+}
+
+/// Get a table of (at least) the sieving primes <= sqrt(stop), the
+/// table is only regenerated if it is too small. It grows
+/// geometrically so that increasing stop values regenerate
+/// it only a few times.
+/// The table is never regenerated while it is in use, a query
+/// nested inside a callback of another query (using the same
+/// context) may only share it.
+/// @param sieveSize  Sieve size in kilobytes.
+/// @return NULL if sqrt(stop) > maxSievingPrime or if the
+///         table is too small and in use.
+///
+const SievingPrimes* SieveContext::getSievingPrimes(uint64_t stop, int sieveSize)
+{
+  uint64_t sqrtStop = isqrt(stop);
+  if (sqrtStop > maxSievingPrime_)
+    return NULL;
+
+  if (!sievingPrimes_ ||
+      sievingPrimes_->getLimit() < sqrtStop)
+  {
+    if (sievingPrimesUsers_ > 0)
+      return NULL;
+
+    uint64_t limit = std::max<uint64_t>(sqrtStop, 1 << 16);
+    if (sievingPrimes_)
+      limit = std::max<uint64_t>(limit, sievingPrimes_->getLimit() * UINT64_C(2));
+    limit = std::min<uint64_t>(limit, maxSievingPrime_);
+
+    delete sievingPrimes_;
+    sievingPrimes_ = NULL;
+    SievingPrimes* sievingPrimes = new SievingPrimes(limit * limit, sieveSize, 1);
+    try {
+      for (int i = 0; i < sievingPrimes->getPieces(); i++)
+        sievingPrimes->sievePiece(i);
+    }
+    catch (...) {
+      delete sievingPrimes;
+      throw;
+    }
+    sievingPrimes_ = sievingPrimes;
+  }
+
+  sievingPrimesUsers_++;
+  return sievingPrimes_;
+}
+
+void SieveContext::releaseSievingPrimes()
+{
+  sievingPrimesUsers_--;
+}
+
+} // namespace primesieve
@@ -10,10 +10,16 @@
 
 #include <primesieve/config.hpp>
 #include <primesieve/SieveOfEratosthenes.hpp>
+#include <primesieve/SieveOfEratosthenes-inline.hpp>
+#include <primesieve/SieveStats.hpp>
 #include <primesieve/PreSieve.hpp>
 #include <primesieve/EratSmall.hpp>
 #include <primesieve/EratMedium.hpp>
 #include <primesieve/EratBig.hpp>
+#include <primesieve/EratSettings.hpp>
+#include <primesieve/SieveContext.hpp>
+#include <primesieve/HugePages.hpp>
+#include <primesieve/CpuInfo.hpp>
 #include <primesieve/pmath.hpp>
 #include <primesieve/primesieve_error.hpp>
 
@@ -21,6 +27,7 @@
 #include <exception>
 #include <string>
 #include <cstddef>
+#include <algorithm>
 
 namespace primesieve {
 
@@ -42,16 +49,26 @@ const uint_t SieveOfEratosthenes::bruijnBitValues_[64] =
 /// @param start      Sieve primes >= start.
 /// @param stop       Sieve primes <= stop.
 /// @param sieveSize  A sieve size in kilobytes.
+/// @param settings   Bucket size and EratSmall, EratMedium limits.
+/// @param context    Reuse the memory and PreSieve tables of previous
+///                   sieving operations (NULL = allocate).
 /// @pre   start      >= 7
 /// @pre   stop       <= 2^64 - 2^32 * 10
 /// @pre   sieveSize  >= 1 && <= 2048
 ///
 SieveOfEratosthenes::SieveOfEratosthenes(uint64_t start,
                                          uint64_t stop,
-                                         uint_t sieveSize) :
+                                         uint_t sieveSize,
+                                         const EratSettings& settings,
+                                         SieveContext* context) :
+  timer_(NULL),
   start_(start),
   stop_(stop),
+  settings_(settings),
+  context_(context),
   sieve_(NULL),
+  sieveAllocSize_(0),
+  sievePageType_(NORMAL_PAGES),
   preSieve_(NULL),
   eratSmall_(NULL),
   eratMedium_(NULL),
@@ -76,8 +93,12 @@ SieveOfEratosthenes::SieveOfEratosthenes(uint64_t start,
   segmentLow_ = start_ - getByteRemainder(start_);
   segmentHigh_ = segmentLow_ + sieveSize_ * NUMBERS_PER_BYTE + 1;
 
-  // allocate sieve of Eratosthenes array
-  sieve_ = new byte_t[sieveSize_];
+  // allocate sieve of Eratosthenes array, large
+  // (2 megabytes) sieve arrays use huge pages
+  sieveAllocSize_ = sieveSize_;
+  void* sieve = (context_) ? context_->allocatePages(sieveAllocSize_, settings_.hugePages, &sievePageType_)
+                           : allocatePages(sieveAllocSize_, settings_.hugePages, &sievePageType_);
+  sieve_ = static_cast<byte_t*>(sieve);
   init();
 }
 
@@ -88,8 +109,13 @@ SieveOfEratosthenes::~SieveOfEratosthenes()
 
 void SieveOfEratosthenes::cleanUp()
 {
-  delete[] sieve_;
-  delete preSieve_;
+  if (context_)
+    context_->freePages(sieve_, sieveAllocSize_, sievePageType_);
+  else
+  {
+    freePages(sieve_, sieveAllocSize_, sievePageType_);
+    delete preSieve_;
+  }
   delete eratSmall_;
   delete eratMedium_;
   delete eratBig_;
@@ -97,14 +123,29 @@ void SieveOfEratosthenes::cleanUp()
 
 void SieveOfEratosthenes::init()
 {
-  limitEratSmall_  = static_cast<uint_t>(sieveSize_ * config::FACTOR_ERATSMALL);
-  limitEratMedium_ = static_cast<uint_t>(sieveSize_ * config::FACTOR_ERATMEDIUM);
+  // If the sieve array is larger than the CPU's L1 data cache
+  // (e.g. L2 cache sized segments) PreSieve and EratSmall
+  // process each segment in L1 data cache sized blocks. The
+  // EratSmall and EratMedium limits depend on the block size
+  // so that the larger segments mainly benefit EratBig.
+  blockSize_ = sieveSize_;
+  if (cpuInfo().hasL1dCache())
+  {
+    uint_t l1dSize = static_cast<uint_t>(cpuInfo().l1dCacheSize());
+    blockSize_ = std::min(blockSize_, floorPowerOf2(l1dSize));
+  }
+
+  limitEratSmall_  = static_cast<uint_t>(blockSize_ * settings_.factorEratSmall);
+  limitEratMedium_ = static_cast<uint_t>(blockSize_ * settings_.factorEratMedium);
+  limitEratMedium_ = std::max(limitEratMedium_, limitEratSmall_);
+  uint_t bucketSize = settings_.bucketSize;
   try {
-    preSieve_ = new PreSieve(limitPreSieve_);
+    preSieve_ = (context_) ? &context_->getPreSieve(limitPreSieve_)
+                           : new PreSieve(limitPreSieve_);
 
-    if (sqrtStop_ > limitPreSieve_)   eratSmall_  = new EratSmall (stop_, sieveSize_, limitEratSmall_);
-    if (sqrtStop_ > limitEratSmall_)  eratMedium_ = new EratMedium(stop_, sieveSize_, limitEratMedium_);
-    if (sqrtStop_ > limitEratMedium_) eratBig_    = new EratBig   (stop_, sieveSize_, sqrtStop_);
+    if (sqrtStop_ > limitPreSieve_)   eratSmall_  = EratSmall ::create(stop_, blockSize_, limitEratSmall_, bucketSize);
+    if (sqrtStop_ > limitEratSmall_)  eratMedium_ = EratMedium::create(stop_, sieveSize_, limitEratMedium_, bucketSize);
+    if (sqrtStop_ > limitEratMedium_) eratBig_    = EratBig   ::create(stop_, sieveSize_, sqrtStop_, bucketSize, settings_.bytesPerAlloc, settings_.hugePages, context_);
   }
   catch (const std::exception&) {
     cleanUp();
@@ -122,6 +163,35 @@ uint_t SieveOfEratosthenes::getPreSieve() const
   return limitPreSieve_;
 }
 
+/// @return Number of EratBig bucket allocations
+uint64_t SieveOfEratosthenes::getBucketAllocs() const
+{
+  return eratBig_ ? eratBig_->getBucketAllocs() : 0;
+}
+
+/// @return Bytes of the sieve array and EratBig's
+///         buckets backed by huge pages
+///
+uint64_t SieveOfEratosthenes::getHugePageBytes() const
+{
+  uint64_t bytes = 0;
+  if (sievePageType_ != NORMAL_PAGES)
+    bytes += sieveAllocSize_;
+  if (eratBig_)
+    bytes += eratBig_->getHugePageBytes();
+  return bytes;
+}
+
+const EratSettings& SieveOfEratosthenes::getEratSettings() const
+{
+  return settings_;
+}
+
+SieveContext* SieveOfEratosthenes::getContext() const
+{
+  return context_;
+}
+
 std::string SieveOfEratosthenes::getMaxStopString()
 {
   return EratBig::getMaxStopString();
@@ -140,33 +210,72 @@ uint64_t SieveOfEratosthenes::getByteRemainder(uint64_t n)
   return r;
 }
 
+/// @return true if sieving has been stopped, checked once
+///         per segment (the default never stops).
+///
+bool SieveOfEratosthenes::isStopped() const
+{
+  return false;
+}
+
+/// Segments of the sieving primes generator (PrimeGenerator)
+/// are sieved while the generator's stage is active, hence
+/// the previous stage is restored.
+///
 void SieveOfEratosthenes::sieveSegment()
 {
-  preSieve();
+  if (isStopped())
+    return;
+  int stage = setStage(SieveStats::PRE_SIEVE);
   crossOffMultiples();
   segmentFinished(sieve_, sieveSize_);
+  setStage(stage);
 }
 
+/// PreSieve and EratSmall process the current segment in blocks
+/// of blockSize_ bytes which fit into the CPU's L1 data cache,
+/// EratMedium and EratBig process the entire segment at once.
+///
 void SieveOfEratosthenes::crossOffMultiples()
 {
-  if (eratSmall_)   eratSmall_->crossOff(sieve_, &sieve_[sieveSize_]);
-  if (eratMedium_) eratMedium_->crossOff(sieve_, sieveSize_);
-  if (eratBig_)       eratBig_->crossOff(sieve_);
+  for (uint_t i = 0; i < sieveSize_; i += blockSize_)
+  {
+    byte_t* block = &sieve_[i];
+    uint_t size = std::min(blockSize_, sieveSize_ - i);
+    setStage(SieveStats::PRE_SIEVE);
+    preSieve(block, size, segmentLow_ + i * NUMBERS_PER_BYTE);
+    if (eratSmall_)
+    {
+      setStage(SieveStats::ERAT_SMALL);
+      eratSmall_->crossOff(block, &block[size]);
+    }
+  }
+
+  if (eratMedium_)
+  {
+    setStage(SieveStats::ERAT_MEDIUM);
+    eratMedium_->crossOff(sieve_, sieveSize_);
+  }
+  if (eratBig_)
+  {
+    setStage(SieveStats::ERAT_BIG);
+    eratBig_->crossOff(sieve_);
+  }
 }
 
-/// Pre-sieve multiples of small primes e.g. <= 19
+/// Pre-sieve multiples of small primes e.g. <= 89
 /// to speed up the sieve of Eratosthenes.
 ///
-void SieveOfEratosthenes::preSieve()
+void SieveOfEratosthenes::preSieve(byte_t* block, uint_t size, uint64_t blockLow)
 {
-  preSieve_->doIt(sieve_, sieveSize_, segmentLow_);
+  preSieve_->doIt(block, size, blockLow);
 
   // unset bits (numbers) < start_
-  if (segmentLow_ <= start_) {
+  if (blockLow <= start_) {
     if (start_ <= limitPreSieve_)
-      sieve_[0] = 0xff;
+      preSieve_->restorePrimes(block, size, blockLow);
     for (int i = 0; bitValues_[i] < getByteRemainder(start_); i++)
-      sieve_[0] &= 0xfe << i;
+      block[0] &= 0xfe << i;
   }
 }
 
@@ -179,12 +288,14 @@ void SieveOfEratosthenes::sieve()
     sieveSegment();
     segmentLow_  += sieveSize_ * NUMBERS_PER_BYTE;
     segmentHigh_ += sieveSize_ * NUMBERS_PER_BYTE;
+    if (isStopped())
+      return;
   }
   // sieve the last segment
   uint64_t remainder = getByteRemainder(stop_);
   sieveSize_ = static_cast<uint_t>((stop_ - remainder) - segmentLow_) / NUMBERS_PER_BYTE + 1;
   segmentHigh_ = segmentLow_ + sieveSize_ * NUMBERS_PER_BYTE + 1;
-  preSieve();
+  int stage = setStage(SieveStats::PRE_SIEVE);
   crossOffMultiples();
   int i;
   // unset bits (numbers) > stop_
@@ -196,6 +307,7 @@ void SieveOfEratosthenes::sieve()
   for (uint_t j = sieveSize_; j % 8 != 0; j++)
     sieve_[j] = 0;
   segmentFinished(sieve_, sieveSize_);
+  setStage(stage);
 }
 
 } // namespace primesieve
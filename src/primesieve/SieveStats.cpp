@@ -0,0 +1,106 @@
+///
+/// @file   SieveStats.cpp
+/// @brief  Per stage timings and counters of PrimeSieve::sieve()
+///         and the wall clock used for timing.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primesieve/SieveStats.hpp>
+#include <primesieve/StageTimer.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstddef>
+#include <ctime>
+
+#if defined(_WIN32)
+  #include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+  #include <sys/time.h>
+  #include <time.h>
+#endif
+
+namespace primesieve {
+
+/// std::clock() measures the CPU time of the process,
+/// it cannot be used for timing multi-threaded code.
+///
+double wallTime()
+{
+#if defined(_WIN32)
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return static_cast<double>(counter.QuadPart) / frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+#elif defined(__unix__) || defined(__APPLE__)
+  timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+#else
+  return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+SieveStats::SieveStats()
+{
+  reset();
+}
+
+void SieveStats::reset()
+{
+  std::fill(seconds, seconds + STAGES, 0.0);
+  segments = 0;
+  bucketAllocs = 0;
+  hugePageBytes = 0;
+  threadIdle.clear();
+}
+
+/// The thread's busy time is subtracted from threadIdle,
+/// ParallelPrimeSieve::sieve() adds the total time once
+/// all threads have finished.
+///
+void SieveStats::add(const SieveStats& stats, int threadNum, double busy)
+{
+  for (int i = 0; i < STAGES; i++)
+    seconds[i] += stats.seconds[i];
+  segments += stats.segments;
+  bucketAllocs += stats.bucketAllocs;
+  hugePageBytes += stats.hugePageBytes;
+
+  std::size_t i = static_cast<std::size_t>(threadNum);
+  if (threadIdle.size() <= i)
+    threadIdle.resize(i + 1, 0.0);
+  threadIdle[i] -= busy;
+}
+
+const char* SieveStats::getStageName(int stage)
+{
+  const char* names[STAGES] =
+  {
+    "PreSieve",
+    "EratSmall",
+    "EratMedium",
+    "EratBig",
+    "PrimeGenerator",
+    "Callback",
+    "Count",
+    "Print",
+    "Wait",
+    "Other"
+  };
+
+  if (stage < 0 || stage >= STAGES)
+    return "";
+  return names[stage];
+}
+
+} // namespace primesieve
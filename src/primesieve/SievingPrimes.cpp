@@ -0,0 +1,149 @@
+///
+/// @file   SievingPrimes.cpp
+/// @brief  Shared, read-only table of the sieving primes up to
+///         sqrt(stop) for use by all ParallelPrimeSieve threads.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primesieve/config.hpp>
+#include <primesieve/SievingPrimes.hpp>
+#include <primesieve/PrimeFinder.hpp>
+#include <primesieve/SieveOfEratosthenes.hpp>
+#include <primesieve/SieveOfEratosthenes-inline.hpp>
+#include <primesieve/littleendian_cast.hpp>
+#include <primesieve/pmath.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using namespace primesieve;
+
+/// TableSieve sieves the primes within [start, stop] and copies
+/// the sieved segments into the SievingPrimes bit array.
+///
+class TableSieve : public SieveOfEratosthenes {
+public:
+  TableSieve(uint64_t start, uint64_t stop, uint_t sieveSize, byte_t* table) :
+    SieveOfEratosthenes(start, stop, sieveSize),
+    table_(table)
+  { }
+  using SieveOfEratosthenes::getNextPrime;
+  void doIt()
+  {
+    generateTinyPrimes();
+    sieve();
+  }
+private:
+  byte_t* table_;
+  void segmentFinished(const byte_t* sieve, uint_t sieveSize)
+  {
+    uint64_t index = getSegmentLow() / NUMBERS_PER_BYTE;
+    std::memcpy(&table_[index], sieve, sieveSize);
+  }
+  /// Generate the primes up to sqrt(stop) using
+  /// the sieve of Eratosthenes.
+  ///
+  void generateTinyPrimes()
+  {
+    uint_t P = getPreSieve() + 1;
+    uint_t N = getSqrtStop();
+    std::vector<char> isPrime(N + 1, true);
+
+    for (uint_t i = 3; i * i <= N; i += 2)
+      if (isPrime[i])
+        for (uint_t j = i * i; j <= N; j += i * 2)
+          isPrime[j] = false;
+
+    for (uint_t i = P + (~P & 1); i <= N; i += 2)
+      if (isPrime[i])
+        addSievingPrime(i);
+  }
+  DISALLOW_COPY_AND_ASSIGN(TableSieve);
+};
+
+} // namespace
+
+namespace primesieve {
+
+/// Allocate the table for the sieving primes <= sqrt(stop), the
+/// primes are generated using sievePiece(0 ... getPieces() - 1).
+/// @param sieveSize  Sieve size in kilobytes.
+/// @param threads    Number of threads used for generating
+///                   the sieving primes.
+///
+SievingPrimes::SievingPrimes(uint64_t stop, uint_t sieveSize, int threads) :
+  limit_(static_cast<uint_t>(isqrt(stop))),
+  sieveSize_(sieveSize),
+  pieces_(0)
+{
+  if (limit_ < 7)
+    return;
+
+  // 8 extra bytes for reading 64-bit words
+  uint64_t bytes = limit_ / NUMBERS_PER_BYTE + 1;
+  primes_.resize(static_cast<std::size_t>(bytes + 8), 0);
+
+  // each thread sieves a range of bytes
+  uint64_t pieces = limit_ / config::MIN_THREAD_INTERVAL;
+  pieces_ = static_cast<int>(getInBetween<uint64_t>(1, pieces, threads));
+}
+
+/// Sieve the i-th piece of the table, the pieces
+/// can be sieved in parallel.
+///
+void SievingPrimes::sievePiece(int i)
+{
+  uint64_t bytes = primes_.size() - 8;
+  uint64_t first = bytes * i / pieces_;
+  uint64_t last = bytes * (i + 1) / pieces_;
+  uint64_t start = first * NUMBERS_PER_BYTE + 7;
+  uint64_t stop = std::min<uint64_t>(last * NUMBERS_PER_BYTE + 1, limit_);
+
+  if (start <= stop)
+  {
+    TableSieve tableSieve(start, stop, sieveSize_, &primes_[0]);
+    tableSieve.doIt();
+  }
+}
+
+/// Add the primes > finder.getPreSieve() and <= finder.getSqrtStop()
+/// to finder, this method is thread-safe.
+/// @pre finder.getSqrtStop() <= getLimit()
+///
+void SievingPrimes::addSievingPrimes(PrimeFinder& finder) const
+{
+  if (primes_.empty())
+    return;
+
+  uint_t start = finder.getPreSieve() + 1;
+  uint_t stop = finder.getSqrtStop();
+  // first byte of the 64-bit word that contains start
+  uint_t i = ((start - 2) / NUMBERS_PER_BYTE) & ~7u;
+  uint64_t base = static_cast<uint64_t>(i) * NUMBERS_PER_BYTE;
+
+  for (; i < primes_.size() - 8; i += 8)
+  {
+    if (finder.isStopped())
+      return;
+    uint64_t bits = littleendian_cast<uint64_t>(&primes_[i]);
+    while (bits != 0)
+    {
+      uint64_t prime = TableSieve::getNextPrime(&bits, base);
+      if (prime > stop)
+        return;
+      if (prime >= start)
+        finder.addSievingPrime(static_cast<uint_t>(prime));
+    }
+    base += NUMBERS_PER_BYTE * 8;
+  }
+}
+
+} // namespace primesieve
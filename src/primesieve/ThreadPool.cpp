@@ -0,0 +1,311 @@
+///
+/// @file   ThreadPool.cpp
+/// @brief  C++11 std::thread backend of ParallelPrimeSieve: a pool
+///         of persistent worker threads and a work-stealing
+///         scheduler with adaptive chunk sizes.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primesieve/config.hpp>
+#include <primesieve/ThreadPool.hpp>
+
+#if defined(PRIMESIEVE_THREAD_POOL)
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/// Used if the thread pool is busy e.g. if a callback function
+/// of a ParallelPrimeSieve calls ParallelPrimeSieve::sieve()
+/// or if multiple threads use ParallelPrimeSieve concurrently.
+///
+void runTemporaryThreads(int threads, const std::function<void(int)>& task)
+{
+  std::vector<std::thread> workers;
+  std::vector<std::exception_ptr> exceptions(threads);
+
+  auto execute = [&](int threadNum)
+  {
+    try {
+      task(threadNum);
+    }
+    catch (...) {
+      exceptions[threadNum] = std::current_exception();
+    }
+  };
+
+  for (int i = 1; i < threads; i++)
+    workers.emplace_back(execute, i);
+
+  execute(0);
+
+  for (std::size_t i = 0; i < workers.size(); i++)
+    workers[i].join();
+
+  for (int i = 0; i < threads; i++)
+    if (exceptions[i])
+      std::rethrow_exception(exceptions[i]);
+}
+
+} // namespace
+
+namespace primesieve {
+
+ThreadPool& ThreadPool::getInstance()
+{
+  static ThreadPool threadPool;
+  return threadPool;
+}
+
+ThreadPool::ThreadPool() :
+  task_(nullptr),
+  generation_(0),
+  threads_(0),
+  running_(0),
+  exit_(false)
+{ }
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    exit_ = true;
+  }
+  wakeUp_.notify_all();
+
+  for (std::size_t i = 0; i < workers_.size(); i++)
+  {
+#if defined(_WIN32)
+    // At DLL unload Windows has already
+    // terminated the worker threads
+    workers_[i].detach();
+#else
+    workers_[i].join();
+#endif
+  }
+}
+
+/// Execute task(threadNum) for threadNum = 0 ... threads - 1
+/// and wait until all threads have finished. If a task throws
+/// an exception it is rethrown in the calling thread.
+///
+void ThreadPool::run(int threads, const std::function<void(int)>& task)
+{
+  std::unique_lock<std::mutex> runLock(runMutex_, std::try_to_lock);
+
+  if (!runLock.owns_lock())
+  {
+    runTemporaryThreads(threads, task);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // reuse the existing workers, create new ones if needed
+    while (static_cast<int>(workers_.size()) < threads - 1)
+    {
+      int threadNum = static_cast<int>(workers_.size()) + 1;
+      workers_.emplace_back(&ThreadPool::worker, this, threadNum, generation_);
+    }
+
+    task_ = &task;
+    exception_ = nullptr;
+    threads_ = threads;
+    running_ = threads - 1;
+    generation_++;
+  }
+
+  wakeUp_.notify_all();
+  execute(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  finished_.wait(lock, [&] { return running_ == 0; });
+  task_ = nullptr;
+
+  if (exception_)
+  {
+    std::exception_ptr exception = exception_;
+    exception_ = nullptr;
+    std::rethrow_exception(exception);
+  }
+}
+
+/// Worker threads sleep until the next run() call
+void ThreadPool::worker(int threadNum, uint64_t generation)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (true)
+  {
+    wakeUp_.wait(lock, [&] { return exit_ || generation_ != generation; });
+    if (exit_)
+      return;
+
+    generation = generation_;
+    if (threadNum >= threads_)
+      continue;
+
+    lock.unlock();
+    execute(threadNum);
+    lock.lock();
+
+    if (--running_ == 0)
+      finished_.notify_one();
+  }
+}
+
+void ThreadPool::execute(int threadNum)
+{
+  try {
+    (*task_)(threadNum);
+  }
+  catch (...) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!exception_)
+      exception_ = std::current_exception();
+  }
+}
+
+/// @param maxChunk  Maximum chunk size, e.g. the OpenMP
+///                  backend's thread interval.
+/// @param minChunk  Minimum chunk size, chunks are not split
+///                  below minChunk to limit the per chunk
+///                  initialization overhead.
+///
+WorkStealing::WorkStealing(uint64_t start,
+                           uint64_t stop,
+                           int threads,
+                           uint64_t maxChunk,
+                           uint64_t minChunk) :
+  ranges_(threads),
+  remaining_(stop - start),
+  abort_(false),
+  maxChunk_(std::max<uint64_t>(maxChunk, 1)),
+  minChunk_(std::max<uint64_t>(std::min(minChunk, maxChunk), 1)),
+  threads_(threads)
+{
+  // initially each thread owns an equal share
+  for (int i = 0; i < threads; i++)
+  {
+    ranges_[i].start = start + (stop - start) / threads * i;
+    ranges_[i].stop = start + (stop - start) / threads * (i + 1);
+  }
+
+  ranges_[threads - 1].stop = stop;
+}
+
+/// Get the next chunk [start, stop[ for the thread threadNum.
+/// @return false if the whole interval has been distributed.
+///
+bool WorkStealing::getChunk(int threadNum, uint64_t* start, uint64_t* stop)
+{
+  Range& range = ranges_[threadNum];
+
+  while (!abort_)
+  {
+    {
+      std::lock_guard<std::mutex> lock(range.mutex);
+
+      if (range.start < range.stop)
+      {
+        uint64_t size = range.stop - range.start;
+        uint64_t chunk = remaining_ / (threads_ * 2);
+        chunk = std::max(chunk, minChunk_);
+        chunk = std::min(chunk, maxChunk_);
+
+        // do not leave behind a tiny chunk
+        if (size - std::min(chunk, size) < minChunk_)
+          chunk = size;
+
+        *start = range.start;
+        *stop = range.start + chunk;
+        range.start += chunk;
+        remaining_ -= chunk;
+        return true;
+      }
+    }
+
+    if (!steal(threadNum))
+      return false;
+  }
+
+  return false;
+}
+
+/// Steal the back half of the largest remaining range
+/// of another thread.
+/// @return false if there is nothing left to steal.
+///
+bool WorkStealing::steal(int threadNum)
+{
+  while (!abort_)
+  {
+    int victim = -1;
+    uint64_t maxSize = 0;
+
+    for (int i = 0; i < threads_; i++)
+    {
+      std::lock_guard<std::mutex> lock(ranges_[i].mutex);
+      uint64_t size = ranges_[i].stop - ranges_[i].start;
+      if (size > maxSize)
+      {
+        maxSize = size;
+        victim = i;
+      }
+    }
+
+    if (victim < 0)
+      return false;
+
+    uint64_t start = 0;
+    uint64_t stop = 0;
+
+    {
+      std::lock_guard<std::mutex> lock(ranges_[victim].mutex);
+      Range& range = ranges_[victim];
+      uint64_t size = range.stop - range.start;
+
+      // another thread was faster, retry
+      if (size == 0)
+        continue;
+
+      stop = range.stop;
+      if (size < minChunk_ * 2)
+        start = range.start;
+      else
+        start = range.start + size / 2;
+      range.stop = start;
+    }
+
+    std::lock_guard<std::mutex> lock(ranges_[threadNum].mutex);
+    ranges_[threadNum].start = start;
+    ranges_[threadNum].stop = stop;
+    return true;
+  }
+
+  return false;
+}
+
+/// Stop distributing chunks, used if a thread
+/// has thrown an exception.
+///
+void WorkStealing::abort()
+{
+  abort_ = true;
+}
+
+} // namespace primesieve
+
+#endif /* PRIMESIEVE_THREAD_POOL */
@@ -0,0 +1,418 @@
+///
+/// @file   TuningProfile.cpp
+/// @brief  Benchmark candidate sieve sizes, bucket sizes and
+///         EratSmall, EratMedium factors on the current machine
+///         and load/save the fastest settings from/to a profile
+///         file.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primesieve/config.hpp>
+#include <primesieve/CpuInfo.hpp>
+#include <primesieve/pmath.hpp>
+#include <primesieve/PrimeSieve.hpp>
+#include <primesieve/primesieve_error.hpp>
+#include <primesieve/StageTimer.hpp>
+#include <primesieve/TuningProfile.hpp>
+
+#include <stdint.h>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+/// 10^19 is the largest power of 10 < 2^64
+const int EXPONENTS = 20;
+
+/// Size of the benchmarked intervals [10^exponent, 10^exponent + TUNE_DISTANCE]
+const uint64_t TUNE_DISTANCE = 1000000000;
+
+uint64_t ipow10(int exponent)
+{
+  uint64_t n = 1;
+  for (int i = 0; i < exponent; i++)
+    n *= 10;
+  return n;
+}
+
+/// Number of decimal digits of n minus 1
+int getExponent(uint64_t n)
+{
+  int exponent = 0;
+  for (; n >= 10; n /= 10)
+    exponent++;
+  return exponent;
+}
+
+/// Use the setting of the largest tuned exponent <= stop's
+/// exponent, or else of the smallest tuned exponent.
+///
+template <typename T>
+T getSetting(const vector<T>& settings, uint64_t stop, T notTuned)
+{
+  for (int i = getExponent(stop); i >= 0; i--)
+    if (settings[i] != notTuned)
+      return settings[i];
+
+  for (int i = 0; i < EXPONENTS; i++)
+    if (settings[i] != notTuned)
+      return settings[i];
+
+  return notTuned;
+}
+
+template <typename T>
+bool isEmpty(const vector<T>& settings, T notTuned)
+{
+  for (int i = 0; i < EXPONENTS; i++)
+    if (settings[i] != notTuned)
+      return false;
+  return true;
+}
+
+/// Best of 2 runs, sieve() because countPrimes()
+/// may use piLMO instead of sieving.
+///
+double benchmark(primesieve::PrimeSieve& ps, uint64_t start, uint64_t stop)
+{
+  double seconds = 0;
+
+  for (int i = 0; i < 2; i++)
+  {
+    double t1 = primesieve::wallTime();
+    ps.sieve(start, stop, primesieve::PrimeSieve::COUNT_PRIMES);
+    double t2 = primesieve::wallTime() - t1;
+    if (i == 0 || t2 < seconds)
+      seconds = t2;
+  }
+
+  return seconds;
+}
+
+template <typename T>
+void printStatus(ostream* status, int exponent, const char* setting, T value, double seconds)
+{
+  if (status)
+  {
+    ostringstream oss;
+    oss << setting << " " << value << ":";
+    *status << "10^" << left << setw(4) << exponent
+            << setw(26) << oss.str() << right
+            << fixed << setprecision(3) << seconds << " s" << endl;
+  }
+}
+
+} // namespace
+
+namespace primesieve {
+
+TuningProfile::TuningProfile() :
+  sieveSizes_(EXPONENTS, 0),
+  bucketSizes_(EXPONENTS, 0),
+  factorsEratSmall_(EXPONENTS, -1),
+  factorsEratMedium_(EXPONENTS, -1),
+  l1dCacheSize_(cpuInfo().l1dCacheSize()),
+  l2CacheSize_(cpuInfo().l2CacheSize())
+{ }
+
+TuningProfile::TuningProfile(const string& filename) :
+  sieveSizes_(EXPONENTS, 0),
+  bucketSizes_(EXPONENTS, 0),
+  factorsEratSmall_(EXPONENTS, -1),
+  factorsEratMedium_(EXPONENTS, -1),
+  l1dCacheSize_(cpuInfo().l1dCacheSize()),
+  l2CacheSize_(cpuInfo().l2CacheSize())
+{
+  if (!filename.empty())
+    load(filename);
+}
+
+bool TuningProfile::empty() const
+{
+  return isEmpty(sieveSizes_, 0) &&
+         isEmpty(bucketSizes_, 0) &&
+         isEmpty(factorsEratSmall_, -1.0) &&
+         isEmpty(factorsEratMedium_, -1.0);
+}
+
+int TuningProfile::getSieveSize(uint64_t stop) const
+{
+  return getSetting(sieveSizes_, stop, 0);
+}
+
+int TuningProfile::getBucketSize(uint64_t stop) const
+{
+  return getSetting(bucketSizes_, stop, 0);
+}
+
+double TuningProfile::getFactorEratSmall(uint64_t stop) const
+{
+  return getSetting(factorsEratSmall_, stop, -1.0);
+}
+
+double TuningProfile::getFactorEratMedium(uint64_t stop) const
+{
+  return getSetting(factorsEratMedium_, stop, -1.0);
+}
+
+int TuningProfile::checkExponent(int exponent)
+{
+  if (exponent < 0 || exponent >= EXPONENTS)
+    throw primesieve_error("TuningProfile: exponent must be >= 0 and <= 19");
+  return exponent;
+}
+
+void TuningProfile::setSieveSize(int exponent, int sieveSize)
+{
+  sieveSizes_[checkExponent(exponent)] = getInBetween(1, floorPowerOf2(sieveSize), 2048);
+}
+
+/// Same bounds as PrimeSieve::setBucketSize()
+void TuningProfile::setBucketSize(int exponent, int bucketSize)
+{
+  bucketSizes_[checkExponent(exponent)] = getInBetween<int>(config::MIN_BUCKETSIZE,
+                                                            floorPowerOf2(bucketSize),
+                                                            config::MAX_BUCKETSIZE);
+}
+
+/// Same bounds as PrimeSieve::setFactorEratSmall()
+void TuningProfile::setFactorEratSmall(int exponent, double factor)
+{
+  factorsEratSmall_[checkExponent(exponent)] = getInBetween(0.0, factor, 3.0);
+}
+
+/// Same bounds as PrimeSieve::setFactorEratMedium()
+void TuningProfile::setFactorEratMedium(int exponent, double factor)
+{
+  factorsEratMedium_[checkExponent(exponent)] = getInBetween(0.0, factor, 9.0);
+}
+
+bool TuningProfile::load(const string& filename)
+{
+  ifstream file(filename.c_str());
+  if (!file)
+    return false;
+
+  TuningProfile profile;
+  int version = 0;
+  string line;
+
+  while (getline(file, line))
+  {
+    istringstream iss(line);
+    string key;
+    if (!(iss >> key) || key[0] == '#')
+      continue;
+
+    if (key == "version")
+      iss >> version;
+    else if (key == "l1d_cache_size")
+      iss >> profile.l1dCacheSize_;
+    else if (key == "l2_cache_size")
+      iss >> profile.l2CacheSize_;
+    else
+    {
+      int exponent = -1;
+      double value = -1;
+      if (!(iss >> exponent >> value) ||
+          exponent < 0 ||
+          exponent >= EXPONENTS ||
+          value < 0)
+        continue;
+
+      if (key == "sieve_size" && value >= 1)
+        profile.setSieveSize(exponent, static_cast<int>(value));
+      else if (key == "bucket_size" && value >= 1)
+        profile.setBucketSize(exponent, static_cast<int>(value));
+      else if (key == "factor_erat_small")
+        profile.setFactorEratSmall(exponent, value);
+      else if (key == "factor_erat_medium")
+        profile.setFactorEratMedium(exponent, value);
+    }
+  }
+
+  // the profile was created on a different CPU
+  if (version != FILE_VERSION ||
+      profile.l1dCacheSize_ != cpuInfo().l1dCacheSize() ||
+      profile.l2CacheSize_ != cpuInfo().l2CacheSize())
+    return false;
+
+  *this = profile;
+  return true;
+}
+
+void TuningProfile::save(const string& filename) const
+{
+  ofstream file(filename.c_str());
+  if (!file)
+    throw primesieve_error("failed to write tuning profile " + filename);
+
+  file << "# primesieve tuning profile, created using primesieve --tune" << endl;
+  file << "version " << FILE_VERSION << endl;
+  file << "l1d_cache_size " << l1dCacheSize_ << endl;
+  file << "l2_cache_size " << l2CacheSize_ << endl;
+  file << "# <setting> <exponent> <value>, used for stop >= 10^exponent" << endl;
+
+  for (int i = 0; i < EXPONENTS; i++)
+  {
+    if (sieveSizes_[i] != 0)
+      file << "sieve_size " << i << " " << sieveSizes_[i] << endl;
+    if (bucketSizes_[i] != 0)
+      file << "bucket_size " << i << " " << bucketSizes_[i] << endl;
+    if (factorsEratSmall_[i] >= 0)
+      file << "factor_erat_small " << i << " " << factorsEratSmall_[i] << endl;
+    if (factorsEratMedium_[i] >= 0)
+      file << "factor_erat_medium " << i << " " << factorsEratMedium_[i] << endl;
+  }
+
+  if (!file)
+    throw primesieve_error("failed to write tuning profile " + filename);
+}
+
+/// For each range magnitude sieve the primes within
+/// [10^exponent, 10^exponent + TUNE_DISTANCE] using sieve sizes
+/// of 16 kilobytes and larger. The sieving time usually
+/// decreases up to the best sieve size and then increases again,
+/// so we stop once a sieve size is 20% slower than the best one.
+/// Then using the best sieve size the bucket size, the EratSmall
+/// factor and the EratMedium factor are tuned one after another.
+///
+void TuningProfile::tune(ostream* status)
+{
+  const double factorsEratSmall[4] = { 0.25, 0.5, 1.0, 1.5 };
+  const double factorsEratMedium[4] = { 1.5, 2.5, 4.0, 6.0 };
+  TuningProfile profile;
+
+  for (int exponent = MIN_EXPONENT; exponent <= MAX_EXPONENT; exponent += 2)
+  {
+    uint64_t start = ipow10(exponent);
+    uint64_t stop = start + TUNE_DISTANCE;
+    PrimeSieve ps;
+    ps.setBucketSize(config::BUCKETSIZE);
+    ps.setFactorEratSmall(config::FACTOR_ERATSMALL);
+    ps.setFactorEratMedium(config::FACTOR_ERATMEDIUM);
+    int bestSieveSize = 0;
+    double bestSeconds = 0;
+
+    for (int sieveSize = 16; sieveSize <= 2048; sieveSize *= 2)
+    {
+      ps.setSieveSize(sieveSize);
+      double seconds = benchmark(ps, start, stop);
+      printStatus(status, exponent, "sieve size", sieveSize, seconds);
+
+      if (bestSieveSize == 0 || seconds < bestSeconds)
+      {
+        bestSieveSize = sieveSize;
+        bestSeconds = seconds;
+      }
+      else if (seconds > bestSeconds * 1.2)
+        break;
+    }
+
+    ps.setSieveSize(bestSieveSize);
+    int bestBucketSize = 0;
+    bestSeconds = 0;
+
+    for (int bucketSize = config::MIN_BUCKETSIZE; bucketSize <= config::MAX_BUCKETSIZE; bucketSize *= 2)
+    {
+      ps.setBucketSize(bucketSize);
+      double seconds = benchmark(ps, start, stop);
+      printStatus(status, exponent, "bucket size", bucketSize, seconds);
+
+      if (bestBucketSize == 0 || seconds < bestSeconds)
+      {
+        bestBucketSize = bucketSize;
+        bestSeconds = seconds;
+      }
+    }
+
+    ps.setBucketSize(bestBucketSize);
+    double bestFactorEratSmall = -1;
+    bestSeconds = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+      ps.setFactorEratSmall(factorsEratSmall[i]);
+      double seconds = benchmark(ps, start, stop);
+      printStatus(status, exponent, "EratSmall factor", factorsEratSmall[i], seconds);
+
+      if (bestFactorEratSmall < 0 || seconds < bestSeconds)
+      {
+        bestFactorEratSmall = factorsEratSmall[i];
+        bestSeconds = seconds;
+      }
+    }
+
+    ps.setFactorEratSmall(bestFactorEratSmall);
+    double bestFactorEratMedium = -1;
+    bestSeconds = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+      ps.setFactorEratMedium(factorsEratMedium[i]);
+      double seconds = benchmark(ps, start, stop);
+      printStatus(status, exponent, "EratMedium factor", factorsEratMedium[i], seconds);
+
+      if (bestFactorEratMedium < 0 || seconds < bestSeconds)
+      {
+        bestFactorEratMedium = factorsEratMedium[i];
+        bestSeconds = seconds;
+      }
+    }
+
+    profile.setSieveSize(exponent, bestSieveSize);
+    profile.setBucketSize(exponent, bestBucketSize);
+    profile.setFactorEratSmall(exponent, bestFactorEratSmall);
+    profile.setFactorEratMedium(exponent, bestFactorEratMedium);
+
+    if (status)
+    {
+      ostringstream best;
+      best << "best: sieve size " << bestSieveSize << " KB"
+           << ", bucket size " << bestBucketSize
+           << ", EratSmall factor " << bestFactorEratSmall
+           << ", EratMedium factor " << bestFactorEratMedium;
+      *status << "10^" << left << setw(4) << exponent << best.str() << endl;
+    }
+  }
+
+  *this = profile;
+}
+
+string TuningProfile::getDefaultFilename()
+{
+  const char* filename = getenv("PRIMESIEVE_TUNING_FILE");
+  if (filename && *filename)
+    return filename;
+
+#if defined(_WIN32)
+  const char* dir = getenv("APPDATA");
+  if (dir && *dir)
+    return string(dir) + "\\primesieve_tuning.txt";
+#else
+  const char* dir = getenv("HOME");
+  if (dir && *dir)
+    return string(dir) + "/.primesieve_tuning";
+#endif
+
+  return string();
+}
+
+TuningProfile& tuningProfile()
+{
+  static TuningProfile profile(TuningProfile::getDefaultFilename());
+  return profile;
+}
+
+} // namespace primesieve
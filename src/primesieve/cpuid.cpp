@@ -0,0 +1,225 @@
+///
+/// @file   cpuid.cpp
+/// @brief  Runtime detection of CPU instruction set extensions using
+///         the CPUID and XGETBV instructions. The results are
+///         computed only once and then cached. Also used to
+///         detect the CPU's cache sizes.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primesieve/cpuid.hpp>
+#include <stdint.h>
+
+#if defined(PRIMESIEVE_X86) && defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+namespace {
+
+#if defined(PRIMESIEVE_X86)
+
+/// CPUID bits
+enum {
+  // %ebx bits, eax = 7
+  bit_AVX2    = 1 << 5,
+  bit_AVX512F = 1 << 16,
+  // %ecx bits, eax = 7
+  bit_AVX512_VPOPCNTDQ = 1 << 14,
+  // %ecx bits, eax = 1
+  bit_POPCNT  = 1 << 23,
+  bit_OSXSAVE = 1 << 27,
+  bit_AVX     = 1 << 28
+};
+
+/// XCR0 bits: the OS saves the YMM (and ZMM) registers
+/// on context switches.
+enum {
+  XSTATE_YMM = (1 << 1) | (1 << 2),
+  XSTATE_ZMM = XSTATE_YMM | (1 << 5) | (1 << 6) | (1 << 7)
+};
+
+void run_cpuid(int eax, int ecx, int* abcd)
+{
+#if defined(_MSC_VER)
+  __cpuidex(abcd, eax, ecx);
+#else
+  int ebx = 0;
+  int edx = 0;
+
+  #if defined(__i386__) && defined(__PIC__)
+    // in case of PIC under 32-bit EBX cannot be clobbered
+    __asm__ ("movl %%ebx, %%edi;"
+             "cpuid;"
+             "xchgl %%ebx, %%edi;"
+             : "=D" (ebx), "+a" (eax), "+c" (ecx), "=d" (edx));
+  #else
+    __asm__ ("cpuid;"
+             : "+b" (ebx), "+a" (eax), "+c" (ecx), "=d" (edx));
+  #endif
+
+  abcd[0] = eax;
+  abcd[1] = ebx;
+  abcd[2] = ecx;
+  abcd[3] = edx;
+#endif
+}
+
+/// Get the value of the XCR0 register, the caller
+/// must ensure that OSXSAVE is supported.
+///
+int get_xcr0()
+{
+#if defined(_MSC_VER)
+  return static_cast<int>(_xgetbv(0));
+#else
+  int eax, edx;
+  __asm__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+  return eax;
+#endif
+}
+
+/// @return XCR0 & state or 0 if the
+///         OS does not support XSAVE.
+///
+int get_os_xstate(int state)
+{
+  int abcd[4];
+  run_cpuid(1, 0, abcd);
+
+  int bits = bit_OSXSAVE | bit_AVX;
+  if ((abcd[2] & bits) != bits)
+    return 0;
+
+  return get_xcr0() & state;
+}
+
+bool cpuid_popcnt()
+{
+  int abcd[4];
+  run_cpuid(1, 0, abcd);
+  return (abcd[2] & bit_POPCNT) == bit_POPCNT;
+}
+
+bool cpuid_avx2()
+{
+  int abcd[4];
+  run_cpuid(0, 0, abcd);
+  if (abcd[0] < 7)
+    return false;
+
+  if (get_os_xstate(XSTATE_YMM) != XSTATE_YMM)
+    return false;
+
+  run_cpuid(7, 0, abcd);
+  return (abcd[1] & bit_AVX2) == bit_AVX2;
+}
+
+bool cpuid_avx512()
+{
+  int abcd[4];
+  run_cpuid(0, 0, abcd);
+  if (abcd[0] < 7)
+    return false;
+
+  if (get_os_xstate(XSTATE_ZMM) != XSTATE_ZMM)
+    return false;
+
+  run_cpuid(7, 0, abcd);
+  return (abcd[1] & bit_AVX512F) == bit_AVX512F;
+}
+
+bool cpuid_avx512_vpopcnt()
+{
+  if (!cpuid_avx512())
+    return false;
+
+  int abcd[4];
+  run_cpuid(7, 0, abcd);
+  return (abcd[2] & bit_AVX512_VPOPCNTDQ) == bit_AVX512_VPOPCNTDQ;
+}
+
+/// Iterate over the subleafs of the deterministic cache
+/// parameters leaf until the cache type is 0 (no more caches).
+/// @return Size of the data or unified cache of
+///         the given level in bytes or 0.
+///
+uint64_t cpuid_cache_size(unsigned leaf, int level)
+{
+  int abcd[4];
+  run_cpuid(static_cast<int>(leaf & 0x80000000u), 0, abcd);
+  if (static_cast<unsigned>(abcd[0]) < leaf)
+    return 0;
+
+  for (int i = 0; i < 16; i++)
+  {
+    run_cpuid(static_cast<int>(leaf), i, abcd);
+    int type = abcd[0] & 31;
+    if (type == 0)
+      break;
+
+    // 1 = data cache, 3 = unified cache
+    if ((type == 1 || type == 3) &&
+        ((abcd[0] >> 5) & 7) == level)
+    {
+      uint64_t ways = ((abcd[1] >> 22) & 0x3ff) + 1;
+      uint64_t partitions = ((abcd[1] >> 12) & 0x3ff) + 1;
+      uint64_t lineSize = (abcd[1] & 0xfff) + 1;
+      uint64_t sets = static_cast<uint64_t>(static_cast<unsigned>(abcd[2])) + 1;
+      return ways * partitions * lineSize * sets;
+    }
+  }
+
+  return 0;
+}
+
+#else
+
+bool cpuid_popcnt() { return false; }
+bool cpuid_avx2()   { return false; }
+bool cpuid_avx512() { return false; }
+bool cpuid_avx512_vpopcnt() { return false; }
+uint64_t cpuid_cache_size(unsigned, int) { return 0; }
+
+#endif
+
+} // namespace
+
+namespace primesieve {
+
+bool has_cpuid_popcnt()
+{
+  static const bool popcnt = cpuid_popcnt();
+  return popcnt;
+}
+
+bool has_cpuid_avx2()
+{
+  static const bool avx2 = cpuid_avx2();
+  return avx2;
+}
+
+bool has_cpuid_avx512()
+{
+  static const bool avx512 = cpuid_avx512();
+  return avx512;
+}
+
+bool has_cpuid_avx512_vpopcnt()
+{
+  static const bool avx512_vpopcnt = cpuid_avx512_vpopcnt();
+  return avx512_vpopcnt;
+}
+
+uint64_t get_cpuid_cache_size(int level)
+{
+  uint64_t size = cpuid_cache_size(0x4u, level);
+  if (size == 0)
+    size = cpuid_cache_size(0x8000001Du, level);
+  return size;
+}
+
+} // namespace primesieve
@@ -0,0 +1,179 @@
+///
+/// @file   decodePrimes.cpp
+/// @brief  Reconstruct the primes from the 1 bits of a sieve array.
+///         The portable decoder extracts one prime per bit using
+///         count trailing zeros and a 64 entry lookup table, the
+///         AVX-512 decoder uses VPCOMPRESSQ to expand each sieve
+///         byte into up to 8 primes at once. The fastest decoder
+///         supported by the CPU is selected at startup.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primesieve/config.hpp>
+#include <primesieve/decodePrimes.hpp>
+#include <primesieve/littleendian_cast.hpp>
+#include <primesieve/cpuid.hpp>
+
+#include <stdint.h>
+#include <cstddef>
+
+#if defined(HAS_TARGET_AVX512)
+  #include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64)
+  #include <intrin.h>
+#endif
+
+namespace {
+
+using primesieve::byte_t;
+
+/// bitValues[i] = number corresponding to the i-th bit of a
+/// 64-bit sieve word, i.e. (i / 8) * 30 + { 7, 11, ..., 31 }[i % 8]
+///
+const uint64_t bitValues[64] =
+{
+    7,  11,  13,  17,  19,  23,  29,  31,
+   37,  41,  43,  47,  49,  53,  59,  61,
+   67,  71,  73,  77,  79,  83,  89,  91,
+   97, 101, 103, 107, 109, 113, 119, 121,
+  127, 131, 133, 137, 139, 143, 149, 151,
+  157, 161, 163, 167, 169, 173, 179, 181,
+  187, 191, 193, 197, 199, 203, 209, 211,
+  217, 221, 223, 227, 229, 233, 239, 241
+};
+
+/// Bit position of the first set bit, compiles to a single
+/// bsf or tzcnt instruction on x86.
+/// @pre x != 0
+///
+inline uint64_t bitScanForward(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanForward64(&index, x);
+  return index;
+#else
+  // De Bruijn bitscan
+  static const uint64_t debruijnIndex[64] =
+  {
+     0, 47,  1, 56, 48, 27,  2, 60,
+    57, 49, 41, 37, 28, 16,  3, 61,
+    54, 58, 35, 52, 50, 42, 21, 44,
+    38, 32, 29, 23, 17, 11,  4, 62,
+    46, 55, 26, 59, 40, 36, 15, 53,
+    34, 51, 20, 43, 31, 22, 10, 45,
+    25, 39, 14, 33, 19, 30,  9, 24,
+    13, 18,  8, 12,  7,  6,  5, 63
+  };
+  uint64_t debruijn64 = UINT64_C(0x03f79d71b4cb0a89);
+  return debruijnIndex[((x ^ (x - 1)) * debruijn64) >> 58];
+#endif
+}
+
+std::size_t decodeDefault(const byte_t* sieve, std::size_t words, uint64_t base, uint64_t* primes)
+{
+  std::size_t n = 0;
+
+  for (std::size_t i = 0; i < words; i++, base += 30 * 8)
+  {
+    uint64_t bits = primesieve::littleendian_cast<uint64_t>(&sieve[i * 8]);
+    while (bits != 0)
+    {
+      primes[n++] = base + bitValues[bitScanForward(bits)];
+      bits &= bits - 1;
+    }
+  }
+
+  return n;
+}
+
+#if defined(HAS_TARGET_AVX512)
+
+/// Number of 1 bits of each byte value
+const byte_t byteCounts[256] =
+{
+  0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+  1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
+  1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
+  2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+  1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
+  2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+  2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+  3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
+  1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
+  2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+  2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+  3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
+  2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
+  3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
+  3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
+  4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8
+};
+
+/// Each sieve byte is used as the mask of VPCOMPRESSQ which
+/// packs the (up to 8) primes of the byte into the lower lanes
+/// of a ZMM register. All 8 lanes are stored, the lanes beyond
+/// the primes are overwritten by the next byte.
+///
+TARGET_AVX512
+std::size_t decodeAvx512(const byte_t* sieve, std::size_t words, uint64_t base, uint64_t* primes)
+{
+  std::size_t n = 0;
+  std::size_t bytes = words * 8;
+  __m512i next = _mm512_set1_epi64(30);
+  __m512i values = _mm512_setr_epi64(7, 11, 13, 17, 19, 23, 29, 31);
+  values = _mm512_add_epi64(values, _mm512_set1_epi64(static_cast<long long>(base)));
+
+  for (std::size_t i = 0; i < bytes; i++)
+  {
+    byte_t bits = sieve[i];
+    __m512i vprimes = _mm512_maskz_compress_epi64(static_cast<__mmask8>(bits), values);
+    _mm512_storeu_si512(&primes[n], vprimes);
+    n += byteCounts[bits];
+    values = _mm512_add_epi64(values, next);
+  }
+
+  return n;
+}
+
+#endif
+
+typedef std::size_t (*decodePrimes_t)(const byte_t*, std::size_t, uint64_t, uint64_t*);
+
+/// Select the fastest decoder supported by the CPU
+decodePrimes_t selectDecoder()
+{
+#if defined(HAS_TARGET_AVX512)
+  if (primesieve::has_cpuid_avx512())
+    return decodeAvx512;
+#endif
+  return decodeDefault;
+}
+
+/// The decoder is selected only once, on first use
+/// (also from other static initializers).
+///
+decodePrimes_t decoder()
+{
+  static const decodePrimes_t function = selectDecoder();
+  return function;
+}
+
+} // namespace
+
+namespace primesieve {
+
+std::size_t decodePrimes(const byte_t* sieve, std::size_t words, uint64_t base, uint64_t* primes)
+{
+  return decoder()(sieve, words, base, primes);
+}
+
+} // namespace primesieve
@@ -8,6 +8,7 @@
 ///
 
 #include <primesieve/config.hpp>
+#include <primesieve/CpuInfo.hpp>
 #include <primesieve/pmath.hpp>
 #include <primesieve/PrimeFinder.hpp>
 #include <primesieve.hpp>
@@ -93,6 +94,8 @@ uint64_t iterator::get_interval_size(uint64_t n)
 {
   n = (n > 10) ? n : 10;
   uint64_t cache_size = config::ITERATOR_CACHE_SMALL;
+  if (cpuInfo().hasL3Cache())
+    cache_size = getInBetween<uint64_t>(1 << 20, cpuInfo().l3CacheSizePerThread(), cache_size);
 
   if (tiny_cache_size_ < cache_size)
   {
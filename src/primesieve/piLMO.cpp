@@ -0,0 +1,457 @@
+///
+/// @file   piLMO.cpp
+/// @brief  Count the primes <= x using the Lagarias-Miller-Odlyzko
+///         algorithm, a refinement of the Meissel-Lehmer method:
+///
+///         pi(x) = S1 + S2 + pi(y) - 1 - P2(x, y)
+///
+///         with y = alpha * x^(1/3). S1 + S2 = phi(x, pi(y)) is the
+///         sum of the ordinary and special leaves of the recursive
+///         phi(x, a) formula. The special leaves are computed using
+///         a segmented sieve of Eratosthenes over [1, x / y] and a
+///         binary indexed tree (counts the unsieved numbers), P2(x, y)
+///         uses PrimeSieve to count the primes up to x / y. The
+///         total run time is O(x^(2/3) / log x) operations.
+///
+/// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
+///
+/// This file is distributed under the BSD License. See the COPYING
+/// file in the top level directory.
+///
+
+#include <primesieve/config.hpp>
+#include <primesieve/piLMO.hpp>
+#include <primesieve/PrimeSieve.hpp>
+#include <primesieve/Callback.hpp>
+#include <primesieve/pmath.hpp>
+#include <primesieve.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+using namespace primesieve;
+
+/// Integer cube root
+uint64_t icbrt(uint64_t x)
+{
+  uint64_t r = static_cast<uint64_t>(std::pow(static_cast<double>(x), 1.0 / 3.0));
+
+  while (r > 0 && r * r * r > x)
+    r--;
+  // cbrt(2^64 - 1) < 2642246
+  while (r < 2642245 && (r + 1) * (r + 1) * (r + 1) <= x)
+    r++;
+
+  return r;
+}
+
+/// Count the primes <= x using the sieve of Eratosthenes
+uint64_t pi_sieve(uint64_t x)
+{
+  PrimeSieve ps;
+  ps.sieve(0, x, PrimeSieve::COUNT_PRIMES);
+  return ps.getPrimeCount();
+}
+
+/// alpha is a tuning factor which balances the computation of
+/// the special leaves (S2) and P2(x, y). With larger alpha
+/// there are more special leaves but less numbers to sieve.
+///
+double getAlpha(uint64_t x)
+{
+  double logx = std::log(static_cast<double>(x));
+  double alpha = logx / 8;
+  double x16 = std::pow(static_cast<double>(x), 1.0 / 6.0);
+
+  return getInBetween(1.0, alpha, x16);
+}
+
+/// phi(x, c) counts the numbers <= x that are not divisible
+/// by any of the first c primes. For tiny c phi(x, c) is
+/// calculated in O(1) using the periodicity of its values
+/// modulo primorial(c).
+///
+class PhiTiny
+{
+public:
+  PhiTiny(const std::vector<uint32_t>& primes, std::size_t c) :
+    primorial_(1),
+    totient_(1)
+  {
+    for (std::size_t i = 1; i <= c; i++)
+    {
+      primorial_ *= primes[i];
+      totient_ *= primes[i] - 1;
+    }
+
+    phi_.resize(static_cast<std::size_t>(primorial_));
+    uint32_t count = 0;
+
+    for (uint64_t n = 0; n < primorial_; n++)
+    {
+      bool coprime = (n > 0);
+      for (std::size_t i = 1; i <= c && coprime; i++)
+        coprime = (n % primes[i] != 0);
+      count += coprime;
+      phi_[static_cast<std::size_t>(n)] = count;
+    }
+  }
+  uint64_t phi(uint64_t x) const
+  {
+    return (x / primorial_) * totient_ + phi_[static_cast<std::size_t>(x % primorial_)];
+  }
+private:
+  uint64_t primorial_;
+  uint64_t totient_;
+  std::vector<uint32_t> phi_;
+};
+
+/// Binary indexed tree (Fenwick tree) which counts the
+/// unsieved numbers of a sieve segment in O(log n).
+///
+class CountTree
+{
+public:
+  CountTree(std::size_t size) :
+    tree_(size + 1),
+    size_(0)
+  { }
+  void init(const byte_t* sieve, std::size_t size)
+  {
+    size_ = size;
+    tree_[0] = 0;
+    for (std::size_t i = 0; i < size; i++)
+      tree_[i + 1] = sieve[i];
+    for (std::size_t i = 1; i <= size; i++)
+    {
+      std::size_t j = i + (i & (0 - i));
+      if (j <= size)
+        tree_[j] += tree_[i];
+    }
+  }
+  /// Remove the number at position pos
+  void remove(std::size_t pos)
+  {
+    for (std::size_t i = pos + 1; i <= size_; i += i & (0 - i))
+      tree_[i]--;
+  }
+  /// Count the unsieved numbers within [0, pos]
+  uint64_t count(std::size_t pos) const
+  {
+    uint64_t sum = 0;
+    for (std::size_t i = pos + 1; i > 0; i &= i - 1)
+      sum += tree_[i];
+    return sum;
+  }
+private:
+  std::vector<uint32_t> tree_;
+  std::size_t size_;
+};
+
+/// Calculate the ordinary leaves:
+/// S1 = \sum_{n <= y, lpf(n) > p_c} mu(n) * phi(x / n, c)
+///
+uint64_t S1(uint64_t x,
+            uint64_t y,
+            std::size_t c,
+            const std::vector<uint32_t>& primes,
+            const std::vector<uint32_t>& lpf,
+            const std::vector<signed char>& mu)
+{
+  PhiTiny phiTiny(primes, c);
+  uint64_t s1 = 0;
+
+  for (uint64_t n = 1; n <= y; n++)
+  {
+    std::size_t i = static_cast<std::size_t>(n);
+    if (mu[i] != 0 && lpf[i] > primes[c])
+    {
+      // all sums are computed modulo 2^64, the final
+      // result pi(x) < 2^64 is nevertheless exact
+      if (mu[i] > 0)
+        s1 += phiTiny.phi(x / n);
+      else
+        s1 -= phiTiny.phi(x / n);
+    }
+  }
+
+  return s1;
+}
+
+/// Calculate the special leaves:
+/// S2 = \sum_{b = c+1}^{pi(y)-1} \sum_{y/p_b < m <= y, lpf(m) > p_b}
+///      -mu(m) * phi(x / (p_b * m), b - 1)
+///
+/// phi(x / (p_b * m), b - 1) is the number of unsieved numbers
+/// <= x / (p_b * m) after sieving with the first b - 1 primes.
+/// This is computed by sieving the interval [1, x / y] using a
+/// segmented sieve of Eratosthenes, the special leaves are
+/// processed segment by segment.
+///
+uint64_t S2(uint64_t x,
+            uint64_t y,
+            std::size_t c,
+            const std::vector<uint32_t>& primes,
+            const std::vector<uint32_t>& lpf,
+            const std::vector<signed char>& mu)
+{
+  uint64_t limit = x / y + 1;
+  uint64_t segmentSize = std::max<uint64_t>(64, isqrt(limit));
+  segmentSize = floorPowerOf2(segmentSize * 2 - 1);
+  std::size_t piY = primes.size() - 1;
+  uint64_t s2 = 0;
+
+  std::vector<byte_t> sieve(static_cast<std::size_t>(segmentSize));
+  std::vector<uint64_t> next(primes.begin(), primes.end());
+  std::vector<uint64_t> phi(primes.size(), 0);
+  CountTree tree(static_cast<std::size_t>(segmentSize));
+
+  for (uint64_t low = 1; low < limit; low += segmentSize)
+  {
+    uint64_t high = std::min(low + segmentSize, limit);
+    std::size_t size = static_cast<std::size_t>(high - low);
+    std::fill(sieve.begin(), sieve.begin() + size, 1);
+    std::size_t b = 1;
+
+    // phi(y, b) with b <= c does not contribute to S2 (S1
+    // contains these leaves), so we simply sieve out the
+    // multiples of the first c primes
+    for (; b <= c; b++)
+    {
+      uint64_t prime = primes[b];
+      uint64_t k = next[b];
+      for (; k < high; k += prime)
+        sieve[static_cast<std::size_t>(k - low)] = 0;
+      next[b] = k;
+    }
+
+    tree.init(&sieve[0], size);
+
+    for (; b < piY; b++)
+    {
+      uint64_t prime = primes[b];
+      uint64_t xp = x / prime;
+      uint64_t minM = std::max(xp / high, y / prime);
+      uint64_t maxM = std::min(xp / low, y);
+
+      // no special leaves for the
+      // remaining primes in this segment
+      if (prime >= maxM)
+        break;
+
+      if (prime * prime <= y)
+      {
+        for (uint64_t m = maxM; m > minM; m--)
+        {
+          std::size_t i = static_cast<std::size_t>(m);
+          if (mu[i] != 0 && prime < lpf[i])
+          {
+            uint64_t xpm = xp / m;
+            uint64_t phiXpm = phi[b] + tree.count(static_cast<std::size_t>(xpm - low));
+            if (mu[i] > 0)
+              s2 -= phiXpm;
+            else
+              s2 += phiXpm;
+          }
+        }
+      }
+      else
+      {
+        // if prime > sqrt(y) all m <= y with lpf(m) > prime
+        // and mu(m) != 0 are primes, mu(m) = -1
+        minM = std::max(minM, prime);
+        std::vector<uint32_t>::const_iterator first =
+            std::upper_bound(primes.begin() + b, primes.end(), minM);
+        std::vector<uint32_t>::const_iterator last =
+            std::upper_bound(first, primes.end(), maxM);
+
+        for (; first != last; ++first)
+        {
+          uint64_t xpm = xp / *first;
+          s2 += phi[b] + tree.count(static_cast<std::size_t>(xpm - low));
+        }
+      }
+
+      phi[b] += tree.count(size - 1);
+
+      // cross off the multiples of prime
+      uint64_t k = next[b];
+      for (; k < high; k += prime)
+      {
+        std::size_t i = static_cast<std::size_t>(k - low);
+        if (sieve[i])
+        {
+          sieve[i] = 0;
+          tree.remove(i);
+        }
+      }
+      next[b] = k;
+    }
+  }
+
+  return s2;
+}
+
+/// Sums pi(x / p) for the primes y < p <= sqrt(x) while
+/// the primes up to x / y are generated in ascending order.
+///
+class P2Callback : public BatchCallback
+{
+public:
+  P2Callback(PrimeSieve& ps, uint64_t x, uint64_t y, uint64_t sqrtx, uint64_t pix) :
+    ps_(ps),
+    it_(sqrtx + 1, y),
+    x_(x),
+    y_(y),
+    pix_(pix),
+    sum_(0)
+  {
+    prime_ = it_.previous_prime();
+    target_ = (prime_ > y_) ? x_ / prime_ : 0;
+  }
+  void callback(const uint64_t* primes, std::size_t count, int)
+  {
+    uint64_t last = primes[count - 1];
+
+    while (prime_ > y_ && target_ <= last)
+    {
+      const uint64_t* pos = std::upper_bound(primes, primes + count, target_);
+      sum_ += pix_ + (pos - primes);
+      next();
+    }
+
+    pix_ += count;
+    if (prime_ <= y_)
+      ps_.stop();
+  }
+  /// Add pi(x / p) for the remaining primes p
+  uint64_t finish()
+  {
+    while (prime_ > y_)
+    {
+      sum_ += pix_;
+      next();
+    }
+    return sum_;
+  }
+private:
+  PrimeSieve& ps_;
+  iterator it_;
+  uint64_t x_;
+  uint64_t y_;
+  uint64_t prime_;
+  uint64_t target_;
+  uint64_t pix_;
+  uint64_t sum_;
+  void next()
+  {
+    prime_ = it_.previous_prime();
+    if (prime_ > y_)
+      target_ = x_ / prime_;
+  }
+};
+
+/// 2nd partial sieve function, counts the numbers <= x
+/// that have exactly 2 prime factors each > y:
+/// P2(x, y) = \sum_{i = a+1}^{b} pi(x / p_i) - pi(p_i) + 1
+/// with a = pi(y), b = pi(sqrt(x)).
+///
+uint64_t P2(uint64_t x, uint64_t y, uint64_t piY)
+{
+  uint64_t sqrtx = isqrt(x);
+  if (y >= sqrtx)
+    return 0;
+
+  uint64_t piSqrtx = pi_sieve(sqrtx);
+  uint64_t stop = x / (y + 1);
+  PrimeSieve ps;
+  P2Callback p2(ps, x, y, sqrtx, piSqrtx);
+  ps.callbackPrimes(sqrtx + 1, stop, &p2);
+
+  uint64_t sum = p2.finish();
+  uint64_t a = piY;
+  uint64_t b = piSqrtx;
+
+  // \sum_{i = a+1}^{b} (i - 1)
+  sum -= (b - a) * (a + b - 1) / 2;
+
+  return sum;
+}
+
+} // namespace
+
+namespace primesieve {
+
+uint64_t piLMO(uint64_t x)
+{
+  return piLMO(x, getAlpha(x));
+}
+
+uint64_t piLMO(uint64_t x, double alpha)
+{
+  // below this limit sieving is faster
+  if (x < 100000)
+    return pi_sieve(x);
+
+  uint64_t x13 = icbrt(x);
+  uint64_t y = static_cast<uint64_t>(x13 * alpha);
+  y = getInBetween(x13, y, isqrt(x));
+
+  std::vector<uint32_t> primes(1, 0);
+  generate_primes(y, &primes);
+  std::size_t piY = primes.size() - 1;
+  std::size_t c = std::min<std::size_t>(piY, 6);
+
+  // Moebius function and least prime factor of n <= y
+  std::vector<signed char> mu(static_cast<std::size_t>(y + 1), 1);
+  std::vector<uint32_t> lpf(static_cast<std::size_t>(y + 1), 0);
+  lpf[1] = 0xffffffffu;
+
+  for (std::size_t b = 1; b <= piY; b++)
+  {
+    uint64_t prime = primes[b];
+    uint64_t square = prime * prime;
+    for (uint64_t n = prime; n <= y; n += prime)
+    {
+      std::size_t i = static_cast<std::size_t>(n);
+      mu[i] = static_cast<signed char>(-mu[i]);
+      if (lpf[i] == 0)
+        lpf[i] = primes[b];
+    }
+    for (uint64_t n = square; n <= y; n += square)
+      mu[static_cast<std::size_t>(n)] = 0;
+  }
+
+  uint64_t phi = S1(x, y, c, primes, lpf, mu) +
+                 S2(x, y, c, primes, lpf, mu);
+
+  return phi + piY - 1 - P2(x, y, piY);
+}
+
+/// piLMO(x) is about as fast as sieving an interval of size
+/// 24 * x^(2/3) (measured), piLMO() is used if [start, stop]
+/// is large and start is small.
+///
+bool isPiLMOFaster(uint64_t start, uint64_t stop)
+{
+  if (start > stop ||
+      stop < config::PI_LMO_THRESHOLD)
+    return false;
+
+  double cost = 24 * std::pow(static_cast<double>(stop), 2.0 / 3.0);
+
+  // pi(start - 1) is either sieved or computed using piLMO()
+  if (start > config::PI_LMO_THRESHOLD)
+    cost += 24 * std::pow(static_cast<double>(start), 2.0 / 3.0);
+  else
+    cost += static_cast<double>(start);
+
+  return cost < static_cast<double>(stop - start);
+}
+
+} // namespace primesieve
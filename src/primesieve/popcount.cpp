@@ -1,7 +1,10 @@
 ///
 /// @file   popcount.cpp
-/// @brief  Fast algorithm to count the number of 1 bits in an array
-///         using only integer operations.
+/// @brief  Fast algorithms to count the number of 1 bits in an
+///         array: Harley-Seal using only integer operations, the
+///         POPCNT instruction, Harley-Seal using AVX2 and AVX-512
+///         VPOPCNTDQ. The fastest algorithm supported by the CPU
+///         is selected at startup.
 ///
 /// Copyright (C) 2015 Kim Walisch, <kim.walisch@gmail.com>
 ///
@@ -13,7 +16,18 @@
   #define __STDC_CONSTANT_MACROS
 #endif
 
+#include <primesieve/popcount.hpp>
+#include <primesieve/cpuid.hpp>
+
 #include <stdint.h>
+#include <algorithm>
+#include <cstddef>
+
+#if defined(HAS_TARGET_POPCNT) || \
+    defined(HAS_TARGET_AVX2) || \
+    defined(HAS_TARGET_AVX512_VPOPCNT)
+  #include <immintrin.h>
+#endif
 
 namespace {
 
@@ -45,9 +59,6 @@ void CSA(uint64_t& h, uint64_t& l, uint64_t a, uint64_t b, uint64_t c)
   l = u ^ c;
 }
 
-} // namespace
-
-namespace primesieve {
 
 /// Harley-Seal popcount (4th iteration).
 /// The Harley-Seal popcount algorithm is one of the fastest algorithms
@@ -55,7 +66,7 @@ namespace primesieve {
 /// This implementation uses only 5.69 instructions per 64-bit word.
 /// @see Chapter 5 in "Hacker's Delight" 2nd edition.
 ///
-uint64_t popcount(const uint64_t* array, uint64_t size)
+uint64_t popcountDefault(const uint64_t* array, uint64_t size)
 {
   uint64_t total = 0;
   uint64_t ones = 0, twos = 0, fours = 0, eights = 0, sixteens = 0;
@@ -96,4 +107,261 @@ uint64_t popcount(const uint64_t* array, uint64_t size)
   return total;
 }
 
+#if defined(HAS_TARGET_POPCNT)
+
+TARGET_POPCNT
+inline uint64_t popcnt64(uint64_t x)
+{
+#if defined(__x86_64__) || defined(_M_X64)
+  return _mm_popcnt_u64(x);
+#else
+  return _mm_popcnt_u32(static_cast<uint32_t>(x)) +
+         _mm_popcnt_u32(static_cast<uint32_t>(x >> 32));
+#endif
+}
+
+/// Uses 4 independent sums to work around the false
+/// dependency of POPCNT on its destination register
+/// of some Intel CPUs.
+///
+TARGET_POPCNT
+uint64_t popcountPopcnt(const uint64_t* array, uint64_t size)
+{
+  uint64_t sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+  uint64_t limit = size - size % 4;
+  uint64_t i = 0;
+
+  for (; i < limit; i += 4)
+  {
+    sum0 += popcnt64(array[i+0]);
+    sum1 += popcnt64(array[i+1]);
+    sum2 += popcnt64(array[i+2]);
+    sum3 += popcnt64(array[i+3]);
+  }
+
+  for (; i < size; i++)
+    sum0 += popcnt64(array[i]);
+
+  return (sum0 + sum1) + (sum2 + sum3);
+}
+
+#endif
+
+#if defined(HAS_TARGET_AVX2)
+
+/// Count the 1 bits of each byte using a 4-bit lookup
+/// table (pshufb) and sum the bytes of each 64-bit lane.
+/// @see http://0x80.pl/articles/sse-popcount.html
+///
+TARGET_AVX2
+inline __m256i popcount256(__m256i v)
+{
+  const __m256i lookup = _mm256_setr_epi8(
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  __m256i lo = _mm256_and_si256(v, low_mask);
+  __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+  __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                _mm256_shuffle_epi8(lookup, hi));
+  return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+TARGET_AVX2
+inline void CSA256(__m256i& h, __m256i& l, __m256i a, __m256i b, __m256i c)
+{
+  __m256i u = _mm256_xor_si256(a, b);
+  h = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+  l = _mm256_xor_si256(u, c);
+}
+
+/// Harley-Seal popcount using 256-bit vectors, processes
+/// 16 vectors (64 words) per iteration.
+///
+TARGET_AVX2
+uint64_t popcountAvx2(const uint64_t* array, uint64_t size)
+{
+  const __m256i* data = reinterpret_cast<const __m256i*>(array);
+  __m256i total = _mm256_setzero_si256();
+  __m256i ones = _mm256_setzero_si256();
+  __m256i twos = _mm256_setzero_si256();
+  __m256i fours = _mm256_setzero_si256();
+  __m256i eights = _mm256_setzero_si256();
+  __m256i sixteens = _mm256_setzero_si256();
+  __m256i twosA, twosB, foursA, foursB, eightsA, eightsB;
+  uint64_t vectors = size / 4;
+  uint64_t limit = vectors - vectors % 16;
+  uint64_t i = 0;
+
+  for (; i < limit; i += 16)
+  {
+    CSA256(twosA, ones, ones, _mm256_loadu_si256(data+i+0), _mm256_loadu_si256(data+i+1));
+    CSA256(twosB, ones, ones, _mm256_loadu_si256(data+i+2), _mm256_loadu_si256(data+i+3));
+    CSA256(foursA, twos, twos, twosA, twosB);
+    CSA256(twosA, ones, ones, _mm256_loadu_si256(data+i+4), _mm256_loadu_si256(data+i+5));
+    CSA256(twosB, ones, ones, _mm256_loadu_si256(data+i+6), _mm256_loadu_si256(data+i+7));
+    CSA256(foursB, twos, twos, twosA, twosB);
+    CSA256(eightsA, fours, fours, foursA, foursB);
+    CSA256(twosA, ones, ones, _mm256_loadu_si256(data+i+8), _mm256_loadu_si256(data+i+9));
+    CSA256(twosB, ones, ones, _mm256_loadu_si256(data+i+10), _mm256_loadu_si256(data+i+11));
+    CSA256(foursA, twos, twos, twosA, twosB);
+    CSA256(twosA, ones, ones, _mm256_loadu_si256(data+i+12), _mm256_loadu_si256(data+i+13));
+    CSA256(twosB, ones, ones, _mm256_loadu_si256(data+i+14), _mm256_loadu_si256(data+i+15));
+    CSA256(foursB, twos, twos, twosA, twosB);
+    CSA256(eightsB, fours, fours, foursA, foursB);
+    CSA256(sixteens, eights, eights, eightsA, eightsB);
+
+    total = _mm256_add_epi64(total, popcount256(sixteens));
+  }
+
+  total = _mm256_slli_epi64(total, 4);
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(eights), 3));
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(fours), 2));
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(twos), 1));
+  total = _mm256_add_epi64(total, popcount256(ones));
+
+  for (; i < vectors; i++)
+    total = _mm256_add_epi64(total, popcount256(_mm256_loadu_si256(data+i)));
+
+  uint64_t lanes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), total);
+  uint64_t sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+  for (i *= 4; i < size; i++)
+    sum += popcount_mul(array[i]);
+
+  return sum;
+}
+
+#endif
+
+#if defined(HAS_TARGET_AVX512_VPOPCNT)
+
+TARGET_AVX512_VPOPCNT
+uint64_t popcountAvx512(const uint64_t* array, uint64_t size)
+{
+  __m512i sum0 = _mm512_setzero_si512();
+  __m512i sum1 = _mm512_setzero_si512();
+  uint64_t limit = size - size % 16;
+  uint64_t i = 0;
+
+  for (; i < limit; i += 16)
+  {
+    sum0 = _mm512_add_epi64(sum0, _mm512_popcnt_epi64(_mm512_loadu_si512(&array[i+0])));
+    sum1 = _mm512_add_epi64(sum1, _mm512_popcnt_epi64(_mm512_loadu_si512(&array[i+8])));
+  }
+
+  // the last 0 - 15 words, masked loads do not
+  // read beyond the end of the array
+  for (; i < size; i += 8)
+  {
+    __mmask8 mask = static_cast<__mmask8>(0xff >> (8 - std::min<uint64_t>(size - i, 8)));
+    sum0 = _mm512_add_epi64(sum0, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(mask, &array[i])));
+  }
+
+  uint64_t lanes[8];
+  _mm512_storeu_si512(lanes, _mm512_add_epi64(sum0, sum1));
+  uint64_t sum = 0;
+  for (int j = 0; j < 8; j++)
+    sum += lanes[j];
+
+  return sum;
+}
+
+#endif
+
+typedef uint64_t (*popcount_t)(const uint64_t*, uint64_t);
+
+/// @return The popcount function of the given
+///         algorithm or NULL if not supported.
+///
+popcount_t getFunction(int algorithm)
+{
+  switch (algorithm)
+  {
+    case primesieve::POPCOUNT_DEFAULT:
+      return popcountDefault;
+#if defined(HAS_TARGET_POPCNT)
+    case primesieve::POPCOUNT_POPCNT:
+      return primesieve::has_cpuid_popcnt() ? popcountPopcnt : NULL;
+#endif
+#if defined(HAS_TARGET_AVX2)
+    case primesieve::POPCOUNT_AVX2:
+      return primesieve::has_cpuid_avx2() ? popcountAvx2 : NULL;
+#endif
+#if defined(HAS_TARGET_AVX512_VPOPCNT)
+    case primesieve::POPCOUNT_AVX512:
+      return primesieve::has_cpuid_avx512_vpopcnt() ? popcountAvx512 : NULL;
+#endif
+    default:
+      return NULL;
+  }
+}
+
+/// AVX-512 VPOPCNTDQ is the fastest, then Harley-Seal AVX2
+/// (for arrays >= 1 kilobyte, i.e. all sieve segments), then
+/// POPCNT and finally Harley-Seal using integer operations.
+///
+int selectPopcount()
+{
+  for (int i = primesieve::POPCOUNT_ALGORITHMS - 1; i > 0; i--)
+    if (getFunction(i))
+      return i;
+  return primesieve::POPCOUNT_DEFAULT;
+}
+
+/// The popcount algorithm is selected only once, on first
+/// use (also works if called from a static initializer).
+///
+int popcountAlgorithm()
+{
+  static const int algorithm = selectPopcount();
+  return algorithm;
+}
+
+popcount_t popcountFunction()
+{
+  static const popcount_t function = getFunction(popcountAlgorithm());
+  return function;
+}
+
+} // namespace
+
+namespace primesieve {
+
+uint64_t popcount(const uint64_t* array, uint64_t size)
+{
+  return popcountFunction()(array, size);
+}
+
+uint64_t popcount(const uint64_t* array, uint64_t size, int algorithm)
+{
+  popcount_t function = getFunction(algorithm);
+  if (!function)
+    function = popcountDefault;
+  return function(array, size);
+}
+
+bool hasPopcount(int algorithm)
+{
+  return getFunction(algorithm) != NULL;
+}
+
+int getPopcount()
+{
+  return popcountAlgorithm();
+}
+
+const char* getPopcountName(int algorithm)
+{
+  switch (algorithm)
+  {
+    case POPCOUNT_DEFAULT: return "default";
+    case POPCOUNT_POPCNT:  return "popcnt";
+    case POPCOUNT_AVX2:    return "avx2";
+    case POPCOUNT_AVX512:  return "avx512";
+    default:               return "unknown";
+  }
+}
+
 } // namespace primesieve
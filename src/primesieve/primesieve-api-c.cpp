@@ -14,6 +14,7 @@
 #include <primesieve/PrimeSieve.hpp>
 #include <primesieve/ParallelPrimeSieve.hpp>
 #include <primesieve/callback_t.hpp>
+#include <primesieve/sieve_size.hpp>
 
 #include <stdint.h>
 #include <stddef.h>
@@ -35,7 +36,7 @@ const int BUFFER_BYTES = 128;
 /// primes[index-2] = integer type, e.g. INT_PRIMES.
 ///
 template <typename T>
-void* generate_primes_helper(uint64_t start, uint64_t stop, size_t* size, int type)
+void* generate_primes_helper(uint64_t start, uint64_t stop, size_t* size, int type, bool parallel)
 {
 #if __cplusplus >= 201103L
   static_assert(BUFFER_BYTES % sizeof(T) == 0, "Prime type sizeof must be a power of 2.");
@@ -48,7 +49,10 @@ void* generate_primes_helper(uint64_t start, uint64_t stop, size_t* size, int ty
     reinterpret_cast<uintptr_t*>(&primes[index])[-1] = reinterpret_cast<uintptr_t>(&primes);
     reinterpret_cast<uintptr_t*>(&primes[index])[-2] = type;
 
-    primesieve::generate_primes(start, stop, &primes);
+    if (parallel)
+      primesieve::parallel_generate_primes(start, stop, &primes);
+    else
+      primesieve::generate_primes(start, stop, &primes);
     if (size)
       *size = primes.size() - index;
     return reinterpret_cast<void*>(&primes[index]);
@@ -63,6 +67,32 @@ void* generate_primes_helper(uint64_t start, uint64_t stop, size_t* size, int ty
   return NULL;
 }
 
+/// Dispatch on the prime type, e.g. INT_PRIMES
+void* generate_primes_type(uint64_t start, uint64_t stop, size_t* size, int type, bool parallel)
+{
+  switch (type)
+  {
+    case SHORT_PRIMES:     return generate_primes_helper<short>(start, stop, size, type, parallel);
+    case USHORT_PRIMES:    return generate_primes_helper<unsigned short>(start, stop, size, type, parallel);
+    case INT_PRIMES:       return generate_primes_helper<int>(start, stop, size, type, parallel);
+    case UINT_PRIMES:      return generate_primes_helper<unsigned int>(start, stop, size, type, parallel);
+    case LONG_PRIMES:      return generate_primes_helper<long>(start, stop, size, type, parallel);
+    case ULONG_PRIMES:     return generate_primes_helper<unsigned long>(start, stop, size, type, parallel);
+    case LONGLONG_PRIMES:  return generate_primes_helper<long long>(start, stop, size, type, parallel);
+    case ULONGLONG_PRIMES: return generate_primes_helper<unsigned long long>(start, stop, size, type, parallel);
+    case INT16_PRIMES:     return generate_primes_helper<int16_t>(start, stop, size, type, parallel);
+    case UINT16_PRIMES:    return generate_primes_helper<uint16_t>(start, stop, size, type, parallel);
+    case INT32_PRIMES:     return generate_primes_helper<int32_t>(start, stop, size, type, parallel);
+    case UINT32_PRIMES:    return generate_primes_helper<uint32_t>(start, stop, size, type, parallel);
+    case INT64_PRIMES:     return generate_primes_helper<int64_t>(start, stop, size, type, parallel);
+    case UINT64_PRIMES:    return generate_primes_helper<uint64_t>(start, stop, size, type, parallel);
+  }
+  errno = EDOM;
+  if (size)
+    *size = 0;
+  return NULL;
+}
+
 /// This is the C array's memory layout:
 /// primes[index]   = first prime.
 /// primes[index-1] = memory address of corresponding std::vector object.
@@ -107,27 +137,12 @@ extern "C"
 
 void* primesieve_generate_primes(uint64_t start, uint64_t stop, size_t* size, int type)
 {
-  switch (type)
-  {
-    case SHORT_PRIMES:     return generate_primes_helper<short>(start, stop, size, type);
-    case USHORT_PRIMES:    return generate_primes_helper<unsigned short>(start, stop, size, type);
-    case INT_PRIMES:       return generate_primes_helper<int>(start, stop, size, type);
-    case UINT_PRIMES:      return generate_primes_helper<unsigned int>(start, stop, size, type);
-    case LONG_PRIMES:      return generate_primes_helper<long>(start, stop, size, type);
-    case ULONG_PRIMES:     return generate_primes_helper<unsigned long>(start, stop, size, type);
-    case LONGLONG_PRIMES:  return generate_primes_helper<long long>(start, stop, size, type);
-    case ULONGLONG_PRIMES: return generate_primes_helper<unsigned long long>(start, stop, size, type);
-    case INT16_PRIMES:     return generate_primes_helper<int16_t>(start, stop, size, type);
-    case UINT16_PRIMES:    return generate_primes_helper<uint16_t>(start, stop, size, type);
-    case INT32_PRIMES:     return generate_primes_helper<int32_t>(start, stop, size, type);
-    case UINT32_PRIMES:    return generate_primes_helper<uint32_t>(start, stop, size, type);
-    case INT64_PRIMES:     return generate_primes_helper<int64_t>(start, stop, size, type);
-    case UINT64_PRIMES:    return generate_primes_helper<uint64_t>(start, stop, size, type);
-  }
-  errno = EDOM;
-  if (size)
-    *size = 0;
-  return NULL;
+  return generate_primes_type(start, stop, size, type, false);
+}
+
+void* primesieve_parallel_generate_primes(uint64_t start, uint64_t stop, size_t* size, int type)
+{
+  return generate_primes_type(start, stop, size, type, true);
 }
 
 void* primesieve_generate_n_primes(uint64_t n, uint64_t start, int type)
@@ -180,6 +195,11 @@ void primesieve_free(void* primes_c)
   }
 }
 
+void primesieve_clear_cache()
+{
+  primesieve::clear_cache();
+}
+
 //////////////////////////////////////////////////////////////////////
 //                     Nth prime functions
 //////////////////////////////////////////////////////////////////////
@@ -189,7 +209,7 @@ uint64_t primesieve_nth_prime(int64_t n, uint64_t start)
   try
   {
     primesieve::PrimeSieve ps;
-    ps.setSieveSize(primesieve::get_sieve_size());
+    ps.setSieveSize(primesieve::get_sieve_size_setting());
     return ps.nthPrime(n, start);
   }
   catch (std::exception&)
@@ -204,8 +224,9 @@ uint64_t primesieve_parallel_nth_prime(int64_t n, uint64_t start)
   try
   {
     primesieve::ParallelPrimeSieve pps;
-    pps.setSieveSize (primesieve::get_sieve_size());
+    pps.setSieveSize (primesieve::get_sieve_size_setting());
     pps.setNumThreads(primesieve::get_num_threads());
+    pps.setBackend   (primesieve::get_thread_backend());
     return pps.nthPrime(n, start);
   }
   catch (std::exception&)
@@ -219,12 +240,25 @@ uint64_t primesieve_parallel_nth_prime(int64_t n, uint64_t start)
 //                      Count functions
 //////////////////////////////////////////////////////////////////////
 
+uint64_t primesieve_pi(uint64_t x)
+{
+  try
+  {
+    return primesieve::pi(x);
+  }
+  catch (std::exception&)
+  {
+    errno = EDOM;
+  }
+  return PRIMESIEVE_ERROR;
+}
+
 uint64_t primesieve_count_primes(uint64_t start, uint64_t stop)
 {
   try
   {
     primesieve::PrimeSieve ps;
-    ps.setSieveSize(primesieve::get_sieve_size());
+    ps.setSieveSize(primesieve::get_sieve_size_setting());
     return ps.countPrimes(start, stop);
   }
   catch (std::exception&)
@@ -239,7 +273,7 @@ uint64_t primesieve_count_twins(uint64_t start, uint64_t stop)
   try
   {
     primesieve::PrimeSieve ps;
-    ps.setSieveSize(primesieve::get_sieve_size());
+    ps.setSieveSize(primesieve::get_sieve_size_setting());
     return ps.countTwins(start, stop);
   }
   catch (std::exception&)
@@ -254,7 +288,7 @@ uint64_t primesieve_count_triplets(uint64_t start, uint64_t stop)
   try
   {
     primesieve::PrimeSieve ps;
-    ps.setSieveSize(primesieve::get_sieve_size());
+    ps.setSieveSize(primesieve::get_sieve_size_setting());
     return ps.countTriplets(start, stop);
   }
   catch (std::exception&)
@@ -269,7 +303,7 @@ uint64_t primesieve_count_quadruplets(uint64_t start, uint64_t stop)
   try
   {
     primesieve::PrimeSieve ps;
-    ps.setSieveSize(primesieve::get_sieve_size());
+    ps.setSieveSize(primesieve::get_sieve_size_setting());
     return ps.countQuadruplets(start, stop);
   }
   catch (std::exception&)
@@ -284,7 +318,7 @@ uint64_t primesieve_count_quintuplets(uint64_t start, uint64_t stop)
   try
   {
     primesieve::PrimeSieve ps;
-    ps.setSieveSize(primesieve::get_sieve_size());
+    ps.setSieveSize(primesieve::get_sieve_size_setting());
     return ps.countQuintuplets(start, stop);
   }
   catch (std::exception&)
@@ -299,7 +333,7 @@ uint64_t primesieve_count_sextuplets(uint64_t start, uint64_t stop)
   try
   {
     primesieve::PrimeSieve ps;
-    ps.setSieveSize(primesieve::get_sieve_size());
+    ps.setSieveSize(primesieve::get_sieve_size_setting());
     return ps.countSextuplets(start, stop);
   }
   catch (std::exception&)
@@ -318,8 +352,9 @@ uint64_t primesieve_parallel_count_primes(uint64_t start, uint64_t stop)
   try
   {
     primesieve::ParallelPrimeSieve pps;
-    pps.setSieveSize (primesieve::get_sieve_size());
+    pps.setSieveSize (primesieve::get_sieve_size_setting());
     pps.setNumThreads(primesieve::get_num_threads());
+    pps.setBackend   (primesieve::get_thread_backend());
     return pps.countPrimes(start, stop);
   }
   catch (std::exception&)
@@ -334,8 +369,9 @@ uint64_t primesieve_parallel_count_twins(uint64_t start, uint64_t stop)
   try
   {
     primesieve::ParallelPrimeSieve pps;
-    pps.setSieveSize (primesieve::get_sieve_size());
+    pps.setSieveSize (primesieve::get_sieve_size_setting());
     pps.setNumThreads(primesieve::get_num_threads());
+    pps.setBackend   (primesieve::get_thread_backend());
     return pps.countTwins(start, stop);
   }
   catch (std::exception&)
@@ -350,8 +386,9 @@ uint64_t primesieve_parallel_count_triplets(uint64_t start, uint64_t stop)
   try
   {
     primesieve::ParallelPrimeSieve pps;
-    pps.setSieveSize (primesieve::get_sieve_size());
+    pps.setSieveSize (primesieve::get_sieve_size_setting());
     pps.setNumThreads(primesieve::get_num_threads());
+    pps.setBackend   (primesieve::get_thread_backend());
     return pps.countTriplets(start, stop);
   }
   catch (std::exception&)
@@ -366,8 +403,9 @@ uint64_t primesieve_parallel_count_quadruplets(uint64_t start, uint64_t stop)
   try
   {
     primesieve::ParallelPrimeSieve pps;
-    pps.setSieveSize (primesieve::get_sieve_size());
+    pps.setSieveSize (primesieve::get_sieve_size_setting());
     pps.setNumThreads(primesieve::get_num_threads());
+    pps.setBackend   (primesieve::get_thread_backend());
     return pps.countQuadruplets(start, stop);
   }
   catch (std::exception&)
@@ -382,8 +420,9 @@ uint64_t primesieve_parallel_count_quintuplets(uint64_t start, uint64_t stop)
   try
   {
     primesieve::ParallelPrimeSieve pps;
-    pps.setSieveSize (primesieve::get_sieve_size());
+    pps.setSieveSize (primesieve::get_sieve_size_setting());
     pps.setNumThreads(primesieve::get_num_threads());
+    pps.setBackend   (primesieve::get_thread_backend());
     return pps.countQuintuplets(start, stop);
   }
   catch (std::exception&)
@@ -398,8 +437,9 @@ uint64_t primesieve_parallel_count_sextuplets(uint64_t start, uint64_t stop)
   try
   {
     primesieve::ParallelPrimeSieve pps;
-    pps.setSieveSize (primesieve::get_sieve_size());
+    pps.setSieveSize (primesieve::get_sieve_size_setting());
     pps.setNumThreads(primesieve::get_num_threads());
+    pps.setBackend   (primesieve::get_thread_backend());
     return pps.countSextuplets(start, stop);
   }
   catch (std::exception&)
@@ -418,7 +458,7 @@ void primesieve_print_primes(uint64_t start, uint64_t stop)
   try
   {
     primesieve::PrimeSieve ps;
-    ps.setSieveSize(primesieve::get_sieve_size());
+    ps.setSieveSize(primesieve::get_sieve_size_setting());
     ps.printPrimes(start, stop);
   }
   catch (std::exception&)
@@ -432,7 +472,7 @@ void primesieve_print_twins(uint64_t start, uint64_t stop)
   try
   {
     primesieve::PrimeSieve ps;
-    ps.setSieveSize(primesieve::get_sieve_size());
+    ps.setSieveSize(primesieve::get_sieve_size_setting());
     ps.printTwins(start, stop);
   }
   catch (std::exception&)
@@ -446,7 +486,7 @@ void primesieve_print_triplets(uint64_t start, uint64_t stop)
   try
   {
     primesieve::PrimeSieve ps;
-    ps.setSieveSize(primesieve::get_sieve_size());
+    ps.setSieveSize(primesieve::get_sieve_size_setting());
     ps.printTriplets(start, stop);
   }
   catch (std::exception&)
@@ -460,7 +500,7 @@ void primesieve_print_quadruplets(uint64_t start, uint64_t stop)
   try
   {
     primesieve::PrimeSieve ps;
-    ps.setSieveSize(primesieve::get_sieve_size());
+    ps.setSieveSize(primesieve::get_sieve_size_setting());
     ps.printQuadruplets(start, stop);
   }
   catch (std::exception&)
@@ -474,7 +514,7 @@ void primesieve_print_quintuplets(uint64_t start, uint64_t stop)
   try
   {
     primesieve::PrimeSieve ps;
-    ps.setSieveSize(primesieve::get_sieve_size());
+    ps.setSieveSize(primesieve::get_sieve_size_setting());
     ps.printQuintuplets(start, stop);
   }
   catch (std::exception&)
@@ -488,7 +528,7 @@ void primesieve_print_sextuplets(uint64_t start, uint64_t stop)
   try
   {
     primesieve::PrimeSieve ps;
-    ps.setSieveSize(primesieve::get_sieve_size());
+    ps.setSieveSize(primesieve::get_sieve_size_setting());
     ps.printSextuplets(start, stop);
   }
   catch (std::exception&)
@@ -506,7 +546,7 @@ void primesieve_callback_primes(uint64_t start, uint64_t stop, void (*callback)(
   try
   {
     primesieve::PrimeSieve ps;
-    ps.setSieveSize(primesieve::get_sieve_size());
+    ps.setSieveSize(primesieve::get_sieve_size_setting());
     // temporarily cast away extern "C" linkage
     ps.callbackPrimes_c(start, stop, reinterpret_cast<callback_t>(callback));
   }
@@ -521,8 +561,9 @@ void primesieve_parallel_callback_primes(uint64_t start, uint64_t stop, void (*c
   try
   {
     primesieve::ParallelPrimeSieve pps;
-    pps.setSieveSize (primesieve::get_sieve_size());
+    pps.setSieveSize (primesieve::get_sieve_size_setting());
     pps.setNumThreads(primesieve::get_num_threads());
+    pps.setBackend   (primesieve::get_thread_backend());
     // temporarily cast away extern "C" linkage
     pps.callbackPrimes_c(start, stop, reinterpret_cast<callback_tn_t>(callback));
   }
@@ -532,6 +573,38 @@ void primesieve_parallel_callback_primes(uint64_t start, uint64_t stop, void (*c
   }
 }
 
+void primesieve_callback_primes_batch(uint64_t start, uint64_t stop, void (*callback)(const uint64_t*, size_t, int))
+{
+  try
+  {
+    primesieve::PrimeSieve ps;
+    ps.setSieveSize(primesieve::get_sieve_size_setting());
+    // temporarily cast away extern "C" linkage
+    ps.callbackPrimes_c(start, stop, reinterpret_cast<callback_batch_t>(callback));
+  }
+  catch (std::exception&)
+  {
+    errno = EDOM;
+  }
+}
+
+void primesieve_parallel_callback_primes_batch(uint64_t start, uint64_t stop, void (*callback)(const uint64_t*, size_t, int))
+{
+  try
+  {
+    primesieve::ParallelPrimeSieve pps;
+    pps.setSieveSize (primesieve::get_sieve_size_setting());
+    pps.setNumThreads(primesieve::get_num_threads());
+    pps.setBackend   (primesieve::get_thread_backend());
+    // temporarily cast away extern "C" linkage
+    pps.callbackPrimes_c(start, stop, reinterpret_cast<callback_batch_t>(callback));
+  }
+  catch (std::exception&)
+  {
+    errno = EDOM;
+  }
+}
+
 //////////////////////////////////////////////////////////////////////
 //                        Getters and Setters
 //////////////////////////////////////////////////////////////////////
@@ -546,6 +619,11 @@ int primesieve_get_num_threads()
   return primesieve::get_num_threads();
 }
 
+int primesieve_get_thread_backend()
+{
+  return primesieve::get_thread_backend();
+}
+
 uint64_t primesieve_get_max_stop()
 {
   return primesieve::get_max_stop();
@@ -561,6 +639,68 @@ void primesieve_set_num_threads(int num_threads)
   primesieve::set_num_threads(num_threads);
 }
 
+void primesieve_set_thread_backend(int backend)
+{
+  try
+  {
+    primesieve::set_thread_backend(backend);
+  }
+  catch (std::exception&)
+  {
+    errno = EDOM;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+//                            pi(x) index
+//////////////////////////////////////////////////////////////////////
+
+int primesieve_load_pi_index(const char* filename)
+{
+  try
+  {
+    primesieve::load_pi_index(filename);
+    return 1;
+  }
+  catch (std::exception&)
+  {
+    errno = EDOM;
+  }
+  return 0;
+}
+
+void primesieve_unload_pi_index()
+{
+  primesieve::unload_pi_index();
+}
+
+int primesieve_build_pi_index(const char* filename, uint64_t stop)
+{
+  try
+  {
+    primesieve::build_pi_index(filename, stop);
+    return 1;
+  }
+  catch (std::exception&)
+  {
+    errno = EDOM;
+  }
+  return 0;
+}
+
+int primesieve_check_pi_index()
+{
+  try
+  {
+    return primesieve::check_pi_index();
+  }
+  catch (std::exception&)
+  {
+    errno = EDOM;
+  }
+  return 0;
+}
+
 //////////////////////////////////////////////////////////////////////
 //                           Miscellaneous
 //////////////////////////////////////////////////////////////////////
@@ -15,22 +15,27 @@
 #include <primesieve/ParallelPrimeSieve.hpp>
 #include <primesieve/Callback.hpp>
 #include <primesieve/PrimeFinder.hpp>
+#include <primesieve/PiIndex.hpp>
+#include <primesieve/SieveContext.hpp>
+#include <primesieve/TuningProfile.hpp>
+#include <primesieve/sieve_size.hpp>
 #include <primesieve.hpp>
 
 #include <stdint.h>
+#include <cstddef>
 #include <string>
 
-#ifdef _OPENMP
-  #include <omp.h>
-#endif
-
 namespace
 {
 /// Number of threads used for sieving in parallel
 int num_threads = primesieve::MAX_THREADS;
 
-/// Sieve size in kilobytes used for sieving
-int sieve_size = SIEVESIZE;
+/// Sieve size in kilobytes set using set_sieve_size(),
+/// AUTO_SIEVE_SIZE = PrimeSieve's default sieve size
+int sieve_size = primesieve::AUTO_SIEVE_SIZE;
+
+/// Multi-threading backend of the parallel_* functions
+int thread_backend = primesieve::DEFAULT_BACKEND;
 }
 
 namespace primesieve
@@ -43,15 +48,16 @@ namespace primesieve
 uint64_t nth_prime(int64_t n, uint64_t start)
 {
   PrimeSieve ps;
-  ps.setSieveSize(get_sieve_size());
+  ps.setSieveSize(sieve_size);
   return ps.nthPrime(n, start);
 }
 
 uint64_t parallel_nth_prime(int64_t n, uint64_t start)
 {
   ParallelPrimeSieve pps;
-  pps.setSieveSize(get_sieve_size());
+  pps.setSieveSize(sieve_size);
   pps.setNumThreads(get_num_threads());
+  pps.setBackend(get_thread_backend());
   return pps.nthPrime(n, start);
 }
 
@@ -59,45 +65,52 @@ uint64_t parallel_nth_prime(int64_t n, uint64_t start)
 //                      Count functions
 //////////////////////////////////////////////////////////////////////
 
+uint64_t pi(uint64_t x)
+{
+  PrimeSieve ps;
+  ps.setSieveSize(sieve_size);
+  return ps.countPrimes(0, x);
+}
+
 uint64_t count_primes(uint64_t start, uint64_t stop)
 {
   PrimeSieve ps;
-  ps.setSieveSize(get_sieve_size());
+  ps.setSieveSize(sieve_size);
   return ps.countPrimes(start, stop);
 }
 
 uint64_t count_twins(uint64_t start, uint64_t stop)
 {
   PrimeSieve ps;
-  ps.setSieveSize(get_sieve_size());
+  ps.setSieveSize(sieve_size);
   return ps.countTwins(start, stop);
 }
 
 uint64_t count_triplets(uint64_t start, uint64_t stop)
 {
   PrimeSieve ps;
-  ps.setSieveSize(get_sieve_size());
+  ps.setSieveSize(sieve_size);
   return ps.countTriplets(start, stop);
 }
 
 uint64_t count_quadruplets(uint64_t start, uint64_t stop)
 {
   PrimeSieve ps;
-  ps.setSieveSize(get_sieve_size());
+  ps.setSieveSize(sieve_size);
   return ps.countQuadruplets(start, stop);
 }
 
 uint64_t count_quintuplets(uint64_t start, uint64_t stop)
 {
   PrimeSieve ps;
-  ps.setSieveSize(get_sieve_size());
+  ps.setSieveSize(sieve_size);
   return ps.countQuintuplets(start, stop);
 }
 
 uint64_t count_sextuplets(uint64_t start, uint64_t stop)
 {
   PrimeSieve ps;
-  ps.setSieveSize(get_sieve_size());
+  ps.setSieveSize(sieve_size);
   return ps.countSextuplets(start, stop);
 }
 
@@ -108,48 +121,54 @@ uint64_t count_sextuplets(uint64_t start, uint64_t stop)
 uint64_t parallel_count_primes(uint64_t start, uint64_t stop)
 {
   ParallelPrimeSieve pps;
-  pps.setSieveSize(get_sieve_size());
+  pps.setSieveSize(sieve_size);
   pps.setNumThreads(get_num_threads());
+  pps.setBackend(get_thread_backend());
   return pps.countPrimes(start, stop);
 }
 
 uint64_t parallel_count_twins(uint64_t start, uint64_t stop)
 {
   ParallelPrimeSieve pps;
-  pps.setSieveSize(get_sieve_size());
+  pps.setSieveSize(sieve_size);
   pps.setNumThreads(get_num_threads());
+  pps.setBackend(get_thread_backend());
   return pps.countTwins(start, stop);
 }
 
 uint64_t parallel_count_triplets(uint64_t start, uint64_t stop)
 {
   ParallelPrimeSieve pps;
-  pps.setSieveSize(get_sieve_size());
+  pps.setSieveSize(sieve_size);
   pps.setNumThreads(get_num_threads());
+  pps.setBackend(get_thread_backend());
   return pps.countTriplets(start, stop);
 }
 
 uint64_t parallel_count_quadruplets(uint64_t start, uint64_t stop)
 {
   ParallelPrimeSieve pps;
-  pps.setSieveSize(get_sieve_size());
+  pps.setSieveSize(sieve_size);
   pps.setNumThreads(get_num_threads());
+  pps.setBackend(get_thread_backend());
   return pps.countQuadruplets(start, stop);
 }
 
 uint64_t parallel_count_quintuplets(uint64_t start, uint64_t stop)
 {
   ParallelPrimeSieve pps;
-  pps.setSieveSize(get_sieve_size());
+  pps.setSieveSize(sieve_size);
   pps.setNumThreads(get_num_threads());
+  pps.setBackend(get_thread_backend());
   return pps.countQuintuplets(start, stop);
 }
 
 uint64_t parallel_count_sextuplets(uint64_t start, uint64_t stop)
 {
   ParallelPrimeSieve pps;
-  pps.setSieveSize(get_sieve_size());
+  pps.setSieveSize(sieve_size);
   pps.setNumThreads(get_num_threads());
+  pps.setBackend(get_thread_backend());
   return pps.countSextuplets(start, stop);
 }
 
@@ -160,45 +179,52 @@ uint64_t parallel_count_sextuplets(uint64_t start, uint64_t stop)
 void print_primes(uint64_t start, uint64_t stop)
 {
   PrimeSieve ps;
-  ps.setSieveSize(get_sieve_size());
+  ps.setSieveSize(sieve_size);
   ps.printPrimes(start, stop);
 }
 
 void print_twins(uint64_t start, uint64_t stop)
 {
   PrimeSieve ps;
-  ps.setSieveSize(get_sieve_size());
+  ps.setSieveSize(sieve_size);
   ps.printTwins(start, stop);
 }
 
 void print_triplets(uint64_t start, uint64_t stop)
 {
   PrimeSieve ps;
-  ps.setSieveSize(get_sieve_size());
+  ps.setSieveSize(sieve_size);
   ps.printTriplets(start, stop);
 }
 
 void print_quadruplets(uint64_t start, uint64_t stop)
 {
   PrimeSieve ps;
-  ps.setSieveSize(get_sieve_size());
+  ps.setSieveSize(sieve_size);
   ps.printQuadruplets(start, stop);
 }
 
 void print_quintuplets(uint64_t start, uint64_t stop)
 {
   PrimeSieve ps;
-  ps.setSieveSize(get_sieve_size());
+  ps.setSieveSize(sieve_size);
   ps.printQuintuplets(start, stop);
 }
 
 void print_sextuplets(uint64_t start, uint64_t stop)
 {
   PrimeSieve ps;
-  ps.setSieveSize(get_sieve_size());
+  ps.setSieveSize(sieve_size);
   ps.printSextuplets(start, stop);
 }
 
+void store_primes(uint64_t start, uint64_t stop, const std::string& filename, int format)
+{
+  PrimeSieve ps;
+  ps.setSieveSize(sieve_size);
+  ps.storePrimes(start, stop, filename, format);
+}
+
 //////////////////////////////////////////////////////////////////////
 //                      Callback functions
 //////////////////////////////////////////////////////////////////////
@@ -206,14 +232,28 @@ void print_sextuplets(uint64_t start, uint64_t stop)
 void callback_primes(uint64_t start, uint64_t stop, void (*callback)(uint64_t))
 {
   PrimeSieve ps;
-  ps.setSieveSize(get_sieve_size());
+  ps.setSieveSize(sieve_size);
   ps.callbackPrimes(start, stop, callback);
 }
 
 void callback_primes(uint64_t start, uint64_t stop, Callback<uint64_t>* callback)
 {
   PrimeSieve ps;
-  ps.setSieveSize(get_sieve_size());
+  ps.setSieveSize(sieve_size);
+  ps.callbackPrimes(start, stop, callback);
+}
+
+void callback_primes(uint64_t start, uint64_t stop, void (*callback)(const uint64_t*, std::size_t, int))
+{
+  PrimeSieve ps;
+  ps.setSieveSize(sieve_size);
+  ps.callbackPrimes(start, stop, callback);
+}
+
+void callback_primes(uint64_t start, uint64_t stop, BatchCallback* callback)
+{
+  PrimeSieve ps;
+  ps.setSieveSize(sieve_size);
   ps.callbackPrimes(start, stop, callback);
 }
 
@@ -224,35 +264,77 @@ void callback_primes(uint64_t start, uint64_t stop, Callback<uint64_t>* callback
 void parallel_callback_primes(uint64_t start, uint64_t stop, void (*callback)(uint64_t))
 {
   ParallelPrimeSieve pps;
-  pps.setSieveSize(get_sieve_size());
+  pps.setSieveSize(sieve_size);
   pps.setNumThreads(get_num_threads());
+  pps.setBackend(get_thread_backend());
   pps.callbackPrimes(start, stop, callback);
 }
 
 void parallel_callback_primes(uint64_t start, uint64_t stop, void (*callback)(uint64_t, int))
 {
   ParallelPrimeSieve pps;
-  pps.setSieveSize(get_sieve_size());
+  pps.setSieveSize(sieve_size);
   pps.setNumThreads(get_num_threads());
+  pps.setBackend(get_thread_backend());
   pps.callbackPrimes(start, stop, callback);
 }
 
 void parallel_callback_primes(uint64_t start, uint64_t stop, Callback<uint64_t>* callback)
 {
   ParallelPrimeSieve pps;
-  pps.setSieveSize(get_sieve_size());
+  pps.setSieveSize(sieve_size);
   pps.setNumThreads(get_num_threads());
+  pps.setBackend(get_thread_backend());
   pps.callbackPrimes(start, stop, callback);
 }
 
 void parallel_callback_primes(uint64_t start, uint64_t stop, Callback<uint64_t, int>* callback)
 {
   ParallelPrimeSieve pps;
-  pps.setSieveSize(get_sieve_size());
+  pps.setSieveSize(sieve_size);
   pps.setNumThreads(get_num_threads());
+  pps.setBackend(get_thread_backend());
   pps.callbackPrimes(start, stop, callback);
 }
 
+void parallel_callback_primes(uint64_t start, uint64_t stop, void (*callback)(const uint64_t*, std::size_t, int))
+{
+  ParallelPrimeSieve pps;
+  pps.setSieveSize(sieve_size);
+  pps.setNumThreads(get_num_threads());
+  pps.setBackend(get_thread_backend());
+  pps.callbackPrimes(start, stop, callback);
+}
+
+void parallel_callback_primes(uint64_t start, uint64_t stop, BatchCallback* callback)
+{
+  ParallelPrimeSieve pps;
+  pps.setSieveSize(sieve_size);
+  pps.setNumThreads(get_num_threads());
+  pps.setBackend(get_thread_backend());
+  pps.callbackPrimes(start, stop, callback);
+}
+
+//////////////////////////////////////////////////////////////////////
+//                   Segment callback functions
+//////////////////////////////////////////////////////////////////////
+
+void callback_segments(uint64_t start, uint64_t stop, SegmentCallback* callback)
+{
+  PrimeSieve ps;
+  ps.setSieveSize(sieve_size);
+  ps.callbackSegments(start, stop, callback);
+}
+
+void parallel_callback_segments(uint64_t start, uint64_t stop, SegmentCallback* callback)
+{
+  ParallelPrimeSieve pps;
+  pps.setSieveSize(sieve_size);
+  pps.setNumThreads(get_num_threads());
+  pps.setBackend(get_thread_backend());
+  pps.callbackSegments(start, stop, callback);
+}
+
 //////////////////////////////////////////////////////////////////////
 //                      Getters and Setters
 //////////////////////////////////////////////////////////////////////
@@ -262,7 +344,19 @@ uint64_t get_max_stop()
   return PrimeFinder::getMaxStop();
 }
 
+/// @return The set sieve size or else the default sieve size,
+///         with AUTO_SIEVE_SIZE the sieve size is chosen for
+///         each sieved range (see PrimeSieve::getSieveSize()).
+///
 int get_sieve_size()
+{
+  if (sieve_size != AUTO_SIEVE_SIZE)
+    return sieve_size;
+  PrimeSieve ps;
+  return ps.getSieveSize();
+}
+
+int get_sieve_size_setting()
 {
   return sieve_size;
 }
@@ -272,27 +366,87 @@ int get_num_threads()
   return num_threads;
 }
 
+int get_thread_backend()
+{
+  return thread_backend;
+}
+
 void set_sieve_size(int kilobytes)
 {
-  sieve_size = getInBetween(1, kilobytes, 2048);
+  if (kilobytes != AUTO_SIEVE_SIZE)
+    kilobytes = getInBetween(1, kilobytes, 2048);
+
+  sieve_size = kilobytes;
 }
 
 void set_num_threads(int threads)
 {
   if (threads != MAX_THREADS)
   {
-#ifdef _OPENMP
-    int max_threads = omp_get_max_threads();
+    // 1 if there is no multi-threading backend
+    int max_threads = ParallelPrimeSieve::getMaxThreads();
     threads = getInBetween(1, threads, max_threads);
-#else
-    // no multi-threading
-    threads = 1;
-#endif
   }
 
   num_threads = threads;
 }
 
+void set_thread_backend(int backend)
+{
+  if (backend < DEFAULT_BACKEND ||
+      backend > THREAD_POOL_BACKEND)
+    throw primesieve_error("invalid multi-threading backend");
+
+  thread_backend = backend;
+}
+
+void clear_cache()
+{
+  SieveContext* context = SieveContext::threadContext();
+  if (context)
+    context->clear();
+}
+
+//////////////////////////////////////////////////////////////////////
+//                         pi(x) index
+//////////////////////////////////////////////////////////////////////
+
+void load_pi_index(const std::string& filename)
+{
+  PiIndex::load(filename);
+}
+
+void unload_pi_index()
+{
+  PiIndex::unload();
+}
+
+void build_pi_index(const std::string& filename, uint64_t stop)
+{
+  PiIndex::build(filename, stop, PiIndex::DEFAULT_LOG2_STEP, get_num_threads(), get_thread_backend());
+}
+
+bool check_pi_index()
+{
+  const PiIndex* piIndex = PiIndex::get();
+  if (!piIndex)
+    throw primesieve_error("no pi(x) index loaded");
+  return piIndex->check(get_num_threads(), get_thread_backend());
+}
+
+//////////////////////////////////////////////////////////////////////
+//                            Tuning
+//////////////////////////////////////////////////////////////////////
+
+void tune()
+{
+  TuningProfile& profile = tuningProfile();
+  profile.tune(NULL);
+  std::string filename = TuningProfile::getDefaultFilename();
+  if (!filename.empty())
+    profile.save(filename);
+}
+
 //////////////////////////////////////////////////////////////////////
 //                      Miscellaneous
 //////////////////////////////////////////////////////////////////////
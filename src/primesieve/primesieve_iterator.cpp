@@ -9,6 +9,7 @@
 ///
 
 #include <primesieve/config.hpp>
+#include <primesieve/CpuInfo.hpp>
 #include <primesieve/pmath.hpp>
 #include <primesieve.hpp>
 #include <primesieve.h>
@@ -48,6 +49,8 @@ uint64_t get_interval_size(uint64_t n, uint64_t& tiny_cache_size)
 {
   n = (n > 10) ? n : 10;
   uint64_t cache_size = config::ITERATOR_CACHE_SMALL;
+  if (cpuInfo().hasL3Cache())
+    cache_size = getInBetween<uint64_t>(1 << 20, cpuInfo().l3CacheSizePerThread(), cache_size);
 
   if (tiny_cache_size < cache_size)
   {
@@ -10,14 +10,26 @@
 ///
 
 #include <primesieve.hpp>
+#include <primesieve/config.hpp>
+#include <primesieve/TuningProfile.hpp>
+#include <primesieve/SieveContext.hpp>
+#include <primesieve/PrimeFinder.hpp>
+#include <primesieve/EratSmall.hpp>
+#include <primesieve/PiIndex.hpp>
+#include <primesieve/PrimeFile.hpp>
+#include <primesieve/sieve_size.hpp>
 
 #include <stdint.h>
 #include <iostream>
 #include <iomanip>
+#include <vector>
 #include <exception>
 #include <stdexcept>
 #include <algorithm>
+#include <cstddef>
+#include <cstdio>
 #include <cstdlib>
+#include <string>
 #include <ctime>
 
 using namespace std;
@@ -48,6 +60,17 @@ const unsigned int primeCounts[19] =
   2895317534U  // pi[10^15, 10^15+10^11]
 };
 
+/// Prime k-tuplet counts up to 10^9
+const unsigned int kTupletCounts[6] =
+{
+  50847534, // primes
+  3424506,  // twin primes
+  759256,   // prime triplets
+  28388,    // prime quadruplets
+  7221,     // prime quintuplets
+  317       // prime sextuplets
+};
+
 /// Keeps the memory usage below 1GB
 const int maxThreads[8] = { 32, 32, 32, 32, 32, 8, 4, 1 };
 
@@ -83,12 +106,29 @@ void check(bool isCorrect)
     throw runtime_error("test failed!");
 }
 
+/// Path of a temporary test file
+string getTempFile(const string& name)
+{
+  const char* vars[3] = { "TMPDIR", "TMP", "TEMP" };
+  for (int i = 0; i < 3; i++)
+  {
+    const char* dir = getenv(vars[i]);
+    if (dir && *dir)
+      return string(dir) + "/" + name;
+  }
+#if defined(_WIN32)
+  return name;
+#else
+  return "/tmp/" + name;
+#endif
+}
+
 /// Count the primes up to 10^10
 void testPix()
 {
   cout << "pi(x) : Prime-counting function test" << endl;
   ParallelPrimeSieve pps;
-  pps.setSieveSize(get_sieve_size());
+  pps.setSieveSize(get_sieve_size_setting());
   pps.setNumThreads(get_num_threads());
   pps.setStart(0);
   pps.setStop(0);
@@ -97,18 +137,655 @@ void testPix()
   // pi(x) with x = 10^i for i = 1 to 10
   for (int i = 1; i <= 10; i++)
   {
-    primeCount += pps.countPrimes(pps.getStop() + 1, ipow(10, i));
+    pps.sieve(pps.getStop() + 1, ipow(10, i), pps.COUNT_PRIMES);
+    primeCount += pps.getPrimeCount();
     cout << "pi(10^" << i << (i < 10 ? ")  = " : ") = ") << setw(12) << primeCount;
     check(primeCount == primeCounts[i - 1]);
   }
   cout << endl;
 }
 
+/// Count the primes up to 10^10 and within [10^12, 10^12+2^32]
+/// using the combinatorial prime counting function
+///
+void testPiLMO()
+{
+  cout << "pi(x) : Combinatorial prime-counting function test" << endl;
+
+  for (int i = 1; i <= 10; i++)
+  {
+    uint64_t primeCount = pi(ipow(10, i));
+    cout << "pi(10^" << i << (i < 10 ? ")  = " : ") = ") << setw(12) << primeCount;
+    check(primeCount == primeCounts[i - 1]);
+  }
+
+  uint64_t start = ipow(10, 12);
+  uint64_t stop = start + ipow(2, 32);
+  uint64_t primeCount = pi(stop) - pi(start - 1);
+  cout << "pi[10^12, 10^12+2^32] = " << setw(11) << primeCount;
+  check(primeCount == primeCounts[10]);
+  cout << endl;
+}
+
+/// Calls PrimeSieve::stop() once the nth prime has been found
+/// (n = 0 stops at the first batch), counts the primes of each
+/// thread.
+///
+class StopAfterNthPrime : public BatchCallback
+{
+public:
+  StopAfterNthPrime(PrimeSieve& ps, uint64_t n) :
+    ps_(ps),
+    n_(n),
+    nthPrime_(0),
+    counts_(ParallelPrimeSieve::getMaxThreads(), 0)
+  { }
+  void callback(const uint64_t* primes, std::size_t count, int threadNum)
+  {
+    counts_[threadNum] += count;
+    if (n_ > count)
+    {
+      n_ -= count;
+      return;
+    }
+    if (n_ > 0)
+    {
+      nthPrime_ = primes[n_ - 1];
+      n_ = 0;
+    }
+    ps_.stop();
+  }
+  uint64_t getNthPrime() const { return nthPrime_; }
+  uint64_t getCount() const
+  {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < counts_.size(); i++)
+      sum += counts_[i];
+    return sum;
+  }
+private:
+  PrimeSieve& ps_;
+  uint64_t n_;
+  uint64_t nthPrime_;
+  vector<uint64_t> counts_;
+};
+
+/// Stop sieving from within a callback, the sieve must
+/// return without processing the rest of the interval.
+///
+void testStop()
+{
+  cout << "Stop sieving from within a callback" << endl;
+
+  PrimeSieve ps;
+  StopAfterNthPrime stopCallback(ps, 1000000);
+  ps.callbackPrimes(0, ipow(10, 12), &stopCallback);
+  cout << "10^6th prime = " << setw(16) << stopCallback.getNthPrime();
+  check(stopCallback.getNthPrime() == 15485863 && ps.isStopped());
+
+  ParallelPrimeSieve pps;
+  pps.setNumThreads(get_num_threads());
+  StopAfterNthPrime stopParallel(pps, 0);
+  pps.callbackPrimes(ipow(10, 15), ipow(10, 15) + ipow(10, 11), &stopParallel);
+  cout << "Stop all threads: " << setw(12) << stopParallel.getCount();
+  check(stopParallel.getCount() < primeCounts[18] / 10 && pps.isStopped());
+  cout << endl;
+}
+
+/// Checks that the primes arrive in ascending order
+class AscendingPrimes : public BatchCallback
+{
+public:
+  AscendingPrimes() : last_(0), count_(0), isAscending_(true) { }
+  void callback(const uint64_t* primes, std::size_t count, int)
+  {
+    for (std::size_t i = 0; i < count; i++)
+    {
+      isAscending_ &= (primes[i] > last_);
+      last_ = primes[i];
+    }
+    count_ += count;
+  }
+  uint64_t getCount() const { return count_; }
+  bool isAscending() const { return isAscending_; }
+private:
+  uint64_t last_;
+  uint64_t count_;
+  bool isAscending_;
+};
+
+/// ParallelPrimeSieve::setOrdered(true), the callback
+/// must receive the primes in ascending order.
+///
+void testOrdered()
+{
+  cout << "Callback primes in order using multiple threads" << endl;
+
+  ParallelPrimeSieve pps;
+  pps.setNumThreads(get_num_threads());
+  pps.setOrdered(true);
+  AscendingPrimes ascending;
+  pps.callbackPrimes(ipow(10, 12), ipow(10, 12) + ipow(10, 9), &ascending);
+  cout << "Ascending primes: " << setw(12) << ascending.getCount();
+  check(ascending.isAscending() && ascending.getCount() == pps.countPrimes(ipow(10, 12), ipow(10, 12) + ipow(10, 9)));
+
+  StopAfterNthPrime stopOrdered(pps, 1000000);
+  pps.callbackPrimes(0, ipow(10, 12), &stopOrdered);
+  cout << "10^6th prime = " << setw(16) << stopOrdered.getNthPrime();
+  check(stopOrdered.getNthPrime() == 15485863);
+  cout << endl;
+}
+
+/// parallel_generate_primes() must store the same
+/// primes as the single-threaded generate_primes().
+///
+void testParallelGenerate()
+{
+  cout << "Generate primes using multiple threads" << endl;
+
+  vector<uint64_t> primes;
+  vector<uint64_t> parallelPrimes(1, 0);
+  primesieve::generate_primes(ipow(10, 12), ipow(10, 12) + ipow(10, 8), &primes);
+  primesieve::parallel_generate_primes(ipow(10, 12), ipow(10, 12) + ipow(10, 8), &parallelPrimes);
+  cout << "Generated primes: " << setw(12) << parallelPrimes.size() - 1;
+  check(equal(primes.begin(), primes.end(), parallelPrimes.begin() + 1) &&
+        primes.size() + 1 == parallelPrimes.size());
+  cout << endl;
+}
+
+/// Counts the 1 bits of the segments, one counter per thread
+/// (no locking), padded to avoid false sharing.
+///
+class SegmentPopcount : public SegmentCallback
+{
+public:
+  SegmentPopcount() :
+    counts_(ParallelPrimeSieve::getMaxThreads() * 8, 0),
+    isValid_(true)
+  { }
+  void callback(const uint8_t* sieve, std::size_t bytes, uint64_t, int thread_num)
+  {
+    if (thread_num < 0 || thread_num * 8 >= static_cast<int>(counts_.size()))
+    {
+      isValid_ = false;
+      return;
+    }
+    uint64_t count = 0;
+    for (std::size_t i = 0; i < bytes; i++)
+      for (uint8_t bits = sieve[i]; bits != 0; bits &= bits - 1)
+        count++;
+    counts_[thread_num * 8] += count;
+  }
+  uint64_t getCount() const
+  {
+    uint64_t sum = 0;
+    for (std::size_t i = 0; i < counts_.size(); i++)
+      sum += counts_[i];
+    return sum;
+  }
+  bool isValid() const { return isValid_; }
+private:
+  vector<uint64_t> counts_;
+  bool isValid_;
+};
+
+/// The 1 bits of the segment bitmaps must match pi(10^9),
+/// the primes 2, 3 and 5 are not part of the bitmaps.
+///
+void testSegments()
+{
+  cout << "Callback the segment bitmaps" << endl;
+
+  ParallelPrimeSieve pps;
+  pps.setNumThreads(get_num_threads());
+  SegmentPopcount popcount;
+  pps.callbackSegments(0, ipow(10, 9), &popcount);
+  cout << "Bitmap popcount: " << setw(13) << popcount.getCount();
+  check(popcount.getCount() == primeCounts[8] - 3 && popcount.isValid());
+  cout << endl;
+}
+
+/// Collecting stats must not change the results
+void testStats()
+{
+  cout << "Collect per stage timings and counters" << endl;
+
+  ParallelPrimeSieve pps;
+  pps.setNumThreads(get_num_threads());
+  pps.setStats(true);
+  pps.sieve(0, ipow(10, 9), pps.COUNT_PRIMES);
+  const SieveStats& stats = pps.getStats();
+  double seconds = 0;
+  for (int i = 0; i < SieveStats::STAGES; i++)
+    seconds += stats.seconds[i];
+  cout << "Prime count: " << setw(17) << pps.getPrimeCount();
+  check(pps.getPrimeCount() == primeCounts[8] &&
+        stats.segments > 0 &&
+        seconds > 0);
+  cout << endl;
+}
+
+/// Count the primes within [10^12, 10^12+2^32] using each
+/// preset bucket size and various EratSmall/EratMedium limits
+void testEratSettings()
+{
+  const int bucketSizes[4] = { 256, 512, 1024, 2048 };
+  const double factorsSmall[4] = { 0.0, 3.0, 1.0, 0.5 };
+  const double factorsMedium[4] = { 0.0, 9.0, 0.5, 2.5 };
+
+  for (int i = 0; i < 4; i++)
+  {
+    cout << "Sieve using bucket size " << bucketSizes[i]
+         << ", EratSmall factor " << factorsSmall[i]
+         << ", EratMedium factor " << factorsMedium[i] << endl;
+
+    ParallelPrimeSieve pps;
+    pps.setNumThreads(get_num_threads());
+    pps.setBucketSize(bucketSizes[i]);
+    pps.setBucketAllocSize(64 << i);
+    pps.setFactorEratSmall(factorsSmall[i]);
+    pps.setFactorEratMedium(factorsMedium[i]);
+    uint64_t start = ipow(10, 12);
+    pps.sieve(start, start + ipow(2, 32), pps.COUNT_PRIMES);
+    cout << "Prime count: " << setw(17) << pps.getPrimeCount();
+    check(pps.getPrimeCount() == primeCounts[10] &&
+          pps.getBucketSize() == bucketSizes[i]);
+  }
+
+  cout << endl;
+}
+
+/// Sieve using 2 megabyte sieve arrays with and without huge
+/// pages, whether huge pages are obtained depends on the system
+void testHugePages()
+{
+  for (int i = 0; i < 2; i++)
+  {
+    bool hugePages = (i == 0);
+    cout << "Sieve " << (hugePages ? "using" : "without") << " huge pages" << endl;
+
+    ParallelPrimeSieve pps;
+    pps.setNumThreads(get_num_threads());
+    pps.setSieveSize(2048);
+    pps.setHugePages(hugePages);
+    pps.setStats(true);
+    uint64_t start = ipow(10, 12);
+    pps.sieve(start, start + ipow(2, 32), pps.COUNT_PRIMES);
+    uint64_t megabytes = pps.getStats().hugePageBytes >> 20;
+    cout << "Huge pages: " << megabytes << " MB" << endl;
+    cout << "Prime count: " << setw(17) << pps.getPrimeCount();
+    check(pps.getPrimeCount() == primeCounts[10] &&
+          (hugePages || megabytes == 0));
+  }
+
+  cout << endl;
+}
+
+/// Build a pi(x) index up to 2^32 with checkpoints every 2^24 and
+/// compare the indexed prime counts against plain sieving, the
+/// interval bounds are random i.e. mostly between checkpoints.
+///
+void testPiIndex()
+{
+  cout << "Count primes using a pi(x) index" << endl;
+
+  string filename = getTempFile("primesieve_test.pix");
+  uint64_t limit = ipow(2, 32);
+  int log2Step = 24;
+  PiIndex::build(filename, limit, log2Step, get_num_threads(), get_thread_backend());
+  PiIndex::load(filename);
+  std::remove(filename.c_str());
+
+  const PiIndex* piIndex = PiIndex::get();
+  bool isCorrect = piIndex &&
+                   piIndex->getLimit() == limit &&
+                   piIndex->check(get_num_threads(), get_thread_backend()) &&
+                   count_primes(0, limit) == 203280221;
+
+  cout << "pi(2^32) = " << setw(22) << count_primes(0, limit);
+  check(isCorrect);
+
+  ParallelPrimeSieve pps;
+  pps.setNumThreads(get_num_threads());
+  int indexed = 0;
+
+  for (int i = 0; i < 100; i++)
+  {
+    uint64_t start = getRand64(limit);
+    uint64_t stop = start + getRand64(limit - start);
+    // every 10th interval starts and stops at checkpoints
+    if (i % 10 == 0)
+    {
+      start = (start >> log2Step) << log2Step;
+      stop = (stop >> log2Step) << log2Step;
+      start += (start > 0);
+    }
+    if (piIndex->isFaster(start, stop))
+      indexed++;
+    pps.sieve(start, stop, pps.COUNT_PRIMES);
+    isCorrect = isCorrect && count_primes(start, stop) == pps.getPrimeCount();
+  }
+
+  PiIndex::unload();
+  cout << "Random intervals: " << setw(11) << indexed;
+  check(isCorrect && indexed > 0);
+  cout << endl;
+}
+
+/// Store the primes of [0, 10^6] and [10^12, 10^12+10^7] in a
+/// prime file (both formats) and compare the file's iteration,
+/// nthPrime(), countPrimes() and skipto() with the sieved primes.
+///
+void testPrimeFile()
+{
+  const char* names[2] = { "bitmap", "delta" };
+  uint64_t starts[2] = { 0, ipow(10, 12) };
+  uint64_t stops[2] = { ipow(10, 6), ipow(10, 12) + ipow(10, 7) };
+  string filename = getTempFile("primesieve_test.primes");
+
+  for (int format = BITMAP_FORMAT; format <= DELTA_FORMAT; format++)
+  {
+    cout << "Store primes in a prime file using the " << names[format] << " format" << endl;
+
+    for (int r = 0; r < 2; r++)
+    {
+      vector<uint64_t> primes;
+      generate_primes(starts[r], stops[r], &primes);
+      store_primes(starts[r], stops[r], filename, format);
+      PrimeFile file(filename);
+      std::remove(filename.c_str());
+
+      bool isCorrect = file.getFormat() == format &&
+                       file.getPrimeCount() == primes.size();
+
+      // iterate over all primes
+      for (size_t i = 0; i < primes.size(); i++)
+        isCorrect = isCorrect && file.next_prime() == primes[i];
+      isCorrect = isCorrect && file.next_prime() == 0;
+
+      for (int i = 0; i < 100; i++)
+      {
+        uint64_t n = getRand64(primes.size()) + 1;
+        isCorrect = isCorrect && file.nthPrime(n) == primes[n - 1];
+
+        uint64_t a = starts[r] + getRand64(stops[r] - starts[r] + 1);
+        uint64_t b = a + getRand64(stops[r] - a + 1);
+        uint64_t count = upper_bound(primes.begin(), primes.end(), b) -
+                         lower_bound(primes.begin(), primes.end(), a);
+        isCorrect = isCorrect && file.countPrimes(a, b) == count;
+
+        vector<uint64_t>::iterator next = lower_bound(primes.begin(), primes.end(), a);
+        file.skipto(a);
+        isCorrect = isCorrect && file.next_prime() == (next != primes.end() ? *next : 0);
+      }
+
+      cout << "Prime count: " << setw(17) << file.getPrimeCount();
+      check(isCorrect);
+    }
+  }
+
+  cout << endl;
+}
+
+/// Count the prime k-tuplets up to 10^9 and within random
+/// intervals using each k-tuplet counting kernel supported by
+/// the CPU, the random intervals are checked against the
+/// scalar kernel.
+///
+void testKTuplets()
+{
+  const char* names[PrimeFinder::TUPLET_KERNELS] = { "scalar", "avx2" };
+  int flags = PrimeSieve::COUNT_PRIMES | PrimeSieve::COUNT_TWINS |
+              PrimeSieve::COUNT_TRIPLETS | PrimeSieve::COUNT_QUADRUPLETS |
+              PrimeSieve::COUNT_QUINTUPLETS | PrimeSieve::COUNT_SEXTUPLETS;
+  int kernel = PrimeFinder::getTupletKernel();
+  vector<uint64_t> starts;
+  vector<uint64_t> stops;
+  vector<uint64_t> expected;
+
+  for (int i = 0; i < 20; i++)
+  {
+    uint64_t start = getRand64(ipow(10, 12));
+    starts.push_back(start);
+    stops.push_back(start + getRand64(ipow(10, 7)));
+  }
+
+  for (int k = 0; k < PrimeFinder::TUPLET_KERNELS; k++)
+  {
+    if (!PrimeFinder::hasTupletKernel(k))
+      continue;
+
+    cout << "Count prime k-tuplets using the " << names[k] << " kernel" << endl;
+    PrimeFinder::setTupletKernel(k);
+    ParallelPrimeSieve pps;
+    pps.setNumThreads(get_num_threads());
+    pps.sieve(0, ipow(10, 9), flags);
+    bool isCorrect = true;
+    for (int i = 0; i < 6; i++)
+      isCorrect = isCorrect && pps.getCount(i) == kTupletCounts[i];
+
+    cout << "Sextuplets up to 10^9: " << setw(6) << pps.getSextupletCount();
+    check(isCorrect);
+
+    for (size_t j = 0; j < starts.size(); j++)
+    {
+      pps.sieve(starts[j], stops[j], flags);
+      for (int i = 0; i < 6; i++)
+      {
+        if (k == PrimeFinder::TUPLETS_SCALAR)
+          expected.push_back(pps.getCount(i));
+        else
+          isCorrect = isCorrect && pps.getCount(i) == expected[j * 6 + i];
+      }
+    }
+
+    cout << "Random intervals: " << setw(11) << starts.size();
+    check(isCorrect);
+  }
+
+  PrimeFinder::setTupletKernel(kernel);
+  cout << endl;
+}
+
+/// Count the primes up to 10^9 and within random intervals
+/// using each EratSmall pattern kernel supported by the CPU,
+/// the random intervals are checked against the scalar
+/// kernel.
+///
+void testPatternKernels()
+{
+  const char* names[EratSmall::PATTERN_KERNELS] = { "scalar", "avx2", "avx512" };
+  int kernel = EratSmall::getPatternKernel();
+  vector<uint64_t> starts;
+  vector<uint64_t> stops;
+  vector<uint64_t> expected;
+
+  for (int i = 0; i < 20; i++)
+  {
+    uint64_t start = getRand64(ipow(10, 12));
+    starts.push_back(start);
+    stops.push_back(start + getRand64(ipow(10, 8)));
+  }
+
+  for (int k = 0; k < EratSmall::PATTERN_KERNELS; k++)
+  {
+    if (!EratSmall::hasPatternKernel(k))
+      continue;
+
+    cout << "Sieve using the " << names[k] << " EratSmall pattern kernel" << endl;
+    EratSmall::setPatternKernel(k);
+    ParallelPrimeSieve pps;
+    pps.setNumThreads(get_num_threads());
+    pps.sieve(0, ipow(10, 9), pps.COUNT_PRIMES);
+    cout << "Prime count: " << setw(17) << pps.getPrimeCount();
+    check(pps.getPrimeCount() == primeCounts[8]);
+
+    bool isCorrect = true;
+    for (size_t j = 0; j < starts.size(); j++)
+    {
+      pps.sieve(starts[j], stops[j], pps.COUNT_PRIMES | pps.COUNT_TWINS);
+      if (k == EratSmall::PATTERNS_SCALAR)
+      {
+        expected.push_back(pps.getPrimeCount());
+        expected.push_back(pps.getTwinCount());
+      }
+      else
+        isCorrect = isCorrect &&
+                    pps.getPrimeCount() == expected[j * 2] &&
+                    pps.getTwinCount() == expected[j * 2 + 1];
+    }
+
+    cout << "Random intervals: " << setw(11) << starts.size();
+    check(isCorrect);
+  }
+
+  EratSmall::setPatternKernel(kernel);
+  cout << endl;
+}
+
+/// Runs a query needing larger sieving primes from within
+/// the callback of a query using the same SieveContext.
+///
+class NestedQuery : public BatchCallback
+{
+public:
+  NestedQuery(SieveContext& context) :
+    context_(context),
+    count_(0),
+    nestedCount_(0)
+  { }
+  void callback(const uint64_t* primes, std::size_t count, int)
+  {
+    count_ += count;
+    if (nestedCount_ == 0 && primes[count - 1] > ipow(10, 6))
+    {
+      // must not free the tables in use by this query
+      context_.clear();
+      PrimeSieve ps;
+      ps.setContext(&context_);
+      nestedCount_ = ps.countPrimes(ipow(10, 14), ipow(10, 14) + ipow(10, 6));
+    }
+  }
+  uint64_t getCount() const { return count_; }
+  uint64_t getNestedCount() const { return nestedCount_; }
+private:
+  SieveContext& context_;
+  uint64_t count_;
+  uint64_t nestedCount_;
+};
+
+/// Repeated small queries using a SieveContext must give the
+/// same results as without and reuse the cached memory.
+///
+void testSieveContext()
+{
+  cout << "Sieve using a SieveContext" << endl;
+
+  SieveContext context;
+  PrimeSieve ps1;
+  PrimeSieve ps2;
+  ps1.setContext(&context);
+  ps2.setCaching(false);
+  uint64_t start = ipow(10, 12);
+  uint64_t count1 = 0;
+  uint64_t count2 = 0;
+  std::size_t cachedBytes = 0;
+
+  for (int i = 0; i < 2; i++)
+  {
+    for (uint64_t j = 0; j < 100; j++)
+    {
+      uint64_t low = start + j * ipow(10, 6);
+      ps1.sieve(low, low + ipow(10, 6), ps1.COUNT_PRIMES);
+      ps2.sieve(low, low + ipow(10, 6), ps2.COUNT_PRIMES);
+      count1 += ps1.getPrimeCount();
+      count2 += ps2.getPrimeCount();
+    }
+    if (i == 0)
+      cachedBytes = context.getCachedBytes();
+  }
+
+  bool isCached = cachedBytes > 0 &&
+                  cachedBytes == context.getCachedBytes();
+  context.clear();
+  cout << "Prime count: " << setw(17) << count1;
+  check(count1 == count2 && isCached && context.getCachedBytes() == 0);
+
+  PrimeSieve ps3;
+  bool isContext = ps1.getContext() == &context &&
+                   ps2.getContext() == NULL &&
+                   ps3.getContext() == SieveContext::threadContext();
+  cout << "Context: " << setw(21) << (isContext ? "resolved" : "wrong");
+  check(isContext);
+
+  // the thread's context only caches small queries
+  SieveContext* threadContext = SieveContext::threadContext();
+  if (threadContext)
+  {
+    ps3.countPrimes(start, start + ipow(10, 6));
+    ps3.countPrimes(ipow(10, 18), ipow(10, 18) + ipow(10, 6));
+    cachedBytes = threadContext->getCachedBytes();
+    clear_cache();
+    bool isBounded = cachedBytes > 0 &&
+                     cachedBytes <= config::THREAD_CONTEXT_CACHE_SIZE +
+                                    config::THREAD_CONTEXT_MAX_SIEVING_PRIME / NUMBERS_PER_BYTE &&
+                     threadContext->getCachedBytes() == 0;
+    cout << "Thread context: " << setw(14) << cachedBytes;
+    check(isBounded);
+  }
+
+  NestedQuery nested(context);
+  ps1.callbackPrimes(0, ipow(10, 8), &nested);
+  context.clear();
+  cout << "Nested query: " << setw(16) << nested.getNestedCount();
+  check(nested.getCount() == primeCounts[7] &&
+        nested.getNestedCount() == ps2.countPrimes(ipow(10, 14), ipow(10, 14) + ipow(10, 6)));
+  cout << endl;
+}
+
+/// The automatic sieve size is the tuned sieve size of the
+/// largest tuned exponent <= log10(stop).
+///
+void testTuningProfile()
+{
+  cout << "Sieve using a tuning profile" << endl;
+
+  TuningProfile& profile = tuningProfile();
+  TuningProfile saved = profile;
+  profile = TuningProfile();
+  profile.setSieveSize(6, 16);
+  profile.setSieveSize(9, 256);
+  profile.setBucketSize(9, 512);
+  profile.setFactorEratSmall(9, 0.5);
+  profile.setFactorEratMedium(9, 4.0);
+  bool isTuned = get_sieve_size() == 16 &&
+                 profile.getSieveSize(10) == 16 &&
+                 profile.getSieveSize(ipow(10, 8)) == 16 &&
+                 profile.getSieveSize(get_max_stop()) == 256;
+
+  ParallelPrimeSieve pps;
+  pps.setNumThreads(get_num_threads());
+  pps.setSieveSize(AUTO_SIEVE_SIZE);
+  pps.sieve(0, ipow(10, 9), pps.COUNT_PRIMES);
+  int sieveSize = pps.getSieveSize();
+  bool isEratTuned = pps.getBucketSize() == 512 &&
+                     pps.getFactorEratSmall() == 0.5 &&
+                     pps.getFactorEratMedium() == 4.0;
+  profile = saved;
+
+  cout << "Prime count: " << setw(17) << pps.getPrimeCount();
+  check(pps.getPrimeCount() == primeCounts[8] &&
+        sieveSize == 256 &&
+        isTuned &&
+        isEratTuned);
+  cout << endl;
+}
+
 /// Count the primes within [10^i, 10^i+2^32] for i = 12 to 19
 void testBigPrimes()
 {
   ParallelPrimeSieve pps;
-  pps.setSieveSize(get_sieve_size());
+  pps.setSieveSize(get_sieve_size_setting());
   pps.setNumThreads(get_num_threads());
   pps.setFlags(pps.COUNT_PRIMES | pps.PRINT_STATUS);
 
@@ -169,6 +846,20 @@ bool primesieve_test()
   {
     cout << left;
     testPix();
+    testPiLMO();
+    testPiIndex();
+    testStop();
+    testOrdered();
+    testParallelGenerate();
+    testPrimeFile();
+    testSegments();
+    testStats();
+    testTuningProfile();
+    testEratSettings();
+    testHugePages();
+    testSieveContext();
+    testKTuplets();
+    testPatternKernels();
     testBigPrimes();
     testRandomIntervals();
   }